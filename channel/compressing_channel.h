@@ -0,0 +1,20 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <channel/channel.h>
+
+namespace channel {
+
+// Adapter between an upstream data source and a downstream channel that
+// compresses data packets before relaying them, once compression is enabled.
+// Until then, data packets are passed to the downstream channel as is.
+class CompressingChannel : public Channel {
+public:
+  virtual void set_compression(bool enabled) = 0;
+};
+
+} // namespace channel
@@ -0,0 +1,106 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <channel/credit_channel.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace channel {
+
+CreditChannel::CreditChannel(NetworkChannel &channel, std::size_t backlog_size)
+    : channel_(channel), backlog_size_(backlog_size)
+{}
+
+std::error_code CreditChannel::send(const u8 *data, int data_len)
+{
+  if (!credits_) {
+    return channel_.send(data, data_len);
+  }
+
+  std::size_t length = data_len;
+
+  // data can't overtake the backlog
+  if (backlog_used_ == 0 && *credits_ > 0) {
+    std::size_t const sent = std::min<u64>(*credits_, length);
+    if (auto error = channel_.send(data, sent)) {
+      return error;
+    }
+    *credits_ -= sent;
+    data += sent;
+    length -= sent;
+  }
+
+  if (length == 0) {
+    return {};
+  }
+
+  if (length > backlog_size_ - backlog_used_) {
+    return std::make_error_code(std::errc::no_buffer_space);
+  }
+
+  if (backlog_.empty()) {
+    backlog_.resize(backlog_size_);
+  }
+
+  // copy at the end of the ring, wrapping around
+  std::size_t const end = (backlog_begin_ + backlog_used_) % backlog_size_;
+  std::size_t const first = std::min(length, backlog_size_ - end);
+  std::memcpy(backlog_.data() + end, data, first);
+  std::memcpy(backlog_.data(), data + first, length - first);
+  backlog_used_ += length;
+
+  return {};
+}
+
+std::error_code CreditChannel::flush()
+{
+  return channel_.flush();
+}
+
+void CreditChannel::close()
+{
+  reset();
+  channel_.close();
+}
+
+void CreditChannel::connect(Callbacks &callbacks)
+{
+  reset();
+  channel_.connect(callbacks);
+}
+
+std::error_code CreditChannel::grant(std::optional<u64> bytes)
+{
+  credits_ = bytes;
+  return send_backlog(credits_.value_or(std::numeric_limits<u64>::max()));
+}
+
+std::error_code CreditChannel::send_backlog(u64 max_bytes)
+{
+  while (backlog_used_ > 0 && max_bytes > 0) {
+    std::size_t const length = std::min<u64>({backlog_used_, backlog_size_ - backlog_begin_, max_bytes});
+    if (auto error = channel_.send(backlog_.data() + backlog_begin_, length)) {
+      return error;
+    }
+
+    backlog_begin_ = (backlog_begin_ + length) % backlog_size_;
+    backlog_used_ -= length;
+    max_bytes -= length;
+    if (credits_) {
+      *credits_ -= length;
+    }
+  }
+
+  return {};
+}
+
+void CreditChannel::reset()
+{
+  credits_.reset();
+  backlog_begin_ = 0;
+  backlog_used_ = 0;
+}
+
+} // namespace channel
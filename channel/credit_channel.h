@@ -0,0 +1,65 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <channel/network_channel.h>
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace channel {
+
+// Holds back what is sent on a NetworkChannel beyond the credits granted by
+// the server, see `grant()`.
+//
+// Data sent without credits is kept in a ring of |backlog_size| bytes, and
+// sent as credits are granted. A send that doesn't fit in the ring fails with
+// std::errc::no_buffer_space, as if the connection had stalled.
+//
+// Sends are not limited until the first grant, and again after the channel
+// is connected or closed, which also drops the backlog.
+class CreditChannel : public NetworkChannel {
+public:
+  CreditChannel(NetworkChannel &channel, std::size_t backlog_size);
+
+  std::error_code send(const u8 *data, int data_len) override;
+  std::error_code flush() override;
+
+  void close() override;
+  bool is_open() const override { return channel_.is_open(); }
+
+  void connect(Callbacks &callbacks) override;
+  in_addr_t const *connected_address() const override { return channel_.connected_address(); }
+
+  // Allows sending |bytes| bytes until the next grant, or any amount if not
+  // set, starting with the backlog.
+  std::error_code grant(std::optional<u64> bytes);
+
+  // Whether sends are limited by credits.
+  bool limited() const { return credits_.has_value(); }
+
+  // Bytes held back, waiting for credits.
+  std::size_t backlog() const { return backlog_used_; }
+
+private:
+  // Sends up to |max_bytes| bytes from the backlog.
+  std::error_code send_backlog(u64 max_bytes);
+
+  void reset();
+
+  NetworkChannel &channel_;
+
+  std::optional<u64> credits_;
+
+  // allocated on first use
+  std::vector<u8> backlog_;
+  std::size_t const backlog_size_;
+  std::size_t backlog_begin_ = 0;
+  std::size_t backlog_used_ = 0;
+};
+
+} // namespace channel
@@ -0,0 +1,122 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <channel/credit_channel.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <utility>
+
+namespace {
+
+// Keeps what is sent.
+class CapturingChannel : public channel::NetworkChannel {
+public:
+  std::error_code send(const u8 *data, int data_len) override
+  {
+    data_.append(reinterpret_cast<char const *>(data), data_len);
+    return {};
+  }
+
+  bool is_open() const override { return true; }
+
+  void connect(channel::Callbacks &callbacks) override {}
+  in_addr_t const *connected_address() const override { return nullptr; }
+
+  // Returns what was sent since the last call.
+  std::string take() { return std::exchange(data_, {}); }
+
+private:
+  std::string data_;
+};
+
+std::error_code send(channel::Channel &channel, std::string_view data)
+{
+  return channel.send(data);
+}
+
+} // namespace
+
+TEST(CreditChannel, UnlimitedUntilGranted)
+{
+  CapturingChannel capture;
+  channel::CreditChannel channel(capture, 4);
+
+  EXPECT_FALSE(channel.limited());
+  EXPECT_FALSE(send(channel, "0123456789"));
+  EXPECT_EQ(capture.take(), "0123456789");
+}
+
+TEST(CreditChannel, HoldsBackWhatExceedsCredits)
+{
+  CapturingChannel capture;
+  channel::CreditChannel channel(capture, 8);
+
+  EXPECT_FALSE(channel.grant(3));
+  EXPECT_TRUE(channel.limited());
+
+  EXPECT_FALSE(send(channel, "abcde"));
+  EXPECT_EQ(capture.take(), "abc");
+  EXPECT_EQ(channel.backlog(), 2u);
+
+  // later data waits behind the backlog
+  EXPECT_FALSE(send(channel, "fg"));
+  EXPECT_EQ(capture.take(), "");
+
+  EXPECT_FALSE(channel.grant(3));
+  EXPECT_EQ(capture.take(), "def");
+  EXPECT_EQ(channel.backlog(), 1u);
+
+  EXPECT_FALSE(channel.grant(std::nullopt));
+  EXPECT_EQ(capture.take(), "g");
+  EXPECT_EQ(channel.backlog(), 0u);
+  EXPECT_FALSE(channel.limited());
+}
+
+TEST(CreditChannel, BacklogWrapsAround)
+{
+  CapturingChannel capture;
+  channel::CreditChannel channel(capture, 4);
+
+  EXPECT_FALSE(channel.grant(0));
+  EXPECT_FALSE(send(channel, "abc"));
+  EXPECT_FALSE(channel.grant(2));
+  EXPECT_EQ(capture.take(), "ab");
+
+  EXPECT_FALSE(send(channel, "def"));
+  EXPECT_EQ(channel.backlog(), 4u);
+
+  EXPECT_FALSE(channel.grant(10));
+  EXPECT_EQ(capture.take(), "cdef");
+}
+
+TEST(CreditChannel, FailsWhenBacklogIsFull)
+{
+  CapturingChannel capture;
+  channel::CreditChannel channel(capture, 4);
+
+  EXPECT_FALSE(channel.grant(0));
+  EXPECT_FALSE(send(channel, "abc"));
+  EXPECT_EQ(send(channel, "de"), std::make_error_code(std::errc::no_buffer_space));
+
+  // what was accepted is kept
+  EXPECT_EQ(channel.backlog(), 3u);
+}
+
+TEST(CreditChannel, ReconnectDropsLimitAndBacklog)
+{
+  CapturingChannel capture;
+  channel::CreditChannel channel(capture, 4);
+  channel::Callbacks callbacks;
+
+  EXPECT_FALSE(channel.grant(0));
+  EXPECT_FALSE(send(channel, "abc"));
+
+  channel.connect(callbacks);
+  EXPECT_FALSE(channel.limited());
+  EXPECT_EQ(channel.backlog(), 0u);
+
+  EXPECT_FALSE(send(channel, "xyz"));
+  EXPECT_EQ(capture.take(), "xyz");
+}
@@ -0,0 +1,313 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <channel/io_uring_channel.h>
+
+#include <channel/component.h>
+#include <util/error_handling.h>
+#include <util/log.h>
+#include <util/uv_helpers.h>
+
+#include <spdlog/fmt/fmt.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <stdexcept>
+#include <system_error>
+
+#include <sys/socket.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+namespace channel {
+
+namespace {
+
+/* the completion queue is also made large enough for completions with all of
+ * the buffers, so that it doesn't overflow in bursts */
+constexpr u32 ring_entries = 256;
+constexpr u16 buffer_group = 0;
+
+/* data left unconsumed is completed with at least this many bytes at a time */
+constexpr u32 min_completion_size = 512;
+
+void check_kernel_version()
+{
+  struct utsname name;
+  int major = 0;
+  int minor = 0;
+  if (uname(&name) != 0 || sscanf(name.release, "%d.%d", &major, &minor) != 2) {
+    throw std::system_error(ENOSYS, std::generic_category(), "io_uring: could not determine the kernel version");
+  }
+
+  if (major < 6) {
+    throw std::system_error(
+        ENOSYS,
+        std::generic_category(),
+        fmt::format("io_uring: multishot receives need Linux 6.0 or later, running {}", name.release));
+  }
+}
+
+} // namespace
+
+IoUringReceiver::IoUringReceiver(uv_loop_t &loop, u32 buffer_count, u32 buffer_size)
+    : ring_(ring_entries, std::max(4 * ring_entries, 2 * buffer_count)),
+      buffers_(ring_, buffer_group, buffer_count, buffer_size)
+{
+  if (buffer_size > IoUringChannel::rx_buffer_size) {
+    throw std::invalid_argument("IoUringReceiver: buffers can't be larger than IoUringChannel::rx_buffer_size");
+  }
+
+  check_kernel_version();
+
+  poll_ = new uv_poll_t;
+  if (int const error = uv_poll_init(&loop, poll_, ring_.fd())) {
+    delete poll_;
+    throw std::system_error(-error, std::generic_category(), "IoUringReceiver: could not poll the ring");
+  }
+  poll_->data = this;
+  CHECK_UV(uv_poll_start(poll_, UV_READABLE, &poll_cb));
+}
+
+IoUringReceiver::~IoUringReceiver()
+{
+  uv_close(reinterpret_cast<uv_handle_t *>(poll_), [](uv_handle_t *handle) { delete reinterpret_cast<uv_poll_t *>(handle); });
+}
+
+void IoUringReceiver::poll_cb(uv_poll_t *handle, int status, int events)
+{
+  auto *const receiver = reinterpret_cast<IoUringReceiver *>(handle->data);
+
+  if (status < 0) {
+    LOG::error("IoUringReceiver: error polling the ring: {}", uv_strerror(status));
+    return;
+  }
+
+  receiver->process_completions();
+}
+
+void IoUringReceiver::submit()
+{
+  if (!processing_) {
+    ring_.submit();
+  }
+}
+
+void IoUringReceiver::drain()
+{
+  while (receives_in_flight_ > 0) {
+    ring_.submit(1);
+    process_completions();
+  }
+}
+
+void IoUringReceiver::process_completions()
+{
+  processing_ = true;
+
+  ring_.for_each_completion([this](io_uring_cqe const &cqe) {
+    bool const has_buffer = cqe.flags & IORING_CQE_F_BUFFER;
+    u16 const buffer_id = IoUringBufferRing::buffer_id(cqe);
+
+    // only receives have a channel, the completions of cancellations are ignored
+    if (auto *const channel = reinterpret_cast<IoUringChannel *>(cqe.user_data)) {
+      channel->on_receive(cqe, has_buffer ? buffers_.buffer(buffer_id) : nullptr);
+    }
+
+    if (has_buffer) {
+      buffers_.recycle(buffer_id);
+    }
+  });
+
+  processing_ = false;
+  submit();
+}
+
+IoUringChannel::IoUringChannel(IoUringReceiver &receiver) : receiver_(receiver) {}
+
+IoUringChannel::~IoUringChannel()
+{
+  // the receiver would hand completions of a receive in flight to this channel
+  DEBUG_ASSUME(!receiving_);
+
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+void IoUringChannel::open_fd(Callbacks &callbacks, int fd)
+{
+  LOG::trace_in(channel::Component::tcp, "IoUringChannel::{}()", __func__);
+  callbacks_ = &callbacks;
+  fd_ = fd;
+  start_receive();
+}
+
+void IoUringChannel::close_permanently()
+{
+  LOG::trace_in(channel::Component::tcp, "IoUringChannel::{}()", __func__);
+  if (closing_) {
+    return;
+  }
+  closing_ = true;
+
+  if (receiving_) {
+    io_uring_sqe *const sqe = receiver_.ring_.get_sqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = reinterpret_cast<u64>(this);
+    receiver_.submit();
+  }
+
+  // the receive in flight holds its own reference to the socket
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  tx_buffer_.clear();
+}
+
+std::error_code IoUringChannel::send(const u8 *data, int data_len)
+{
+  LOG::trace_in(channel::Component::tcp, "IoUringChannel::{}(len:{})", __func__, data_len);
+  if (fd_ < 0) {
+    return std::make_error_code(std::errc::not_connected);
+  }
+
+  if (tx_buffer_.size() + data_len > tx_buffer_size) {
+    on_error(-ENOBUFS);
+    return std::make_error_code(std::errc::no_buffer_space);
+  }
+
+  tx_buffer_.insert(tx_buffer_.end(), data, data + data_len);
+  return flush_tx();
+}
+
+std::error_code IoUringChannel::flush_tx()
+{
+  while (!tx_buffer_.empty()) {
+    ssize_t const sent = ::send(fd_, tx_buffer_.data(), tx_buffer_.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        // the rest is sent on the next send or receive
+        break;
+      }
+      int const error = errno;
+      on_error(-error);
+      return {error, std::generic_category()};
+    }
+    tx_buffer_.erase(tx_buffer_.begin(), tx_buffer_.begin() + sent);
+  }
+
+  return {};
+}
+
+void IoUringChannel::start_receive()
+{
+  io_uring_sqe *const sqe = receiver_.ring_.get_sqe();
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = fd_;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = receiver_.buffers_.group();
+  sqe->user_data = reinterpret_cast<u64>(this);
+
+  receiving_ = true;
+  ++receiver_.receives_in_flight_;
+}
+
+void IoUringChannel::on_receive(io_uring_cqe const &cqe, u8 const *data)
+{
+  if (!(cqe.flags & IORING_CQE_F_MORE)) {
+    receiving_ = false;
+    --receiver_.receives_in_flight_;
+  }
+
+  if (!closing_ && !tx_buffer_.empty()) {
+    // peers send data often enough for this to retry without polling for
+    // the socket to be writable
+    static_cast<void>(flush_tx());
+  }
+
+  if (!closing_) {
+    if (cqe.res > 0) {
+      if (data) {
+        received(data, cqe.res);
+      } else {
+        on_error(-EINVAL);
+      }
+    } else if (cqe.res == 0) {
+      on_error(UV_EOF);
+    } else if (cqe.res != -ENOBUFS) {
+      on_error(cqe.res);
+    }
+    // on -ENOBUFS all buffers were in use, and the receive is restarted below
+  }
+
+  if (closing_) {
+    if (!receiving_) {
+      // no more completions refer to this channel
+      callbacks_->on_closed();
+    }
+    return;
+  }
+
+  if (!receiving_) {
+    start_receive();
+  }
+}
+
+void IoUringChannel::received(u8 const *data, u32 length)
+{
+  try {
+    while (length > 0 && !closing_) {
+      if (rx_buffer_.empty()) {
+        // hand the data straight from the receiver's buffer
+        u32 const consumed = callbacks_->received_data(data, length);
+        ASSUME(consumed <= length);
+        data += consumed;
+        length -= consumed;
+
+        if (length > 0 && !closing_) {
+          if (length >= rx_buffer_size) {
+            on_error(-EOVERFLOW);
+            return;
+          }
+          rx_buffer_.assign(data, data + length);
+        }
+        return;
+      }
+
+      // complete what was left unconsumed with as little data as needed, so
+      // that the rest can be handed without copying
+      u32 const left = rx_buffer_.size();
+      u32 const size = std::min({length, std::max(left, min_completion_size), rx_buffer_size - left});
+      rx_buffer_.insert(rx_buffer_.end(), data, data + size);
+      data += size;
+      length -= size;
+
+      u32 const consumed = callbacks_->received_data(rx_buffer_.data(), rx_buffer_.size());
+      ASSUME(consumed <= rx_buffer_.size());
+      rx_buffer_.erase(rx_buffer_.begin(), rx_buffer_.begin() + consumed);
+
+      if (rx_buffer_.size() == rx_buffer_size) {
+        on_error(-EOVERFLOW);
+        return;
+      }
+    }
+  } catch (std::exception const &e) {
+    LOG::error("IoUringChannel: error handling received data: '{}'", e.what());
+    on_error(-EPROTO);
+  }
+}
+
+void IoUringChannel::on_error(int error)
+{
+  callbacks_->on_error(error);
+  close_permanently();
+}
+
+} // namespace channel
@@ -0,0 +1,146 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <channel/callbacks.h>
+#include <channel/server_channel.h>
+#include <platform/platform.h>
+#include <util/io_uring.h>
+
+#include <uv.h>
+
+#include <vector>
+
+namespace channel {
+
+class IoUringChannel;
+
+// Receives the data of accepted TCP connections with io_uring, on behalf of
+// the IoUringChannels of a libuv loop's thread.
+//
+// Each connection keeps a multishot receive in flight, which takes buffers
+// from a ring shared by all connections as data arrives, so idle connections
+// hold no buffer. The ring's file descriptor is polled on the loop, and all
+// completions available when it polls readable are processed at once, with
+// the submissions they lead to made in a single system call.
+//
+// Multishot receives need Linux 6.0 or later.
+class IoUringReceiver {
+public:
+  // Sets up the ring with |buffer_count| buffers of |buffer_size| bytes, and
+  // starts polling it on |loop|.
+  //
+  // Throws std::system_error if io_uring can't be used.
+  IoUringReceiver(uv_loop_t &loop, u32 buffer_count, u32 buffer_size);
+  ~IoUringReceiver();
+
+  IoUringReceiver(IoUringReceiver const &) = delete;
+  IoUringReceiver &operator=(IoUringReceiver const &) = delete;
+
+  // Submits the queued operations, unless completions are being processed,
+  // in which case they are submitted once all of them are.
+  void submit();
+
+  // Processes completions until all the receives of closed channels are done
+  // and their Callbacks::on_closed have been called. Meant for shutting down,
+  // after calling IoUringChannel::close_permanently on all channels.
+  void drain();
+
+  // Number of receives in flight.
+  u64 receives_in_flight() const { return receives_in_flight_; }
+
+private:
+  friend class IoUringChannel;
+
+  static void poll_cb(uv_poll_t *handle, int status, int events);
+
+  void process_completions();
+
+  IoUring ring_;
+  IoUringBufferRing buffers_;
+
+  /* freed once closed, which can be after the receiver is destroyed */
+  uv_poll_t *poll_;
+
+  bool processing_ = false;
+  u64 receives_in_flight_ = 0;
+};
+
+// A server-side TCP connection read through an IoUringReceiver.
+//
+// Data is handed to Callbacks::received_data straight from the receiver's
+// buffers. Only what the callbacks leave unconsumed is copied, to be handed
+// again with the data that follows, up to rx_buffer_size bytes.
+//
+// Errors for on_error callback:
+//   UV_EOF: the peer closed the connection
+//   -EPROTO: handler threw exception
+//   -EOVERFLOW: unconsumed data fills rx_buffer_size bytes
+//   -ENOBUFS: data waiting to be sent would exceed tx_buffer_size bytes
+//   negated errno values of failed receives and sends
+// The channel closes itself after an error.
+class IoUringChannel : public ServerChannel {
+public:
+  static constexpr u32 rx_buffer_size = (64 * 1024);
+  static constexpr u32 tx_buffer_size = (64 * 1024);
+
+  explicit IoUringChannel(IoUringReceiver &receiver);
+  ~IoUringChannel() override;
+
+  IoUringChannel(IoUringChannel const &) = delete;
+  IoUringChannel &operator=(IoUringChannel const &) = delete;
+
+  // Starts receiving on the connected socket |fd|, which the channel takes
+  // ownership of. The receive is submitted with the next
+  // IoUringReceiver::submit().
+  void open_fd(Callbacks &callbacks, int fd);
+
+  // Closes the socket and cancels the receive in flight. Callbacks::on_closed
+  // is called once the receive completes.
+  void close_permanently() override;
+
+  // Sends |data| without blocking. Meant for the few bytes a server sends
+  // back now and then: what doesn't fit in the socket's send buffer is kept,
+  // up to tx_buffer_size bytes, and sent on the next send or receive.
+  std::error_code send(const u8 *data, int data_len) override;
+
+  bool is_open() const { return fd_ >= 0; }
+
+  // Number of bytes waiting to be sent.
+  std::size_t tx_pending() const { return tx_buffer_.size(); }
+
+private:
+  friend class IoUringReceiver;
+
+  // Queues a multishot receive.
+  void start_receive();
+
+  // Handles a completion of the receive, with the data it received if any.
+  // The channel may be destroyed by the time this returns.
+  void on_receive(io_uring_cqe const &cqe, u8 const *data);
+
+  // Hands |data| to the callbacks, along with what was left unconsumed.
+  void received(u8 const *data, u32 length);
+
+  // Sends as much of tx_buffer_ as the socket takes without blocking.
+  std::error_code flush_tx();
+
+  void on_error(int error);
+
+  IoUringReceiver &receiver_;
+  Callbacks *callbacks_ = nullptr;
+
+  int fd_ = -1;
+  bool receiving_ = false;
+  bool closing_ = false;
+
+  /* data left unconsumed by the callbacks */
+  std::vector<u8> rx_buffer_;
+  /* data that didn't fit in the socket's send buffer */
+  std::vector<u8> tx_buffer_;
+};
+
+} // namespace channel
@@ -0,0 +1,342 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+// Compares the two ways ingest workers can read collector connections: libuv with a TCPChannel per connection, and
+// io_uring with IoUringChannels sharing the buffers of an IoUringReceiver. Synthetic collectors send length-prefixed
+// messages over loopback TCP from another thread, in writes of WRITE_BUFFER_SIZE bytes like collectors' buffered
+// writers, and the receiving loop consumes whole messages only. Only some of the connections send, the others stay idle
+// as connections mostly do between collectors' reports.
+//
+// Reported: throughput, CPU time of the receiving thread per GB received, and memory set aside for received data.
+//
+// Usage: io_uring_channel_bench [--connections n] [--active n] [--megabytes n]
+
+#include <channel/callbacks.h>
+#include <channel/io_uring_channel.h>
+#include <channel/tcp_channel.h>
+#include <collector/constants.h>
+#include <util/stop_watch.h>
+
+#include <uv.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+/* what ingest workers use */
+constexpr u32 io_uring_buffer_count = 1024;
+constexpr u32 io_uring_buffer_size = 16 * 1024;
+
+/* messages are cycled through by every connection */
+constexpr std::size_t stream_size = 256 * 1024;
+
+// Messages of varying sizes, each prefixed with its u16 length, which together
+// end on a message boundary.
+std::string make_stream()
+{
+  std::mt19937 random(42);
+  std::uniform_int_distribution<u16> size(8, 400);
+
+  std::string stream;
+  while (stream.size() < stream_size) {
+    u16 const length = size(random);
+    stream.append(reinterpret_cast<char const *>(&length), sizeof(length));
+    for (u16 i = 0; i < length; ++i) {
+      stream.push_back(static_cast<char>(random()));
+    }
+  }
+  return stream;
+}
+
+// Consumes whole messages, reading all of their bytes.
+class MessageCallbacks : public channel::Callbacks {
+public:
+  MessageCallbacks(u64 &consumed, u64 &closed) : consumed_(consumed), closed_(closed) {}
+
+  u32 received_data(u8 const *data, int length) override
+  {
+    u32 offset = 0;
+    while (length - offset >= sizeof(u16)) {
+      u16 size;
+      memcpy(&size, data + offset, sizeof(size));
+      if (length - offset - sizeof(u16) < size) {
+        break;
+      }
+      for (u16 i = 0; i < size; ++i) {
+        checksum_ += data[offset + sizeof(u16) + i];
+      }
+      offset += sizeof(u16) + size;
+    }
+    consumed_ += offset;
+    return offset;
+  }
+
+  void on_error(int error) override
+  {
+    if (error != UV_EOF) {
+      std::cerr << "receive error: " << error << std::endl;
+      std::exit(1);
+    }
+  }
+
+  void on_closed() override { ++closed_; }
+
+private:
+  u64 &consumed_;
+  u64 &closed_;
+  u64 checksum_ = 0;
+};
+
+struct Connections {
+  std::vector<int> clients;
+  std::vector<int> servers;
+};
+
+Connections connect_loopback(std::size_t count)
+{
+  auto const check = [](int result, char const *what) {
+    if (result < 0) {
+      throw std::system_error(errno, std::generic_category(), what);
+    }
+    return result;
+  };
+
+  int const listener = check(socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0), "socket");
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addr_len = sizeof(addr);
+  check(bind(listener, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)), "bind");
+  check(listen(listener, SOMAXCONN), "listen");
+  check(getsockname(listener, reinterpret_cast<struct sockaddr *>(&addr), &addr_len), "getsockname");
+
+  Connections connections;
+  for (std::size_t i = 0; i < count; ++i) {
+    int const client = check(socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0), "socket");
+    check(connect(client, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)), "connect");
+    int const nodelay = 1;
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    connections.clients.push_back(client);
+    connections.servers.push_back(check(accept4(listener, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK), "accept"));
+  }
+
+  close(listener);
+  return connections;
+}
+
+// Sends |rounds| times the stream on each of the first |active| clients, a
+// write of WRITE_BUFFER_SIZE bytes at a time on each client in turn.
+void send_streams(std::vector<int> const &clients, std::size_t active, std::size_t rounds, std::string const &stream)
+{
+  std::vector<std::size_t> offsets(active, 0);
+  std::size_t const total = rounds * stream.size();
+
+  for (std::size_t sent = 0; sent < total;) {
+    std::size_t const size = std::min<std::size_t>(WRITE_BUFFER_SIZE, total - sent);
+    for (std::size_t i = 0; i < active; ++i) {
+      for (std::size_t done = 0; done < size;) {
+        std::size_t const offset = (offsets[i] + done) % stream.size();
+        std::size_t const length = std::min(size - done, stream.size() - offset);
+        ssize_t const written = write(clients[i], stream.data() + offset, length);
+        if (written < 0) {
+          std::cerr << "send error: " << strerror(errno) << std::endl;
+          std::exit(1);
+        }
+        done += written;
+      }
+      offsets[i] += size;
+    }
+    sent += size;
+  }
+}
+
+double thread_cpu_seconds()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_THREAD, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+struct Backend {
+  char const *name;
+
+  // Opens a channel reading |fd| with |callbacks|.
+  std::function<void(int fd, channel::Callbacks &callbacks)> open;
+
+  // Submits what the channels just opened need.
+  std::function<void()> start;
+
+  // Closes all channels.
+  std::function<void()> close;
+
+  // Memory set aside for received data.
+  std::function<std::size_t()> buffer_memory;
+};
+
+void run(
+    uv_loop_t &loop,
+    Backend const &backend,
+    std::size_t connection_count,
+    std::size_t active,
+    std::size_t rounds,
+    std::string const &stream)
+{
+  auto connections = connect_loopback(connection_count);
+
+  u64 consumed = 0;
+  u64 closed = 0;
+  std::vector<std::unique_ptr<MessageCallbacks>> callbacks;
+  for (int fd : connections.servers) {
+    callbacks.push_back(std::make_unique<MessageCallbacks>(consumed, closed));
+    backend.open(fd, *callbacks.back());
+  }
+  backend.start();
+
+  u64 const expected = static_cast<u64>(active) * rounds * stream.size();
+
+  StopWatch<> watch;
+  double const cpu_start = thread_cpu_seconds();
+
+  std::thread sender(send_streams, std::cref(connections.clients), active, rounds, std::cref(stream));
+  while (consumed < expected) {
+    uv_run(&loop, UV_RUN_ONCE);
+  }
+  sender.join();
+
+  double const cpu = thread_cpu_seconds() - cpu_start;
+  double const seconds = watch.elapsed_ns() / 1e9;
+  double const gigabytes = expected / 1e9;
+
+  std::cout << std::left << std::setw(10) << backend.name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(10) << expected / 1e6 / seconds << " MB/s" << std::setprecision(3) << std::setw(10)
+            << cpu / gigabytes << " CPU s/GB" << std::setprecision(1) << std::setw(10)
+            << backend.buffer_memory() / (1024.0 * 1024.0) << " MiB buffers" << std::endl;
+
+  backend.close();
+  while (closed < connection_count) {
+    uv_run(&loop, UV_RUN_ONCE);
+  }
+  for (int fd : connections.clients) {
+    close(fd);
+  }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  std::size_t connection_count = 1000;
+  std::size_t active = 100;
+  std::size_t megabytes = 1024;
+
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--connections") && i + 1 < argc) {
+      connection_count = std::atoll(argv[++i]);
+    } else if (!strcmp(argv[i], "--active") && i + 1 < argc) {
+      active = std::atoll(argv[++i]);
+    } else if (!strcmp(argv[i], "--megabytes") && i + 1 < argc) {
+      megabytes = std::atoll(argv[++i]);
+    } else {
+      std::cerr << "usage: " << argv[0] << " [--connections n] [--active n] [--megabytes n]" << std::endl;
+      return 1;
+    }
+  }
+  active = std::min(active, connection_count);
+  if (active == 0) {
+    std::cerr << "at least one connection must be active" << std::endl;
+    return 1;
+  }
+
+  // each connection takes two file descriptors
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+
+  auto const stream = make_stream();
+  std::size_t const rounds = std::max<std::size_t>(1, megabytes * 1024 * 1024 / active / stream.size());
+
+  std::cout << connection_count << " connections, " << active << " sending " << rounds * stream.size() << " bytes each"
+            << std::endl;
+
+  uv_loop_t loop;
+  uv_loop_init(&loop);
+
+  {
+    std::vector<std::unique_ptr<channel::TCPChannel>> channels;
+    run(loop,
+        Backend{
+            .name = "libuv",
+            .open =
+                [&](int fd, channel::Callbacks &callbacks) {
+                  channels.push_back(std::make_unique<channel::TCPChannel>(loop));
+                  channels.back()->open_fd(callbacks, fd);
+                },
+            .start = [] {},
+            .close =
+                [&] {
+                  for (auto &channel : channels) {
+                    channel->close_permanently();
+                  }
+                },
+            .buffer_memory = [&] { return channels.size() * channel::TCPChannel::rx_buffer_size; },
+        },
+        connection_count,
+        active,
+        rounds,
+        stream);
+  }
+
+  try {
+    channel::IoUringReceiver receiver(loop, io_uring_buffer_count, io_uring_buffer_size);
+    std::vector<std::unique_ptr<channel::IoUringChannel>> channels;
+    run(loop,
+        Backend{
+            .name = "io_uring",
+            .open =
+                [&](int fd, channel::Callbacks &callbacks) {
+                  channels.push_back(std::make_unique<channel::IoUringChannel>(receiver));
+                  channels.back()->open_fd(callbacks, fd);
+                },
+            .start = [&] { receiver.submit(); },
+            .close =
+                [&] {
+                  for (auto &channel : channels) {
+                    channel->close_permanently();
+                  }
+                  receiver.drain();
+                },
+            .buffer_memory = [&] { return std::size_t{io_uring_buffer_count} * io_uring_buffer_size; },
+        },
+        connection_count,
+        active,
+        rounds,
+        stream);
+  } catch (std::system_error const &e) {
+    std::cout << "io_uring is not available: " << e.what() << std::endl;
+  }
+
+  uv_run(&loop, UV_RUN_NOWAIT);
+  uv_loop_close(&loop);
+
+  return 0;
+}
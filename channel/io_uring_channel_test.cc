@@ -0,0 +1,278 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <channel/io_uring_channel.h>
+
+#include <util/stop_watch.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+static constexpr u32 buffer_count = 8;
+static constexpr u32 buffer_size = 4096;
+
+// Consumes messages made of a u32 length followed by that many bytes, and
+// leaves incomplete ones unconsumed.
+class MessageCallbacks : public channel::Callbacks {
+public:
+  u32 received_data(u8 const *data, int length) override
+  {
+    u32 consumed = 0;
+    while (length - consumed >= sizeof(u32)) {
+      u32 size;
+      memcpy(&size, data + consumed, sizeof(size));
+      if (length - consumed - sizeof(u32) < size) {
+        break;
+      }
+      messages.emplace_back(reinterpret_cast<char const *>(data + consumed + sizeof(u32)), size);
+      consumed += sizeof(u32) + size;
+    }
+    return consumed;
+  }
+
+  void on_error(int error) override { errors.push_back(error); }
+
+  void on_closed() override
+  {
+    closed = true;
+    if (on_closed_cb) {
+      on_closed_cb();
+    }
+  }
+
+  std::vector<std::string> messages;
+  std::vector<int> errors;
+  bool closed = false;
+  std::function<void()> on_closed_cb;
+};
+
+std::string make_message(std::string const &payload)
+{
+  u32 const size = payload.size();
+  return std::string(reinterpret_cast<char const *>(&size), sizeof(size)) + payload;
+}
+
+class IoUringChannelTest : public ::testing::Test {
+protected:
+  void SetUp() override
+  {
+    ASSERT_EQ(uv_loop_init(&loop_), 0);
+    try {
+      receiver_.emplace(loop_, buffer_count, buffer_size);
+    } catch (std::system_error const &e) {
+      GTEST_SKIP() << "io_uring is not available: " << e.what();
+    }
+  }
+
+  void TearDown() override
+  {
+    receiver_.reset();
+    uv_run(&loop_, UV_RUN_NOWAIT);
+    uv_loop_close(&loop_);
+  }
+
+  // Connects a new channel to a socket, whose other end is returned.
+  int open(channel::IoUringChannel &channel, channel::Callbacks &callbacks)
+  {
+    int fds[2];
+    EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds), 0);
+    channel.open_fd(callbacks, fds[0]);
+    receiver_->submit();
+    return fds[1];
+  }
+
+  // Runs the loop until |done| or a timeout.
+  void run_until(std::function<bool()> const &done)
+  {
+    StopWatch<> watch;
+    while (!done() && !watch.elapsed(std::chrono::seconds(5))) {
+      uv_run(&loop_, UV_RUN_NOWAIT);
+    }
+  }
+
+  uv_loop_t loop_;
+  std::optional<channel::IoUringReceiver> receiver_;
+};
+
+} // namespace
+
+TEST_F(IoUringChannelTest, ReceivesMessagesAcrossBuffers)
+{
+  MessageCallbacks callbacks;
+  auto channel = std::make_unique<channel::IoUringChannel>(*receiver_);
+  int const peer = open(*channel, callbacks);
+
+  // messages span buffers, and more is sent than the buffers can hold at once
+  std::vector<std::string> expected;
+  std::string data;
+  for (u32 i = 0; i < 2000; ++i) {
+    expected.push_back(std::string(i % 300, 'a' + i % 26));
+    data += make_message(expected.back());
+  }
+  ASSERT_GT(data.size(), buffer_count * buffer_size);
+
+  for (std::size_t offset = 0; offset < data.size();) {
+    ssize_t const written = write(peer, data.data() + offset, std::min<std::size_t>(data.size() - offset, 10000));
+    ASSERT_GT(written, 0);
+    offset += written;
+    uv_run(&loop_, UV_RUN_NOWAIT);
+  }
+
+  run_until([&] { return callbacks.messages.size() == expected.size(); });
+  EXPECT_EQ(callbacks.messages, expected);
+  EXPECT_TRUE(callbacks.errors.empty());
+  EXPECT_EQ(receiver_->receives_in_flight(), 1u);
+
+  channel->close_permanently();
+  run_until([&] { return callbacks.closed; });
+  EXPECT_TRUE(callbacks.closed);
+  EXPECT_EQ(receiver_->receives_in_flight(), 0u);
+  close(peer);
+}
+
+TEST_F(IoUringChannelTest, EofClosesChannel)
+{
+  MessageCallbacks callbacks;
+  auto channel = std::make_unique<channel::IoUringChannel>(*receiver_);
+  callbacks.on_closed_cb = [&] { channel.reset(); };
+  int const peer = open(*channel, callbacks);
+
+  auto const message = make_message("last words");
+  ASSERT_EQ(write(peer, message.data(), message.size()), static_cast<ssize_t>(message.size()));
+  close(peer);
+
+  run_until([&] { return callbacks.closed; });
+  EXPECT_EQ(callbacks.messages, std::vector<std::string>{"last words"});
+  EXPECT_EQ(callbacks.errors, std::vector<int>{UV_EOF});
+  EXPECT_EQ(channel, nullptr);
+  EXPECT_EQ(receiver_->receives_in_flight(), 0u);
+}
+
+TEST_F(IoUringChannelTest, SendsToPeer)
+{
+  MessageCallbacks callbacks;
+  auto channel = std::make_unique<channel::IoUringChannel>(*receiver_);
+  int const peer = open(*channel, callbacks);
+
+  std::string const command = "8 bytes!";
+  EXPECT_FALSE(channel->send(reinterpret_cast<u8 const *>(command.data()), command.size()));
+
+  char buf[16];
+  ASSERT_EQ(read(peer, buf, sizeof(buf)), static_cast<ssize_t>(command.size()));
+  EXPECT_EQ(std::string(buf, command.size()), command);
+
+  channel->close_permanently();
+  run_until([&] { return callbacks.closed; });
+
+  // a closed channel doesn't send
+  EXPECT_TRUE(channel->send(reinterpret_cast<u8 const *>(command.data()), command.size()));
+  close(peer);
+}
+
+TEST_F(IoUringChannelTest, KeepsWhatDoesNotFitUntilNextReceive)
+{
+  MessageCallbacks callbacks;
+  auto channel = std::make_unique<channel::IoUringChannel>(*receiver_);
+  int const peer = open(*channel, callbacks);
+
+  // send numbered commands until the socket's send buffer is full
+  u64 count = 0;
+  while (channel->tx_pending() == 0) {
+    ASSERT_FALSE(channel->send(reinterpret_cast<u8 const *>(&count), sizeof(count)));
+    ++count;
+  }
+  EXPECT_TRUE(channel->is_open());
+  EXPECT_TRUE(callbacks.errors.empty());
+
+  // the rest is sent once the peer reads and data is received from it
+  std::string received;
+  auto read_available = [&] {
+    char buf[4096];
+    for (ssize_t n; (n = recv(peer, buf, sizeof(buf), MSG_DONTWAIT)) > 0;) {
+      received.append(buf, n);
+    }
+  };
+  read_available();
+
+  auto const message = make_message("nudge");
+  ASSERT_EQ(write(peer, message.data(), message.size()), static_cast<ssize_t>(message.size()));
+  run_until([&] { return channel->tx_pending() == 0; });
+  read_available();
+
+  ASSERT_EQ(received.size(), count * sizeof(u64));
+  for (u64 i = 0; i < count; ++i) {
+    u64 value;
+    memcpy(&value, received.data() + i * sizeof(u64), sizeof(value));
+    ASSERT_EQ(value, i);
+  }
+  EXPECT_TRUE(callbacks.errors.empty());
+
+  channel->close_permanently();
+  run_until([&] { return callbacks.closed; });
+  close(peer);
+}
+
+TEST_F(IoUringChannelTest, OverflowClosesChannel)
+{
+  // never consumes anything
+  class StuckCallbacks : public MessageCallbacks {
+    u32 received_data(u8 const *, int) override { return 0; }
+  } callbacks;
+
+  auto channel = std::make_unique<channel::IoUringChannel>(*receiver_);
+  int const peer = open(*channel, callbacks);
+
+  std::string const data(channel::IoUringChannel::rx_buffer_size + buffer_size, 'x');
+  for (std::size_t offset = 0; offset < data.size() && !callbacks.closed;) {
+    ssize_t const written = send(peer, data.data() + offset, data.size() - offset, MSG_DONTWAIT);
+    if (written > 0) {
+      offset += written;
+    }
+    uv_run(&loop_, UV_RUN_NOWAIT);
+  }
+
+  run_until([&] { return callbacks.closed; });
+  EXPECT_EQ(callbacks.errors, std::vector<int>{-EOVERFLOW});
+  close(peer);
+}
+
+TEST_F(IoUringChannelTest, DrainClosesAllChannels)
+{
+  std::vector<std::unique_ptr<MessageCallbacks>> callbacks;
+  std::vector<std::unique_ptr<channel::IoUringChannel>> channels;
+  std::vector<int> peers;
+  for (int i = 0; i < 10; ++i) {
+    callbacks.push_back(std::make_unique<MessageCallbacks>());
+    channels.push_back(std::make_unique<channel::IoUringChannel>(*receiver_));
+    peers.push_back(open(*channels.back(), *callbacks.back()));
+  }
+  uv_run(&loop_, UV_RUN_NOWAIT);
+  EXPECT_EQ(receiver_->receives_in_flight(), 10u);
+
+  for (auto &channel : channels) {
+    channel->close_permanently();
+  }
+  receiver_->drain();
+
+  EXPECT_EQ(receiver_->receives_in_flight(), 0u);
+  for (auto const &callback : callbacks) {
+    EXPECT_TRUE(callback->closed);
+    EXPECT_TRUE(callback->errors.empty());
+  }
+  for (int peer : peers) {
+    close(peer);
+  }
+}
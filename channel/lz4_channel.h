@@ -5,7 +5,7 @@
 
 #pragma once
 
-#include <channel/channel.h>
+#include <channel/compressing_channel.h>
 #include <platform/types.h>
 #include <util/raii.h>
 
@@ -23,7 +23,7 @@ namespace channel {
 //
 // When the compression is enabled, the Lz4Channel will compress the incoming
 // data packets before relay then.
-class Lz4Channel : public Channel {
+class Lz4Channel : public CompressingChannel {
 public:
   // |channel|: the downstream channel which will actually send out the data.
   // |max_data_length|: max number of bytes of any incoming data packet sent
@@ -33,7 +33,7 @@ public:
 
   std::error_code send(const u8 *data, int data_len) override;
 
-  void set_compression(bool enabled);
+  void set_compression(bool enabled) override;
 
   void close() override;
   std::error_code flush() override;
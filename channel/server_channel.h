@@ -0,0 +1,29 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <platform/types.h>
+
+#include <system_error>
+
+namespace channel {
+
+// A connection accepted by a server, which hands the data it receives to its
+// Callbacks.
+class ServerChannel {
+public:
+  virtual ~ServerChannel() {}
+
+  // Sends |data| back to the peer. On failure Callbacks::on_error is called
+  // as well.
+  virtual std::error_code send(const u8 *data, int data_len) = 0;
+
+  // Closes the connection for good. Callbacks::on_closed will be called once
+  // the channel is no longer in use, at which point it can be destroyed.
+  virtual void close_permanently() = 0;
+};
+
+} // namespace channel
@@ -7,6 +7,7 @@
 
 #include <channel/callbacks.h>
 #include <channel/network_channel.h>
+#include <channel/server_channel.h>
 #include <platform/platform.h>
 
 #include <uv.h>
@@ -28,7 +29,7 @@ struct buffer_t {
  *     handled by handler
  *   libuv errors.
  */
-class TCPChannel : public NetworkChannel {
+class TCPChannel : public NetworkChannel, public ServerChannel {
 public:
   static constexpr u32 rx_buffer_size = (64 * 1024);
 
@@ -82,7 +83,7 @@ public:
   /**
    * Closes the channel, and does not try to reinitilize.
    */
-  void close_permanently();
+  void close_permanently() override;
 
   /**
    * @see Channel::send
@@ -4,17 +4,35 @@
 #include <channel/upstream_connection.h>
 
 #include <channel/component.h>
+#include <channel/lz4_channel.h>
 #include <util/log.h>
 
 namespace channel {
 
+namespace {
+
+std::unique_ptr<CompressingChannel>
+make_compressing_channel(Channel &channel, std::size_t buffer_size, std::optional<ZstdChannel::Options> const &zstd)
+{
+  if (zstd) {
+    return std::make_unique<ZstdChannel>(channel, buffer_size, *zstd);
+  }
+  return std::make_unique<Lz4Channel>(channel, buffer_size);
+}
+
+} // namespace
+
 UpstreamConnection::UpstreamConnection(
-    std::size_t buffer_size, bool allow_compression, NetworkChannel &primary_channel, Channel *secondary_channel)
+    std::size_t buffer_size,
+    bool allow_compression,
+    NetworkChannel &primary_channel,
+    Channel *secondary_channel,
+    std::optional<ZstdChannel::Options> const &zstd)
     : primary_channel_(primary_channel),
-      lz4_channel_(primary_channel_, buffer_size),
+      compressing_channel_(make_compressing_channel(primary_channel_, buffer_size, zstd)),
       allow_compression_(allow_compression),
-      double_write_channel_(lz4_channel_, secondary_channel ? *secondary_channel : lz4_channel_),
-      buffered_writer_(secondary_channel ? static_cast<Channel &>(double_write_channel_) : lz4_channel_, buffer_size)
+      double_write_channel_(*compressing_channel_, secondary_channel ? *secondary_channel : *compressing_channel_),
+      buffered_writer_(secondary_channel ? static_cast<Channel &>(double_write_channel_) : *compressing_channel_, buffer_size)
 {}
 
 void UpstreamConnection::connect(Callbacks &callbacks)
@@ -51,11 +69,11 @@ void UpstreamConnection::set_compression(bool enabled)
 
   LOG::trace_in(
       Component::upstream,
-      "UpstreamConnection: {} ({}allowed) LZ4 compression",
+      "UpstreamConnection: {} ({}allowed) compression",
       enabled ? "enabling" : "disabling",
       allow_compression_ ? "" : "not ");
 
-  lz4_channel_.set_compression(enabled && allow_compression_);
+  compressing_channel_->set_compression(enabled && allow_compression_);
 }
 
 BufferedWriter &UpstreamConnection::buffered_writer()
@@ -8,16 +8,25 @@
 #include <channel/buffered_writer.h>
 #include <channel/callbacks.h>
 #include <channel/double_write_channel.h>
-#include <channel/lz4_channel.h>
+#include <channel/compressing_channel.h>
 #include <channel/network_channel.h>
+#include <channel/zstd_channel.h>
 #include <platform/platform.h>
 
+#include <memory>
+#include <optional>
+
 namespace channel {
 
 class UpstreamConnection : public NetworkChannel {
 public:
+  // Data is compressed with LZ4, unless |zstd| options are given.
   UpstreamConnection(
-      std::size_t buffer_size, bool allow_compression, NetworkChannel &primary_channel, Channel *secondary_channel = nullptr);
+      std::size_t buffer_size,
+      bool allow_compression,
+      NetworkChannel &primary_channel,
+      Channel *secondary_channel = nullptr,
+      std::optional<ZstdChannel::Options> const &zstd = std::nullopt);
 
   /**
    * Connects to an endpoint and starts negotiating
@@ -52,7 +61,7 @@ public:
 
 private:
   NetworkChannel &primary_channel_;
-  Lz4Channel lz4_channel_;
+  std::unique_ptr<CompressingChannel> compressing_channel_;
   bool allow_compression_;
   DoubleWriteChannel double_write_channel_;
   BufferedWriter buffered_writer_;
@@ -0,0 +1,85 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <channel/zstd_channel.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace channel {
+
+namespace {
+
+void check_zstd_error(size_t code)
+{
+  if (ZSTD_isError(code)) {
+    throw std::runtime_error(std::string("ZstdChannel: compression failed: ") + ZSTD_getErrorName(code));
+  }
+}
+
+} // namespace
+
+ZstdChannel::ZstdChannel(Channel &channel, u32 max_data_length, Options const &options)
+    : channel_(channel), buffer_(ZSTD_compressBound(max_data_length) + ZSTD_CStreamOutSize())
+{
+  zstd_ctx_.reset(ZSTD_createCCtx());
+  if (!zstd_ctx_) {
+    throw std::runtime_error("ZstdChannel: Failed to create Zstandard context.");
+  }
+
+  check_zstd_error(ZSTD_CCtx_setParameter(zstd_ctx_.get(), ZSTD_c_compressionLevel, options.level));
+  check_zstd_error(ZSTD_CCtx_setParameter(zstd_ctx_.get(), ZSTD_c_windowLog, options.window_log));
+  if (!options.dictionary.empty()) {
+    check_zstd_error(ZSTD_CCtx_loadDictionary(zstd_ctx_.get(), options.dictionary.data(), options.dictionary.size()));
+  }
+}
+
+void ZstdChannel::set_compression(bool enabled)
+{
+  if (enabled && !compression_enabled_) {
+    // the reducer starts decompressing after the uncompressed first message,
+    // so each connection needs a frame of its own
+    check_zstd_error(ZSTD_CCtx_reset(zstd_ctx_.get(), ZSTD_reset_session_only));
+  }
+
+  compression_enabled_ = enabled;
+}
+
+std::error_code ZstdChannel::send(const u8 *data, int data_len)
+{
+  if (!compression_enabled_) {
+    return channel_.send(data, data_len);
+  }
+
+  ZSTD_inBuffer input = {.src = data, .size = static_cast<size_t>(data_len), .pos = 0};
+
+  for (;;) {
+    ZSTD_outBuffer output = {.dst = buffer_.data(), .size = buffer_.size(), .pos = 0};
+
+    // flushing makes all of |data| available to the reducer, without ending the frame
+    size_t const remaining = ZSTD_compressStream2(zstd_ctx_.get(), &output, &input, ZSTD_e_flush);
+    check_zstd_error(remaining);
+
+    if (output.pos > 0) {
+      if (auto const error = channel_.send(buffer_.data(), output.pos)) {
+        return error;
+      }
+    }
+
+    if (remaining == 0) {
+      return {};
+    }
+  }
+}
+
+void ZstdChannel::close()
+{
+  channel_.close();
+}
+
+std::error_code ZstdChannel::flush()
+{
+  return channel_.flush();
+}
+
+} // namespace channel
@@ -0,0 +1,70 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <channel/compressing_channel.h>
+#include <platform/types.h>
+#include <util/raii.h>
+
+#include <zstd.h>
+
+#include <string>
+#include <vector>
+
+namespace channel {
+
+// ZstdChannel compresses data packets with Zstandard, as an alternative to
+// Lz4Channel.
+//
+// Unlike Lz4Channel, which compresses each data packet into a frame of its
+// own, the whole connection is a single Zstandard frame, started when
+// compression is enabled: each data packet is flushed so the reducer can
+// process it right away, but later packets are compressed with the earlier
+// ones as history, up to the window size. A dictionary trained on recorded
+// ingest streams gives the same advantage to the first packets.
+//
+// The reducer tells Zstandard from LZ4 by the frame's magic number, and finds
+// the dictionary by the id written in the frame header.
+class ZstdChannel : public CompressingChannel {
+public:
+  struct Options {
+    // compression level, 0 for Zstandard's default
+    int level = 0;
+    // log2 of the window size, which the reducer needs to keep for each
+    // connection, 0 for Zstandard's default for |level|
+    int window_log = 0;
+    // contents of a dictionary file trained with `zstd --train`, if any
+    std::string dictionary;
+  };
+
+  // |channel|: the downstream channel which will actually send out the data.
+  // |max_data_length|: max number of bytes of any incoming data packet sent
+  //                    via send() function. Note that it's caller's
+  //                    responsibility to honor this constraint.
+  //
+  // Throws if |options| are not valid.
+  ZstdChannel(Channel &channel, u32 max_data_length, Options const &options);
+
+  std::error_code send(const u8 *data, int data_len) override;
+
+  // Enabling compression starts a new frame.
+  void set_compression(bool enabled) override;
+
+  void close() override;
+  std::error_code flush() override;
+
+  bool is_open() const override { return channel_.is_open(); }
+
+private:
+  bool compression_enabled_ = false;
+
+  Channel &channel_;
+  std::vector<u8> buffer_;
+
+  pod_unique_ptr<ZSTD_CCtx, size_t, ZSTD_freeCCtx> zstd_ctx_;
+};
+
+} // namespace channel
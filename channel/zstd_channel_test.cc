@@ -0,0 +1,234 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <channel/zstd_channel.h>
+
+#include <util/zstd_decompressor.h>
+
+#include <zdict.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+static constexpr u32 max_data_length = 16 * 1024;
+static constexpr size_t output_buffer_size = 64 * 1024;
+
+// Keeps what is sent, for decompressing it.
+class CapturingChannel : public channel::Channel {
+public:
+  std::error_code send(const u8 *data, int data_len) override
+  {
+    data_.append(reinterpret_cast<char const *>(data), data_len);
+    return {};
+  }
+
+  bool is_open() const override { return true; }
+
+  // Returns what was sent since the last call.
+  std::string take() { return std::exchange(data_, {}); }
+
+private:
+  std::string data_;
+};
+
+std::error_code send(channel::Channel &channel, std::string_view data)
+{
+  return channel.send(data);
+}
+
+// Looks like what collectors send: the same few strings, with varying numbers.
+std::string make_payload(u32 seed, size_t size)
+{
+  static constexpr char const *comms[] = {"nginx", "envoy", "kube-proxy", "coredns", "containerd-shim"};
+
+  std::string payload;
+  for (u32 i = 0; payload.size() < size; ++i) {
+    u32 const n = seed * 7919 + i * 104729;
+    payload += "pid=" + std::to_string(n % 32768) + " comm=" + comms[n % 5] +
+               " cgroup=/kubepods/burstable/pod" + std::to_string(n % 97) + " bytes=" + std::to_string(n) + ";";
+  }
+  payload.resize(size);
+  return payload;
+}
+
+std::string train_dictionary()
+{
+  std::string samples;
+  std::vector<size_t> sizes;
+  for (u32 i = 0; i < 1000; ++i) {
+    sizes.push_back(500);
+    samples += make_payload(i, sizes.back());
+  }
+
+  std::string dictionary(16 * 1024, '\0');
+  size_t const size =
+      ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(), samples.data(), sizes.data(), sizes.size());
+  EXPECT_FALSE(ZDICT_isError(size)) << ZDICT_getErrorName(size);
+  dictionary.resize(ZDICT_isError(size) ? 0 : size);
+  return dictionary;
+}
+
+// Decompresses |data| with |decompressor|, feeding it |chunk_size| bytes at a
+// time like a TCP channel would. Returns nullopt on error.
+std::optional<std::string> decompress(ZstdDecompressor &decompressor, std::string_view data, size_t chunk_size)
+{
+  std::string out;
+
+  while (!data.empty()) {
+    auto const chunk = data.substr(0, chunk_size);
+    size_t consumed = 0;
+    if (decompressor.process(reinterpret_cast<u8 const *>(chunk.data()), chunk.size(), &consumed) != 0) {
+      return std::nullopt;
+    }
+    out.append(reinterpret_cast<char const *>(decompressor.output_buf()), decompressor.output_buf_size());
+    decompressor.discard(decompressor.output_buf_size());
+    data.remove_prefix(consumed);
+  }
+
+  return out;
+}
+
+} // namespace
+
+TEST(ZstdChannelTest, SendsAreDecompressedAsTheyArrive)
+{
+  CapturingChannel downstream;
+  channel::ZstdChannel channel(downstream, max_data_length, {.level = 3, .window_log = 17});
+  ZstdContextPool pool({});
+  std::optional<ZstdDecompressor> decompressor;
+
+  // the first message is sent as is
+  ASSERT_FALSE(send(channel, std::string_view("version_info")));
+  EXPECT_EQ(downstream.take(), "version_info");
+
+  channel.set_compression(true);
+
+  size_t total_compressed = 0;
+  for (u32 i = 0; i < 50; ++i) {
+    auto const payload = make_payload(i, max_data_length);
+    ASSERT_FALSE(send(channel, payload));
+
+    auto const compressed = downstream.take();
+    total_compressed += compressed.size();
+
+    if (!decompressor) {
+      ASSERT_TRUE(ZstdDecompressor::is_frame(reinterpret_cast<u8 const *>(compressed.data()), compressed.size()));
+      decompressor.emplace(output_buffer_size, pool);
+    }
+
+    // each send is flushed, so all of it is available before the next one
+    EXPECT_EQ(decompress(*decompressor, compressed, 1000), payload);
+  }
+
+  EXPECT_LT(total_compressed, 50 * max_data_length / 4);
+}
+
+TEST(ZstdChannelTest, Dictionary)
+{
+  auto const dictionary = train_dictionary();
+  ASSERT_FALSE(dictionary.empty());
+
+  auto const payload = make_payload(12345, 2000);
+
+  auto compress = [&payload](std::string dictionary) {
+    CapturingChannel downstream;
+    channel::ZstdChannel channel(downstream, max_data_length, {.level = 3, .dictionary = std::move(dictionary)});
+    channel.set_compression(true);
+    EXPECT_FALSE(send(channel, payload));
+    return downstream.take();
+  };
+
+  auto const with_dictionary = compress(dictionary);
+  EXPECT_LT(with_dictionary.size(), compress({}).size());
+
+  // the dictionary is found by the id in the frame header
+  auto dictionaries = std::make_shared<ZstdDictionaries>();
+  dictionaries->add(dictionary);
+  ZstdContextPool pool({.dictionaries = dictionaries});
+  ZstdDecompressor decompressor(output_buffer_size, pool);
+  EXPECT_EQ(decompress(decompressor, with_dictionary, 7), payload);
+
+  ZstdContextPool pool_without_dictionary({});
+  ZstdDecompressor decompressor_without_dictionary(output_buffer_size, pool_without_dictionary);
+  EXPECT_EQ(decompress(decompressor_without_dictionary, with_dictionary, 7), std::nullopt);
+}
+
+TEST(ZstdChannelTest, NewFrameOnReconnect)
+{
+  CapturingChannel downstream;
+  channel::ZstdChannel channel(downstream, max_data_length, {});
+  ZstdContextPool pool({});
+
+  channel.set_compression(true);
+  ASSERT_FALSE(send(channel, make_payload(1, 1000)));
+  downstream.take();
+
+  // a new connection starts uncompressed
+  channel.set_compression(false);
+  ASSERT_FALSE(send(channel, std::string_view("version_info")));
+  EXPECT_EQ(downstream.take(), "version_info");
+  channel.set_compression(true);
+
+  auto const payload = make_payload(2, 1000);
+  ASSERT_FALSE(send(channel, payload));
+
+  // a decompressor that saw nothing of the first connection
+  ZstdDecompressor decompressor(output_buffer_size, pool);
+  EXPECT_EQ(decompress(decompressor, downstream.take(), 100), payload);
+}
+
+TEST(ZstdChannelTest, WindowLogMax)
+{
+  CapturingChannel downstream;
+  channel::ZstdChannel channel(downstream, max_data_length, {.window_log = 20});
+  channel.set_compression(true);
+  auto const payload = make_payload(3, 1000);
+  ASSERT_FALSE(send(channel, payload));
+  auto const compressed = downstream.take();
+
+  ZstdContextPool small_pool({.window_log_max = 17});
+  ZstdDecompressor rejecting(output_buffer_size, small_pool);
+  EXPECT_EQ(decompress(rejecting, compressed, compressed.size()), std::nullopt);
+
+  ZstdContextPool large_pool({.window_log_max = 20});
+  ZstdDecompressor accepting(output_buffer_size, large_pool);
+  EXPECT_EQ(decompress(accepting, compressed, compressed.size()), payload);
+}
+
+TEST(ZstdContextPoolTest, ReusesContexts)
+{
+  CapturingChannel downstream;
+  channel::ZstdChannel channel(downstream, max_data_length, {});
+  channel.set_compression(true);
+  auto const payload = make_payload(4, 1000);
+  ASSERT_FALSE(send(channel, payload));
+  auto const compressed = downstream.take();
+
+  ZstdContextPool pool({}, 1);
+  {
+    // a connection closed in the middle of a frame
+    ZstdDecompressor first(output_buffer_size, pool);
+    auto const partial = decompress(first, std::string_view(compressed).substr(0, compressed.size() / 2), 100);
+    ASSERT_TRUE(partial);
+    EXPECT_LT(partial->size(), payload.size());
+  }
+  EXPECT_EQ(pool.idle(), 1u);
+
+  // the reused context starts a new frame
+  ZstdDecompressor second(output_buffer_size, pool);
+  EXPECT_EQ(pool.idle(), 0u);
+  EXPECT_EQ(decompress(second, compressed, 100), payload);
+
+  {
+    ZstdDecompressor third(output_buffer_size, pool);
+  }
+  // only one idle context is kept
+  EXPECT_EQ(pool.idle(), 1u);
+}
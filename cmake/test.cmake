@@ -114,3 +114,34 @@ function(add_ebpf_unit_test NAME)
   add_dependencies(unit_tests "${NAME}_test")
   set_property(TEST ${TEST_NAME} PROPERTY LABELS eBPFContainer)
 endfunction(add_ebpf_unit_test)
+
+# Adds a benchmark named `${NAME}_bench`, which is part of the `benchmarks` target.
+#
+# The file `${NAME}_bench.cc` is implicitly added as a source.
+# Additional source files can be declared with the `SRCS` parameter.
+#
+# Benchmarks are plain executables that print their results, and are not run as part of `make test`.
+# Additional libraries can be linked with the `LIBS` parameter.
+add_custom_target(benchmarks)
+function(add_benchmark NAME)
+  set(BENCH_NAME "${NAME}_bench")
+  cmake_parse_arguments(ARG "" "" "SRCS;LIBS;DEPS" ${ARGN})
+
+  add_executable(
+    ${BENCH_NAME}
+      "${BENCH_NAME}.cc"
+      ${ARG_SRCS}
+  )
+
+  target_link_libraries(
+    ${BENCH_NAME}
+      ${ARG_LIBS}
+      shared-executable
+  )
+
+  if(ARG_DEPS)
+    add_dependencies(${BENCH_NAME} ${ARG_DEPS})
+  endif()
+
+  add_dependencies(benchmarks ${BENCH_NAME})
+endfunction(add_benchmark)
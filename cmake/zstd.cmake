@@ -0,0 +1,16 @@
+# Copyright The OpenTelemetry Authors
+# SPDX-License-Identifier: Apache-2.0
+
+include_guard()
+
+find_path(ZSTD_INCLUDE_DIR zstd.h)
+find_library(ZSTD_LIBRARY NAMES "libzstd.a")
+find_package_handle_standard_args(ZSTD DEFAULT_MSG ZSTD_LIBRARY ZSTD_INCLUDE_DIR)
+if(NOT ZSTD_FOUND)
+  message(FATAL_ERROR "Could not find zstd. Build container should already have that set up")
+endif()
+message(STATUS "zstd INCLUDE_DIR: ${ZSTD_INCLUDE_DIR}")
+message(STATUS "zstd LIBRARY: ${ZSTD_LIBRARY}")
+add_library(zstd INTERFACE)
+target_include_directories(zstd INTERFACE "${ZSTD_INCLUDE_DIR}")
+target_link_libraries(zstd INTERFACE "${ZSTD_LIBRARY}")
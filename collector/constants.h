@@ -10,3 +10,5 @@
 
 constexpr auto HEARTBEAT_INTERVAL = 2s;
 constexpr auto WRITE_BUFFER_SIZE = 16 * 1024;
+/* data held back while the server limits what collectors send */
+constexpr auto CREDIT_BACKLOG_SIZE = 8 * 1024 * 1024;
@@ -0,0 +1,94 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <collector/kernel/bpf_dump_reader.h>
+
+#include <generated/ebpf_net/agent_internal/meta.h>
+#include <generated/ebpf_net/agent_internal/wire_message.h>
+
+#include <util/file_ops.h>
+#include <util/meta.h>
+
+#include <absl/container/flat_hash_map.h>
+
+#include <spdlog/fmt/fmt.h>
+
+#include <stdexcept>
+#include <utility>
+
+#include <string.h>
+
+namespace {
+
+struct MessageLayout {
+  u16 size;
+  /* the wire message starts with u16 rpc_id + u16 _len */
+  bool dynamic_size;
+};
+
+absl::flat_hash_map<u16, MessageLayout> make_message_layouts()
+{
+  absl::flat_hash_map<u16, MessageLayout> layouts;
+
+  meta::foreach<ebpf_net::agent_internal_metadata::messages>([&](auto tag) {
+    using message = decltype(meta::tag_type(tag));
+    constexpr bool dynamic_size = requires(typename message::wire_message const &msg) { msg._len; };
+
+    layouts.emplace(message::rpc_id, MessageLayout{.size = message::wire_message_size, .dynamic_size = dynamic_size});
+  });
+
+  return layouts;
+}
+
+} // namespace
+
+BpfDumpReader::BpfDumpReader(std::string dump) : dump_(std::move(dump)) {}
+
+BpfDumpReader BpfDumpReader::load(char const *path)
+{
+  return BpfDumpReader(*read_file_as_string(path).try_raise());
+}
+
+std::size_t BpfDumpReader::wire_message_length(u16 rpc_id, std::string_view message)
+{
+  static auto const layouts = make_message_layouts();
+
+  auto const layout = layouts.find(rpc_id);
+  if (layout == layouts.end()) {
+    return 0;
+  }
+
+  if (!layout->second.dynamic_size) {
+    return layout->second.size;
+  }
+
+  if (message.size() < 2 * sizeof(u16)) {
+    return layout->second.size;
+  }
+
+  u16 length;
+  memcpy(&length, message.data() + sizeof(u16), sizeof(length));
+  return length;
+}
+
+std::string_view BpfDumpReader::next()
+{
+  std::string_view const remaining = std::string_view(dump_).substr(offset_);
+  if (remaining.size() < sizeof(u64) + sizeof(u16)) {
+    throw std::runtime_error(fmt::format("bpf dump: truncated message at offset {}", offset_));
+  }
+
+  u16 rpc_id;
+  memcpy(&rpc_id, remaining.data() + sizeof(u64), sizeof(rpc_id));
+
+  std::size_t const length = wire_message_length(rpc_id, remaining.substr(sizeof(u64)));
+  if (length == 0) {
+    throw std::runtime_error(fmt::format("bpf dump: unknown rpc_id {} at offset {}", rpc_id, offset_));
+  }
+  if (remaining.size() < sizeof(u64) + length) {
+    throw std::runtime_error(fmt::format("bpf dump: truncated message at offset {}", offset_));
+  }
+
+  offset_ += sizeof(u64) + length;
+  return remaining.substr(0, sizeof(u64) + length);
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <platform/platform.h>
+
+#include <string>
+#include <string_view>
+
+/**
+ * Reads back the eBPF messages written by BufferedPoller to `--bpf-dump-file`.
+ *
+ * The dump is the concatenation of the messages as BPF submitted them, each
+ *   starting at the timestamp:
+ *      [ u64 timestamp + wire message ]
+ * so the same bytes PerfReader::peek_message() returns for a sample. Messages
+ * carry no length prefix, so lengths come from the agent_internal message
+ * metadata: fixed-size messages have a known size, and dynamic-size messages
+ * carry their wire length in `_len`, like BPF computes the unpadded size.
+ */
+class BpfDumpReader {
+public:
+  /**
+   * C'tor
+   * @param dump: the contents of a dump file
+   */
+  explicit BpfDumpReader(std::string dump);
+
+  /**
+   * Reads the dump file at `path`. Throws if it can't be read.
+   */
+  static BpfDumpReader load(char const *path);
+
+  /**
+   * Returns true if all messages have been read
+   */
+  bool empty() const { return offset_ == dump_.size(); }
+
+  /**
+   * Returns the next message, starting at its timestamp, and advances past it.
+   *
+   * Throws if the message is truncated or has an unknown rpc_id.
+   * Assumes !empty().
+   */
+  std::string_view next();
+
+  /**
+   * Starts reading from the first message again
+   */
+  void rewind() { offset_ = 0; }
+
+  /**
+   * Returns the wire length of the message with the given rpc_id, reading
+   *   `_len` from `message` (starting at the rpc_id) for dynamic-size ones.
+   *   Returns 0 for unknown rpc_ids.
+   */
+  static std::size_t wire_message_length(u16 rpc_id, std::string_view message);
+
+private:
+  std::string dump_;
+  std::size_t offset_ = 0;
+};
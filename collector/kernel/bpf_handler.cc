@@ -16,18 +16,21 @@ BPFHandler::BPFHandler(
     std::string full_program,
     bool enable_http_metrics,
     bool enable_userland_tcp,
+    bool use_bpf_ring_buffer,
+    bool enable_bpf_stats_aggregation,
     FileDescriptor &bpf_dump_file,
     logging::Logger &log,
     ::ebpf_net::ingest::Encoder *encoder,
     HostInfo const &host_info)
     : loop_(loop),
       probe_handler_(log),
-      bpf_module_(0),
+      bpf_module_(0, nullptr, false /* rw_engine_enabled */),
       perf_(),
       encoder_(encoder),
       buf_poller_(nullptr),
       enable_http_metrics_(enable_http_metrics),
       enable_userland_tcp_(enable_userland_tcp),
+      enable_bpf_stats_aggregation_(enable_bpf_stats_aggregation),
       bpf_dump_file_(bpf_dump_file),
       log_(log),
       last_lost_count_(0),
@@ -36,7 +39,13 @@ BPFHandler::BPFHandler(
   if (enable_userland_tcp) {
     full_program = "#define ENABLE_TCP_DATA_STREAM 1\n" + full_program;
   }
-  int res = probe_handler_.start_bpf_module(full_program, bpf_module_, perf_);
+  if (use_bpf_ring_buffer) {
+    full_program = "#define USE_BPF_RING_BUFFER 1\n" + full_program;
+  }
+  if (enable_bpf_stats_aggregation) {
+    full_program = "#define ENABLE_BPF_STATS_AGGREGATION 1\n" + full_program;
+  }
+  int res = probe_handler_.start_bpf_module(full_program, bpf_module_, perf_, use_bpf_ring_buffer);
   if (res != 0) {
     throw std::system_error(errno, std::generic_category(), "ProbeHandler couldn't load BPFModule");
   }
@@ -54,6 +63,7 @@ void BPFHandler::load_buffered_poller(
     u64 boot_time_adjustment,
     CurlEngine &curl_engine,
     u64 socket_stats_interval_sec,
+    std::size_t dns_parse_threads,
     CgroupHandler::CgroupSettings const &cgroup_settings,
     KernelCollectorRestarter &kernel_collector_restarter)
 {
@@ -68,6 +78,8 @@ void BPFHandler::load_buffered_poller(
       log_,
       probe_handler_,
       bpf_module_,
+      enable_bpf_stats_aggregation_,
+      dns_parse_threads,
       socket_stats_interval_sec,
       cgroup_settings,
       encoder_,
@@ -242,6 +254,38 @@ void BPFHandler::start_poll(u64 interval_useconds, u64 n_intervals)
 void BPFHandler::slow_poll()
 {
   buf_poller_->slow_poll();
+
+  /* done here rather than when the loss is seen, since re-probing polls the rings */
+  if (buf_poller_->resync_requested()) {
+    resync_after_loss();
+  }
+}
+
+void BPFHandler::resync_after_loss()
+{
+  // drain what was already submitted, so the tables reflect it
+  buf_poller_->start(1, 1);
+
+  buf_poller_->reconcile_bpf_tables();
+
+  ProcessProber::probe_existing(
+      probe_handler_,
+      bpf_module_,
+      [this]() { buf_poller_->start(1, 1); },
+      [this](std::string error_loc) { check_cb(error_loc); });
+
+  SocketProber::probe_existing(
+      probe_handler_,
+      bpf_module_,
+      [this]() { buf_poller_->start(1, 1); },
+      [this](std::string error_loc) { check_cb(error_loc); },
+      log_);
+
+  // one more poll to make sure the perf rings are clear
+  buf_poller_->start(1, 1);
+
+  buf_poller_->resync_completed();
+  log_.info("resynchronized socket and process tables after lost bpf samples");
 }
 
 u64 BPFHandler::serv_lost_count()
@@ -249,6 +293,13 @@ u64 BPFHandler::serv_lost_count()
   return buf_poller_->serv_lost_count();
 }
 
+void BPFHandler::set_throttled(bool throttled)
+{
+  if (buf_poller_) {
+    buf_poller_->set_throttled(throttled);
+  }
+}
+
 void BPFHandler::check_cb(std::string error_loc)
 {
   u64 lost_count = serv_lost_count();
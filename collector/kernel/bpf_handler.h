@@ -33,6 +33,8 @@ public:
       std::string full_program,
       bool enable_http_metrics,
       bool enable_userland_tcp,
+      bool use_bpf_ring_buffer,
+      bool enable_bpf_stats_aggregation,
       FileDescriptor &bpf_dump_file,
       logging::Logger &log,
       ::ebpf_net::ingest::Encoder *encoder,
@@ -51,6 +53,7 @@ public:
       u64 boot_time_adjustment,
       CurlEngine &curl_engine,
       u64 socket_stats_interval_sec,
+      std::size_t dns_parse_threads,
       CgroupHandler::CgroupSettings const &cgroup_settings,
       KernelCollectorRestarter &kernel_collector_restarter);
 
@@ -66,7 +69,8 @@ public:
   void start_poll(u64 interval_useconds, u64 n_intervals);
 
   /**
-   * Calls less frequent cleanup operations on buf_poller_
+   * Calls less frequent cleanup operations on buf_poller_, and resynchronizes
+   *   socket and process tables if BPF samples were lost
    */
   void slow_poll();
 
@@ -75,6 +79,11 @@ public:
    */
   u64 serv_lost_count();
 
+  /**
+   * Calls set_throttled(throttled) on buf_poller_
+   */
+  void set_throttled(bool throttled);
+
   /**
    * Callback passed to probers for checking lost count
    */
@@ -88,6 +97,12 @@ public:
 #endif
 
 private:
+  /**
+   * Reconciles the socket and process tables with BPF, then re-probes
+   *   existing sockets and processes to report what BPF missed
+   */
+  void resync_after_loss();
+
   uv_loop_t &loop_;
   ProbeHandler probe_handler_;
   ebpf::BPFModule bpf_module_;
@@ -96,6 +111,7 @@ private:
   std::unique_ptr<BufferedPoller> buf_poller_;
   bool enable_http_metrics_;
   bool enable_userland_tcp_;
+  bool enable_bpf_stats_aggregation_;
   FileDescriptor &bpf_dump_file_;
   logging::Logger &log_;
   u64 last_lost_count_;
@@ -0,0 +1,171 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <platform/types.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <collector/kernel/bpf_src/tcp-processor/tcp_processor.h>
+
+/* Userland stand-ins for what the BPF HTTP parser uses from the rest of the
+ * tcp-processor, so that it can be built and tested outside of the kernel. */
+
+#define TCP_SOCKET_PROTOCOL_STATE_SIZE 16
+
+#define bpf_probe_read(dst, size, src) std::memcpy((dst), (src), (size))
+
+struct pt_regs;
+struct sock;
+
+struct tcp_protocol_state_t {
+  u8 data[TCP_SOCKET_PROTOCOL_STATE_SIZE];
+};
+
+struct tcp_connection_t {
+  struct sock *sk;
+  struct tcp_protocol_state_t protocol_state;
+};
+
+struct http_response_t {
+  u16 code;
+  enum CLIENT_SERVER_TYPE dir;
+};
+
+static std::vector<http_response_t> submitted_responses;
+
+static u64 get_timestamp(void)
+{
+  return 0;
+}
+
+static void enable_tcp_connection(struct tcp_control_value_t *pctrl, int recv, int send)
+{
+  if (send != 0) {
+    pctrl->streams[ST_SEND].enable = send < 0 ? 0 : 1;
+  }
+  if (recv != 0) {
+    pctrl->streams[ST_RECV].enable = recv < 0 ? 0 : 1;
+  }
+}
+
+static void tcp_events_submit_http_response(struct pt_regs *ctx, struct sock *sk, u16 code, u64 latency, u8 dir)
+{
+  submitted_responses.push_back({code, (enum CLIENT_SERVER_TYPE)dir});
+}
+
+#include <collector/kernel/bpf_src/tcp-processor/bpf_memory.h>
+
+#include <collector/kernel/bpf_src/tcp-processor/bpf_http_protocol.h>
+
+namespace {
+
+constexpr std::string_view status_line = "HTTP/1.1 404 Not Found\r\n";
+
+TCP_PROTOCOL_DETECT_RESULT detect(std::string_view data)
+{
+  return http_detect(nullptr, nullptr, nullptr, ST_SEND, reinterpret_cast<const u8 *>(data.data()), data.size());
+}
+
+TCP_PROTOCOL_DETECT_RESULT parse(http_protocol_state_data_t &state, std::string_view data)
+{
+  return http_parse_status_line(&state, reinterpret_cast<const u8 *>(data.data()), data.size());
+}
+
+} // namespace
+
+TEST(BpfHttpProtocolTest, DetectsRequestMethods)
+{
+  for (std::string_view data : {"GET / HTTP/1.1\r\n", "HEAD /", "DELETE /", "CONNECT h", "OPTIONS *", "TRACE /", "PUT /",
+                                "POST /", "PATCH /"}) {
+    SCOPED_TRACE(data);
+    EXPECT_EQ(TPD_SUCCESS, detect(data));
+  }
+
+  for (std::string_view data : {"GOT / HTTP/1.1\r\n", "HTTP/1.1 200 OK\r\n", "PING /", "\x16\x03\x01\x02"}) {
+    SCOPED_TRACE(data);
+    EXPECT_EQ(TPD_FAILED, detect(data));
+  }
+
+  EXPECT_EQ(TPD_UNKNOWN, detect("GE"));
+}
+
+TEST(BpfHttpProtocolTest, ParsesStatusLineSplitAtAnyByte)
+{
+  for (size_t split = 0; split <= status_line.size(); ++split) {
+    SCOPED_TRACE(split);
+    http_protocol_state_data_t state = {};
+
+    auto result = parse(state, status_line.substr(0, split));
+    if (split < HTTP_STATUS_LINE_LEN) {
+      EXPECT_EQ(TPD_UNKNOWN, result);
+      result = parse(state, status_line.substr(split));
+    }
+
+    EXPECT_EQ(TPD_SUCCESS, result);
+    EXPECT_EQ(404, state.status_code);
+    EXPECT_EQ(1, state.version_major);
+    EXPECT_EQ(1, state.version_minor);
+  }
+}
+
+TEST(BpfHttpProtocolTest, ParsesStatusLineOneByteAtATime)
+{
+  http_protocol_state_data_t state = {};
+
+  for (size_t i = 0; i + 1 < HTTP_STATUS_LINE_LEN; ++i) {
+    EXPECT_EQ(TPD_UNKNOWN, parse(state, status_line.substr(i, 1)));
+  }
+  EXPECT_EQ(TPD_SUCCESS, parse(state, status_line.substr(HTTP_STATUS_LINE_LEN - 1, 1)));
+  EXPECT_EQ(404, state.status_code);
+}
+
+TEST(BpfHttpProtocolTest, RejectsOtherDataSplitAtAnyByte)
+{
+  for (std::string_view data : {"HTTP/1.x 200 OK\r\n", "HTTX/1.1 200 OK\r\n", "HTTP/1.1 2O0 OK\r\n", "GET / HTTP/1.1\r\n"}) {
+    for (size_t split = 0; split <= data.size(); ++split) {
+      SCOPED_TRACE(testing::Message() << data << " split at " << split);
+      http_protocol_state_data_t state = {};
+
+      auto result = parse(state, data.substr(0, split));
+      if (result == TPD_UNKNOWN) {
+        result = parse(state, data.substr(split));
+      }
+
+      EXPECT_EQ(TPD_FAILED, result);
+    }
+  }
+}
+
+TEST(BpfHttpProtocolTest, SubmitsResponseSplitOverWrites)
+{
+  for (size_t split = 1; split < HTTP_STATUS_LINE_LEN; ++split) {
+    SCOPED_TRACE(split);
+    submitted_responses.clear();
+    tcp_connection_t conn = {};
+    tcp_control_value_t ctrl = {};
+    auto const *data = reinterpret_cast<const u8 *>(status_line.data());
+
+    // the client sent a request, its response comes on the receive side
+    http_process_request(nullptr, &conn, &ctrl, ST_SEND, nullptr, 0);
+    EXPECT_EQ(1u, ctrl.streams[ST_RECV].enable);
+    EXPECT_EQ(0u, ctrl.streams[ST_SEND].enable);
+
+    http_process_response(nullptr, &conn, &ctrl, ST_RECV, data, split);
+    EXPECT_TRUE(submitted_responses.empty());
+    EXPECT_EQ(1u, ctrl.streams[ST_RECV].enable);
+
+    http_process_response(nullptr, &conn, &ctrl, ST_RECV, data + split, status_line.size() - split);
+    ASSERT_EQ(1u, submitted_responses.size());
+    EXPECT_EQ(404, submitted_responses[0].code);
+    EXPECT_EQ(SC_CLIENT, submitted_responses[0].dir);
+
+    // back to waiting for the next request
+    EXPECT_EQ(0u, ctrl.streams[ST_RECV].enable);
+    EXPECT_EQ(1u, ctrl.streams[ST_SEND].enable);
+  }
+}
@@ -41,7 +41,53 @@
 #include "config.h"
 #include "render_bpf.h"
 // Perf events
+//
+// With USE_BPF_RING_BUFFER, events go through a single BPF ring buffer shared by all CPUs instead of per-CPU perf rings.
+// Messages are submitted from the start of the generated struct, with the current cpu in place of the perf sample size,
+// so userland can read both at the same offsets.
+#pragma passthrough on
+#if USE_BPF_RING_BUFFER
+BPF_RINGBUF_OUTPUT(events, EVENTS_RING_BUFFER_N_PAGES);
+BPF_F_TABLE("array", u32, u64, events_lost, 1, BPF_F_MMAPABLE);
+BPF_ARRAY(events_last_wakeup, u64, 1);
+
+static inline int events_output(struct pt_regs *ctx, void *msg, u32 perf_size)
+{
+  *(u32 *)msg = bpf_get_smp_processor_id();
+
+  /* wake up userland once enough data is pending, or enough time went by since the last wakeup, see render_bpf.h */
+  u64 flags = BPF_RB_NO_WAKEUP;
+  u32 zero = 0;
+  u64 *last_wakeup = events_last_wakeup.lookup(&zero);
+  u64 now = bpf_ktime_get_ns();
+  if (events.ringbuf_query(BPF_RB_AVAIL_DATA) >= EVENTS_RING_BUFFER_WAKEUP_BYTES ||
+      (last_wakeup && now - *last_wakeup >= EVENTS_RING_BUFFER_WAKEUP_NS)) {
+    flags = BPF_RB_FORCE_WAKEUP;
+    /* racing CPUs can both wake userland up, which is harmless */
+    if (last_wakeup) {
+      *last_wakeup = now;
+    }
+  }
+
+  int ret = events.ringbuf_output(msg, perf_size + sizeof(u32), flags);
+  if (ret < 0) {
+    u64 *lost = events_lost.lookup(&zero);
+    if (lost) {
+      __sync_fetch_and_add(lost, 1);
+    }
+  }
+  return ret;
+}
+#else
 BPF_PERF_OUTPUT(events);
+
+static inline int events_output(struct pt_regs *ctx, void *msg, u32 perf_size)
+{
+  /* perf prepends its own u32 sample size */
+  return events.perf_submit(ctx, (char *)msg + sizeof(u32), perf_size);
+}
+#endif
+#pragma passthrough off
 #include "ebpf_net/agent_internal/bpf.h"
 
 // Common utility functions
@@ -141,6 +187,28 @@ BPF_HASH(tcp_open_sockets, struct sock *, struct tcp_open_socket_t, TABLE_SIZE__
 BPF_HASH(udp_open_sockets, struct sock *, struct udp_open_socket_t, TABLE_SIZE__UDP_OPEN_SOCKETS);
 BPF_HASH(udp_get_port_hash, u64, struct sock *, TABLE_SIZE__UDP_GET_PORT_HASH);
 
+/* With ENABLE_BPF_STATS_AGGREGATION, periodic socket statistics are accumulated in these per-CPU tables instead of
+ * being submitted as events, and userland drains them once per stats interval. Closing reports still go through
+ * events, and samples fall back to events when a table is full. */
+#pragma passthrough on
+#if ENABLE_BPF_STATS_AGGREGATION
+BPF_F_TABLE(
+    /*table_type*/ "percpu_hash",
+    /*key_type*/ struct sock *,
+    /*value_type*/ struct tcp_stats_agg_t,
+    /*name*/ tcp_stats_agg,
+    /*max_entries*/ TABLE_SIZE__TCP_STATS_AGG,
+    /*flags*/ BPF_F_NO_PREALLOC);
+BPF_F_TABLE(
+    /*table_type*/ "percpu_hash",
+    /*key_type*/ struct udp_stats_agg_key_t,
+    /*value_type*/ struct udp_stats_agg_t,
+    /*name*/ udp_stats_agg,
+    /*max_entries*/ TABLE_SIZE__UDP_STATS_AGG,
+    /*flags*/ BPF_F_NO_PREALLOC);
+#endif
+#pragma passthrough off
+
 BEGIN_DECLARE_SAVED_ARGS(cgroup_exit)
 pid_t tgid;
 END_DECLARE_SAVED_ARGS(cgroup_exit)
@@ -533,6 +601,111 @@ static inline u32 tcp_get_delivered(struct sock *sk)
 #pragma passthrough off
 }
 
+// Stats pre-aggregation
+//
+// aggregate_* return 0 if the sample was accumulated in the per-CPU tables, and -1 if it should be submitted as an
+// event instead: when aggregation is disabled, the table is full, or the sample can't be aggregated.
+#pragma passthrough on
+#if ENABLE_BPF_STATS_AGGREGATION
+static inline int aggregate_rtt_estimator(
+    struct sock *sk,
+    struct tcp_open_socket_t *sk_info,
+    u64 now,
+    u32 srtt,
+    u64 bytes_acked,
+    u32 packets_retrans,
+    u64 bytes_received,
+    u32 rcv_rtt_us)
+{
+  struct tcp_stats_agg_t *agg = tcp_stats_agg.lookup(&sk);
+  if (!agg) {
+    struct tcp_stats_agg_t zero = {};
+    tcp_stats_agg.insert(&sk, &zero);
+    agg = tcp_stats_agg.lookup(&sk);
+    if (!agg) {
+      return -1;
+    }
+  }
+
+  // counters are cumulative, so only the latest sample matters
+  agg->last_update = now;
+  agg->bytes_acked = bytes_acked;
+  agg->bytes_received = bytes_received;
+  agg->packets_delivered = tcp_get_delivered(sk);
+  agg->packets_retrans = packets_retrans;
+  agg->rcv_holes = sk_info->rcv_holes;
+  agg->rcv_delivered = sk_info->rcv_delivered;
+  if (srtt > agg->max_srtt) {
+    agg->max_srtt = srtt;
+  }
+  if (rcv_rtt_us > agg->max_rcv_rtt) {
+    agg->max_rcv_rtt = rcv_rtt_us;
+  }
+  return 0;
+}
+
+static inline void clear_tcp_stats_agg(struct sock *sk)
+{
+  tcp_stats_agg.delete(&sk);
+}
+
+static inline int aggregate_udp_stats(struct sock *sk, u8 is_rx, u64 now, struct udp_stats_t *stats)
+{
+  // only connected sockets: their addresses can't change between packets, so there is no address change that would
+  // need to be ordered with the aggregated stats
+  if (sk->sk_state != TCP_ESTABLISHED) {
+    return -1;
+  }
+
+  struct udp_stats_agg_key_t key = {.sk = (u64)sk, .is_rx = is_rx};
+  struct udp_stats_agg_t *agg = udp_stats_agg.lookup(&key);
+  if (!agg) {
+    struct udp_stats_agg_t zero = {};
+    udp_stats_agg.insert(&key, &zero);
+    agg = udp_stats_agg.lookup(&key);
+    if (!agg) {
+      return -1;
+    }
+  }
+
+  agg->last_update = now;
+  agg->packets += stats->packets;
+  agg->bytes += stats->bytes;
+  return 0;
+}
+
+static inline void clear_udp_stats_agg(struct sock *sk)
+{
+  struct udp_stats_agg_key_t key = {.sk = (u64)sk, .is_rx = 0};
+  udp_stats_agg.delete(&key);
+  key.is_rx = 1;
+  udp_stats_agg.delete(&key);
+}
+#else
+static inline int aggregate_rtt_estimator(
+    struct sock *sk,
+    struct tcp_open_socket_t *sk_info,
+    u64 now,
+    u32 srtt,
+    u64 bytes_acked,
+    u32 packets_retrans,
+    u64 bytes_received,
+    u32 rcv_rtt_us)
+{
+  return -1;
+}
+
+static inline void clear_tcp_stats_agg(struct sock *sk) {}
+
+static inline int aggregate_udp_stats(struct sock *sk, u8 is_rx, u64 now, struct udp_stats_t *stats)
+{
+  return -1;
+}
+
+static inline void clear_udp_stats_agg(struct sock *sk) {}
+#endif
+#pragma passthrough off
+
 static inline void
 report_rtt_estimator(struct pt_regs *ctx, struct sock *sk, struct tcp_open_socket_t *sk_info, u64 now, bool adjust)
 {
@@ -599,6 +772,12 @@ report_rtt_estimator(struct pt_regs *ctx, struct sock *sk, struct tcp_open_socke
     bytes_received &= ~3ull;
   }
 
+  // the report on close is always submitted, so it is ordered with close_sock_info
+  if (!adjust &&
+      aggregate_rtt_estimator(sk, sk_info, now, srtt, bytes_acked, packets_retrans, bytes_received, rcv_rtt_us) == 0) {
+    return;
+  }
+
   perf_submit_agent_internal__rtt_estimator(
       ctx,
       now,
@@ -668,6 +847,9 @@ static int add_tcp_open_socket(struct pt_regs *ctx, struct sock *sk, u32 tgid, u
     bpf_log(ctx, BPF_LOG_TABLE_BAD_INSERT, BPF_TABLE_TCP_OPEN_SOCKETS, tgid, abs_val(ret));
     return -1;
   }
+
+  // drop anything left over from a previous socket at the same address
+  clear_tcp_stats_agg(sk);
   return 1;
 }
 
@@ -694,6 +876,8 @@ static void remove_tcp_open_socket(struct pt_regs *ctx, struct sock *sk)
     return;
   }
 
+  clear_tcp_stats_agg(sk);
+
   // always report last rtt estimator before close
   // for short-lived connections, we won't see any data otherwise
   u64 now = get_timestamp();
@@ -1195,6 +1379,10 @@ static inline int add_udp_open_socket(struct pt_regs *ctx, struct sock *sk, u32
     bpf_log(ctx, BPF_LOG_TABLE_BAD_INSERT, BPF_TABLE_UDP_OPEN_SOCKETS, (u64)tgid, abs_val(ret));
     return -1;
   }
+
+  // drop anything left over from a previous socket at the same address. aggregated stats are otherwise left in place
+  // when a socket is closed, for userland to collect when it handles udp_destroy_socket
+  clear_udp_stats_agg(sk);
   return 1;
 }
 
@@ -1619,7 +1807,9 @@ static void udp_update_stats(
     stats->addr_changed = (lchanged || rchanged) ? (u8)family : 0;
 
     /* send the update if anything has changed, or if we have statistics */
-    udp_send_stats_if_nonempty(ctx, now, sk, stats, is_rx);
+    if (changed || aggregate_udp_stats(sk, is_rx, now, stats) != 0) {
+      udp_send_stats_if_nonempty(ctx, now, sk, stats, is_rx);
+    }
 
     /* reset statistics */
     stats->packets = 1;
@@ -2173,8 +2363,7 @@ perf_check_and_submit_dns(struct pt_regs *ctx, struct sock *sk, struct sk_buff *
   struct jb_blob blob = {to, valid_len};
   bpf_fill_agent_internal__dns_packet(msg, get_timestamp(), (u64)sk, blob, len, is_rx);
 
-  events.perf_submit(
-      ctx, &msg->unpadded_size, ((DNS_MAX_PACKET_LEN + sizeof(struct jb_agent_internal__dns_packet) + 8 + 7) / 8) * 8 + 4);
+  events_output(ctx, msg, ((DNS_MAX_PACKET_LEN + sizeof(struct jb_agent_internal__dns_packet) + 8 + 7) / 8) * 8 + 4);
 }
 
 // - Receive UDP packets ---------------------------------------
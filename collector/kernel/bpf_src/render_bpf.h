@@ -24,6 +24,8 @@
 #define TABLE_SIZE__DEAD_GROUP_TASKS 512 // Should be no more than the number of cores, in theory
 #define TABLE_SIZE__STACK_TRACES 16384   // Number of stack traces to keep in the table
 #define TABLE_SIZE__NIC_INFO_TABLE 128   // Info per network interface
+#define TABLE_SIZE__TCP_STATS_AGG (16 * 1024) // Sockets with pre-aggregated stats pending, falls back to perf events when full
+#define TABLE_SIZE__UDP_STATS_AGG (16 * 1024) // (socket, direction) with pre-aggregated stats pending, same fallback
 
 #define WATERMARK_STACK_TRACES                                                                                                 \
   (TABLE_SIZE__STACK_TRACES - 256) // When to clear the table (unfortunately non-atomic, but that's a lot of stack traces...)
@@ -31,6 +33,15 @@
 // Maximum number of bytes in a tcp_data message block
 #define DATA_CHANNEL_CHUNK_MAX 16383
 
+// Number of pages in the events BPF ring buffer, when used instead of perf rings (must be a power of 2)
+#define EVENTS_RING_BUFFER_N_PAGES 4096
+// Userland is woken up when the events BPF ring buffer has this many bytes pending, or when an event is submitted at least
+// EVENTS_RING_BUFFER_WAKEUP_NS after the last wakeup. Each wakeup costs a context switch in the poller, so busy hosts
+// batch up to EVENTS_RING_BUFFER_WAKEUP_BYTES per wakeup. On quiet hosts the time bound keeps an event from waiting for
+// the poller's 100ms timer. An event submitted right after a wakeup can still wait for that timer if nothing follows it.
+#define EVENTS_RING_BUFFER_WAKEUP_BYTES (64 * 1024)
+#define EVENTS_RING_BUFFER_WAKEUP_NS (10 * 1000 * 1000ull)
+
 // Shouldn't be necessary, be we aren't getting the lifetime of tcp
 // sockets right in some edge case
 
@@ -133,6 +144,36 @@ enum BPF_TABLE_ID {
 #define TAIL_CALL_CONTINUE_TCP_RECVMSG 7
 #define NUM_TAIL_CALLS 8
 
+// Stats pre-aggregation (ENABLE_BPF_STATS_AGGREGATION)
+//
+// Values of the tcp_stats_agg and udp_stats_agg per-CPU hash tables, which userland drains in batches once per stats
+// interval instead of receiving rtt_estimator and udp_stats events. Sizes must be multiples of 8, since that is how
+// per-CPU values are laid out when read from userland.
+
+struct tcp_stats_agg_t {
+  u64 last_update;     // timestamp of the latest sample on this cpu, 0 if none
+  u64 bytes_acked;     // cumulative counters, as of the latest sample
+  u64 bytes_received;
+  u32 packets_delivered;
+  u32 packets_retrans;
+  u32 rcv_holes;
+  u32 rcv_delivered;
+  u32 max_srtt;        // maximum over the samples since the last drain
+  u32 max_rcv_rtt;
+};
+
+struct udp_stats_agg_key_t {
+  u64 sk;
+  u32 is_rx;
+  u32 padding;
+};
+
+struct udp_stats_agg_t {
+  u64 last_update; // timestamp of the latest sample on this cpu, 0 if none
+  u32 packets;     // totals since the last drain
+  u32 bytes;
+};
+
 #if _PROCESSING_BPF
 // Include this until we merge the tcp-processor code into render_bpf more closely
 // Note, this is included by bpf and userland c++, so it -must- be an include with "" not <>
@@ -9,9 +9,16 @@
 
 #pragma once
 
+// Length of an HTTP response status line up to the code, "HTTP/x.y NNN"
+#define HTTP_STATUS_LINE_LEN 12
+
 struct http_protocol_state_data_t {
   u64 request_timestamp;
-  u64 __unused; // Keep this to TCP_SOCKET_PROTOCOL_STATE_SIZE
+  u16 status_code;    // Response code, as parsed so far
+  u8 status_line_pos; // Bytes of the response status line parsed so far, it can be split over several writes
+  u8 version_major;
+  u8 version_minor;
+  u8 __unused[3]; // Keep this to TCP_SOCKET_PROTOCOL_STATE_SIZE
 };
 
 static enum TCP_PROTOCOL_DETECT_RESULT http_detect(
@@ -115,6 +122,7 @@ static void http_process_request(
   // Keep the request timestamp for latency calculation
   struct http_protocol_state_data_t *state_data = (struct http_protocol_state_data_t *)(pconn->protocol_state.data);
   state_data->request_timestamp = get_timestamp();
+  state_data->status_line_pos = 0;
 
   // Enable getting the response, and turn off the request side until we get it
   if (streamtype == ST_RECV) {
@@ -124,6 +132,90 @@ static void http_process_request(
   }
 }
 
+// Parses the next bytes of a response status line, one at a time, so that a status line that is split over several
+// writes is still recognized without buffering, or shipping it to userland.
+// Returns TPD_SUCCESS when the status line is complete, TPD_UNKNOWN if it needs more data, and TPD_FAILED if this is not
+// an HTTP status line.
+static enum TCP_PROTOCOL_DETECT_RESULT
+http_parse_status_line(struct http_protocol_state_data_t *state_data, const u8 *data, size_t data_len)
+{
+#if _PROCESSING_BPF
+#pragma passthrough on
+#pragma unroll
+#pragma passthrough off
+#endif
+  for (size_t i = 0; i < HTTP_STATUS_LINE_LEN; i++) {
+    if (i >= data_len) {
+      return TPD_UNKNOWN;
+    }
+
+    char c = 0;
+    bpf_probe_read(&c, 1, data + i);
+    int digit = char_to_number(c);
+
+    switch (state_data->status_line_pos) {
+    case 0:
+      if (c != 'H') {
+        return TPD_FAILED;
+      }
+      state_data->status_code = 0;
+      break;
+    case 1:
+    case 2:
+      if (c != 'T') {
+        return TPD_FAILED;
+      }
+      break;
+    case 3:
+      if (c != 'P') {
+        return TPD_FAILED;
+      }
+      break;
+    case 4:
+      if (c != '/') {
+        return TPD_FAILED;
+      }
+      break;
+    case 5:
+      if (digit == -1) {
+        return TPD_FAILED;
+      }
+      state_data->version_major = (u8)digit;
+      break;
+    case 6:
+      if (c != '.') {
+        return TPD_FAILED;
+      }
+      break;
+    case 7:
+      if (digit == -1) {
+        return TPD_FAILED;
+      }
+      state_data->version_minor = (u8)digit;
+      break;
+    case 8:
+      if (c != ' ') {
+        return TPD_FAILED;
+      }
+      break;
+    default:
+      // Ensure each digit of HTTP response code is valid
+      if (digit == -1) {
+        return TPD_FAILED;
+      }
+      state_data->status_code = state_data->status_code * 10 + (u16)digit;
+      break;
+    }
+
+    state_data->status_line_pos++;
+    if (state_data->status_line_pos >= HTTP_STATUS_LINE_LEN) {
+      return TPD_SUCCESS;
+    }
+  }
+
+  return TPD_UNKNOWN;
+}
+
 static void http_process_response(
     struct pt_regs *ctx,
     struct tcp_connection_t *pconn,
@@ -140,55 +232,29 @@ static void http_process_response(
   DEBUG_PRINTK("             data=%s, data_len=%d\n", data, (int)data_len);
 #endif
 
-  // HTTP response can't be less than 12 characters long, if we haven't gotten
-  // 12 characters yet, just wait until more bytes show up
-  if (data_len < 12) {
-    goto finished_response;
-  }
-
-  char localdata[12] = {};
-  bpf_probe_read(localdata, 12, data);
+  struct http_protocol_state_data_t *state_data = (struct http_protocol_state_data_t *)(pconn->protocol_state.data);
 
-  // Pattern match against HTTP/x.y
-  if (!string_starts_with(localdata, 12, "HTTP/") || localdata[6] != '.' || localdata[8] != ' ') {
-    goto finished_response;
+  enum TCP_PROTOCOL_DETECT_RESULT res = http_parse_status_line(state_data, data, data_len);
+  if (res == TPD_UNKNOWN) {
+    // The status line continues in the next write, keep listening to the response side
+    return;
   }
-  int http_version_major = char_to_number(localdata[5]);
-  int http_version_minor = char_to_number(localdata[7]);
 
-#if TRACE_HTTP_PROTOCOL
-  DEBUG_PRINTK("HTTP version: %d.%d\n", http_version_major, http_version_minor);
-#endif
-  // Check for invalid HTTP version
-  if (http_version_major == -1 || http_version_minor == -1) {
-    goto finished_response;
-  }
-
-  // Convert HTTP response code to integer
-  int http_code_2 = char_to_number(localdata[9]);
-  int http_code_1 = char_to_number(localdata[10]);
-  int http_code_0 = char_to_number(localdata[11]);
+  state_data->status_line_pos = 0;
 
+  if (res == TPD_SUCCESS) {
 #if TRACE_HTTP_PROTOCOL
-  DEBUG_PRINTK("HTTP response code: %d%d%d\n", http_code_2, http_code_1, http_code_0);
+    DEBUG_PRINTK("HTTP version: %d.%d\n", state_data->version_major, state_data->version_minor);
+    DEBUG_PRINTK("HTTP response code: %d\n", state_data->status_code);
 #endif
 
-  // Ensure each digit of HTTP response code is valid
-  if (http_code_2 == -1 || http_code_1 == -1 || http_code_0 == -1) {
-    goto finished_response;
+    // Submit the http response code, and latency
+    u64 latency = get_timestamp() - state_data->request_timestamp;
+    u8 client_server = (streamtype == ST_SEND) ? SC_SERVER : SC_CLIENT;
+    tcp_events_submit_http_response(ctx, pconn->sk, state_data->status_code, latency, client_server);
   }
 
-  u16 code = (u16)(http_code_2 * 100 + http_code_1 * 10 + http_code_0);
-
-  // Submit the http response code, and latency
-  struct http_protocol_state_data_t *state_data = (struct http_protocol_state_data_t *)(pconn->protocol_state.data);
-  u64 latency = get_timestamp() - state_data->request_timestamp;
-  u8 client_server = (streamtype == ST_SEND) ? SC_SERVER : SC_CLIENT;
-  tcp_events_submit_http_response(ctx, pconn->sk, code, latency, client_server);
-
   // Enable getting the request, and turn off the response side until we get it
-finished_response:
-
   if (streamtype == ST_RECV) {
     enable_tcp_connection(pctrl, -1, 1);
   } else {
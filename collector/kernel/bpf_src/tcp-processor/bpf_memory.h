@@ -9,11 +9,8 @@
 
 #pragma once
 
-#include "bpf_debug.h"
-#include "bpf_types.h"
-
 // s2 can not be longer than 16 bytes due to older bpf inlining limitations
-inline static int string_starts_with(const char *s1, const size_t s1_len, const char *s2)
+inline static int string_starts_with(const void *s1, const size_t s1_len, const char *s2)
 {
 
   const size_t s2_len = strlen(s2);
@@ -25,10 +22,12 @@ inline static int string_starts_with(const char *s1, const size_t s1_len, const
   char localdata[16] = {};
   bpf_probe_read(localdata, s2_len, s1);
 
+#if _PROCESSING_BPF
 #pragma passthrough on
 #pragma unroll
 #pragma passthrough off
-  for (int i = 0; i < s2_len; i++) {
+#endif
+  for (size_t i = 0; i < s2_len; i++) {
     if (localdata[i] != s2[i]) {
       return 0;
     }
@@ -20,14 +20,19 @@
 #include <generated/ebpf_net/agent_internal/wire_message.h>
 #include <generated/ebpf_net/ingest/wire_message.h>
 
+#include <bcc/libbpf.h>
+
+#include <absl/container/flat_hash_set.h>
+
 #include <spdlog/common.h>
 #include <spdlog/fmt/bin_to_hex.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
-
-constexpr u16 DNS_MAX_PACKET_LEN = 512;
+#include <vector>
 
 #ifdef DEBUG_PID
 static BufferedPoller *singleton_ = nullptr;
@@ -35,6 +40,76 @@ static BufferedPoller *singleton_ = nullptr;
 
 static constexpr u64 DNS_TIMEOUT_TIME_NS = 10'000'000'000ull;
 
+/* how many samples to look through for DNS packets to hand to the parse pool, per batch */
+static constexpr std::size_t DNS_PARSE_SCAN_AHEAD_SAMPLES = 16 * 1024;
+
+/* number of entries read from a per-CPU stats table per batch syscall */
+static constexpr u32 STATS_AGG_DRAIN_BATCH_SIZE = 256;
+
+/* while throttled, TCP socket stats are sent once every this many timeslots */
+static constexpr u32 THROTTLED_STATS_TIMESLOTS = 4;
+
+/* while throttled, one in this many DNS requests is tracked */
+static constexpr u16 THROTTLED_DNS_SAMPLING = 4;
+
+/**
+ * Collects the keys of a BPF hash table.
+ *
+ * Iteration starts from `missing_key`, which must never be in the table, and is bounded by
+ * `max_entries` since the table can change while it is being iterated.
+ */
+template <typename Key> static absl::flat_hash_set<Key> bpf_table_keys(int fd, Key missing_key, std::size_t max_entries)
+{
+  absl::flat_hash_set<Key> keys;
+  Key key = missing_key;
+  Key next_key;
+  for (std::size_t i = 0; i < max_entries && bpf_get_next_key(fd, &key, &next_key) == 0; ++i) {
+    keys.insert(next_key);
+    key = next_key;
+  }
+  return keys;
+}
+
+/**
+ * Removes all entries from a BPF per-CPU hash table using BPF_MAP_LOOKUP_AND_DELETE_BATCH, calling
+ * `fn(key, values)` for each, where `values` points to one value per possible cpu.
+ *
+ * @returns the number of entries drained, or -errno on failure
+ */
+template <typename Key, typename Value, typename Fn> static int drain_percpu_hash(int fd, std::size_t n_cpus, Fn &&fn)
+{
+  static_assert(sizeof(Value) % 8 == 0, "the kernel lays out per-cpu values with 8-byte alignment");
+
+  std::vector<Key> keys(STATS_AGG_DRAIN_BATCH_SIZE);
+  std::vector<Value> values(STATS_AGG_DRAIN_BATCH_SIZE * n_cpus);
+
+  int drained = 0;
+  u32 batch = 0;
+  u32 *in_batch = nullptr;
+  for (;;) {
+    u32 out_batch = 0;
+    u32 count = STATS_AGG_DRAIN_BATCH_SIZE;
+    int const ret = bpf_lookup_and_delete_batch(fd, in_batch, &out_batch, keys.data(), values.data(), &count);
+    int const err = ret < 0 ? errno : 0;
+    if (err && err != ENOENT) {
+      return -err;
+    }
+
+    for (u32 i = 0; i < count; ++i) {
+      fn(keys[i], &values[i * n_cpus]);
+    }
+    drained += count;
+
+    /* ENOENT: no more entries after this batch */
+    if (err == ENOENT) {
+      return drained;
+    }
+
+    batch = out_batch;
+    in_batch = &batch;
+  }
+}
+
 BufferedPoller::BufferedPoller(
     uv_loop_t &loop,
     PerfContainer &container,
@@ -45,6 +120,8 @@ BufferedPoller::BufferedPoller(
     logging::Logger &log,
     ProbeHandler &probe_handler,
     ebpf::BPFModule &bpf_module,
+    bool enable_bpf_stats_aggregation,
+    std::size_t dns_parse_threads,
     u64 socket_stats_interval_sec,
     CgroupHandler::CgroupSettings const &cgroup_settings,
     ::ebpf_net::ingest::Encoder *encoder,
@@ -57,6 +134,7 @@ BufferedPoller::BufferedPoller(
       buffered_writer_(writer),
       probe_handler_(probe_handler),
       bpf_module_(bpf_module),
+      enable_bpf_stats_aggregation_(enable_bpf_stats_aggregation),
       writer_(buffered_writer_, monotonic, time_adjustment, encoder),
       collector_index_({writer_}),
       process_handler_(writer_, collector_index_, log_),
@@ -107,6 +185,19 @@ BufferedPoller::BufferedPoller(
     add_handler<tcp_data_message_metadata, &BufferedPoller::handle_tcp_data>();
   }
 
+  if (enable_bpf_stats_aggregation_) {
+    n_possible_cpus_ = ebpf::get_possible_cpus().size();
+    tcp_stats_agg_fd_ = probe_handler_.get_table_fd(bpf_module_, "tcp_stats_agg");
+    udp_stats_agg_fd_ = probe_handler_.get_table_fd(bpf_module_, "udp_stats_agg");
+    if (n_possible_cpus_ == 0 || tcp_stats_agg_fd_ < 0 || udp_stats_agg_fd_ < 0) {
+      throw std::runtime_error("BufferedPoller: could not set up BPF stats aggregation tables");
+    }
+  }
+
+  if (dns_parse_threads > 0) {
+    dns_parse_pool_ = std::make_unique<DnsParsePool>(dns_parse_threads);
+  }
+
   // Create a tcp data handler for the tcp_data message
   tcp_data_handler_ = std::make_unique<TCPDataHandler>(loop_, bpf_module, writer_, container, log_);
 
@@ -141,25 +232,32 @@ void BufferedPoller::process_samples(bool is_event)
     LOG::debug_in(AgentLogKind::PERF, "* Perf event triggered *\ncontainer_ is:\n{}\n\n", cstr);
   }
 
+  if (dns_parse_pool_) {
+    submit_dns_packets(reader);
+  }
+
   // read the top contents of our container into our buffer
   while (!reader.empty()) {
     auto peek_type = reader.peek_type();
 
-    auto handle_bpf_lost_samples = [this]() {
-      send_report_if_recent_loss();
-      log_.warn("Lost {} bpf samples - restarting kernel collector.", lost_count_);
-      kernel_collector_restarter_.request_restart();
-    };
-
 #ifndef NDEBUG
     if (debug_bpf_lost_samples_) {
+      debug_bpf_lost_samples_ = false;
       lost_count_ += 1;
-      handle_bpf_lost_samples();
-      return;
+      if (handle_bpf_lost_samples(1)) {
+        return;
+      }
+      continue;
     }
 #endif
 
     if (peek_type == PERF_RECORD_SAMPLE) {
+      u64 const timestamp = reader.peek_timestamp();
+      if (lost_interval_count_) {
+        report_lost_interval(timestamp);
+      }
+      last_sample_timestamp_ = timestamp;
+
       if (bpf_dump_file_) {
         auto const view = reader.peek_message();
         bpf_dump_file_.write_all(view.first);
@@ -177,18 +275,26 @@ void BufferedPoller::process_samples(bool is_event)
       /* if rpc_id is in handlers list, call it. */
       u32 handlers_idx = agent_internal_hash(rpc_id);
       if (handlers_[handlers_idx] != nullptr) {
-        (this->*handlers_[handlers_idx])(reader, length);
+        if (handler_observer_) {
+          handler_observer_->before_handler(rpc_id);
+          (this->*handlers_[handlers_idx])(reader, length);
+          handler_observer_->after_handler(rpc_id);
+        } else {
+          (this->*handlers_[handlers_idx])(reader, length);
+        }
         continue;
       }
 
       /* unknown message -- this is a bug */
       throw std::runtime_error("unexpected bpf message\n");
     } else if (peek_type == PERF_RECORD_LOST) {
-      lost_count_ += reader.peek_n_lost();
+      u64 const n_lost = reader.peek_n_lost();
+      lost_count_ += n_lost;
       reader.pop();
 
-      handle_bpf_lost_samples();
-      return;
+      if (handle_bpf_lost_samples(n_lost)) {
+        return;
+      }
     } else {
       throw std::runtime_error("Unexpected record type\n");
     }
@@ -197,6 +303,9 @@ void BufferedPoller::process_samples(bool is_event)
   /* do we need to process stats? */
   s16 relative = tcp_socket_stats_.relative_timeslot(t);
   if (relative != 0) {
+    if (enable_bpf_stats_aggregation_) {
+      drain_aggregated_stats();
+    }
     send_stats_from_queue(t);
     udp_send_stats_from_queue(t);
     send_report_if_recent_loss();
@@ -208,6 +317,44 @@ void BufferedPoller::process_samples(bool is_event)
   }
 }
 
+void BufferedPoller::submit_dns_packets(PerfReader const &reader)
+{
+  using dns_packet = ebpf_net::agent_internal::dns_packet_message_metadata;
+
+  /* offset of the packet from the timestamp, as laid out for handle_dns_message() */
+  static constexpr std::size_t packet_offset = sizeof(u64) + dns_packet::wire_message_size;
+
+  /* rotated so that under load, when the scan stops before the last ring, every ring still gets scanned ahead */
+  reader.scan_ahead(DNS_PARSE_SCAN_AHEAD_SAMPLES, dns_scan_ahead_first_ring_++, [this](auto const &ring) {
+    if (ring.peek_aligned_u16(2 * sizeof(u64)) != dns_packet::rpc_id) {
+      return;
+    }
+
+    u32 const length = ring.peek_aligned_u32(sizeof(u32));
+    if (length < packet_offset) {
+      return;
+    }
+
+    dns_packet::wire_message msg;
+    ring.peek_copy(reinterpret_cast<char *>(&msg), 2 * sizeof(u64), sizeof(msg));
+
+    std::size_t const pkt_len = msg._len - jb_agent_internal__dns_packet__data_size;
+    if (pkt_len > DNS_MAX_PACKET_LEN || packet_offset + pkt_len > length) {
+      /* garbled, let handle_dns_message() deal with it */
+      return;
+    }
+
+    /* the message may wrap around the end of the ring */
+    auto const [first, second] = ring.peek();
+    std::string_view const head = first.substr(std::min(packet_offset, first.size()), pkt_len);
+    std::string_view const tail = second.substr(packet_offset - std::min(packet_offset, first.size()), pkt_len - head.size());
+
+    dns_parse_pool_->submit({.timestamp = ring.peek_aligned_u64(sizeof(u64)), .sk = msg.sk}, head, tail);
+  });
+
+  dns_parse_pool_->notify();
+}
+
 void BufferedPoller::send_report_if_recent_loss()
 {
   if (lost_count_ == notified_lost_count_) {
@@ -223,6 +370,169 @@ u64 BufferedPoller::serv_lost_count()
   return lost_count_;
 }
 
+bool BufferedPoller::handle_bpf_lost_samples(u64 n_lost)
+{
+  send_report_if_recent_loss();
+
+  if (!lost_interval_count_) {
+    lost_interval_start_ = last_sample_timestamp_;
+  }
+  lost_interval_count_ += n_lost;
+
+  /* tables are still being populated during startup, start over from a clean state */
+  if (!all_probes_loaded_) {
+    log_.warn("Lost {} bpf samples while loading probes - restarting kernel collector.", lost_count_);
+    kernel_collector_restarter_.request_restart();
+    return true;
+  }
+
+  /* further losses before the pending resync runs are covered by it */
+  if (resync_requested_) {
+    return false;
+  }
+
+  u64 const now = monotonic();
+  while (!recent_loss_resyncs_.empty() && recent_loss_resyncs_.front() + loss_resync_window_ns < now) {
+    recent_loss_resyncs_.pop_front();
+  }
+
+  if (recent_loss_resyncs_.size() >= max_loss_resyncs_per_window) {
+    log_.warn(
+        "Lost {} bpf samples, {} times in the last {}s - restarting kernel collector.",
+        lost_count_,
+        recent_loss_resyncs_.size() + 1,
+        loss_resync_window_ns / 1'000'000'000ull);
+    kernel_collector_restarter_.request_restart();
+    return true;
+  }
+
+  recent_loss_resyncs_.push_back(now);
+  resync_requested_ = true;
+  log_.warn("Lost {} bpf samples - resynchronizing socket and process tables.", lost_count_);
+  return false;
+}
+
+void BufferedPoller::report_lost_interval(u64 end_timestamp)
+{
+  log_.warn(
+      "Lost {} bpf samples over {}ms (timestamps {} to {})",
+      lost_interval_count_,
+      (end_timestamp - std::min(lost_interval_start_, end_timestamp)) / 1'000'000,
+      lost_interval_start_,
+      end_timestamp);
+  lost_interval_count_ = 0;
+}
+
+void BufferedPoller::reconcile_bpf_tables()
+{
+  int const tcp_fd = probe_handler_.get_table_fd(bpf_module_, "tcp_open_sockets");
+  int const udp_fd = probe_handler_.get_table_fd(bpf_module_, "udp_open_sockets");
+  int const tgid_fd = probe_handler_.get_table_fd(bpf_module_, "tgid_info_table");
+
+  /* Events still queued in the rings when the BPF tables are read would make
+   * them look out of sync with userland, so the tables are read, the rings
+   * drained, and the tables read again. An entry counts as closed only if
+   * neither read has it, and as untracked only if both have it: anything that
+   * opened or closed in between had its event handled by the drain. */
+  absl::flat_hash_set<u64> const tcp_before =
+      tcp_fd >= 0 ? bpf_table_keys<u64>(tcp_fd, 0, TABLE_SIZE__TCP_OPEN_SOCKETS) : absl::flat_hash_set<u64>{};
+  absl::flat_hash_set<u64> const udp_before =
+      udp_fd >= 0 ? bpf_table_keys<u64>(udp_fd, 0, TABLE_SIZE__UDP_OPEN_SOCKETS) : absl::flat_hash_set<u64>{};
+  /* tgids are bounded by PID_MAX_LIMIT, so ~0u is never in the table */
+  absl::flat_hash_set<u32> const tgids_before =
+      tgid_fd >= 0 ? bpf_table_keys<u32>(tgid_fd, ~0u, TABLE_SIZE__TGID_INFO) : absl::flat_hash_set<u32>{};
+
+  start(1, 1);
+
+  message_metadata const metadata{.timestamp = monotonic() + time_adjustment_};
+
+  /* TCP */
+  if (tcp_fd >= 0) {
+    auto const bpf_sks = bpf_table_keys<u64>(tcp_fd, 0, TABLE_SIZE__TCP_OPEN_SOCKETS);
+
+    std::vector<u64> closed;
+    for (auto const &[sk, index] : tcp_socket_table_) {
+      if (!bpf_sks.contains(sk) && !tcp_before.contains(sk)) {
+        closed.push_back(sk);
+      }
+    }
+    for (u64 sk : closed) {
+      jb_agent_internal__close_sock_info msg = {};
+      msg.sk = sk;
+      handle_close_socket(metadata, msg);
+    }
+
+    std::size_t n_untracked = 0;
+    for (u64 sk : bpf_sks) {
+      if (tcp_before.contains(sk) && !tcp_socket_table_.contains(sk)) {
+        bpf_delete_elem(tcp_fd, &sk);
+        ++n_untracked;
+      }
+    }
+
+    LOG::debug("reconcile_bpf_tables: closed {} tcp sockets, re-probing {}", closed.size(), n_untracked);
+  }
+
+  /* UDP */
+  if (udp_fd >= 0) {
+    auto const bpf_sks = bpf_table_keys<u64>(udp_fd, 0, TABLE_SIZE__UDP_OPEN_SOCKETS);
+
+    std::vector<u64> closed;
+    for (auto const &[sk, index] : udp_socket_table_) {
+      if (!bpf_sks.contains(sk) && !udp_before.contains(sk)) {
+        closed.push_back(sk);
+      }
+    }
+    for (u64 sk : closed) {
+      jb_agent_internal__udp_destroy_socket msg = {};
+      msg.sk = sk;
+      handle_udp_destroy_socket(metadata, msg);
+    }
+
+    std::size_t n_untracked = 0;
+    for (u64 sk : bpf_sks) {
+      if (udp_before.contains(sk) && !udp_socket_table_.contains(sk)) {
+        bpf_delete_elem(udp_fd, &sk);
+        ++n_untracked;
+      }
+    }
+
+    LOG::debug("reconcile_bpf_tables: closed {} udp sockets, re-probing {}", closed.size(), n_untracked);
+  }
+
+  /* processes */
+  if (tgid_fd >= 0) {
+    auto const bpf_tgids = bpf_table_keys<u32>(tgid_fd, ~0u, TABLE_SIZE__TGID_INFO);
+    auto const tracked_tgids = process_handler_.tracked_tgids();
+    absl::flat_hash_set<u32> const tracked(tracked_tgids.begin(), tracked_tgids.end());
+
+    std::size_t n_closed = 0;
+    for (u32 tgid : tracked_tgids) {
+      if (!bpf_tgids.contains(tgid) && !tgids_before.contains(tgid)) {
+        jb_agent_internal__pid_close msg = {};
+        msg.pid = tgid;
+        handle_pid_close(metadata, msg);
+        ++n_closed;
+      }
+    }
+
+    std::size_t n_untracked = 0;
+    for (u32 tgid : bpf_tgids) {
+      if (tgids_before.contains(tgid) && !tracked.contains(tgid)) {
+        bpf_delete_elem(tgid_fd, &tgid);
+        ++n_untracked;
+      }
+    }
+
+    LOG::debug("reconcile_bpf_tables: closed {} processes, re-probing {}", n_closed, n_untracked);
+  }
+}
+
+void BufferedPoller::resync_completed()
+{
+  resync_requested_ = false;
+}
+
 template <
     typename MessageMetadata,
     BufferedPoller::message_handler_fn<MessageMetadata> Handler,
@@ -330,24 +640,18 @@ void BufferedPoller::handle_dns_message(message_metadata const &metadata, jb_age
   }
   u32 sk_id = pos.index;
 
-  /* make variables to parse the DNS packet */
-  char hostname_out[DNS_NAME_MAX_LENGTH];
-  int hostname_len = 0;
-  int num_ipv4_addrs = MAX_ENCODED_IP_ADDRS;
-  struct in_addr ipv4_addrs[MAX_ENCODED_IP_ADDRS];
-  int num_ipv6_addrs = MAX_ENCODED_IP_ADDRS;
-  struct in6_addr ipv6_addrs[MAX_ENCODED_IP_ADDRS];
+  /* parse the packet, unless the worker pool already did */
+  DnsParseResult parsed;
+  if (!dns_parse_pool_ || !dns_parse_pool_->take({.timestamp = metadata.timestamp, .sk = sk}, pkt_len, parsed)) {
+    parse_dns_packet(dns_packet.data(), pkt_len, parsed);
+  }
 
   /* see if this is a request */
-  uint16_t type_out;
-  uint16_t qid_out;
-  int is_response;
-  int ret = dns_parse_query(dns_packet.data(), pkt_len, &is_response, &type_out, &qid_out, hostname_out, &hostname_len);
-  if (ret != ARES_SUCCESS) {
+  if (parsed.query_status != ARES_SUCCESS) {
     LOG::debug_in(
         AgentLogKind::DNS,
         "dns_parse_query returned {}, total len {} valid len {} packet {:n}",
-        ret,
+        parsed.query_status,
         msg.total_len,
         pkt_len,
         spdlog::to_hex(dns_packet.data(), dns_packet.data() + pkt_len));
@@ -359,14 +663,22 @@ void BufferedPoller::handle_dns_message(message_metadata const &metadata, jb_age
       "{}\nis_response {} type_out {} qid_out {} hostname {}",
       msg.total_len,
       pkt_len,
-      is_response,
-      type_out,
-      qid_out,
-      std::string_view(hostname_out, hostname_len));
+      parsed.is_response,
+      parsed.type,
+      parsed.qid,
+      std::string_view(parsed.question, parsed.question_len));
+
+  if (!parsed.is_response) {
+    /* query ids are random, responses to requests left out find no match */
+    if (throttled_ && (parsed.qid % THROTTLED_DNS_SAMPLING) != 0) {
+      return;
+    }
 
-  if (!is_response) {
     DnsRequests::dns_request_key key{
-        .qid = qid_out, .type = type_out, .name = std::string(hostname_out, hostname_len), .is_rx = (bool)msg.is_rx};
+        .qid = parsed.qid,
+        .type = parsed.type,
+        .name = std::string_view(parsed.question, parsed.question_len),
+        .is_rx = (bool)msg.is_rx};
 
     // Add request to table, for later processing when response shows up
     DnsRequests::dns_request_value value{.timestamp_ns = metadata.timestamp, .sk = sk};
@@ -376,22 +688,26 @@ void BufferedPoller::handle_dns_message(message_metadata const &metadata, jb_age
 
   // looking for requests in the other direction
   DnsRequests::dns_request_key key{
-      .qid = qid_out, .type = type_out, .name = std::string(hostname_out, hostname_len), .is_rx = !msg.is_rx};
+      .qid = parsed.qid,
+      .type = parsed.type,
+      .name = std::string_view(parsed.question, parsed.question_len),
+      .is_rx = !msg.is_rx};
 
-  // parse the reply
+  // the parsed reply
   int send_a_aaaa_response = 0;
   u16 sent_hostname_len = 0;
-  char *sent_hostname = NULL;
+  char const *sent_hostname = NULL;
 
-  ret = dns_parse_a_aaaa_reply(
-      dns_packet.data(), pkt_len, hostname_out, &hostname_len, ipv4_addrs, &num_ipv4_addrs, ipv6_addrs, &num_ipv6_addrs);
+  int const hostname_len = parsed.hostname_len;
+  int const num_ipv4_addrs = parsed.num_ipv4_addrs;
+  int const num_ipv6_addrs = parsed.num_ipv6_addrs;
 
   if (hostname_len == 0 || (num_ipv4_addrs + num_ipv6_addrs) == 0) {
     LOG::debug_in(
         AgentLogKind::DNS,
         "dns_parse_a_aaaa_reply returned {}, total len {} valid len {} "
         "packet {:n}",
-        ret,
+        parsed.reply_status,
         msg.total_len,
         pkt_len,
         spdlog::to_hex(dns_packet.data(), dns_packet.data() + pkt_len));
@@ -407,115 +723,114 @@ void BufferedPoller::handle_dns_message(message_metadata const &metadata, jb_age
         "{}\nnum_ipv4_addrs {} num_ipv6_addrs {}",
         msg.total_len,
         pkt_len,
-        is_response,
-        type_out,
-        qid_out,
-        std::string_view(hostname_out, hostname_len));
+        num_ipv4_addrs,
+        num_ipv6_addrs);
 
     send_a_aaaa_response = 1;
     // truncate hostname */
     sent_hostname_len = (hostname_len < DNS_NAME_MAX_LENGTH) ? (u16)hostname_len : DNS_NAME_MAX_LENGTH;
-    sent_hostname = hostname_out + hostname_len - sent_hostname_len;
+    sent_hostname = parsed.hostname + hostname_len - sent_hostname_len;
   }
 
   // Only process DNS replies have have a matching request
   // otherwise someone could be spoofing us
-  std::list<DnsRequests::Request> reqs;
-  dns_requests_.lookup(key, reqs);
-  if (reqs.size() > 0) {
-
-    /* see if this response matches requests we have seen */
-    for (auto &req : reqs) {
-
-      /* submit the dns response with latency information */
-      u64 request_timestamp = req->second.timestamp_ns;
-      u64 latency_ns = metadata.timestamp - request_timestamp;
-
-      if (send_a_aaaa_response) {
-        LOG::debug_in(
-            AgentLogKind::DNS,
-            "sending DNS for hostname {} num_ipv4_addrs:{} "
-            "num_ipv6_addrs:{} latency_ns:{}",
-            sent_hostname,
-            num_ipv4_addrs,
-            num_ipv6_addrs,
-            latency_ns);
-
-        // if the socket is exactly the same, then we match
-        bool matching = sk == req->second.sk;
-        if (!matching) {
-          // if it's not, but the port and address is exactly the same, then we
-          // also match
-          auto pos1 = udp_socket_table_.find(sk);
-          if (pos1.index == udp_socket_table_.invalid) {
-            if (!udp_socket_table_ever_full_ && all_probes_loaded_) {
-              log_.error("ERROR: handle_dns_message - sk not found. sk={:x}", sk);
-            }
+  bool has_requests = false;
+
+  /* see if this response matches requests we have seen */
+  dns_requests_.for_each_with_key(key, [&](DnsRequests::Request req) {
+    has_requests = true;
+    auto const &request = dns_requests_.value(req);
+
+    /* submit the dns response with latency information */
+    u64 request_timestamp = request.timestamp_ns;
+    u64 latency_ns = metadata.timestamp - request_timestamp;
+
+    if (send_a_aaaa_response) {
+      LOG::debug_in(
+          AgentLogKind::DNS,
+          "sending DNS for hostname {} num_ipv4_addrs:{} "
+          "num_ipv6_addrs:{} latency_ns:{}",
+          sent_hostname,
+          num_ipv4_addrs,
+          num_ipv6_addrs,
+          latency_ns);
+
+      // if the socket is exactly the same, then we match
+      bool matching = sk == request.sk;
+      if (!matching) {
+        // if it's not, but the port and address is exactly the same, then we
+        // also match
+        auto pos1 = udp_socket_table_.find(sk);
+        if (pos1.index == udp_socket_table_.invalid) {
+          if (!udp_socket_table_ever_full_ && all_probes_loaded_) {
+            log_.error("ERROR: handle_dns_message - sk not found. sk={:x}", sk);
           }
-          auto pos2 = udp_socket_table_.find(req->second.sk);
-          if (pos2.index == udp_socket_table_.invalid) {
-            if (!udp_socket_table_ever_full_ && all_probes_loaded_) {
-              log_.error("ERROR: handle_dns_message - sk2 not found. sk2={}", req->second.sk);
-            }
-          }
-
-          // more strict would be this, thought i'm not sure port is necessarily
-          // the same in k8s environments either. matching =
-          // pos1.entry->pid==pos2.entry->pid &&
-          // pos1.entry->lport==pos2.entry->lport;
-          matching = pos1.entry->pid == pos2.entry->pid;
-
-          // why does the socket not match for request and response
-          if (!matching) {
-            LOG::debug_in(
-                AgentLogKind::DNS,
-                "dns socket mismatch {}@{}:{}(pid={}) != {}@{}:{}(pid={})\n"
-                "hostname: {}  num_ipv4_addrs:{}  num_ipv6_addrs:{}  latency: "
-                "{}",
-                sk,
-                IPv6Address::from(pos1.entry->laddr),
-                pos1.entry->lport,
-                pos1.entry->pid,
-                req->second.sk,
-                IPv6Address::from(pos2.entry->laddr),
-                pos2.entry->lport,
-                pos2.entry->pid,
-                sent_hostname,
-                num_ipv4_addrs,
-                num_ipv6_addrs,
-                latency_ns);
+        }
+        auto pos2 = udp_socket_table_.find(request.sk);
+        if (pos2.index == udp_socket_table_.invalid) {
+          if (!udp_socket_table_ever_full_ && all_probes_loaded_) {
+            log_.error("ERROR: handle_dns_message - sk2 not found. sk2={}", request.sk);
           }
         }
 
-        // if receiving a dns response, this is a client and 'total time' is the
-        // appropriate metric if sending a dns response, this is a server and
-        // 'processing time' is the appropriate metric
-        writer_.dns_response_tstamp(
-            metadata.timestamp,
-            sk_id,
-            hostname_len,
-            /* domain_name */ jb_blob{sent_hostname, sent_hostname_len},
-            /* ipv4_addrs */
-            jb_blob{(char *)ipv4_addrs, (u16)(sizeof(u32) * num_ipv4_addrs)},
-            /* ipv6_addrs */
-            jb_blob{(char *)ipv6_addrs, (u16)(sizeof(struct in6_addr) * num_ipv6_addrs)},
-            latency_ns,
-            msg.is_rx ? SC_CLIENT : SC_SERVER);
+        // more strict would be this, thought i'm not sure port is necessarily
+        // the same in k8s environments either. matching =
+        // pos1.entry->pid==pos2.entry->pid &&
+        // pos1.entry->lport==pos2.entry->lport;
+        matching = pos1.entry->pid == pos2.entry->pid;
+
+        // why does the socket not match for request and response
+        if (!matching) {
+          LOG::debug_in(
+              AgentLogKind::DNS,
+              "dns socket mismatch {}@{}:{}(pid={}) != {}@{}:{}(pid={})\n"
+              "hostname: {}  num_ipv4_addrs:{}  num_ipv6_addrs:{}  latency: "
+              "{}",
+              sk,
+              IPv6Address::from(pos1.entry->laddr),
+              pos1.entry->lport,
+              pos1.entry->pid,
+              request.sk,
+              IPv6Address::from(pos2.entry->laddr),
+              pos2.entry->lport,
+              pos2.entry->pid,
+              sent_hostname,
+              num_ipv4_addrs,
+              num_ipv6_addrs,
+              latency_ns);
+        }
       }
-      // else {
-      //  // someday add other dns responses, or dns resolution errors
-      //}
+
+      // if receiving a dns response, this is a client and 'total time' is the
+      // appropriate metric if sending a dns response, this is a server and
+      // 'processing time' is the appropriate metric
+      writer_.dns_response_tstamp(
+          metadata.timestamp,
+          sk_id,
+          hostname_len,
+          /* domain_name */ jb_blob{sent_hostname, sent_hostname_len},
+          /* ipv4_addrs */
+          jb_blob{(char const *)parsed.ipv4_addrs, (u16)(sizeof(u32) * num_ipv4_addrs)},
+          /* ipv6_addrs */
+          jb_blob{(char const *)parsed.ipv6_addrs, (u16)(sizeof(struct in6_addr) * num_ipv6_addrs)},
+          latency_ns,
+          msg.is_rx ? SC_CLIENT : SC_SERVER);
     }
+    // else {
+    //  // someday add other dns responses, or dns resolution errors
+    //}
+  });
 
+  if (has_requests) {
     /* remove request key */
     dns_requests_.remove_all_with_key(key);
   }
 }
 
-void BufferedPoller::timeout_dns_request(u64 timestamp_ns, const DnsRequests::Request &req)
+void BufferedPoller::timeout_dns_request(u64 timestamp_ns, DnsRequests::Request req)
 {
-  u64 t_req = req->second.timestamp_ns;
-  u64 sk = req->second.sk;
+  u64 t_req = dns_requests_.value(req).timestamp_ns;
+  u64 sk = dns_requests_.value(req).sk;
 
   // Look up the udp socket table entry
   auto pos = udp_socket_table_.find(sk);
@@ -531,8 +846,9 @@ void BufferedPoller::timeout_dns_request(u64 timestamp_ns, const DnsRequests::Re
     u64 duration_ns = (timestamp_ns - t_req);
 
     /* truncate hostname */
-    const char *hostname_out = req->first.name.c_str();
-    size_t hostname_len = req->first.name.size();
+    std::string_view const name = dns_requests_.name(req);
+    const char *hostname_out = name.data();
+    size_t hostname_len = name.size();
 
     u16 sent_hostname_len = (hostname_len < DNS_NAME_MAX_LENGTH) ? (u16)hostname_len : DNS_NAME_MAX_LENGTH;
 
@@ -560,10 +876,9 @@ void BufferedPoller::slow_poll()
 
 void BufferedPoller::process_dns_timeouts(u64 t)
 {
-  std::list<DnsRequests::Request> old_reqs;
-  dns_requests_.lookup_older_than(t - DNS_TIMEOUT_TIME_NS, old_reqs);
-  for (auto &req : old_reqs) {
-    timeout_dns_request(t, req);
+  /* timeout_dns_request() removes the request, moving on to the next oldest */
+  while (auto const req = dns_requests_.oldest_older_than(t - DNS_TIMEOUT_TIME_NS)) {
+    timeout_dns_request(t, *req);
   }
 }
 
@@ -812,6 +1127,10 @@ void BufferedPoller::handle_http_response(message_metadata const &metadata, jb_a
       msg.latency_ns,
       client_server_type_to_string((enum CLIENT_SERVER_TYPE)msg.client_server));
 
+  if (throttled_) {
+    return;
+  }
+
   writer_.http_response_tstamp(metadata.timestamp, msg.sk, msg.pid, msg.code, msg.latency_ns, msg.client_server);
 }
 
@@ -829,6 +1148,27 @@ void BufferedPoller::send_socket_stats(u64 t, u64 sk, tcp_statistics &stats)
   stats.valid = false;
 }
 
+void BufferedPoller::carry_socket_stats(u32 index, tcp_statistics &stats)
+{
+  auto &next = tcp_socket_stats_.lookup_relative(index, 1, true).second;
+
+  if (!next.valid) {
+    next = stats;
+  } else {
+    next.diff_bytes_acked += stats.diff_bytes_acked;
+    next.diff_delivered += stats.diff_delivered;
+    next.diff_retrans += stats.diff_retrans;
+    next.max_srtt = std::max(next.max_srtt, stats.max_srtt);
+
+    next.diff_bytes_received += stats.diff_bytes_received;
+    next.diff_rcv_holes += stats.diff_rcv_holes;
+    next.diff_rcv_delivered += stats.diff_rcv_delivered;
+    next.max_rcv_rtt = std::max(next.max_rcv_rtt, stats.max_rcv_rtt);
+  }
+
+  stats.valid = false;
+}
+
 void BufferedPoller::send_stats_from_queue(u64 t)
 {
   if (tcp_socket_stats_.relative_timeslot(t) == 0) {
@@ -836,6 +1176,12 @@ void BufferedPoller::send_stats_from_queue(u64 t)
     return;
   }
 
+  /* while throttled, stats are carried over to the next timeslot rather than sent, but for every few timeslots */
+  bool const carry = throttled_ && (++carried_stats_timeslots_ < THROTTLED_STATS_TIMESLOTS);
+  if (!carry) {
+    carried_stats_timeslots_ = 0;
+  }
+
   auto &queue = tcp_socket_stats_.current_queue();
   while (!queue.empty()) {
     /* get the next index */
@@ -845,10 +1191,14 @@ void BufferedPoller::send_stats_from_queue(u64 t)
     auto &stats = tcp_socket_stats_.lookup_relative(index, 0, false).second;
 
     if (stats.valid) {
-      /* write the message */
-      send_socket_stats(t, tcp_index_to_sk_[index], stats);
+      if (carry) {
+        carry_socket_stats(index, stats);
+      } else {
+        /* write the message */
+        send_socket_stats(t, tcp_index_to_sk_[index], stats);
+      }
 
-      /* send_socket_stats sets stats.valid = false */
+      /* both set stats.valid = false */
     }
     queue.pop();
   }
@@ -908,11 +1258,13 @@ void BufferedPoller::handle_udp_destroy_socket(message_metadata const &metadata,
     return;
   }
 
+  if (enable_bpf_stats_aggregation_) {
+    collect_aggregated_udp_stats(metadata.timestamp, msg.sk);
+  }
+
   // Ensure dns queries on this socket are timed out
-  std::list<DnsRequests::Request> reqs;
-  dns_requests_.lookup_socket(msg.sk, reqs);
-  for (auto &req : reqs) {
-    timeout_dns_request(metadata.timestamp, req);
+  while (auto const req = dns_requests_.any_with_socket(msg.sk)) {
+    timeout_dns_request(metadata.timestamp, *req);
   }
 
   /* send out statistics message if available */
@@ -1202,6 +1554,100 @@ void BufferedPoller::udp_send_stats_from_queue(u64 t)
   }
 }
 
+void BufferedPoller::drain_aggregated_stats()
+{
+  int const n_tcp = drain_percpu_hash<u64, tcp_stats_agg_t>(
+      tcp_stats_agg_fd_, n_possible_cpus_, [this](u64 sk, tcp_stats_agg_t const *per_cpu) {
+        /* counters are cumulative: take them from the most recent sample, and the max of the rtts */
+        tcp_stats_agg_t const *latest = nullptr;
+        u32 max_srtt = 0;
+        u32 max_rcv_rtt = 0;
+        for (std::size_t cpu = 0; cpu < n_possible_cpus_; ++cpu) {
+          auto const &agg = per_cpu[cpu];
+          if (agg.last_update == 0) {
+            continue;
+          }
+          if (!latest || agg.last_update > latest->last_update) {
+            latest = &agg;
+          }
+          max_srtt = std::max(max_srtt, agg.max_srtt);
+          max_rcv_rtt = std::max(max_rcv_rtt, agg.max_rcv_rtt);
+        }
+        if (!latest) {
+          return;
+        }
+
+        jb_agent_internal__rtt_estimator msg = {};
+        msg.sk = sk;
+        msg.srtt = max_srtt;
+        msg.bytes_acked = latest->bytes_acked;
+        msg.packets_delivered = latest->packets_delivered;
+        msg.packets_retrans = latest->packets_retrans;
+        msg.rcv_holes = latest->rcv_holes;
+        msg.bytes_received = latest->bytes_received;
+        msg.rcv_delivered = latest->rcv_delivered;
+        msg.rcv_rtt = max_rcv_rtt;
+        handle_rtt_estimator(message_metadata{.timestamp = latest->last_update}, msg);
+      });
+  if (n_tcp < 0) {
+    log_.error("drain_aggregated_stats: failed to drain tcp stats: {}", strerror(-n_tcp));
+  }
+
+  int const n_udp = drain_percpu_hash<udp_stats_agg_key_t, udp_stats_agg_t>(
+      udp_stats_agg_fd_, n_possible_cpus_, [this](udp_stats_agg_key_t const &key, udp_stats_agg_t const *per_cpu) {
+        jb_agent_internal__udp_stats msg = {};
+        msg.sk = key.sk;
+        msg.is_rx = key.is_rx;
+        u64 last_update = 0;
+        for (std::size_t cpu = 0; cpu < n_possible_cpus_; ++cpu) {
+          msg.packets += per_cpu[cpu].packets;
+          msg.bytes += per_cpu[cpu].bytes;
+          last_update = std::max(last_update, per_cpu[cpu].last_update);
+        }
+        if (msg.packets == 0) {
+          return;
+        }
+        handle_udp_stats(message_metadata{.timestamp = last_update}, msg);
+      });
+  if (n_udp < 0) {
+    log_.error("drain_aggregated_stats: failed to drain udp stats: {}", strerror(-n_udp));
+  }
+
+  LOG::debug_in(AgentLogKind::PERF, "drain_aggregated_stats: tcp={} udp={}", n_tcp, n_udp);
+}
+
+void BufferedPoller::collect_aggregated_udp_stats(u64 t, u64 sk)
+{
+  std::vector<udp_stats_agg_t> per_cpu(n_possible_cpus_);
+
+  for (u32 is_rx = 0; is_rx < 2; ++is_rx) {
+    udp_stats_agg_key_t key = {.sk = sk, .is_rx = is_rx};
+    if (bpf_lookup_elem(udp_stats_agg_fd_, &key, per_cpu.data()) != 0) {
+      continue;
+    }
+
+    jb_agent_internal__udp_stats msg = {};
+    msg.sk = sk;
+    msg.is_rx = is_rx;
+    u64 last_update = 0;
+    for (auto const &agg : per_cpu) {
+      msg.packets += agg.packets;
+      msg.bytes += agg.bytes;
+      last_update = std::max(last_update, agg.last_update);
+    }
+
+    /* BPF clears the entry when a new socket reuses the address, so anything newer than the close is not ours */
+    if (last_update > t) {
+      continue;
+    }
+
+    bpf_delete_elem(udp_stats_agg_fd_, &key);
+    if (msg.packets > 0) {
+      handle_udp_stats(message_metadata{.timestamp = last_update}, msg);
+    }
+  }
+}
+
 u32 BufferedPoller::u64_hasher::operator()(u64 const &s) const noexcept
 {
   return lookup3_hashword((u32 *)&s, sizeof(u64) / 4, 0x7AFBAF00);
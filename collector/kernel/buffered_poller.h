@@ -16,6 +16,7 @@
 #include <channel/buffered_writer.h>
 #include <collector/kernel/bpf_src/render_bpf.h>
 #include <collector/kernel/cgroup_handler.h>
+#include <collector/kernel/dns_parse_pool.h>
 #include <collector/kernel/dns_requests.h>
 #include <collector/kernel/nat_handler.h>
 #include <collector/kernel/perf_poller.h>
@@ -28,6 +29,7 @@
 #include <generated/ebpf_net/ingest/writer.h>
 #include <generated/ebpf_net/kernel_collector/index.h>
 
+#include <deque>
 #include <memory>
 
 class KernelCollectorRestarter;
@@ -54,6 +56,8 @@ public:
    * @param writer: the writer using which to send messages
    * @param time_adjustment: how much to add to CLOCK_MONOTONIC when comparing
    *   to ring timestamp
+   * @param dns_parse_threads: number of threads parsing DNS packets ahead of
+   *   their handler, or 0 to parse them inline
    */
   BufferedPoller(
       uv_loop_t &loop,
@@ -65,6 +69,8 @@ public:
       logging::Logger &log,
       ProbeHandler &probe_handler,
       ebpf::BPFModule &bpf_module,
+      bool enable_bpf_stats_aggregation,
+      std::size_t dns_parse_threads,
       u64 socket_stats_interval_sec,
       CgroupHandler::CgroupSettings const &cgroup_settings,
       ::ebpf_net::ingest::Encoder *encoder,
@@ -109,12 +115,42 @@ public:
 
   void slow_poll();
 
+  /**
+   * Has the poller send less while the server limits what it receives:
+   *   * TCP socket stats are sent every few timeslots, accumulated since
+   *   * HTTP responses are dropped
+   *   * only a sample of DNS requests is tracked, picked by query id
+   */
+  void set_throttled(bool throttled) { throttled_ = throttled; }
+
   /**
    * let us know when all the probes are loaded
    * and have achieved steady-state
    */
   void set_all_probes_loaded(void);
 
+  /**
+   * Returns true if BPF samples were lost and the socket and process tables
+   *   should be resynchronized
+   */
+  bool resync_requested() const { return resync_requested_; }
+
+  /**
+   * Reconciles the userland socket and process tables with the BPF ones,
+   *   after BPF samples were lost. Drains the rings between two reads of the
+   *   BPF tables, so that events still queued are not taken for losses:
+   *   * entries only tracked in userland are closed, since their close
+   *     notification might have been lost
+   *   * entries only tracked in BPF are removed from the BPF tables, so that
+   *     probing existing sockets and processes reports them again
+   */
+  void reconcile_bpf_tables();
+
+  /**
+   * Marks the resynchronization requested after lost samples as done
+   */
+  void resync_completed();
+
 #ifndef NDEBUG
   /**
    * Debug code for internal development to simulate lost BPF samples (PERF_RECORD_LOST) in BufferedPoller.
@@ -122,7 +158,37 @@ public:
   void debug_bpf_lost_samples();
 #endif
 
+  /**
+   * Gets called around each message handler, for profiling
+   */
+  class HandlerObserver {
+  public:
+    virtual ~HandlerObserver() {}
+
+    virtual void before_handler(u16 rpc_id) = 0;
+    virtual void after_handler(u16 rpc_id) = 0;
+  };
+
+  /**
+   * Sets the observer called around each message handler, or nullptr for none
+   */
+  void set_handler_observer(HandlerObserver *observer) { handler_observer_ = observer; }
+
 private:
+  /**
+   * Handles a loss of BPF samples, by requesting either a resync or, if
+   *   losses keep happening, a restart of the kernel collector
+   *
+   * @returns true if a restart was requested and processing should stop
+   */
+  bool handle_bpf_lost_samples(u64 n_lost);
+
+  /**
+   * Reports the interval over which samples were lost, now that the first
+   *   sample after the loss has been seen
+   */
+  void report_lost_interval(u64 end_timestamp);
+
   /**
    * polling point for dns timeout detection
    * called via slow poll
@@ -212,6 +278,14 @@ private:
    */
   void send_socket_stats(u64 t, u64 sk, tcp_statistics &stats);
 
+  /**
+   * Adds the statistics for the entry at @index to its entry in the next
+   *   timeslot, instead of sending them
+   *
+   * Also marks the entry as invalid.
+   */
+  void carry_socket_stats(u32 index, tcp_statistics &stats);
+
   /**
    * Processes the current queue in socket_stats_, sending out messages and
    *   setting entries to stats.queued=false, stats.valid=false, then advances
@@ -277,6 +351,20 @@ private:
    */
   void udp_send_stats_from_queue(u64 t);
 
+  /*** STATS PRE-AGGREGATION ***/
+  /**
+   * Drains the per-CPU tables where BPF pre-aggregates socket statistics,
+   *   feeding their contents to handle_rtt_estimator and handle_udp_stats
+   *   as if they were events. Called once per stats timeslot.
+   */
+  void drain_aggregated_stats();
+
+  /**
+   * Collects the pre-aggregated statistics of a closing udp socket, which
+   *   BPF leaves in place for userland
+   */
+  void collect_aggregated_udp_stats(u64 t, u64 sk);
+
   /*** CONTAINERS ***/
   /**
    * Handler for a new cgroup dir
@@ -297,7 +385,14 @@ private:
   void handle_existing_conntrack_tuple(message_metadata const &metadata, jb_agent_internal__existing_conntrack_tuple &msg);
 
   /*** DNS ***/
-  void timeout_dns_request(u64 timestamp_ns, const DnsRequests::Request &req);
+  void timeout_dns_request(u64 timestamp_ns, DnsRequests::Request req);
+
+  /**
+   * Looks ahead in the batch for DNS packets, and queues them on
+   *   dns_parse_pool_ so they're parsed by the time handle_dns_message
+   *   gets to them.
+   */
+  void submit_dns_packets(PerfReader const &reader);
 
   /*** ERRORS ***/
   void handle_bpf_log(message_metadata const &metadata, jb_agent_internal__bpf_log &msg);
@@ -316,6 +411,13 @@ private:
   IBufferedWriter &buffered_writer_;
   ProbeHandler &probe_handler_;
   ebpf::BPFModule &bpf_module_;
+
+  /* BPF pre-aggregation of socket statistics (ENABLE_BPF_STATS_AGGREGATION) */
+  bool const enable_bpf_stats_aggregation_;
+  std::size_t n_possible_cpus_ = 0;
+  int tcp_stats_agg_fd_ = -1;
+  int udp_stats_agg_fd_ = -1;
+
   ::ebpf_net::ingest::Writer writer_;
   std::unique_ptr<TCPDataHandler> tcp_data_handler_;
   ::ebpf_net::kernel_collector::Index collector_index_;
@@ -326,6 +428,19 @@ private:
   /* the last lost count that a message was sent for */
   u64 notified_lost_count_ = 0;
 
+  /* loss recovery: resync after lost samples, restart only if losses keep happening */
+  static constexpr u64 loss_resync_window_ns = 10 * 60 * 1'000'000'000ull;
+  static constexpr std::size_t max_loss_resyncs_per_window = 3;
+
+  /* when the resyncs in the current window started, in monotonic time */
+  std::deque<u64> recent_loss_resyncs_;
+  bool resync_requested_ = false;
+
+  /* timestamp of the last sample read, and the loss being tracked since then */
+  u64 last_sample_timestamp_ = 0;
+  u64 lost_interval_start_ = 0;
+  u64 lost_interval_count_ = 0;
+
   handler_fn handlers_[AGENT_INTERNAL_HASH_SIZE];
 
   /* u64 Hasher */
@@ -356,11 +471,20 @@ private:
 
   /* DNS */
   DnsRequests dns_requests_;
+  std::unique_ptr<DnsParsePool> dns_parse_pool_;
+  /* ring submit_dns_packets() starts scanning from */
+  std::size_t dns_scan_ahead_first_ring_ = 0;
 
   bool all_probes_loaded_;
 
+  /* see set_throttled() */
+  bool throttled_ = false;
+  u32 carried_stats_timeslots_ = 0;
+
   KernelCollectorRestarter &kernel_collector_restarter_;
 
+  HandlerObserver *handler_observer_ = nullptr;
+
 #ifndef NDEBUG
   bool debug_bpf_lost_samples_ = false;
 #endif
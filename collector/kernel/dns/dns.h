@@ -14,6 +14,9 @@ extern "C" {
 #define DNS_NAME_MAX_LENGTH 256
 #define MAX_ENCODED_IP_ADDRS 16
 
+/* largest DNS packet the BPF side submits */
+#define DNS_MAX_PACKET_LEN 512
+
 #define MAX_ENCODED_DNS_MESSAGE                                                                                                \
   (/* timestamp */ sizeof(u64) + /* jb message */ jb_ingest__dns_response__data_size +                                         \
    /* ip addrs */ (sizeof(u32) * MAX_ENCODED_IP_ADDRS) + /* DNS name */ DNS_NAME_MAX_LENGTH)
@@ -0,0 +1,183 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <collector/kernel/dns_parse_pool.h>
+
+#include <collector/kernel/dns/ares.h>
+
+#include <stdexcept>
+
+#include <string.h>
+
+void parse_dns_packet(u8 const *packet, int len, DnsParseResult &result)
+{
+  result.question_len = 0;
+  result.reply_status = -1;
+  result.hostname_len = 0;
+  result.num_ipv4_addrs = 0;
+  result.num_ipv6_addrs = 0;
+
+  result.query_status =
+      dns_parse_query(packet, len, &result.is_response, &result.type, &result.qid, result.question, &result.question_len);
+  if (result.query_status != ARES_SUCCESS || !result.is_response) {
+    return;
+  }
+
+  /* the reply parser leaves the hostname untouched if it fails early, in which case the question is used */
+  memcpy(result.hostname, result.question, result.question_len);
+  result.hostname_len = result.question_len;
+
+  result.num_ipv4_addrs = MAX_ENCODED_IP_ADDRS;
+  result.num_ipv6_addrs = MAX_ENCODED_IP_ADDRS;
+  result.reply_status = dns_parse_a_aaaa_reply(
+      packet,
+      len,
+      result.hostname,
+      &result.hostname_len,
+      result.ipv4_addrs,
+      &result.num_ipv4_addrs,
+      result.ipv6_addrs,
+      &result.num_ipv6_addrs);
+}
+
+DnsParsePool::DnsParsePool(std::size_t n_threads, std::size_t n_slots)
+    : slots_(std::make_unique<Slot[]>(n_slots)), n_slots_(n_slots)
+{
+  if (n_threads == 0 || n_slots == 0) {
+    throw std::invalid_argument("DnsParsePool: needs at least one thread and one slot");
+  }
+
+  workers_.reserve(n_threads);
+  for (std::size_t i = 0; i < n_threads; ++i) {
+    workers_.emplace_back([this] { worker_loop(); });
+  }
+}
+
+DnsParsePool::~DnsParsePool()
+{
+  stop_ = true;
+
+  /* workers only wake up when the published sequence number changes */
+  published_.fetch_add(1);
+  published_.notify_all();
+
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+bool DnsParsePool::submit(Key const &key, std::string_view first, std::string_view second)
+{
+  std::size_t const len = first.size() + second.size();
+  if (len > DNS_MAX_PACKET_LEN || slot_by_key_.contains(key)) {
+    return false;
+  }
+
+  u32 const index = next_seq_ % n_slots_;
+  Slot &slot = slots_[index];
+
+  switch (slot.state.load(std::memory_order_acquire)) {
+  case SLOT_QUEUED:
+    /* the pool is full */
+    return false;
+
+  case SLOT_DONE:
+    /* parsed but never taken, e.g. the message was dropped while disconnected, or taken before it was parsed */
+    if (auto const found = slot_by_key_.find(slot.key); found != slot_by_key_.end() && found->second == index) {
+      slot_by_key_.erase(found);
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  memcpy(slot.packet, first.data(), first.size());
+  if (!second.empty()) {
+    memcpy(slot.packet + first.size(), second.data(), second.size());
+  }
+  slot.len = len;
+  slot.key = key;
+  slot.state.store(SLOT_QUEUED, std::memory_order_relaxed);
+
+  slot_by_key_.emplace(key, index);
+  ++next_seq_;
+  return true;
+}
+
+void DnsParsePool::notify()
+{
+  if (published_.load(std::memory_order_relaxed) == next_seq_) {
+    return;
+  }
+
+  /* releases the slots' contents to the workers */
+  published_.store(next_seq_);
+  published_.notify_all();
+}
+
+bool DnsParsePool::take(Key const &key, int len, DnsParseResult &result)
+{
+  auto const found = slot_by_key_.find(key);
+  if (found == slot_by_key_.end()) {
+    return false;
+  }
+
+  Slot &slot = slots_[found->second];
+  slot_by_key_.erase(found);
+
+  if (slot.state.load(std::memory_order_acquire) != SLOT_DONE) {
+    /* rather than wait, leave the slot to the worker: submit() reuses it once the worker is done */
+    notify();
+    return false;
+  }
+
+  bool const matches = slot.len == len;
+  if (matches) {
+    result = slot.result;
+  }
+
+  slot.state.store(SLOT_FREE, std::memory_order_relaxed);
+  return matches;
+}
+
+bool DnsParsePool::parsed(Key const &key) const
+{
+  auto const found = slot_by_key_.find(key);
+  return found != slot_by_key_.end() && slots_[found->second].state.load(std::memory_order_acquire) == SLOT_DONE;
+}
+
+void DnsParsePool::clear()
+{
+  /* slots still queued are left to the workers, submit() reuses them once they are done */
+  notify();
+  slot_by_key_.clear();
+}
+
+void DnsParsePool::worker_loop()
+{
+  for (;;) {
+    u64 seq = claimed_.load();
+    u64 const published = published_.load();
+
+    /* checked after loading published_, so the wake-up from the d'tor is never mistaken for a packet */
+    if (stop_) {
+      return;
+    }
+
+    if (seq >= published) {
+      published_.wait(published);
+      continue;
+    }
+
+    if (!claimed_.compare_exchange_weak(seq, seq + 1)) {
+      continue;
+    }
+
+    Slot &slot = slots_[seq % n_slots_];
+    parse_dns_packet(slot.packet, slot.len, slot.result);
+
+    slot.state.store(SLOT_DONE, std::memory_order_release);
+    slot.state.notify_one();
+  }
+}
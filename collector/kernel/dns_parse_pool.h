@@ -0,0 +1,151 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <platform/platform.h>
+
+#include <collector/kernel/dns/dns.h>
+
+#include <absl/container/flat_hash_map.h>
+
+#include <atomic>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <netinet/in.h>
+
+/**
+ * Result of parsing a DNS packet, see parse_dns_packet()
+ */
+struct DnsParseResult {
+  /* return value of dns_parse_query, the other fields are only valid if ARES_SUCCESS */
+  int query_status;
+  int is_response;
+  u16 type;
+  u16 qid;
+  char question[DNS_NAME_MAX_LENGTH];
+  int question_len;
+
+  /* responses only: return value of dns_parse_a_aaaa_reply and its outputs */
+  int reply_status;
+  char hostname[DNS_NAME_MAX_LENGTH];
+  int hostname_len;
+  int num_ipv4_addrs;
+  struct in_addr ipv4_addrs[MAX_ENCODED_IP_ADDRS];
+  int num_ipv6_addrs;
+  struct in6_addr ipv6_addrs[MAX_ENCODED_IP_ADDRS];
+};
+
+/**
+ * Parses the query and, for responses, the A/AAAA records of a DNS packet.
+ *
+ * Only depends on the packet's contents, so it is safe to call from any thread.
+ */
+void parse_dns_packet(u8 const *packet, int len, DnsParseResult &result);
+
+/**
+ * Parses DNS packets on a pool of worker threads, ahead of the poller handling them.
+ *
+ * The poller thread looks ahead in the control channel and submit()s the DNS packets it finds, then take()s each result
+ * when it reaches that message in stream order. All socket state and encoding stays on the poller thread, so the
+ * ordering of the ingest stream is unchanged; only the parsing runs in parallel.
+ *
+ * Packets are identified by their BPF timestamp and socket. submit() and take() must be called from a single thread.
+ * Workers claim packets through a shared sequence number and publish results through a per-slot state, so neither
+ * side takes a lock. Packets that can't be submitted (pool full), whose result was evicted, or that are not parsed yet
+ * when taken are simply parsed inline by the caller, so the poller never waits for a worker.
+ */
+class DnsParsePool {
+public:
+  struct Key {
+    u64 timestamp;
+    u64 sk;
+
+    bool operator==(Key const &other) const { return timestamp == other.timestamp && sk == other.sk; }
+
+    template <typename H> friend H AbslHashValue(H h, Key const &key) { return H::combine(std::move(h), key.timestamp, key.sk); }
+  };
+
+  /**
+   * C'tor
+   * @param n_threads: number of worker threads, must be at least 1
+   * @param n_slots: maximum number of packets submitted but not yet taken
+   */
+  DnsParsePool(std::size_t n_threads, std::size_t n_slots = 1024);
+
+  /* stops and joins the worker threads */
+  ~DnsParsePool();
+
+  /* disallow copy and assignment */
+  DnsParsePool(DnsParsePool const &) = delete;
+  void operator=(DnsParsePool const &) = delete;
+
+  /**
+   * Queues a packet for parsing. The packet may be split in two parts if it wraps around the ring it was read from.
+   *
+   * Returns false if the packet was not queued, either because it is already pending or because all slots are busy.
+   */
+  bool submit(Key const &key, std::string_view first, std::string_view second = {});
+
+  /**
+   * Wakes up the workers for packets queued since the last call.
+   */
+  void notify();
+
+  /**
+   * Copies the result of the packet submitted with `key` to `result`, and forgets the packet.
+   *
+   * Never waits for the workers: returns false if no such packet is pending, if it is not parsed yet, or if its length
+   * doesn't match `len`. The caller then parses the packet inline.
+   */
+  bool take(Key const &key, int len, DnsParseResult &result);
+
+  /* whether the packet submitted with `key` is parsed, so that take() would not fall back */
+  bool parsed(Key const &key) const;
+
+  /**
+   * Forgets all pending packets, without waiting for the workers to finish the ones in progress.
+   */
+  void clear();
+
+  std::size_t n_threads() const { return workers_.size(); }
+
+  /* number of packets that are queued or parsed, but not yet taken */
+  std::size_t pending() const { return slot_by_key_.size(); }
+
+private:
+  enum SlotState : u32 { SLOT_FREE, SLOT_QUEUED, SLOT_DONE };
+
+  struct alignas(64) Slot {
+    std::atomic<u32> state{SLOT_FREE};
+    int len;
+    Key key;
+    u8 packet[DNS_MAX_PACKET_LEN];
+    DnsParseResult result;
+  };
+
+  void worker_loop();
+
+  std::unique_ptr<Slot[]> slots_;
+  std::size_t const n_slots_;
+
+  /* next sequence number to submit, poller thread only */
+  u64 next_seq_ = 0;
+
+  /* sequence numbers below this one are visible to the workers */
+  alignas(64) std::atomic<u64> published_{0};
+  /* next sequence number for a worker to claim */
+  alignas(64) std::atomic<u64> claimed_{0};
+  std::atomic<bool> stop_{false};
+
+  /* poller thread only */
+  absl::flat_hash_map<Key, u32> slot_by_key_;
+
+  std::vector<std::thread> workers_;
+};
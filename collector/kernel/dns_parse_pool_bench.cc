@@ -0,0 +1,146 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+// Measures DNS packet throughput of the poller thread when parsing inline, against handing packets to a DnsParsePool
+// with an increasing number of worker threads. Packets come from a capture recorded with `--bpf-dump-file`, and are
+// submitted and taken in windows, like BufferedPoller does with each batch it reads from the control channel.
+//
+// Usage: dns_parse_pool_bench <bpf-dump-file> [max_threads] [iterations]
+
+#include <collector/kernel/bpf_dump_reader.h>
+#include <collector/kernel/dns_parse_pool.h>
+#include <util/stop_watch.h>
+
+#include <generated/ebpf_net/agent_internal/meta.h>
+#include <generated/ebpf_net/agent_internal/wire_message.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+#include <string.h>
+
+namespace {
+
+/* packets submitted before the poller starts taking them, like one batch */
+constexpr std::size_t window_size = 512;
+
+struct Packet {
+  DnsParsePool::Key key;
+  std::string_view data;
+};
+
+std::vector<Packet> dns_packets(BpfDumpReader &reader, std::size_t &n_messages)
+{
+  using dns_packet = ebpf_net::agent_internal::dns_packet_message_metadata;
+
+  std::vector<Packet> packets;
+  for (n_messages = 0; !reader.empty(); ++n_messages) {
+    std::string_view const message = reader.next();
+
+    u16 rpc_id;
+    memcpy(&rpc_id, message.data() + sizeof(u64), sizeof(rpc_id));
+    if (rpc_id != dns_packet::rpc_id || message.size() < sizeof(u64) + dns_packet::wire_message_size) {
+      continue;
+    }
+
+    dns_packet::wire_message msg;
+    memcpy(&msg, message.data() + sizeof(u64), sizeof(msg));
+
+    std::size_t const offset = sizeof(u64) + dns_packet::wire_message_size;
+    std::size_t const len = msg._len - jb_agent_internal__dns_packet__data_size;
+    if (len > DNS_MAX_PACKET_LEN || offset + len > message.size()) {
+      continue;
+    }
+
+    /* keys only need to be unique among pending packets */
+    packets.push_back({.key = {.timestamp = packets.size(), .sk = msg.sk}, .data = message.substr(offset, len)});
+  }
+  return packets;
+}
+
+/* stands in for the work handle_dns_message does with the result */
+u64 consume(DnsParseResult const &result)
+{
+  return result.query_status + result.question_len + result.num_ipv4_addrs + result.num_ipv6_addrs;
+}
+
+double bench_inline(std::vector<Packet> const &packets, u64 iterations, u64 &checksum)
+{
+  StopWatch<> watch;
+  for (u64 i = 0; i < iterations; ++i) {
+    for (auto const &packet : packets) {
+      DnsParseResult result;
+      parse_dns_packet(reinterpret_cast<u8 const *>(packet.data.data()), packet.data.size(), result);
+      checksum += consume(result);
+    }
+  }
+  return (double)watch.elapsed_ns() / (iterations * packets.size());
+}
+
+double bench_pool(std::vector<Packet> const &packets, std::size_t n_threads, u64 iterations, u64 &checksum, u64 &inline_parsed)
+{
+  DnsParsePool pool(n_threads);
+
+  StopWatch<> watch;
+  for (u64 i = 0; i < iterations; ++i) {
+    for (std::size_t begin = 0; begin < packets.size(); begin += window_size) {
+      std::size_t const end = std::min(begin + window_size, packets.size());
+
+      for (std::size_t j = begin; j < end; ++j) {
+        pool.submit(packets[j].key, packets[j].data);
+      }
+      pool.notify();
+
+      for (std::size_t j = begin; j < end; ++j) {
+        auto const &packet = packets[j];
+        DnsParseResult result;
+        if (!pool.take(packet.key, packet.data.size(), result)) {
+          parse_dns_packet(reinterpret_cast<u8 const *>(packet.data.data()), packet.data.size(), result);
+          ++inline_parsed;
+        }
+        checksum += consume(result);
+      }
+    }
+  }
+  return (double)watch.elapsed_ns() / (iterations * packets.size());
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " <bpf-dump-file> [max_threads] [iterations]" << std::endl;
+    return 1;
+  }
+
+  std::size_t const max_threads = argc > 2 ? std::atoi(argv[2]) : 8;
+  u64 const iterations = argc > 3 ? std::atoll(argv[3]) : 10;
+
+  auto reader = BpfDumpReader::load(argv[1]);
+  std::size_t n_messages = 0;
+  auto const packets = dns_packets(reader, n_messages);
+
+  std::cout << "messages: " << n_messages << ", dns packets: " << packets.size() << std::endl;
+  if (packets.empty()) {
+    std::cerr << "no DNS packets in the dump" << std::endl;
+    return 1;
+  }
+
+  u64 checksum = 0;
+  double const inline_ns = bench_inline(packets, iterations, checksum);
+  std::cout << "inline:    " << inline_ns << " ns/packet (" << 1e3 / inline_ns << " Mpackets/s)" << std::endl;
+
+  for (std::size_t n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+    u64 inline_parsed = 0;
+    double const pool_ns = bench_pool(packets, n_threads, iterations, checksum, inline_parsed);
+    std::cout << "threads " << n_threads << ": " << pool_ns << " ns/packet (" << 1e3 / pool_ns << " Mpackets/s), "
+              << inline_parsed << " parsed inline" << std::endl;
+  }
+
+  std::cout << "checksum: " << checksum << std::endl;
+  return 0;
+}
@@ -0,0 +1,197 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <collector/kernel/dns/ares.h>
+#include <collector/kernel/dns_parse_pool.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <arpa/inet.h>
+
+namespace {
+
+/* a DNS packet for www.example.com, type A, with one answer if `answer` is given */
+std::string make_packet(u16 qid, bool is_response, char const *answer = nullptr)
+{
+  std::string packet;
+  auto const put_u16 = [&](u16 value) {
+    packet.push_back(value >> 8);
+    packet.push_back(value & 0xff);
+  };
+
+  put_u16(qid);
+  put_u16(is_response ? 0x8180 : 0x0100);
+  put_u16(1);
+  put_u16(answer ? 1 : 0);
+  put_u16(0);
+  put_u16(0);
+
+  packet.append("\3www\7example\3com", 16);
+  packet.push_back(0);
+  put_u16(1); /* type A */
+  put_u16(1); /* class IN */
+
+  if (answer) {
+    put_u16(0xc00c); /* pointer to the question's name */
+    put_u16(1);
+    put_u16(1);
+    put_u16(0);
+    put_u16(60); /* ttl */
+    put_u16(4);
+
+    in_addr addr;
+    inet_pton(AF_INET, answer, &addr);
+    packet.append(reinterpret_cast<char const *>(&addr), sizeof(addr));
+  }
+
+  return packet;
+}
+
+DnsParseResult parse_inline(std::string const &packet)
+{
+  DnsParseResult result;
+  parse_dns_packet(reinterpret_cast<u8 const *>(packet.data()), packet.size(), result);
+  return result;
+}
+
+/* spins until a worker parsed the packet submitted with `key`, since take() doesn't wait */
+void wait_parsed(DnsParsePool &pool, DnsParsePool::Key const &key)
+{
+  pool.notify();
+  while (!pool.parsed(key)) {
+  }
+}
+
+} // namespace
+
+TEST(dns_parse_pool, parse_query)
+{
+  auto const result = parse_inline(make_packet(42, false));
+
+  ASSERT_EQ(ARES_SUCCESS, result.query_status);
+  EXPECT_FALSE(result.is_response);
+  EXPECT_EQ(42, result.qid);
+  EXPECT_EQ(1, result.type);
+  EXPECT_EQ("www.example.com", std::string_view(result.question, result.question_len));
+}
+
+TEST(dns_parse_pool, parse_response)
+{
+  auto const result = parse_inline(make_packet(7, true, "10.1.2.3"));
+
+  ASSERT_EQ(ARES_SUCCESS, result.query_status);
+  EXPECT_TRUE(result.is_response);
+  EXPECT_EQ("www.example.com", std::string_view(result.hostname, result.hostname_len));
+  ASSERT_EQ(1, result.num_ipv4_addrs);
+  EXPECT_EQ(0, result.num_ipv6_addrs);
+
+  in_addr expected;
+  inet_pton(AF_INET, "10.1.2.3", &expected);
+  EXPECT_EQ(expected.s_addr, result.ipv4_addrs[0].s_addr);
+}
+
+TEST(dns_parse_pool, matches_inline_parsing)
+{
+  DnsParsePool pool(4, 64);
+
+  std::vector<std::string> packets;
+  for (u16 i = 0; i < 200; ++i) {
+    packets.push_back(i % 2 ? make_packet(i, true, "192.168.0.1") : make_packet(i, false));
+  }
+
+  for (std::size_t begin = 0; begin < packets.size(); begin += 50) {
+    for (std::size_t i = begin; i < begin + 50; ++i) {
+      /* split some packets, as when they wrap around the ring */
+      std::string_view const packet = packets[i];
+      ASSERT_TRUE(pool.submit({.timestamp = i, .sk = 1}, packet.substr(0, i % 20), packet.substr(i % 20)));
+    }
+    pool.notify();
+
+    for (std::size_t i = begin; i < begin + 50; ++i) {
+      DnsParseResult result;
+      wait_parsed(pool, {.timestamp = i, .sk = 1});
+      ASSERT_TRUE(pool.take({.timestamp = i, .sk = 1}, packets[i].size(), result));
+
+      auto const expected = parse_inline(packets[i]);
+      EXPECT_EQ(expected.qid, result.qid);
+      EXPECT_EQ(expected.is_response, result.is_response);
+      EXPECT_EQ(std::string_view(expected.question, expected.question_len), std::string_view(result.question, result.question_len));
+      EXPECT_EQ(expected.num_ipv4_addrs, result.num_ipv4_addrs);
+    }
+  }
+
+  EXPECT_EQ(0u, pool.pending());
+}
+
+TEST(dns_parse_pool, falls_back_when_unavailable)
+{
+  DnsParsePool pool(1, 2);
+  std::string const packet = make_packet(1, false);
+  DnsParseResult result;
+
+  /* never submitted */
+  EXPECT_FALSE(pool.take({.timestamp = 1, .sk = 1}, packet.size(), result));
+
+  ASSERT_TRUE(pool.submit({.timestamp = 1, .sk = 1}, packet));
+  EXPECT_FALSE(pool.submit({.timestamp = 1, .sk = 1}, packet));
+  ASSERT_TRUE(pool.submit({.timestamp = 2, .sk = 1}, packet));
+
+  /* both slots queued */
+  EXPECT_FALSE(pool.submit({.timestamp = 3, .sk = 1}, packet));
+
+  /* different packet under the same key */
+  wait_parsed(pool, {.timestamp = 2, .sk = 1});
+  EXPECT_FALSE(pool.take({.timestamp = 1, .sk = 1}, packet.size() + 1, result));
+  EXPECT_TRUE(pool.take({.timestamp = 2, .sk = 1}, packet.size(), result));
+
+  pool.clear();
+  EXPECT_EQ(0u, pool.pending());
+}
+
+TEST(dns_parse_pool, evicts_results_never_taken)
+{
+  DnsParsePool pool(1, 1);
+  std::string const packet = make_packet(1, false);
+  DnsParseResult result;
+
+  ASSERT_TRUE(pool.submit({.timestamp = 1, .sk = 1}, packet));
+
+  /* wait for the worker, so the slot can be reused */
+  wait_parsed(pool, {.timestamp = 1, .sk = 1});
+  pool.clear();
+  ASSERT_TRUE(pool.submit({.timestamp = 1, .sk = 1}, packet));
+  wait_parsed(pool, {.timestamp = 1, .sk = 1});
+  ASSERT_TRUE(pool.take({.timestamp = 1, .sk = 1}, packet.size(), result));
+
+  ASSERT_TRUE(pool.submit({.timestamp = 2, .sk = 1}, packet));
+  pool.notify();
+  while (pool.pending() && !pool.submit({.timestamp = 3, .sk = 1}, packet)) {
+    /* spins until the worker is done with the first packet */
+  }
+
+  EXPECT_FALSE(pool.take({.timestamp = 2, .sk = 1}, packet.size(), result));
+  wait_parsed(pool, {.timestamp = 3, .sk = 1});
+  EXPECT_TRUE(pool.take({.timestamp = 3, .sk = 1}, packet.size(), result));
+}
+
+TEST(dns_parse_pool, take_does_not_wait)
+{
+  DnsParsePool pool(1, 1);
+  std::string const packet = make_packet(1, false);
+  DnsParseResult result;
+
+  /* not even published to the workers yet */
+  ASSERT_TRUE(pool.submit({.timestamp = 1, .sk = 1}, packet));
+  EXPECT_FALSE(pool.take({.timestamp = 1, .sk = 1}, packet.size(), result));
+  EXPECT_EQ(0u, pool.pending());
+
+  /* the slot is reused once the worker is done with the packet nobody took */
+  while (!pool.submit({.timestamp = 2, .sk = 1}, packet)) {
+  }
+  wait_parsed(pool, {.timestamp = 2, .sk = 1});
+  EXPECT_TRUE(pool.take({.timestamp = 2, .sk = 1}, packet.size(), result));
+}
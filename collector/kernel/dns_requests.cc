@@ -1,33 +1,11 @@
 // Copyright The OpenTelemetry Authors
 // SPDX-License-Identifier: Apache-2.0
 
-#include "spdlog/common.h"
 #include <collector/kernel/dns_requests.h>
 #include <platform/platform.h>
 #include <util/log.h>
 
-/**
- * DNS requests key hash function
- *
- * @param[in] k The dns request key to hash
- * @return the hash of the dns request key
- */
-size_t DnsRequests::dns_request_key_hash::operator()(const dns_request_key &k) const noexcept
-{
-  return std::hash<uint16_t>{}(k.qid) ^ std::hash<uint16_t>{}(k.type) ^ std::hash<std::string>{}(k.name);
-}
-
-/**
- * DNS requests key comparison function
- *
- * @param[in] k The first dns request key to compare
- * @param[in] k2 The second dns request key to compare
- * @return true if the keys are equal, false otherwise
- */
-bool DnsRequests::dns_request_key_equal_to::operator()(const dns_request_key &k, const dns_request_key &k2) const noexcept
-{
-  return k.qid == k2.qid && k.type == k2.type && k.name == k2.name;
-}
+#include <cassert>
 
 /**
  * Add a DNS Request to the data structure
@@ -37,81 +15,95 @@ bool DnsRequests::dns_request_key_equal_to::operator()(const dns_request_key &k,
  */
 void DnsRequests::add(const dns_request_key &key, const dns_request_value &value)
 {
-  auto iter = dns_requests_.insert(dns_requests_.end(), std::make_pair(key, value));
-  dns_requests_by_key_.insert(std::make_pair(key, iter));
-  dns_requests_by_sock_.insert(std::make_pair(value.sk, iter));
-}
+  u32 req;
+  if (free_entries_ != invalid) {
+    req = free_entries_;
+    free_entries_ = entries_[req].all.next;
+  } else {
+    req = entries_.size();
+    entries_.emplace_back();
+  }
 
-/**
- * Return a list of DNS Requests that correspond to a particular key
- *
- * @param[in] key Key of the DNS Request to look up
- * @param[out] out The list of matching dns request key/value pairs
- */
-void DnsRequests::lookup(const dns_request_key &key, std::list<Request> &out)
-{
-  auto key_er = dns_requests_by_key_.equal_range(key);
-  for (auto eriter = key_er.first; eriter != key_er.second; eriter++) {
-    out.push_back(eriter->second);
+  auto &entry = entries_[req];
+  entry.key = IndexKey{.qid = key.qid, .type = key.type, .name_id = intern(key.name)};
+  entry.value = value;
+
+  /* append to the insertion order list */
+  entry.all = Links{.prev = newest_, .next = invalid};
+  if (newest_ != invalid) {
+    entries_[newest_].all.next = req;
+  } else {
+    oldest_ = req;
   }
+  newest_ = req;
+
+  link<IndexKey, &Entry::key_list>(by_key_, entry.key, req);
+  link<u64, &Entry::sk_list>(by_sock_, value.sk, req);
+
+  ++size_;
 }
 
 /**
- * Return a list of DNS Requests that are older than a particular timestamp
+ * Return the oldest DNS Request, if older than a particular timestamp
  *
  * @param[in] timestamp_ns The timestamp to get requests older than
- * @param[out] out The list of matching dns request key/value pairs
+ * @return the matching request, if any
  */
-
-void DnsRequests::lookup_older_than(u64 timestamp_ns, std::list<DnsRequests::Request> &out)
+std::optional<DnsRequests::Request> DnsRequests::oldest_older_than(u64 timestamp_ns) const
 {
-  for (auto iter = dns_requests_.begin(); iter != dns_requests_.end(); iter++) {
-    if (iter->second.timestamp_ns >= timestamp_ns) {
-      break;
-    }
-
-    out.push_back(iter);
+  if (oldest_ == invalid || entries_[oldest_].value.timestamp_ns >= timestamp_ns) {
+    return std::nullopt;
   }
+
+  return oldest_;
 }
 
 /**
- * Return a list of DNS Requests that match a particular socket
+ * Return a DNS Request that matches a particular socket
  *
  * @param[in] sk The kernel `struct sock*` pointer of the socket to look up
- * @param[out] out The list of matching dns request key/value pairs
+ * @return the matching request, if any
  */
-void DnsRequests::lookup_socket(u64 sk, std::list<DnsRequests::Request> &out)
+std::optional<DnsRequests::Request> DnsRequests::any_with_socket(u64 sk) const
 {
-  auto sk_er = dns_requests_by_sock_.equal_range(sk);
-  for (auto eriter = sk_er.first; eriter != sk_er.second; eriter++) {
-    out.push_back(eriter->second);
+  auto const found = by_sock_.find(sk);
+  if (found == by_sock_.end()) {
+    return std::nullopt;
   }
+
+  return found->second;
 }
 
 /**
  * Removes a specific DNS Request
  *
- * @param[in] key The DNS Request to remove, as returned by lookup* functions
+ * @param[in] req The DNS Request to remove, as returned by lookup* functions
  */
-void DnsRequests::remove(const Request &req)
+void DnsRequests::remove(Request req)
 {
-  auto key_er = dns_requests_by_key_.equal_range(req->first);
-  for (auto eriter = key_er.first; eriter != key_er.second; eriter++) {
-    if (eriter->second == req) {
-      dns_requests_by_key_.erase(eriter);
-      break;
-    }
-  }
+  assert(req < entries_.size());
+  auto &entry = entries_[req];
+
+  unlink<IndexKey, &Entry::key_list>(by_key_, entry.key, req);
+  unlink<u64, &Entry::sk_list>(by_sock_, entry.value.sk, req);
 
-  auto sk_er = dns_requests_by_sock_.equal_range(req->second.sk);
-  for (auto skiter = sk_er.first; skiter != sk_er.second; skiter++) {
-    if (skiter->second == req) {
-      dns_requests_by_sock_.erase(skiter);
-      break;
-    }
+  if (entry.all.prev != invalid) {
+    entries_[entry.all.prev].all.next = entry.all.next;
+  } else {
+    oldest_ = entry.all.next;
   }
+  if (entry.all.next != invalid) {
+    entries_[entry.all.next].all.prev = entry.all.prev;
+  } else {
+    newest_ = entry.all.prev;
+  }
+
+  release_name(entry.key.name_id);
+
+  entry.all = Links{.prev = invalid, .next = free_entries_};
+  free_entries_ = req;
 
-  dns_requests_.erase(req);
+  --size_;
 }
 
 /**
@@ -121,20 +113,92 @@ void DnsRequests::remove(const Request &req)
  */
 void DnsRequests::remove_all_with_key(const dns_request_key &key)
 {
-  auto key_er = dns_requests_by_key_.equal_range(key);
-  for (auto eriter = key_er.first; eriter != key_er.second;) {
-    auto req = eriter->second;
+  auto const index_key = find_index_key(key);
+  if (!index_key) {
+    return;
+  }
+
+  for (auto found = by_key_.find(*index_key); found != by_key_.end(); found = by_key_.find(*index_key)) {
+    remove(found->second);
+  }
+}
+
+std::optional<DnsRequests::IndexKey> DnsRequests::find_index_key(const dns_request_key &key) const
+{
+  auto const name = name_ids_.find(key.name);
+  if (name == name_ids_.end()) {
+    return std::nullopt;
+  }
+
+  return IndexKey{.qid = key.qid, .type = key.type, .name_id = name->second};
+}
+
+u32 DnsRequests::intern(std::string_view name)
+{
+  if (auto found = name_ids_.find(name); found != name_ids_.end()) {
+    ++names_[found->second].refs;
+    return found->second;
+  }
+
+  u32 name_id;
+  if (!free_names_.empty()) {
+    name_id = free_names_.back();
+    free_names_.pop_back();
+  } else {
+    name_id = names_.size();
+    names_.emplace_back();
+  }
 
-    auto sk_er = dns_requests_by_sock_.equal_range(req->second.sk);
-    for (auto skiter = sk_er.first; skiter != sk_er.second; skiter++) {
-      if (skiter->second == req) {
-        dns_requests_by_sock_.erase(skiter);
-        break;
-      }
-    }
+  /* reuses the capacity left by the slot's previous name */
+  auto &interned = names_[name_id];
+  interned.name.assign(name);
+  interned.refs = 1;
 
-    dns_requests_.erase(req);
+  name_ids_.emplace(interned.name, name_id);
+  return name_id;
+}
+
+void DnsRequests::release_name(u32 name_id)
+{
+  auto &interned = names_[name_id];
+  assert(interned.refs > 0);
+
+  if (--interned.refs == 0) {
+    name_ids_.erase(std::string_view(interned.name));
+    free_names_.push_back(name_id);
+  }
+}
+
+template <typename Key, DnsRequests::Links DnsRequests::Entry::*links>
+void DnsRequests::link(absl::flat_hash_map<Key, u32> &heads, Key const &key, u32 req)
+{
+  auto [head, inserted] = heads.try_emplace(key, req);
+
+  (entries_[req].*links).prev = invalid;
+  if (inserted) {
+    (entries_[req].*links).next = invalid;
+  } else {
+    /* push to the front of the list */
+    (entries_[req].*links).next = head->second;
+    (entries_[head->second].*links).prev = req;
+    head->second = req;
+  }
+}
+
+template <typename Key, DnsRequests::Links DnsRequests::Entry::*links>
+void DnsRequests::unlink(absl::flat_hash_map<Key, u32> &heads, Key const &key, u32 req)
+{
+  auto const &entry_links = entries_[req].*links;
+
+  if (entry_links.next != invalid) {
+    (entries_[entry_links.next].*links).prev = entry_links.prev;
+  }
 
-    eriter = dns_requests_by_key_.erase(eriter);
+  if (entry_links.prev != invalid) {
+    (entries_[entry_links.prev].*links).next = entry_links.next;
+  } else if (entry_links.next != invalid) {
+    heads[key] = entry_links.next;
+  } else {
+    heads.erase(key);
   }
 }
@@ -5,19 +5,42 @@
 
 #pragma once
 
-#include <list>
-#include <unordered_map>
-
 #include <platform/platform.h>
 
+#include <absl/container/flat_hash_map.h>
+
+#include <deque>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * Pending DNS requests, waiting for their response or their timeout.
+ *
+ * Requests live in a pool of entries that are threaded on three intrusive
+ * lists: all requests in insertion order, requests with the same key, and
+ * requests sent on the same socket. Query names are interned and reference
+ * counted, so that repeated queries for the same name share one copy.
+ *
+ * Requests are timed out after a single, fixed delay, and BPF timestamps are
+ * monotonic, so the insertion order list is also the expiry order: finding
+ * expired requests only looks at the expired ones, like a timer wheel with a
+ * single slot per timeout would.
+ *
+ * Once the pool, the name table and the indexes have grown to fit the
+ * steady-state number of pending requests, none of the operations allocate.
+ */
 class DnsRequests {
   // Type declarations
 public:
   struct dns_request_key {
-    u16 qid;          // transaction id
-    u16 type;         // query type
-    std::string name; // query data
-    bool is_rx;       // was this request 'sent (client)' or 'received (server)'
+    u16 qid;               // transaction id
+    u16 type;              // query type
+    std::string_view name; // query data
+    bool is_rx;            // was this request 'sent (client)' or 'received (server)', not part of the key's identity
   };
 
   struct dns_request_value {
@@ -25,34 +48,119 @@ public:
     u64 sk;           // socket that sent the dns request
   };
 
+  /* handle to a pending request, valid until it is removed */
+  using Request = u32;
+
+  // Public interface
+public:
+  void add(const dns_request_key &key, const dns_request_value &value);
+
+  /**
+   * Calls `fn(Request)` for each request that matches `key`.
+   * `fn` must not add or remove requests.
+   */
+  template <typename Fn> void for_each_with_key(const dns_request_key &key, Fn &&fn) const
+  {
+    auto const index_key = find_index_key(key);
+    if (!index_key) {
+      return;
+    }
+
+    auto const found = by_key_.find(*index_key);
+    if (found == by_key_.end()) {
+      return;
+    }
+
+    for (u32 req = found->second; req != invalid; req = entries_[req].key_list.next) {
+      fn(req);
+    }
+  }
+
+  /**
+   * Returns the oldest request if it is older than `timestamp_ns`.
+   * Removing it, and calling again, visits expired requests in O(expired).
+   */
+  std::optional<Request> oldest_older_than(u64 timestamp_ns) const;
+
+  /**
+   * Returns a request sent on socket `sk`, if any.
+   */
+  std::optional<Request> any_with_socket(u64 sk) const;
+
+  const dns_request_value &value(Request req) const { return entries_[req].value; }
+  std::string_view name(Request req) const { return names_[entries_[req].key.name_id].name; }
+
+  void remove(Request req);
+  void remove_all_with_key(const dns_request_key &key);
+
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Protected types
 protected:
-  struct dns_request_key_hash {
-    size_t operator()(const dns_request_key &k) const noexcept;
+  static constexpr u32 invalid = std::numeric_limits<u32>::max();
+
+  struct IndexKey {
+    u16 qid;
+    u16 type;
+    u32 name_id;
+
+    bool operator==(IndexKey const &other) const
+    {
+      return qid == other.qid && type == other.type && name_id == other.name_id;
+    }
+
+    template <typename H> friend H AbslHashValue(H h, IndexKey const &key)
+    {
+      return H::combine(std::move(h), key.qid, key.type, key.name_id);
+    }
   };
-  struct dns_request_key_equal_to {
-    bool operator()(const dns_request_key &k, const dns_request_key &k2) const noexcept;
+
+  struct Links {
+    u32 prev = invalid;
+    u32 next = invalid;
   };
 
-  typedef std::list<std::pair<dns_request_key, dns_request_value>> DnsRequestsList;
-  typedef std::unordered_multimap<dns_request_key, DnsRequestsList::iterator, dns_request_key_hash, dns_request_key_equal_to>
-      DnsRequestsByKeyMap;
-  typedef std::unordered_multimap<u64, DnsRequestsList::iterator> DnsRequestsBySockMap;
+  struct Entry {
+    IndexKey key;
+    dns_request_value value;
+    /* insertion order; `next` chains free entries */
+    Links all;
+    Links key_list;
+    Links sk_list;
+  };
 
-public:
-  typedef DnsRequestsList::iterator Request;
+  struct Name {
+    std::string name;
+    u32 refs = 0;
+  };
 
-  // Public interface
-public:
-  void add(const dns_request_key &key, const dns_request_value &value);
-  void lookup(const dns_request_key &key, std::list<Request> &out);
-  void lookup_older_than(u64 timestamp_ns, std::list<Request> &out);
-  void lookup_socket(u64 sk, std::list<Request> &out);
-  void remove(const Request &req);
-  void remove_all_with_key(const dns_request_key &key);
+  // Protected member functions
+protected:
+  std::optional<IndexKey> find_index_key(const dns_request_key &key) const;
+
+  u32 intern(std::string_view name);
+  void release_name(u32 name_id);
+
+  template <typename Key, Links Entry::*links>
+  void link(absl::flat_hash_map<Key, u32> &heads, Key const &key, u32 req);
+  template <typename Key, Links Entry::*links>
+  void unlink(absl::flat_hash_map<Key, u32> &heads, Key const &key, u32 req);
 
   // Protected member variables
 protected:
-  DnsRequestsByKeyMap dns_requests_by_key_;
-  DnsRequestsList dns_requests_;
-  DnsRequestsBySockMap dns_requests_by_sock_;
+  std::vector<Entry> entries_;
+  u32 free_entries_ = invalid;
+  u32 oldest_ = invalid;
+  u32 newest_ = invalid;
+  std::size_t size_ = 0;
+
+  /* a deque, so that the views used as keys in name_ids_ stay valid */
+  std::deque<Name> names_;
+  std::vector<u32> free_names_;
+  absl::flat_hash_map<std::string_view, u32> name_ids_;
+
+  /* first request of each key's and each socket's list */
+  absl::flat_hash_map<IndexKey, u32> by_key_;
+  absl::flat_hash_map<u64, u32> by_sock_;
 };
@@ -0,0 +1,165 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+// Measures DnsRequests under synthetic DNS traffic, the way BufferedPoller drives it: every query is added, most get a
+// response that looks up and removes their key, and the rest are expired by the periodic timeout pass. Queries go to a
+// limited set of names, as they do from service mesh sidecars, and come from a set of sockets. Time is simulated, so the
+// request rate and the number of pending requests do not depend on how fast the machine is.
+//
+// Usage: dns_requests_bench [n_queries] [queries_per_sec] [n_names] [response_percent]
+
+#include <collector/kernel/dns_requests.h>
+#include <util/stop_watch.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::atomic<u64> n_allocations = 0;
+
+/* like BufferedPoller */
+constexpr u64 timeout_ns = 10'000'000'000ull;
+constexpr u64 slow_poll_interval_ns = 1'000'000'000ull;
+constexpr u64 n_sockets = 1024;
+
+struct PendingResponse {
+  u64 timestamp_ns;
+  DnsRequests::dns_request_key key;
+};
+
+/* responses in flight, in a fixed ring so that the benchmark itself does not allocate */
+class ResponseQueue {
+public:
+  ResponseQueue(std::size_t capacity) : ring_(capacity) {}
+
+  bool empty() const { return head_ == tail_; }
+  bool full() const { return tail_ - head_ == ring_.size(); }
+  PendingResponse const &front() const { return ring_[head_ % ring_.size()]; }
+  PendingResponse const &back() const { return ring_[(tail_ - 1) % ring_.size()]; }
+  void pop_front() { ++head_; }
+  void push_back(PendingResponse const &response) { ring_[tail_++ % ring_.size()] = response; }
+
+private:
+  std::vector<PendingResponse> ring_;
+  u64 head_ = 0;
+  u64 tail_ = 0;
+};
+
+} // namespace
+
+void *operator new(std::size_t size)
+{
+  n_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+int main(int argc, char *argv[])
+{
+  u64 const n_queries = argc > 1 ? std::atoll(argv[1]) : 10'000'000;
+  u64 const queries_per_sec = argc > 2 ? std::atoll(argv[2]) : 50'000;
+  u64 const n_names = argc > 3 ? std::atoll(argv[3]) : 200;
+  u32 const response_percent = argc > 4 ? std::atoi(argv[4]) : 95;
+
+  if (queries_per_sec == 0 || n_names == 0) {
+    std::cerr << "queries_per_sec and n_names must be positive" << std::endl;
+    return 1;
+  }
+
+  std::vector<std::string> names;
+  for (u64 i = 0; i < n_names; ++i) {
+    names.push_back("service-" + std::to_string(i) + ".namespace.svc.cluster.local");
+  }
+
+  /* responses arrive 0.1-20ms after their query, which is less than the time between two timeout passes */
+  std::mt19937_64 rng(42);
+  std::uniform_int_distribution<u64> latency(100'000, 20'000'000);
+  std::uniform_int_distribution<u32> percent(0, 99);
+  std::geometric_distribution<u64> name_rank(5.0 / n_names);
+
+  DnsRequests requests;
+  ResponseQueue responses(1 << 16);
+  u64 const query_interval_ns = 1'000'000'000ull / queries_per_sec;
+  u64 next_slow_poll = slow_poll_interval_ns;
+  u64 n_responses = 0;
+  u64 n_timeouts = 0;
+  u64 max_pending = 0;
+
+  auto const run = [&](u64 first, u64 last) {
+    for (u64 i = first; i < last; ++i) {
+      u64 const now = i * query_interval_ns;
+
+      while (!responses.empty() && responses.front().timestamp_ns <= now) {
+        bool found = false;
+        requests.for_each_with_key(responses.front().key, [&](DnsRequests::Request) { found = true; });
+        if (found) {
+          requests.remove_all_with_key(responses.front().key);
+          ++n_responses;
+        }
+        responses.pop_front();
+      }
+
+      if (now >= next_slow_poll) {
+        while (auto const req = requests.oldest_older_than(now - timeout_ns)) {
+          requests.remove(*req);
+          ++n_timeouts;
+        }
+        next_slow_poll += slow_poll_interval_ns;
+      }
+
+      DnsRequests::dns_request_key const key{
+          .qid = u16(i), .type = 1, .name = names[name_rank(rng) % n_names], .is_rx = false};
+      requests.add(key, {.timestamp_ns = now, .sk = i % n_sockets});
+      max_pending = std::max<u64>(max_pending, requests.size());
+
+      /* responses are queued in arrival order, approximately: good enough to keep the queue short */
+      if (percent(rng) < response_percent && !responses.full()) {
+        u64 const arrival = now + latency(rng);
+        if (responses.empty() || responses.back().timestamp_ns <= arrival) {
+          responses.push_back({arrival, key});
+        } else {
+          responses.push_back({responses.back().timestamp_ns, key});
+        }
+      }
+    }
+  };
+
+  /* warm up until the timeout pass has run, so pools and indexes reach their steady-state size */
+  u64 const warmup = std::min(n_queries, (timeout_ns + 2 * slow_poll_interval_ns) / query_interval_ns);
+  run(0, warmup);
+
+  n_responses = n_timeouts = 0;
+  u64 const allocations_before = n_allocations.load();
+  StopWatch<> watch;
+  run(warmup, n_queries);
+  double const ns = watch.elapsed_ns();
+  u64 const allocations = n_allocations.load() - allocations_before;
+
+  u64 const measured = n_queries - warmup;
+  std::cout << measured << " queries at " << queries_per_sec << " queries/s to " << n_names << " names, " << n_responses
+            << " responses, " << n_timeouts << " timeouts, " << max_pending << " max pending" << std::endl;
+  if (measured > 0) {
+    std::cout << "  " << ns / measured << " ns/query, " << allocations << " allocations, "
+              << double(allocations) / measured << " allocations/query" << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,107 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <collector/kernel/dns_requests.h>
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+using request_key = DnsRequests::dns_request_key;
+
+std::vector<u64> timestamps_with_key(DnsRequests const &requests, request_key const &key)
+{
+  std::vector<u64> timestamps;
+  requests.for_each_with_key(key, [&](DnsRequests::Request req) { timestamps.push_back(requests.value(req).timestamp_ns); });
+  return timestamps;
+}
+
+} // namespace
+
+TEST(dns_requests, lookup_by_key)
+{
+  DnsRequests requests;
+  requests.add({.qid = 1, .type = 1, .name = "example.com", .is_rx = false}, {.timestamp_ns = 10, .sk = 100});
+  requests.add({.qid = 1, .type = 1, .name = "example.com", .is_rx = false}, {.timestamp_ns = 20, .sk = 200});
+  requests.add({.qid = 2, .type = 1, .name = "example.com", .is_rx = false}, {.timestamp_ns = 30, .sk = 100});
+  requests.add({.qid = 1, .type = 28, .name = "example.com", .is_rx = false}, {.timestamp_ns = 40, .sk = 100});
+  EXPECT_EQ(4u, requests.size());
+
+  /* is_rx is not part of the key */
+  auto timestamps = timestamps_with_key(requests, {.qid = 1, .type = 1, .name = "example.com", .is_rx = true});
+  EXPECT_EQ((std::set<u64>{10, 20}), std::set<u64>(timestamps.begin(), timestamps.end()));
+
+  EXPECT_TRUE(timestamps_with_key(requests, {.qid = 1, .type = 1, .name = "example.org", .is_rx = false}).empty());
+
+  requests.remove_all_with_key({.qid = 1, .type = 1, .name = "example.com", .is_rx = false});
+  EXPECT_EQ(2u, requests.size());
+  EXPECT_TRUE(timestamps_with_key(requests, {.qid = 1, .type = 1, .name = "example.com", .is_rx = false}).empty());
+  EXPECT_EQ(
+      (std::vector<u64>{30}), timestamps_with_key(requests, {.qid = 2, .type = 1, .name = "example.com", .is_rx = false}));
+}
+
+TEST(dns_requests, expires_oldest_first)
+{
+  DnsRequests requests;
+  for (u64 i = 0; i < 10; ++i) {
+    requests.add({.qid = u16(i), .type = 1, .name = "example.com", .is_rx = false}, {.timestamp_ns = i * 10, .sk = i});
+  }
+
+  /* removing from the middle keeps the expiry order */
+  request_key const key{.qid = 3, .type = 1, .name = "example.com", .is_rx = false};
+  EXPECT_EQ((std::vector<u64>{30}), timestamps_with_key(requests, key));
+  requests.remove_all_with_key(key);
+
+  std::vector<u64> expired;
+  while (auto const req = requests.oldest_older_than(55)) {
+    expired.push_back(requests.value(*req).timestamp_ns);
+    requests.remove(*req);
+  }
+  EXPECT_EQ((std::vector<u64>{0, 10, 20, 40, 50}), expired);
+  EXPECT_EQ(4u, requests.size());
+}
+
+TEST(dns_requests, lookup_by_socket)
+{
+  DnsRequests requests;
+  requests.add({.qid = 1, .type = 1, .name = "a.example.com", .is_rx = false}, {.timestamp_ns = 10, .sk = 100});
+  requests.add({.qid = 2, .type = 1, .name = "b.example.com", .is_rx = false}, {.timestamp_ns = 20, .sk = 200});
+  requests.add({.qid = 3, .type = 1, .name = "c.example.com", .is_rx = false}, {.timestamp_ns = 30, .sk = 100});
+
+  std::set<std::string> names;
+  while (auto const req = requests.any_with_socket(100)) {
+    EXPECT_EQ(100u, requests.value(*req).sk);
+    names.emplace(requests.name(*req));
+    requests.remove(*req);
+  }
+  EXPECT_EQ((std::set<std::string>{"a.example.com", "c.example.com"}), names);
+  EXPECT_EQ(1u, requests.size());
+  EXPECT_FALSE(requests.any_with_socket(100));
+  EXPECT_TRUE(requests.any_with_socket(200));
+}
+
+TEST(dns_requests, reuses_entries_and_names)
+{
+  DnsRequests requests;
+
+  for (int round = 0; round < 3; ++round) {
+    for (u64 i = 0; i < 100; ++i) {
+      std::string const name = "host-" + std::to_string(i % 10) + ".example.com";
+      requests.add({.qid = u16(i), .type = 1, .name = name, .is_rx = false}, {.timestamp_ns = i, .sk = i % 7});
+    }
+
+    /* names are shared between requests, and freed once no request uses them */
+    request_key const key{.qid = 13, .type = 1, .name = "host-3.example.com", .is_rx = false};
+    requests.for_each_with_key(key, [&](DnsRequests::Request req) { EXPECT_EQ("host-3.example.com", requests.name(req)); });
+
+    while (auto const req = requests.oldest_older_than(1000)) {
+      requests.remove(*req);
+    }
+    EXPECT_TRUE(requests.empty());
+    EXPECT_FALSE(requests.any_with_socket(3));
+  }
+}
@@ -85,6 +85,9 @@ KernelCollector::KernelCollector(
     CurlEngine &curl_engine,
     bool enable_http_metrics,
     bool enable_userland_tcp,
+    bool use_bpf_ring_buffer,
+    bool enable_bpf_stats_aggregation,
+    std::size_t dns_parse_threads,
     u64 socket_stats_interval_sec,
     CgroupHandler::CgroupSettings cgroup_settings,
     std::string const &bpf_dump_file,
@@ -103,12 +106,14 @@ KernelCollector::KernelCollector(
       encoder_(intake_config_.make_encoder()),
       callbacks_(*this),
       primary_channel_(intake_config_.make_channel(loop)),
+      credit_channel_(*primary_channel_, CREDIT_BACKLOG_SIZE),
       secondary_channel_(intake_config_.create_output_record_file()),
       upstream_connection_(
           WRITE_BUFFER_SIZE,
           intake_config_.allow_compression(),
-          *primary_channel_,
-          secondary_channel_ ? &secondary_channel_ : nullptr),
+          credit_channel_,
+          secondary_channel_ ? &secondary_channel_ : nullptr,
+          intake_config_.zstd_options()),
       writer_(upstream_connection_.buffered_writer(), monotonic, boot_time_adjustment, encoder_.get()),
       last_probe_monotonic_time_ns_(monotonic() - inter_probe_time_ns_),
       is_connected_(false),
@@ -121,6 +126,9 @@ KernelCollector::KernelCollector(
           }),
       enable_http_metrics_(enable_http_metrics),
       enable_userland_tcp_(enable_userland_tcp),
+      use_bpf_ring_buffer_(use_bpf_ring_buffer),
+      enable_bpf_stats_aggregation_(enable_bpf_stats_aggregation),
+      dns_parse_threads_(dns_parse_threads),
       socket_stats_interval_sec_(socket_stats_interval_sec),
       cgroup_settings_(std::move(cgroup_settings)),
       log_(writer_),
@@ -247,6 +255,10 @@ void KernelCollector::on_upstream_connected()
 {
   LOG::trace("upstream connected");
 
+  /* a command cut short by the previous connection won't be completed */
+  received_command_ = 0;
+  recieved_length_ = 0;
+
   try {
     send_connection_metadata();
   } catch (std::exception &e) {
@@ -287,7 +299,16 @@ void KernelCollector::probe_holdoff_timeout(uv_timer_t *timer)
   auto potential_troubleshoot_item = TroubleshootItem::bpf_compilation_failed;
   try {
     bpf_handler_.emplace(
-        loop_, full_program_, enable_http_metrics_, enable_userland_tcp_, bpf_dump_file_, log_, encoder_.get(), host_info_);
+        loop_,
+        full_program_,
+        enable_http_metrics_,
+        enable_userland_tcp_,
+        use_bpf_ring_buffer_,
+        enable_bpf_stats_aggregation_,
+        bpf_dump_file_,
+        log_,
+        encoder_.get(),
+        host_info_);
 
     potential_troubleshoot_item = TroubleshootItem::unexpected_exception;
     writer_.bpf_compiled();
@@ -298,8 +319,10 @@ void KernelCollector::probe_holdoff_timeout(uv_timer_t *timer)
         boot_time_adjustment_,
         curl_engine_,
         socket_stats_interval_sec_,
+        dns_parse_threads_,
         cgroup_settings_,
         kernel_collector_restarter_);
+    bpf_handler_->set_throttled(credit_channel_.limited());
 
     potential_troubleshoot_item = TroubleshootItem::bpf_load_probes_failed;
     bpf_handler_->load_probes(writer_);
@@ -541,6 +564,34 @@ void KernelCollector::handle_received_command(u64 command)
   if (command == static_cast<u64>(ServerCommand::DISABLE_SEND)) {
     LOG::info("Stop sending data, instructed by the server.");
     disabled_ = true;
+  } else if (command == static_cast<u64>(ServerCommand::FLOW_CONTROL_OFFERED)) {
+    // only the binary encoder receives commands, and older servers would drop
+    // the connection on a message they don't know, hence waiting for the offer
+    writer_.flow_control_supported();
+    upstream_connection_.flush();
+  } else if (auto const kib = parse_credit_grant(command)) {
+    handle_credit_grant(*kib);
+  }
+}
+
+void KernelCollector::handle_credit_grant(u32 kib)
+{
+  std::optional<u64> const bytes = (kib == CREDIT_GRANT_UNLIMITED) ? std::nullopt : std::make_optional(u64(kib) << 10);
+
+  if (bytes.has_value() != credit_channel_.limited()) {
+    if (bytes) {
+      LOG::info("Server is falling behind, sending less data until it catches up.");
+    } else {
+      LOG::info("Server caught up, sending all data again.");
+    }
+    if (bpf_handler_) {
+      bpf_handler_->set_throttled(bytes.has_value());
+    }
+  }
+
+  if (auto const error = credit_channel_.grant(bytes)) {
+    LOG::trace("sending data held back failed: {}", error.message());
+    upstream_connection_.close();
   }
 }
 
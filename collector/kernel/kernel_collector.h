@@ -6,6 +6,7 @@
 #pragma once
 
 #include <channel/callbacks.h>
+#include <channel/credit_channel.h>
 #include <channel/file_channel.h>
 #include <channel/upstream_connection.h>
 #include <collector/kernel/bpf_handler.h>
@@ -45,6 +46,9 @@ public:
       CurlEngine &curl_engine,
       bool enable_http_metrics,
       bool enable_userland_tcp,
+      bool use_bpf_ring_buffer,
+      bool enable_bpf_stats_aggregation,
+      std::size_t dns_parse_threads,
       u64 socket_stats_interval_sec,
       CgroupHandler::CgroupSettings cgroup_settings,
       std::string const &bpf_dump_file,
@@ -135,6 +139,9 @@ private:
   /* handles command received from the server */
   void handle_received_command(u64 command);
 
+  /* handles flow-control credits granted by the server, see server_command.h */
+  void handle_credit_grant(u32 kib);
+
   /* sends a heartbeat message to the server */
   void send_heartbeat();
 
@@ -179,6 +186,7 @@ private:
   std::optional<BPFHandler> bpf_handler_;
   Callbacks callbacks_;
   std::unique_ptr<channel::NetworkChannel> primary_channel_;
+  channel::CreditChannel credit_channel_;
   channel::FileChannel secondary_channel_;
   channel::UpstreamConnection upstream_connection_;
   ::ebpf_net::ingest::Writer writer_;
@@ -195,6 +203,9 @@ private:
   /* enable/disable features */
   bool enable_http_metrics_;
   bool enable_userland_tcp_;
+  bool use_bpf_ring_buffer_;
+  bool enable_bpf_stats_aggregation_;
+  std::size_t dns_parse_threads_;
   u64 socket_stats_interval_sec_;
   CgroupHandler::CgroupSettings const cgroup_settings_;
 
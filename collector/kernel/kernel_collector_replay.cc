@@ -0,0 +1,407 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+// Replays a capture recorded with `--bpf-dump-file` through BufferedPoller, its message handlers, ProcessHandler,
+// NatHandler, CgroupHandler, TCPDataHandler and the ingest encoder, as fast as they go. Messages are written into an
+// in-memory control channel ring, and the encoded output is counted and discarded, so this needs neither root nor a
+// live kernel.
+//
+// Reports events/sec, allocations and output bytes per event over `iterations` replays of the capture, then does one
+// more replay to break down ns, allocations and output bytes per event by message handler.
+//
+// Caveats:
+//   * timestamps are rebased to start at 0 on every replay, stats are still sent by wall clock
+//   * the data channel isn't part of the capture, so `tcp_data` only covers the control side of the handler
+//   * `stack_trace` messages are skipped, since they need the BPF stack table
+//   * there are no BPF tables, so the TCPDataHandler backchannel to BPF fails, and is only logged at debug level
+//
+// Usage: kernel_collector_replay <bpf-dump-file> [iterations] [dns_parse_threads]
+
+#include <channel/buffered_writer.h>
+#include <channel/channel.h>
+#include <collector/constants.h>
+#include <collector/kernel/bpf_dump_reader.h>
+#include <collector/kernel/buffered_poller.h>
+#include <collector/kernel/kernel_collector_restarter.h>
+#include <collector/kernel/perf_reader.h>
+#include <collector/kernel/probe_handler.h>
+#include <util/curl_engine.h>
+#include <util/file_ops.h>
+#include <util/log.h>
+#include <util/logger.h>
+#include <util/meta.h>
+#include <util/stop_watch.h>
+
+#include <generated/ebpf_net/agent_internal/meta.h>
+#include <generated/ebpf_net/agent_internal/wire_message.h>
+#include <generated/ebpf_net/ingest/writer.h>
+
+#include <bcc/bpf_module.h>
+#include <bcc/file_desc.h>
+#include <bcc/table_desc.h>
+#include <bcc/table_storage.h>
+
+#include <linux/bpf.h>
+#include <linux/perf_event.h>
+
+#include <absl/container/flat_hash_map.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <string.h>
+
+#include <uv.h>
+
+namespace {
+
+/* allocations made by the whole process, including BPF and libuv set up, so only differences are reported */
+std::atomic<u64> allocation_count = 0;
+
+} // namespace
+
+void *operator new(std::size_t size)
+{
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+namespace {
+
+constexpr u64 ring_page_size = 4096;
+
+/* bytes of control channel ring, the poller drains it every time it fills up */
+constexpr u32 control_ring_bytes = 4096 * ring_page_size;
+
+/* same default as the kernel collector's --socket-stats-interval-sec */
+constexpr u64 socket_stats_interval_sec = 10;
+
+class InMemoryPerfRingStorage : public PerfRingStorage {
+public:
+  InMemoryPerfRingStorage(u32 n_bytes) : buffer_((ring_page_size + n_bytes) / sizeof(u64))
+  {
+    data_ = reinterpret_cast<char *>(buffer_.data());
+    n_data_pages_ = n_bytes / ring_page_size;
+    page_size_ = ring_page_size;
+  }
+
+  void set_callback(uv_loop_t &loop, void *ctx, CALLBACK cb) override {}
+
+private:
+  std::vector<u64> buffer_;
+};
+
+/* counts and discards what the ingest writer sends upstream */
+class NullChannel : public channel::Channel {
+public:
+  std::error_code send(const u8 *data, int data_len) override
+  {
+    bytes_sent_ += data_len;
+    return {};
+  }
+
+  bool is_open() const override { return true; }
+
+  u64 bytes_sent() const { return bytes_sent_; }
+
+private:
+  u64 bytes_sent_ = 0;
+};
+
+/* counts the bytes each encoded message takes, so they can be attributed to handlers */
+class CountingWriter : public IBufferedWriter {
+public:
+  CountingWriter(IBufferedWriter &writer) : writer_(writer) {}
+
+  Expected<u8 *, std::error_code> start_write(u32 length) override
+  {
+    bytes_written_ += length;
+    return writer_.start_write(length);
+  }
+
+  void finish_write() override { writer_.finish_write(); }
+  std::error_code flush() override { return writer_.flush(); }
+  u32 buf_size() const override { return writer_.buf_size(); }
+  bool is_writable() const override { return writer_.is_writable(); }
+
+  u64 bytes_written() const { return bytes_written_; }
+
+private:
+  IBufferedWriter &writer_;
+  u64 bytes_written_ = 0;
+};
+
+class HandlerProfiler : public BufferedPoller::HandlerObserver {
+public:
+  struct Stats {
+    u64 events = 0;
+    u64 ns = 0;
+    u64 allocations = 0;
+    u64 bytes = 0;
+  };
+
+  HandlerProfiler(CountingWriter const &writer) : writer_(writer) {}
+
+  void before_handler(u16 rpc_id) override
+  {
+    allocations_ = allocation_count.load(std::memory_order_relaxed);
+    bytes_ = writer_.bytes_written();
+    watch_.reset();
+  }
+
+  void after_handler(u16 rpc_id) override
+  {
+    u64 const ns = watch_.elapsed_ns();
+
+    auto &stats = stats_[rpc_id];
+    ++stats.events;
+    stats.ns += ns;
+    stats.allocations += allocation_count.load(std::memory_order_relaxed) - allocations_;
+    stats.bytes += writer_.bytes_written() - bytes_;
+  }
+
+  absl::flat_hash_map<u16, Stats> const &stats() const { return stats_; }
+
+private:
+  CountingWriter const &writer_;
+  StopWatch<> watch_;
+  u64 allocations_ = 0;
+  u64 bytes_ = 0;
+  absl::flat_hash_map<u16, Stats> stats_;
+};
+
+/* dump messages laid out as the records BPF submits to the control channel */
+class Records {
+public:
+  Records(BpfDumpReader &reader)
+  {
+    using stack_trace = ebpf_net::agent_internal::stack_trace_message_metadata;
+
+    u64 first_timestamp = 0;
+    u64 last_timestamp = 0;
+
+    while (!reader.empty()) {
+      std::string_view const message = reader.next();
+
+      u64 timestamp;
+      memcpy(&timestamp, message.data(), sizeof(timestamp));
+      u16 rpc_id;
+      memcpy(&rpc_id, message.data() + sizeof(u64), sizeof(rpc_id));
+
+      if (rpc_id == stack_trace::rpc_id) {
+        ++n_skipped_;
+        continue;
+      }
+
+      if (records_.empty()) {
+        first_timestamp = timestamp;
+      }
+      last_timestamp = std::max(last_timestamp, timestamp);
+
+      /* [u32 size][u32 unpadded size][u64 timestamp + wire message][padding to 8 bytes] */
+      std::string record(sizeof(u64) + ((message.size() + 7) & ~7ull), '\0');
+      u32 const size = record.size() - sizeof(u32);
+      u32 const unpadded_size = message.size();
+      memcpy(record.data(), &size, sizeof(size));
+      memcpy(record.data() + sizeof(u32), &unpadded_size, sizeof(unpadded_size));
+      memcpy(record.data() + sizeof(u64), message.data(), message.size());
+
+      records_.push_back(std::move(record));
+      timestamps_.push_back(timestamp - std::min(timestamp, first_timestamp));
+    }
+
+    span_ = last_timestamp - first_timestamp;
+  }
+
+  std::size_t size() const { return records_.size(); }
+  bool empty() const { return records_.empty(); }
+  std::size_t n_skipped() const { return n_skipped_; }
+
+  /* every replay gets timestamps past the previous one's */
+  u64 replay_span() const { return span_ + 1; }
+
+  /**
+   * Writes all records to `ring`, draining it through `poller` whenever it's
+   *   full. Returns the ns spent in the poller.
+   */
+  u64 replay(PerfRing &ring, BufferedPoller &poller, u64 timestamp_offset)
+  {
+    u64 poll_ns = 0;
+
+    for (std::size_t i = 0; i < records_.size();) {
+      std::size_t const batch_start = i;
+
+      ring.start_write_batch();
+      for (; i < records_.size(); ++i) {
+        u64 const timestamp = timestamp_offset + timestamps_[i];
+        memcpy(records_[i].data() + sizeof(u64), &timestamp, sizeof(timestamp));
+
+        try {
+          ring.write(records_[i], PERF_RECORD_SAMPLE);
+        } catch (std::range_error const &) {
+          break;
+        }
+      }
+      ring.finish_write_batch();
+
+      if (i == batch_start) {
+        throw std::runtime_error("replay: the poller doesn't drain the control channel ring");
+      }
+
+      StopWatch<> watch;
+      poller.poll();
+      poll_ns += watch.elapsed_ns();
+    }
+
+    return poll_ns;
+  }
+
+private:
+  std::vector<std::string> records_;
+  std::vector<u64> timestamps_;
+  std::size_t n_skipped_ = 0;
+  u64 span_ = 0;
+};
+
+std::map<u16, std::string_view> message_names()
+{
+  std::map<u16, std::string_view> names;
+  meta::foreach<ebpf_net::agent_internal_metadata::messages>([&](auto tag) {
+    using message = decltype(meta::tag_type(tag));
+    names.emplace(message::rpc_id, message::name);
+  });
+  return names;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " <bpf-dump-file> [iterations] [dns_parse_threads]" << std::endl;
+    return 1;
+  }
+
+  u64 const iterations = argc > 2 ? std::atoll(argv[2]) : 10;
+  std::size_t const dns_parse_threads = argc > 3 ? std::atoi(argv[3]) : 0;
+
+  LOG::init(true);
+
+  auto reader = BpfDumpReader::load(argv[1]);
+  Records records(reader);
+  std::cout << "messages: " << records.size() << ", skipped: " << records.n_skipped() << std::endl;
+  if (records.empty()) {
+    std::cerr << "no messages to replay in the dump" << std::endl;
+    return 1;
+  }
+
+  uv_loop_t loop;
+  if (uv_loop_init(&loop) != 0) {
+    throw std::runtime_error("uv_loop_init failed");
+  }
+  auto curl_engine = CurlEngine::create(&loop);
+
+  NullChannel channel;
+  channel::BufferedWriter buffered_writer(channel, WRITE_BUFFER_SIZE);
+  CountingWriter writer(buffered_writer);
+
+  ::ebpf_net::ingest::Writer log_writer(writer, monotonic, 0);
+  logging::Logger log(log_writer);
+
+  /* TCPDataHandler needs the `_tcp_control` table to exist, its file descriptor is never valid here */
+  ebpf::BPFModule bpf_module(0);
+  bpf_module.table_storage().Insert(
+      ebpf::Path({bpf_module.id(), "_tcp_control"}),
+      ebpf::TableDesc(
+          "_tcp_control", ebpf::FileDesc(-1), BPF_MAP_TYPE_HASH, sizeof(tcp_control_key_t), sizeof(tcp_control_value_t), 0, 0));
+
+  PerfContainer container;
+  PerfRing ring(std::make_shared<InMemoryPerfRingStorage>(control_ring_bytes));
+  container.add_ring(ring);
+  PerfRing data_ring(std::make_shared<InMemoryPerfRingStorage>(ring_page_size));
+  container.add_data_ring(data_ring, 0);
+
+  ProbeHandler probe_handler(log);
+  FileDescriptor no_bpf_dump_file;
+  KernelCollectorRestarter restarter([] { throw std::runtime_error("replay: the kernel collector can't be restarted"); });
+
+  /* the last replay, for profiling, needs its timestamps to be readable too */
+  u64 const time_adjustment = (iterations + 1) * records.replay_span();
+
+  BufferedPoller poller(
+      loop,
+      container,
+      writer,
+      time_adjustment,
+      *curl_engine,
+      no_bpf_dump_file,
+      log,
+      probe_handler,
+      bpf_module,
+      false,
+      dns_parse_threads,
+      socket_stats_interval_sec,
+      CgroupHandler::CgroupSettings{},
+      nullptr,
+      restarter);
+  poller.set_all_probes_loaded();
+
+  u64 const allocations_start = allocation_count.load(std::memory_order_relaxed);
+  u64 const bytes_start = channel.bytes_sent();
+  u64 poll_ns = 0;
+  for (u64 i = 0; i < iterations; ++i) {
+    poll_ns += records.replay(ring, poller, i * records.replay_span());
+  }
+
+  double const n_events = (double)iterations * records.size();
+  if (iterations > 0) {
+    std::cout << "events/sec: " << n_events * 1e9 / poll_ns << std::endl;
+    std::cout << "ns/event: " << poll_ns / n_events << std::endl;
+    std::cout << "allocations/event: " << (allocation_count.load(std::memory_order_relaxed) - allocations_start) / n_events
+              << std::endl;
+    std::cout << "output bytes/event: " << (channel.bytes_sent() - bytes_start) / n_events << std::endl;
+  }
+
+  HandlerProfiler profiler(writer);
+  poller.set_handler_observer(&profiler);
+  records.replay(ring, poller, iterations * records.replay_span());
+  poller.set_handler_observer(nullptr);
+
+  std::cout << std::endl << "per handler (one replay):" << std::endl;
+  auto const names = message_names();
+  for (auto const &[rpc_id, name] : names) {
+    auto const found = profiler.stats().find(rpc_id);
+    if (found == profiler.stats().end()) {
+      continue;
+    }
+
+    auto const &stats = found->second;
+    double const events = stats.events;
+    std::cout << "  " << name << ": " << stats.events << " events, " << stats.ns / events << " ns/event, "
+              << stats.allocations / events << " allocations/event, " << stats.bytes / events << " bytes/event" << std::endl;
+  }
+
+  return 0;
+}
@@ -4,7 +4,11 @@
 #include <collector/kernel/kernel_collector.h>
 #include <collector/kernel/kernel_collector_restarter.h>
 
-KernelCollectorRestarter::KernelCollectorRestarter(KernelCollector &collector) : collector_(collector)
+KernelCollectorRestarter::KernelCollectorRestarter(KernelCollector &collector)
+    : KernelCollectorRestarter([&collector] { collector.restart(); })
+{}
+
+KernelCollectorRestarter::KernelCollectorRestarter(std::function<void()> restart) : restart_(std::move(restart))
 {
   reset();
 }
@@ -17,7 +21,7 @@ void KernelCollectorRestarter::check_restart()
     } else {
       restart_in_progress_ = true;
       LOG::debug("restarting KernelCollector");
-      collector_.restart();
+      restart_();
     }
   }
 }
@@ -7,6 +7,8 @@
 
 #include <platform/platform.h>
 
+#include <functional>
+
 class KernelCollector;
 
 /**
@@ -21,6 +23,13 @@ class KernelCollectorRestarter {
 
 public:
   KernelCollectorRestarter(KernelCollector &collector);
+
+  /**
+   * Calls `restart` in place of KernelCollector::restart(), for tools that
+   *   run a BufferedPoller without a KernelCollector.
+   */
+  explicit KernelCollectorRestarter(std::function<void()> restart);
+
   void startup_completed();
   void request_restart();
   void reset();
@@ -32,5 +41,5 @@ private:
   bool restart_requested_;
   bool restart_in_progress_;
 
-  KernelCollector &collector_;
+  std::function<void()> restart_;
 };
@@ -113,6 +113,12 @@ protected:
 
     bool const enable_userland_tcp = false;
 
+    bool const use_bpf_ring_buffer = false;
+
+    bool const enable_bpf_stats_aggregation = false;
+
+    std::size_t const dns_parse_threads = 0;
+
     u64 const socket_stats_interval_sec = 10;
 
     struct utsname unamebuf;
@@ -157,6 +163,9 @@ protected:
         *curl_engine,
         enable_http_metrics,
         enable_userland_tcp,
+        use_bpf_ring_buffer,
+        enable_bpf_stats_aggregation,
+        dns_parse_threads,
         socket_stats_interval_sec,
         CgroupHandler::CgroupSettings{false, std::nullopt},
         bpf_dump_file,
@@ -109,6 +109,51 @@ void check_permissions()
   }
 }
 
+/**
+ * Returns true if the running kernel supports BPF ring buffers (Linux 5.8+), by creating and
+ * immediately closing a minimally sized one.
+ */
+bool is_bpf_ring_buffer_supported()
+{
+  int fd = bcc_create_map(BPF_MAP_TYPE_RINGBUF, "", 0, 0, getpagesize(), 0);
+  if (fd < 0) {
+    LOG::debug("Test BPF ring buffer creation failed with errno {}: {}", errno, strerror(errno));
+    return false;
+  }
+
+  close(fd);
+  return true;
+}
+
+/**
+ * Returns true if the running kernel supports what BPF stats pre-aggregation needs: per-CPU hash tables and batched
+ * lookup-and-delete (Linux 5.6+). Checked by draining a freshly created, empty table.
+ */
+bool is_bpf_stats_aggregation_supported()
+{
+  int fd = bcc_create_map(BPF_MAP_TYPE_PERCPU_HASH, "", sizeof(u64), sizeof(u64), 1, 0);
+  if (fd < 0) {
+    LOG::debug("Test BPF per-CPU hash creation failed with errno {}: {}", errno, strerror(errno));
+    return false;
+  }
+
+  u64 key;
+  std::vector<u64> values(ebpf::get_possible_cpus().size());
+  u32 out_batch = 0;
+  u32 count = 1;
+  int ret = bpf_lookup_and_delete_batch(fd, nullptr, &out_batch, &key, values.data(), &count);
+  int const err = ret < 0 ? errno : 0;
+  close(fd);
+
+  /* an empty table reports ENOENT when batch operations are supported */
+  if (err != ENOENT) {
+    LOG::debug("Test BPF batch lookup and delete failed with errno {}: {}", err, strerror(err));
+    return false;
+  }
+
+  return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 void mount_debugfs_if_required()
 {
@@ -320,6 +365,21 @@ int main(int argc, char *argv[])
   args::Flag enable_userland_tcp_flag(
       *parser, "userland_tcp", "Enable userland tcp processing (experimental)", {"enable-userland-tcp"});
 
+  auto disable_bpf_ring_buffer = parser.add_flag(
+      "disable-bpf-ring-buffer", "Always use per-CPU perf rings for eBPF events, even if the kernel supports BPF ring buffers");
+
+  auto enable_bpf_stats_aggregation = parser.add_flag(
+      "enable-bpf-stats-aggregation",
+      "Pre-aggregate TCP and UDP socket statistics in per-CPU eBPF tables, drained once per socket stats interval,"
+      " instead of sending them as events (for hosts with high socket churn, requires Linux 5.6+)");
+
+  args::ValueFlag<std::size_t> dns_parse_threads(
+      *parser,
+      "threads",
+      "Number of worker threads parsing DNS packets ahead of the main event loop (0 parses them on the event loop)",
+      {"dns-parse-threads"},
+      0);
+
   auto force_docker_metadata = parser.add_flag("force-docker-metadata", "Forces the use of docker metadata");
   auto disable_nomad_metadata = parser.add_flag("disable-nomad-metadata", "Disables detection and use of Nomad metadata");
 
@@ -412,6 +472,8 @@ int main(int argc, char *argv[])
   bool const enable_userland_tcp = enable_userland_tcp_flag.Matched();
   LOG::info("Userland TCP: {}", enabled_disabled[enable_userland_tcp]);
 
+  LOG::info("DNS parse threads: {}", dns_parse_threads.Get());
+
   /* Initialize curl */
   curlpp::initialize();
 
@@ -509,6 +571,19 @@ int main(int argc, char *argv[])
   try {
     check_permissions();
 
+    /* prefer a single BPF ring buffer over per-CPU perf rings when the kernel supports it */
+    bool const use_bpf_ring_buffer = !*disable_bpf_ring_buffer && is_bpf_ring_buffer_supported();
+    LOG::info("BPF ring buffer: {}", enabled_disabled[use_bpf_ring_buffer]);
+
+    bool use_bpf_stats_aggregation = false;
+    if (*enable_bpf_stats_aggregation) {
+      use_bpf_stats_aggregation = is_bpf_stats_aggregation_supported();
+      if (!use_bpf_stats_aggregation) {
+        LOG::warn("BPF stats aggregation is not supported by the running kernel, sending socket statistics as events");
+      }
+    }
+    LOG::info("BPF stats aggregation: {}", enabled_disabled[use_bpf_stats_aggregation]);
+
     /* mount debugfs if it is not mounted */
     mount_debugfs_if_required();
 
@@ -572,6 +647,9 @@ int main(int argc, char *argv[])
         *curl_engine,
         enable_http_metrics,
         enable_userland_tcp,
+        use_bpf_ring_buffer,
+        use_bpf_stats_aggregation,
+        dns_parse_threads.Get(),
         socket_stats_interval_sec.Get(),
         CgroupHandler::CgroupSettings{
             .force_docker_metadata = *force_docker_metadata,
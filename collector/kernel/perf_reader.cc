@@ -27,17 +27,32 @@ void PerfContainer::add_ring(PerfRing &pr)
   readers_.push_back(pr);
 }
 
-void PerfContainer::add_data_ring(PerfRing &pr)
+void PerfContainer::set_ring_buffer(std::shared_ptr<BpfRingBufferStorage> storage)
 {
+  if (!readers_.empty())
+    throw std::runtime_error("cannot use both a ring buffer and perf rings for the control channel");
 
-  if (data_readers_.size() >= BPF_MAX_CPUS)
+  ring_buffer_ = std::make_unique<BpfRingBuffer>(std::move(storage));
+}
+
+void PerfContainer::add_data_ring(PerfRing &pr, u32 cpu)
+{
+  if (data_readers_.size() >= BPF_MAX_CPUS || cpu >= BPF_MAX_CPUS)
     throw std::runtime_error("Only up to " _STRINGIZE(BPF_MAX_CPUS) " cpus are currently supported");
 
+  if (data_reader_index_by_cpu_.size() <= cpu) {
+    data_reader_index_by_cpu_.resize(cpu + 1, 0);
+  }
+  data_reader_index_by_cpu_[cpu] = data_readers_.size();
+
   data_readers_.push_back(pr);
 }
 
 void PerfContainer::set_callback(uv_loop_t &loop, void *ctx, CALLBACK cb)
 {
+  if (ring_buffer_) {
+    ring_buffer_->set_callback(loop, ctx, cb);
+  }
   for (auto &reader : readers_) {
     reader.set_callback(loop, ctx, cb);
   }
@@ -50,6 +65,12 @@ std::string PerfContainer::inspect(void)
 {
   std::string out;
 
+  if (ring_buffer_) {
+    u32 total_bytes;
+    u32 bytes = ring_buffer_->bytes_remaining(&total_bytes);
+    out += fmt::format("ring_buffer_: size={} ({}% full)\n", bytes, (((double)bytes) / (double)total_bytes) * 100.0);
+  }
+
   size_t num_readers = readers_.size();
   out += fmt::format("readers_: size={}\n", num_readers);
   for (size_t n = 0; n < readers_.size(); n++) {
@@ -66,8 +87,17 @@ std::string PerfContainer::inspect(void)
 }
 
 PerfReader::PerfReader(PerfContainer &container, u64 max_timestamp)
-    : container_(container), max_timestamp_(max_timestamp), active_(true)
+    : container_(container), ring_buffer_(container.ring_buffer_.get()), max_timestamp_(max_timestamp), active_(true)
 {
+  if (ring_buffer_) {
+    /* start the control channel first, so every record seen in it has its data available */
+    ring_buffer_->start_read_batch();
+    for (auto &data_reader : container.data_readers_) {
+      data_reader.start_read_batch();
+    }
+    return;
+  }
+
   for (size_t i = 0; i < container.readers_.size(); i++) {
     auto &reader = container.readers_[i];
     reader.start_read_batch();
@@ -91,11 +121,25 @@ PerfReader::~PerfReader()
 
 bool PerfReader::empty()
 {
+  if (ring_buffer_) {
+    if (ring_buffer_->peek_size() == -ENOENT)
+      return true;
+    if (ring_buffer_->peek_type() != PERF_RECORD_SAMPLE)
+      return false;
+    return ring_buffer_->peek_aligned_u64(sizeof(u64)) > max_timestamp_;
+  }
+
   return (container_.n_entries_ == 0) || (container_.entries_[0].timestamp > max_timestamp_);
 }
 
 void PerfReader::pop_unpadded_and_copy_to(char *dest)
 {
+  if (ring_buffer_) {
+    ring_buffer_->peek_copy(dest, 0, ring_buffer_->peek_size());
+    ring_buffer_->pop();
+    return;
+  }
+
   auto &reader = top();
   /* get length */
   u32 length = reader.peek_size();
@@ -108,6 +152,12 @@ void PerfReader::pop_unpadded_and_copy_to(char *dest)
 
 void PerfReader::pop_and_copy_to(char *dest)
 {
+  if (ring_buffer_) {
+    ring_buffer_->peek_copy(dest, sizeof(u64), ring_buffer_->peek_aligned_u32(sizeof(u32)));
+    ring_buffer_->pop();
+    return;
+  }
+
   auto &reader = top();
   /* get unpadded length */
   u32 unpadded = reader.peek_aligned_u32(sizeof(u32));
@@ -120,6 +170,11 @@ void PerfReader::pop_and_copy_to(char *dest)
 
 void PerfReader::pop()
 {
+  if (ring_buffer_) {
+    ring_buffer_->pop();
+    return;
+  }
+
   auto &reader = top();
   reader.pop();
   update_after_pop();
@@ -130,6 +185,8 @@ void PerfReader::stop()
   if (!active_)
     return;
 
+  if (ring_buffer_)
+    ring_buffer_->finish_read_batch();
   for (auto &reader : container_.readers_)
     reader.finish_read_batch();
   for (auto &data_reader : container_.data_readers_)
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <bitset>
+#include <memory>
 #include <queue>
 #include <utility>
 #include <vector>
@@ -13,6 +14,7 @@
 #include <platform/platform.h>
 
 #include <collector/kernel/bpf_src/render_bpf.h>
+#include <util/bpf_ring_buffer.h>
 #include <util/perf_ring_cpp.h>
 
 /**
@@ -26,6 +28,12 @@
  *   * if the next entry is PERF_RECORD_SAMPLE, the timestamp will be the one
  *     encoded in the sample. This code assume that a sample starts with
  *      [ perf_event_header + u32 size + u32 unpadded_size + u64 timestamp ]
+ *
+ * Alternatively, the control channel can be a single BPF ring buffer shared by
+ *   all CPUs (see set_ring_buffer). Records come out of it already ordered, so
+ *   entries_ is not used. Its records start with
+ *      [ u32 cpu + u32 unpadded_size + u64 timestamp ]
+ *   so the same offsets apply to both.
  */
 class PerfContainer {
 public:
@@ -48,11 +56,22 @@ public:
   void add_ring(PerfRing &pr);
 
   /**
-   * Add the data channel ring to the collection
+   * Use a single BPF ring buffer as the control channel, instead of per-CPU
+   * perf rings added with add_ring().
+   */
+  void set_ring_buffer(std::shared_ptr<BpfRingBufferStorage> storage);
+
+  /**
+   * Returns true if the control channel is a BPF ring buffer
+   */
+  bool has_ring_buffer() const { return ring_buffer_ != nullptr; }
+
+  /**
+   * Add the data channel ring for the given cpu to the collection
    *
    * Throws if trying to add more than 64 elements
    */
-  void add_data_ring(PerfRing &pr);
+  void add_data_ring(PerfRing &pr, u32 cpu);
 
   /**
    * Set a callback to execute when events show up in the
@@ -68,7 +87,7 @@ public:
    */
   std::string inspect(void);
 
-  // returns the number of perf rings in this container
+  // returns the number of control channel perf rings in this container
   std::size_t size() const { return readers_.size(); }
 
   // returns a reference to the i-th perf ring
@@ -83,6 +102,12 @@ private:
   std::vector<PerfRing> readers_;
   std::vector<PerfRing> data_readers_;
 
+  /* cpu -> index into data_readers_ */
+  std::vector<u32> data_reader_index_by_cpu_;
+
+  /* control channel, when not using per-CPU perf rings */
+  std::unique_ptr<BpfRingBuffer> ring_buffer_;
+
   /* (timestamp, reader_index) pairs */
   struct PerfEntry {
     u64 timestamp;
@@ -135,33 +160,49 @@ public:
    *
    * Assumes reader is not empty (i.e., !empty())
    */
-  inline u32 peek_type() const { return top().peek_type(); }
+  inline u32 peek_type() const { return ring_buffer_ ? ring_buffer_->peek_type() : top().peek_type(); }
 
   /**
    * Returns the total size of the next perf event
    *
    * Assumes reader is not empty (i.e., !empty())
    */
-  inline u32 peek_size() { return top().peek_size(); }
+  inline u32 peek_size() { return ring_buffer_ ? ring_buffer_->peek_size() : top().peek_size(); }
 
   /**
    * Returns the length of the payload of the next value
    *
    * Assumes reader is not empty (i.e., !empty()) and type==PERF_RECORD_SAMPLE
    */
-  inline u16 peek_unpadded_length() { return top().peek_aligned_u32(sizeof(u32)); }
+  inline u16 peek_unpadded_length()
+  {
+    return ring_buffer_ ? ring_buffer_->peek_aligned_u32(sizeof(u32)) : top().peek_aligned_u32(sizeof(u32));
+  }
 
   /**
    * Returns the length of the payload of the next value
    *
    * Assumes reader is not empty (i.e., !empty()) and type==PERF_RECORD_SAMPLE
    */
-  inline u16 peek_rpc_id() { return top().peek_aligned_u16(2 * sizeof(u64)); }
+  inline u16 peek_rpc_id()
+  {
+    return ring_buffer_ ? ring_buffer_->peek_aligned_u16(2 * sizeof(u64)) : top().peek_aligned_u16(2 * sizeof(u64));
+  }
+
+  /**
+   * Returns the timestamp of the next value
+   *
+   * Assumes reader is not empty (i.e., !empty()) and type==PERF_RECORD_SAMPLE
+   */
+  inline u64 peek_timestamp()
+  {
+    return ring_buffer_ ? ring_buffer_->peek_aligned_u64(sizeof(u64)) : top().peek_aligned_u64(sizeof(u64));
+  }
 
   /**
    * Returns the number of lost samples, if type is PERF_RECORD_LOST
    */
-  inline u64 peek_n_lost() { return top().peek_aligned_u64(sizeof(u64)); }
+  inline u64 peek_n_lost() { return ring_buffer_ ? ring_buffer_->peek_n_lost() : top().peek_aligned_u64(sizeof(u64)); }
 
   /**
    * Returns a view into the sample's contents, without the perf event header.
@@ -176,17 +217,20 @@ public:
    */
   inline std::pair<std::string_view, std::string_view> peek_message() const
   {
-    auto const &ring = top();
-    assert(ring.peek_type() == PERF_RECORD_SAMPLE);
-    return ring.peek();
+    assert(peek_type() == PERF_RECORD_SAMPLE);
+    return ring_buffer_ ? ring_buffer_->peek() : top().peek();
   }
 
   /**
-   * Returns which cpu index we're reading from next
+   * Returns the index of the data ring belonging to the cpu the next value
+   * was submitted from
    */
-
   inline size_t peek_index() const
   {
+    if (ring_buffer_) {
+      /* ring buffer records carry the cpu in place of the perf sample size */
+      return container_.data_reader_index_by_cpu_[ring_buffer_->peek_aligned_u32(0)];
+    }
     size_t idx = container_.entries_[0].reader_index;
     return idx;
   }
@@ -223,6 +267,16 @@ public:
    */
   void stop();
 
+  /**
+   * Calls `fn(ring)` for up to `max_samples` samples in the batch, without consuming them. `ring` is a read-only
+   * cursor (PerfRing or BpfRingBuffer) positioned at the sample, so the same peek functions apply.
+   *
+   * Samples are visited ring by ring rather than in timestamp order, and may include samples past `max_timestamp`.
+   * Per-CPU rings are visited starting with ring `first_ring` (modulo the number of rings), so that callers can rotate
+   * it and have every ring scanned when `max_samples` runs out before the last ring.
+   */
+  template <typename Fn> void scan_ahead(std::size_t max_samples, std::size_t first_ring, Fn &&fn) const;
+
 private:
   /**
    * Returns the reader with the smallest
@@ -252,6 +306,9 @@ private:
   /* container to read from */
   PerfContainer &container_;
 
+  /* the container's ring buffer, if it has one */
+  BpfRingBuffer *ring_buffer_;
+
   /* the maximum timestamp we should accept */
   u64 max_timestamp_;
 
@@ -262,3 +319,30 @@ private:
   PerfReader(const PerfReader &) = delete;
   void operator=(const PerfReader &) = delete;
 };
+
+/*****************
+ * IMPLEMENTATION
+ *****************/
+
+template <typename Fn> void PerfReader::scan_ahead(std::size_t max_samples, std::size_t first_ring, Fn &&fn) const
+{
+  /* copies only advance their own read position, the shared consumer position is untouched until stop() */
+  auto const scan = [&](auto cursor) {
+    for (; max_samples > 0 && cursor.peek_size() != -ENOENT; cursor.pop()) {
+      if (cursor.peek_type() == PERF_RECORD_SAMPLE) {
+        fn(std::as_const(cursor));
+        --max_samples;
+      }
+    }
+  };
+
+  if (ring_buffer_) {
+    scan(*ring_buffer_);
+    return;
+  }
+
+  auto const &readers = container_.readers_;
+  for (std::size_t i = 0; i < readers.size(); ++i) {
+    scan(readers[(first_ring + i) % readers.size()]);
+  }
+}
@@ -0,0 +1,287 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+// Compares draining the control channel through per-CPU perf rings, which PerfReader merges by timestamp, against a
+// single BPF ring buffer shared by all CPUs. Rings are kept in memory and filled by a userland emulation of the kernel
+// producers, so this runs without eBPF support.
+//
+// Usage: perf_reader_bench [n_cpus] [n_events]
+
+#include <collector/kernel/perf_reader.h>
+#include <util/stop_watch.h>
+
+#include <linux/perf_event.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include <string.h>
+
+namespace {
+
+constexpr u64 ring_page_size = 4096;
+
+/* bytes of control channel ring per cpu, the ring buffer gets the same total */
+constexpr u32 ring_bytes_per_cpu = 256 * ring_page_size;
+
+/* events written between two drains */
+constexpr u32 events_per_round = 16 * 1024;
+
+/* layout of the records submitted by BPF, see BpfGenerator */
+struct Record {
+  u32 size_or_cpu;
+  u32 unpadded_size;
+  u64 timestamp;
+  u16 rpc_id;
+  u8 payload[38];
+};
+static_assert(sizeof(Record) % 8 == 0);
+
+std::string_view as_view(Record const &record)
+{
+  return std::string_view(reinterpret_cast<char const *>(&record), sizeof(record));
+}
+
+class InMemoryPerfRingStorage : public PerfRingStorage {
+public:
+  InMemoryPerfRingStorage(u32 n_bytes) : buffer_((ring_page_size + n_bytes) / sizeof(u64))
+  {
+    data_ = reinterpret_cast<char *>(buffer_.data());
+    n_data_pages_ = n_bytes / ring_page_size;
+    page_size_ = ring_page_size;
+  }
+
+  void set_callback(uv_loop_t &loop, void *ctx, CALLBACK cb) override {}
+
+private:
+  std::vector<u64> buffer_;
+};
+
+class InMemoryBpfRingBufferStorage : public BpfRingBufferStorage {
+public:
+  InMemoryBpfRingBufferStorage(u64 n_bytes) : buffer_(n_bytes / sizeof(u64))
+  {
+    consumer_pos_ = &consumer_;
+    producer_pos_ = &producer_;
+    data_ = reinterpret_cast<char const *>(buffer_.data());
+    data_size_ = n_bytes;
+    lost_count_ = &lost_;
+  }
+
+  void set_callback(uv_loop_t &loop, void *ctx, CALLBACK cb) override {}
+
+  /* emulates bpf_ringbuf_output(): reserve, copy, then commit; returns false if the record was lost */
+  bool output(std::string_view record)
+  {
+    u64 const size = BpfRingBuffer::record_size(record.size());
+    if (producer_ + size - __atomic_load_n(&consumer_, __ATOMIC_ACQUIRE) > data_size_) {
+      ++lost_;
+      return false;
+    }
+
+    char *const data = reinterpret_cast<char *>(buffer_.data());
+    u64 const mask = data_size_ - 1;
+    u32 *const header = reinterpret_cast<u32 *>(&data[producer_ & mask]);
+    u64 const payload = (producer_ + BpfRingBuffer::header_size) & mask;
+
+    __atomic_store_n(header, BpfRingBuffer::busy_bit | record.size(), __ATOMIC_RELAXED);
+    __atomic_store_n(&producer_, producer_ + size, __ATOMIC_RELEASE);
+
+    u64 const len_to_ring_end = data_size_ - payload;
+    if (record.size() > len_to_ring_end) {
+      memcpy(&data[payload], record.data(), len_to_ring_end);
+      memcpy(&data[0], record.data() + len_to_ring_end, record.size() - len_to_ring_end);
+    } else {
+      memcpy(&data[payload], record.data(), record.size());
+    }
+
+    __atomic_store_n(header, (u32)record.size(), __ATOMIC_RELEASE);
+    return true;
+  }
+
+private:
+  std::vector<u64> buffer_;
+  u64 consumer_ = 0;
+  u64 producer_ = 0;
+  u64 lost_ = 0;
+};
+
+struct PerfRings {
+  PerfRings(u32 n_cpus)
+  {
+    for (u32 cpu = 0; cpu < n_cpus; ++cpu) {
+      PerfRing ring(std::make_shared<InMemoryPerfRingStorage>(ring_bytes_per_cpu));
+      rings.push_back(ring);
+      container->add_ring(ring);
+
+      PerfRing data_ring(std::make_shared<InMemoryPerfRingStorage>(ring_page_size));
+      container->add_data_ring(data_ring, cpu);
+    }
+  }
+
+  /* returns false if the record was lost */
+  bool output(u32 cpu, Record record)
+  {
+    record.size_or_cpu = sizeof(Record) - sizeof(u32);
+    auto &ring = rings[cpu];
+    ring.start_write_batch();
+    try {
+      ring.write(as_view(record), PERF_RECORD_SAMPLE);
+    } catch (std::range_error const &) {
+      return false;
+    }
+    ring.finish_write_batch();
+    return true;
+  }
+
+  std::unique_ptr<PerfContainer> container = std::make_unique<PerfContainer>();
+  std::vector<PerfRing> rings;
+};
+
+struct RingBuffer {
+  RingBuffer(u32 n_cpus)
+  {
+    /* same byte budget as the perf rings, rounded down to a power of 2 */
+    u64 n_bytes = ring_bytes_per_cpu;
+    while (n_bytes * 2 <= (u64)ring_bytes_per_cpu * n_cpus) {
+      n_bytes *= 2;
+    }
+
+    storage = std::make_shared<InMemoryBpfRingBufferStorage>(n_bytes);
+    container->set_ring_buffer(storage);
+
+    for (u32 cpu = 0; cpu < n_cpus; ++cpu) {
+      PerfRing data_ring(std::make_shared<InMemoryPerfRingStorage>(ring_page_size));
+      container->add_data_ring(data_ring, cpu);
+    }
+  }
+
+  bool output(u32 cpu, Record record)
+  {
+    record.size_or_cpu = cpu;
+    return storage->output(as_view(record));
+  }
+
+  std::unique_ptr<PerfContainer> container = std::make_unique<PerfContainer>();
+  std::shared_ptr<InMemoryBpfRingBufferStorage> storage;
+};
+
+struct DrainResult {
+  u64 samples = 0;
+  u64 lost = 0;
+  u64 checksum = 0;
+};
+
+DrainResult drain(PerfContainer &container)
+{
+  DrainResult result;
+  PerfReader reader(container, ~0ull);
+  while (!reader.empty()) {
+    if (reader.peek_type() == PERF_RECORD_LOST) {
+      result.lost += reader.peek_n_lost();
+    } else {
+      ++result.samples;
+      result.checksum += reader.peek_rpc_id() + reader.peek_index();
+    }
+    reader.pop();
+  }
+  return result;
+}
+
+/* writes `n_events` spread randomly across cpus in rounds, returns drain ns/event */
+template <typename Rings> double bench_throughput(Rings &rings, u32 n_cpus, u64 n_events)
+{
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<u32> pick_cpu(0, n_cpus - 1);
+
+  Record record = {};
+  record.unpadded_size = sizeof(Record) - sizeof(u64);
+  record.rpc_id = 1;
+
+  u64 drain_ns = 0;
+  u64 drained = 0;
+  for (u64 written = 0; written < n_events;) {
+    for (u32 i = 0; i < events_per_round && written < n_events; ++i, ++written) {
+      record.timestamp = written + 1;
+      if (!rings.output(pick_cpu(rng), record)) {
+        throw std::runtime_error("ring full during throughput run, reduce events_per_round");
+      }
+    }
+
+    StopWatch<> watch;
+    drained += drain(*rings.container).samples;
+    drain_ns += watch.elapsed_ns();
+  }
+
+  if (drained != n_events) {
+    throw std::runtime_error("drained a different number of events than written");
+  }
+
+  return (double)drain_ns / n_events;
+}
+
+/* bursts on a single cpu without draining, returns the number of writes that did not fit in the rings
+ *
+ * These are the events the kernel would drop. Kernel perf rings would report them in PERF_RECORD_LOST records, which the
+ * in-memory rings here cannot emulate, so failed writes are counted for both transports instead. */
+template <typename Rings> u64 bench_burst_failed_writes(Rings &rings, u64 n_events)
+{
+  Record record = {};
+  record.unpadded_size = sizeof(Record) - sizeof(u64);
+  record.rpc_id = 1;
+
+  u64 failed = 0;
+  for (u64 i = 0; i < n_events; ++i) {
+    record.timestamp = i + 1;
+    if (!rings.output(0, record)) {
+      ++failed;
+    }
+  }
+
+  return failed;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  u32 const n_cpus = argc > 1 ? std::atoi(argv[1]) : 8;
+  u64 const n_events = argc > 2 ? std::atoll(argv[2]) : 10 * 1000 * 1000;
+
+  if (n_cpus == 0 || n_cpus > BPF_MAX_CPUS) {
+    std::cerr << "n_cpus must be between 1 and " << BPF_MAX_CPUS << std::endl;
+    return 1;
+  }
+
+  std::cout << "cpus: " << n_cpus << ", events: " << n_events << ", record size: " << sizeof(Record) << std::endl;
+
+  {
+    PerfRings perf(n_cpus);
+    RingBuffer ring_buffer(n_cpus);
+
+    double const perf_ns = bench_throughput(perf, n_cpus, n_events);
+    double const ring_buffer_ns = bench_throughput(ring_buffer, n_cpus, n_events);
+
+    std::cout << "drain, perf rings:  " << perf_ns << " ns/event (" << 1e3 / perf_ns << " Mevents/s)" << std::endl;
+    std::cout << "drain, ring buffer: " << ring_buffer_ns << " ns/event (" << 1e3 / ring_buffer_ns << " Mevents/s)"
+              << std::endl;
+  }
+
+  {
+    u64 const burst = 2ull * ring_bytes_per_cpu / sizeof(Record) * std::min<u32>(n_cpus, 4);
+
+    PerfRings perf(n_cpus);
+    RingBuffer ring_buffer(n_cpus);
+
+    std::cout << "single cpu burst of " << burst << " events, failed writes with perf rings: "
+              << bench_burst_failed_writes(perf, burst)
+              << ", failed writes with ring buffer: " << bench_burst_failed_writes(ring_buffer, burst) << std::endl;
+  }
+
+  return 0;
+}
@@ -15,7 +15,10 @@
 #include <collector/agent_log.h>
 #include <collector/kernel/bpf_src/render_bpf.h>
 #include <collector/kernel/probe_handler.h>
+#include <util/stop_watch.h>
+#include <util/system_ops.h>
 
+#include <chrono>
 #include <memory>
 #include <vector>
 
@@ -24,12 +27,6 @@
 #define DATA_CHANNEL_PERF_RING_N_BYTES (256 * 4096)
 #define DATA_CHANNEL_PERF_RING_N_WATERMARK_BYTES (1)
 
-namespace ebpf {
-// This function is declared in BCC's common.h, which is private (doesn't get installed).
-// TODO: remove this when bcc/common.h is made public.
-std::vector<int> get_online_cpus();
-} // namespace ebpf
-
 ProbeHandler::ProbeHandler(logging::Logger &log) : log_(log), num_failed_probes_(0), stack_trace_count_(0){};
 
 void ProbeHandler::load_kernel_symbols()
@@ -62,7 +59,7 @@ int ProbeHandler::setup_mmap(int cpu, int perf_fd, PerfContainer &perf, bool is_
   /* add to perf container */
   PerfRing ring(std::move(s));
   if (is_data) {
-    perf.add_data_ring(ring);
+    perf.add_data_ring(ring, cpu);
   } else {
     perf.add_ring(ring);
   }
@@ -77,7 +74,7 @@ int ProbeHandler::setup_mmap(int cpu, int perf_fd, PerfContainer &perf, bool is_
   return 0;
 }
 
-int ProbeHandler::get_bpf_table_descriptor(ebpf::BPFModule &bpf_module, const char *table_name)
+int ProbeHandler::get_bpf_table_descriptor(ebpf::BPFModule &bpf_module, const char *table_name, size_t *max_entries)
 {
   ebpf::TableStorage::iterator it;
   ebpf::Path path({bpf_module.id(), table_name});
@@ -92,24 +89,69 @@ int ProbeHandler::get_bpf_table_descriptor(ebpf::BPFModule &bpf_module, const ch
     return -3;
   }
 
+  if (max_entries) {
+    *max_entries = it->second.max_entries;
+  }
+
   return events_fd;
 }
 
-int ProbeHandler::start_bpf_module(std::string full_program, ebpf::BPFModule &bpf_module, PerfContainer &perf)
+int ProbeHandler::setup_ring_buffer_mmap(int ring_fd, size_t n_bytes, int lost_count_fd, PerfContainer &perf)
+{
+  try {
+    perf.set_ring_buffer(std::make_shared<MmapBpfRingBufferStorage>(ring_fd, n_bytes, lost_count_fd));
+  } catch (std::exception &exc) {
+    LOG::error("cannot map ring buffer fd {}: {}", ring_fd, exc.what());
+    return -4;
+  }
+
+  return 0;
+}
+
+int ProbeHandler::start_bpf_module(
+    std::string full_program, ebpf::BPFModule &bpf_module, PerfContainer &perf, bool use_bpf_ring_buffer)
 {
+  auto const usage_before = get_resource_usage();
+  StopWatch<> compile_time;
+
   int res = bpf_module.load_string(full_program, nullptr, 0);
   if (res != 0) {
     LOG::error("Cannot initialize BPF program, res={}", res);
     return -1;
   }
-  LOG::info("eBPF program successfully compiled");
+
+  if (auto const usage_after = get_resource_usage(); usage_before && usage_after) {
+    auto const cpu_time = (usage_after->user_mode_time + usage_after->kernel_mode_time) -
+                          (usage_before->user_mode_time + usage_before->kernel_mode_time);
+    LOG::info(
+        "eBPF program successfully compiled in {}: cpu_time={} max_rss={}MiB (+{}MiB)",
+        compile_time.elapsed<std::chrono::milliseconds>(),
+        std::chrono::duration_cast<std::chrono::milliseconds>(cpu_time),
+        usage_after->max_resident_set_size >> 20,
+        (usage_after->max_resident_set_size - usage_before->max_resident_set_size) >> 20);
+  } else {
+    LOG::info("eBPF program successfully compiled in {}", compile_time.elapsed<std::chrono::milliseconds>());
+  }
 
   /* get events table descriptor */
-  int events_fd = get_bpf_table_descriptor(bpf_module, "events");
+  size_t events_max_entries = 0;
+  int events_fd = get_bpf_table_descriptor(bpf_module, "events", &events_max_entries);
   if (events_fd < 0) {
     return events_fd;
   }
 
+  if (use_bpf_ring_buffer) {
+    /* records the BPF side could not fit in the ring buffer */
+    int events_lost_fd = get_bpf_table_descriptor(bpf_module, "events_lost");
+    if (events_lost_fd < 0) {
+      return events_lost_fd;
+    }
+
+    res = setup_ring_buffer_mmap(events_fd, events_max_entries, events_lost_fd, perf);
+    if (res < 0)
+      return res;
+  }
+
   /* get data_channel table descriptor */
   int data_channel_fd = get_bpf_table_descriptor(bpf_module, "data_channel");
   if (data_channel_fd < 0) {
@@ -121,9 +163,11 @@ int ProbeHandler::start_bpf_module(std::string full_program, ebpf::BPFModule &bp
 
   /* open mmaps */
   for (auto cpu : online_cpus) {
-    res = setup_mmap(cpu, events_fd, perf, false, EVENTS_PERF_RING_N_BYTES, EVENTS_PERF_RING_N_WATERMARK_BYTES);
-    if (res < 0)
-      return res;
+    if (!use_bpf_ring_buffer) {
+      res = setup_mmap(cpu, events_fd, perf, false, EVENTS_PERF_RING_N_BYTES, EVENTS_PERF_RING_N_WATERMARK_BYTES);
+      if (res < 0)
+        return res;
+    }
     res =
         setup_mmap(cpu, data_channel_fd, perf, true, DATA_CHANNEL_PERF_RING_N_BYTES, DATA_CHANNEL_PERF_RING_N_WATERMARK_BYTES);
     if (res < 0)
@@ -164,6 +208,11 @@ ebpf::BPFStackTable ProbeHandler::get_stack_table(ebpf::BPFModule &bpf_module, c
   throw std::runtime_error("ProbeHandler: stack table not found");
 }
 
+int ProbeHandler::get_table_fd(ebpf::BPFModule &bpf_module, const std::string &name)
+{
+  return get_bpf_table_descriptor(bpf_module, name.c_str());
+}
+
 int ProbeHandler::register_tail_call(
     ebpf::BPFModule &bpf_module, const std::string &prog_array_name, int index, const std::string &func_name)
 {
@@ -19,6 +19,13 @@
 #include <string>
 #include <vector>
 
+namespace ebpf {
+// These functions are declared in BCC's common.h, which is private (doesn't get installed).
+// TODO: remove this when bcc/common.h is made public.
+std::vector<int> get_online_cpus();
+std::vector<int> get_possible_cpus();
+} // namespace ebpf
+
 /**
  * ProbeAlternatives encapsulates multiple alternatives to attempt when attaching a probe.  Alternatives may be needed due to
  * differences in kernel versions or builds.
@@ -62,7 +69,15 @@ public:
    */
   void clear_kernel_symbols();
 
-  int start_bpf_module(std::string full_program, ebpf::BPFModule &bpf_module, PerfContainer &perf);
+  /**
+   * Loads the BPF program and maps the rings it submits events through.
+   *
+   * If `use_bpf_ring_buffer` is set, the program must have been compiled with
+   * USE_BPF_RING_BUFFER, and the control channel is read from a single BPF ring
+   * buffer instead of per-CPU perf rings.
+   */
+  int start_bpf_module(
+      std::string full_program, ebpf::BPFModule &bpf_module, PerfContainer &perf, bool use_bpf_ring_buffer = false);
 
   /**
    * BPF table helpers
@@ -71,6 +86,12 @@ public:
   ebpf::BPFProgTable get_prog_table(ebpf::BPFModule &bpf_module, const std::string &name);
   ebpf::BPFStackTable get_stack_table(ebpf::BPFModule &bpf_module, const std::string &name);
 
+  /**
+   * Returns the file descriptor of a table declared in bpf, or a negative
+   * value (after logging an error) if the table is not found
+   */
+  int get_table_fd(ebpf::BPFModule &bpf_module, const std::string &name);
+
   /**
    * Register tail call in table
    */
@@ -178,13 +199,18 @@ protected:
   /**
    * Returns the file descriptor for a table declared in bpf
    */
-  int get_bpf_table_descriptor(ebpf::BPFModule &bpf_module, const char *table_name);
+  int get_bpf_table_descriptor(ebpf::BPFModule &bpf_module, const char *table_name, size_t *max_entries = nullptr);
 
   /**
    * Sets up memory mapping for perf rings
    */
   int setup_mmap(int cpu, int events_fd, PerfContainer &perf, bool is_data, u32 n_bytes, u32 n_watermark_bytes);
 
+  /**
+   * Sets up memory mapping for the control channel BPF ring buffer
+   */
+  int setup_ring_buffer_mmap(int ring_fd, size_t n_bytes, int lost_count_fd, PerfContainer &perf);
+
 private:
   static constexpr char probe_prefix_[] = "ebpf_net_p_";
   static constexpr char kretprobe_prefix_[] = "ebpf_net_r_";
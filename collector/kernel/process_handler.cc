@@ -123,6 +123,16 @@ void ProcessHandler::pid_exit(std::chrono::nanoseconds timestamp, struct jb_agen
   }
 }
 
+std::vector<u32> ProcessHandler::tracked_tgids() const
+{
+  std::vector<u32> tgids;
+  tgids.reserve(processes_.size());
+  for (auto const &process : processes_) {
+    tgids.push_back(process.first);
+  }
+  return tgids;
+}
+
 #ifdef DEBUG_TGID
 void ProcessHandler::debug_tgid_dump()
 {
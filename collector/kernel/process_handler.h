@@ -43,6 +43,9 @@ public:
 
   void pid_exit(std::chrono::nanoseconds timestamp, struct jb_agent_internal__pid_exit const &msg);
 
+  // returns the tgids of all processes currently tracked
+  std::vector<u32> tracked_tgids() const;
+
 #ifdef DEBUG_TGID
   void debug_tgid_dump();
 #endif // DEBUG_TGID
@@ -32,6 +32,15 @@ ProcessProber::ProcessProber(
   probe_handler.start_probe(bpf_module, "on_wake_up_new_task", "wake_up_new_task");
   probe_handler.start_probe(bpf_module, "on_set_task_comm", "__set_task_comm");
 
+  probe_existing(probe_handler, bpf_module, periodic_cb, check_cb);
+}
+
+void ProcessProber::probe_existing(
+    ProbeHandler &probe_handler,
+    ebpf::BPFModule &bpf_module,
+    std::function<void(void)> periodic_cb,
+    std::function<void(std::string)> check_cb)
+{
   // EXISTING
   probe_handler.start_kretprobe(bpf_module, "onret_get_pid_task", "get_pid_task");
   periodic_cb();
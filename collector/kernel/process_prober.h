@@ -21,9 +21,20 @@ public:
       std::function<void(void)> periodic_cb,
       std::function<void(std::string)> check_cb);
 
+  /**
+   * Reports existing processes that are not in the BPF tgid table, without
+   *   touching the probes for new processes. Used to resynchronize after BPF
+   *   samples were lost.
+   */
+  static void probe_existing(
+      ProbeHandler &probe_handler,
+      ebpf::BPFModule &bpf_module,
+      std::function<void(void)> periodic_cb,
+      std::function<void(std::string)> check_cb);
+
 private:
   /**
    * Iterates over /proc and triggers calls to get_pid_task
    */
-  void trigger_get_pid_task(std::function<void(void)> periodic_cb);
+  static void trigger_get_pid_task(std::function<void(void)> periodic_cb);
 };
@@ -5,7 +5,7 @@
 
 #pragma once
 
-#include <memory>
+#include <optional>
 
 #include "platform/platform.h"
 
@@ -15,16 +15,15 @@ class TCPDataHandler;
 
 class ProtocolHandlerBase {
 public:
-  typedef std::shared_ptr<ProtocolHandlerBase> ptr_type;
-
   ProtocolHandlerBase(TCPDataHandler *data_handler, const tcp_control_key_t &key, u32 pid);
   virtual ~ProtocolHandlerBase() {}
 
   virtual void handle_server_data(u64 tstamp, u64 offset, STREAM_TYPE stream_type, const u8 *data, size_t data_len) = 0;
   virtual void handle_client_data(u64 tstamp, u64 offset, STREAM_TYPE stream_type, const u8 *data, size_t data_len) = 0;
 
-  virtual void set_upgrade(ptr_type upgrade) { upgrade_ = upgrade; }
-  virtual ptr_type get_upgrade() { return upgrade_; }
+  // asks the data handler to replace this handler with one for `protocol`, once the current data is handled
+  void set_upgrade(int protocol) { upgrade_ = protocol; }
+  std::optional<int> get_upgrade() const { return upgrade_; }
   inline TCPDataHandler *data_handler() { return data_handler_; }
   inline tcp_control_key_t control_key() const { return key_; }
   inline u32 pid() const { return pid_; }
@@ -32,6 +31,6 @@ public:
 private:
   TCPDataHandler *data_handler_;
   tcp_control_key_t key_;
-  ptr_type upgrade_;
+  std::optional<int> upgrade_;
   u32 pid_;
 };
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "protocol_handler_http.h"
+#include "collector/kernel/tcp_data_handler.h"
 #include "platform/platform.h"
 #include "protocol_tools.h"
 #include "spdlog/common.h"
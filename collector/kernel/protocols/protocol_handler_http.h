@@ -4,10 +4,9 @@
  */
 
 #pragma once
-#include "../tcp_data_handler.h"
 #include "protocol_handler_base.h"
 
-class ProtocolHandler_HTTP : public ProtocolHandlerBase {
+class ProtocolHandler_HTTP final : public ProtocolHandlerBase {
 private:
   u64 request_timestamp_;
   u64 response_timestamp_;
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "protocol_handler_unknown.h"
+#include "collector/kernel/tcp_data_handler.h"
 #include "absl/base/internal/endian.h"
 #include "platform/platform.h"
 #include "protocol_tools.h"
@@ -9,6 +10,7 @@
 #include "spdlog/fmt/bin_to_hex.h"
 #include "util/log.h"
 #include <string_view>
+#include <utility>
 
 ProtocolHandler_UNKNOWN::ProtocolHandler_UNKNOWN(TCPDataHandler *data_handler, const tcp_control_key_t &key, u32 pid)
     : ProtocolHandlerBase(data_handler, key, pid)
@@ -110,7 +112,7 @@ void ProtocolHandler_UNKNOWN::handle_client_data(
       std::string_view((const char *)data, data_len));
 
   // All the client-side protocol detection routines we want to run
-  std::list<std::pair<int, PROTOCOL_DETECT_FUNC>> client_protocols = {
+  static constexpr std::pair<int, PROTOCOL_DETECT_FUNC> client_protocols[] = {
       {TCPPROTO_HTTP, &ProtocolHandler_UNKNOWN::detect_http},
       //{TCPPROTO_MYSQL, &ProtocolHandler_UNKNOWN::detect_mysql},
   };
@@ -125,8 +127,7 @@ void ProtocolHandler_UNKNOWN::handle_client_data(
       auto res = (this->*detect)(offset, stream_type, data, data_len);
       if (res == TPD_SUCCESS) {
         // If we -definitely- detected a particular protocol, upgrade to its handler
-        ProtocolHandlerBase::ptr_type upgrade = data_handler()->create_protocol_handler(tcpproto, control_key(), pid());
-        set_upgrade(upgrade);
+        set_upgrade(tcpproto);
         return;
       } else if (res == TPD_FAILED) {
         // Remove any that are disqualified
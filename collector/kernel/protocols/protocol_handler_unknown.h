@@ -4,10 +4,9 @@
  */
 
 #pragma once
-#include "../tcp_data_handler.h"
 #include "protocol_handler_base.h"
 
-class ProtocolHandler_UNKNOWN : public ProtocolHandlerBase {
+class ProtocolHandler_UNKNOWN final : public ProtocolHandlerBase {
 public:
   ProtocolHandler_UNKNOWN(TCPDataHandler *data_handler, const tcp_control_key_t &key, u32 pid);
   virtual ~ProtocolHandler_UNKNOWN();
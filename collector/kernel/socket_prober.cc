@@ -4,16 +4,29 @@
 #include <collector/agent_log.h>
 #include <collector/kernel/fd_reader.h>
 #include <collector/kernel/probe_handler.h>
-#include <collector/kernel/proc_net_reader.h>
 #include <collector/kernel/proc_reader.h>
 #include <collector/kernel/socket_prober.h>
 #include <config.h>
 #include <iostream>
 #include <set>
 #include <util/log.h>
+#include <util/stop_watch.h>
+
+#include <absl/container/flat_hash_set.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 static constexpr u32 periodic_cb_mask = 0x3f;
 
+/* /proc/net files are drained in reads this large: each read(2) makes the kernel emit several dozen entries (lines are
+ * 128 to 178 bytes), so that periodic_cb can still drain the perf rings about every periodic_cb_mask + 1 sockets */
+static constexpr std::size_t proc_net_read_size = 8 * 1024;
+
 SocketProber::SocketProber(
     ProbeHandler &probe_handler,
     ebpf::BPFModule &bpf_module,
@@ -45,6 +58,28 @@ SocketProber::SocketProber(
   probe_handler.start_probe(bpf_module, "on_udp_v46_get_port", "udp_v4_get_port");
   probe_handler.start_probe(bpf_module, "on_udp_v46_get_port", "udp_v6_get_port");
 
+  probe_existing_sockets(probe_handler, bpf_module, periodic_cb, check_cb);
+}
+
+SocketProber::SocketProber(logging::Logger &log) : log_(log) {}
+
+void SocketProber::probe_existing(
+    ProbeHandler &probe_handler,
+    ebpf::BPFModule &bpf_module,
+    std::function<void(void)> periodic_cb,
+    std::function<void(std::string)> check_cb,
+    logging::Logger &log)
+{
+  SocketProber prober(log);
+  prober.probe_existing_sockets(probe_handler, bpf_module, periodic_cb, check_cb);
+}
+
+void SocketProber::probe_existing_sockets(
+    ProbeHandler &probe_handler,
+    ebpf::BPFModule &bpf_module,
+    std::function<void(void)> periodic_cb,
+    std::function<void(std::string)> check_cb)
+{
   // EXISTING
   probe_handler.start_probe(bpf_module, "on_tcp46_seq_show", "tcp4_seq_show");
   probe_handler.start_probe(bpf_module, "on_tcp46_seq_show", "tcp6_seq_show");
@@ -60,13 +95,16 @@ SocketProber::SocketProber(
   periodic_cb();
   check_cb("clear inode table");
 
+  StopWatch<> watch;
   fill_inode_to_pid_map(seen_inodes, periodic_cb);
   check_cb("fill_inode_to_pid_map()");
+  LOG::info("existing sockets: inode to pid map filled in {}", watch.elapsed_reset<std::chrono::milliseconds>());
 
   // now iterate over processes again but look through network namespaces
   // for new ns, read tcp and tcp6. this will trigger tcp46_seq_show
   trigger_seq_show(periodic_cb);
   check_cb("trigger_seq_show()");
+  LOG::info("existing sockets: seq_show triggered in {}", watch.elapsed_reset<std::chrono::milliseconds>());
 
   /* can remove existing now */
   probe_handler.cleanup_probe("tcp4_seq_show");
@@ -89,6 +127,9 @@ void SocketProber::fill_inode_to_pid_map(ebpf::BPFHashTable<u32, u32> &map, std:
   ProcReader proc_reader;
   u32 proc_count = 0;
   u32 n_update_failures = 0;
+
+  // inodes already added, checked here rather than with a lookup syscall on the BPF map
+  absl::flat_hash_set<u32> added_inodes;
   while (proc_reader.next()) {
     // every few procs, call periodic_cb, in case a lot of them are skipped
     if (((++proc_count) & periodic_cb_mask) == 0)
@@ -116,14 +157,11 @@ void SocketProber::fill_inode_to_pid_map(ebpf::BPFHashTable<u32, u32> &map, std:
     while (!fd_reader.next_fd()) {
       int ino = fd_reader.get_inode();
       if (ino > 0) {
-        u32 lookup_pid = 0;
-        ebpf::StatusTuple stat = map.get_value((u32)ino, lookup_pid);
-        if (stat.code() == 0) {
-          LOG::trace_in(
-              AgentLogKind::SOCKET, "Duplicate file descriptor for pid={}, ino={} (lookup_pid={})", pid, ino, lookup_pid);
+        if (added_inodes.contains((u32)ino)) {
+          LOG::trace_in(AgentLogKind::SOCKET, "Duplicate file descriptor for pid={}, ino={}", pid, ino);
           continue;
         }
-        stat = map.update_value((u32)ino, (u32)pid);
+        ebpf::StatusTuple stat = map.update_value((u32)ino, (u32)pid);
         if (stat.code()) {
           // log at most 10 times
           if (++n_update_failures < 10) {
@@ -133,6 +171,7 @@ void SocketProber::fill_inode_to_pid_map(ebpf::BPFHashTable<u32, u32> &map, std:
           }
           continue;
         }
+        added_inodes.insert((u32)ino);
         LOG::trace_in(AgentLogKind::SOCKET, "Added inode to hash_map: pid={}, ino={}", pid, ino);
       }
 
@@ -148,6 +187,8 @@ void SocketProber::fill_inode_to_pid_map(ebpf::BPFHashTable<u32, u32> &map, std:
   if (n_update_failures != 0) {
     log_.warn("Recovering existing socket inodes got {} total update failures", n_update_failures);
   }
+
+  LOG::debug("existing sockets: found {} socket inodes in {} /proc entries", added_inodes.size(), proc_count);
 }
 
 void SocketProber::trigger_seq_show(std::function<void(void)> periodic_cb)
@@ -176,58 +217,37 @@ void SocketProber::trigger_seq_show(std::function<void(void)> periodic_cb)
     /* new network namespace -- process it */
     done_network_namespaces.insert(network_namespace);
 
-    read_proc_net_tcp("/proc/" + std::to_string(pid) + "/net/tcp", periodic_cb);
-    read_proc_net_tcp("/proc/" + std::to_string(pid) + "/net/tcp6", periodic_cb);
-    read_proc_net_udp("/proc/" + std::to_string(pid) + "/net/udp", periodic_cb);
-    read_proc_net_udp("/proc/" + std::to_string(pid) + "/net/udp6", periodic_cb);
+    read_proc_net("/proc/" + std::to_string(pid) + "/net/tcp", periodic_cb);
+    read_proc_net("/proc/" + std::to_string(pid) + "/net/tcp6", periodic_cb);
+    read_proc_net("/proc/" + std::to_string(pid) + "/net/udp", periodic_cb);
+    read_proc_net("/proc/" + std::to_string(pid) + "/net/udp6", periodic_cb);
   }
 
   periodic_cb();
 }
 
-void SocketProber::read_proc_net_tcp(const std::string &filename, std::function<void(void)> periodic_cb)
+void SocketProber::read_proc_net(const std::string &filename, std::function<void(void)> periodic_cb)
 {
-
-  ProcNetReader proc_net_reader(filename);
-  u32 sk_count = 0;
-  while (proc_net_reader.next()) {
-    // every few sk's, call periodic_cb
-    if (((++sk_count) & periodic_cb_mask) == 0)
-      periodic_cb();
-
-    // u64 sk_p = proc_net_reader.get_sk();
-
-    // int sk_state = proc_net_reader.get_sk_state();
-    // if ((sk_state != 1) && (sk_state != 10)) {
-    //   LOG::trace_in(AgentLogKind::SOCKET, "sk {:x} state not listen/established: {}", sk_p, sk_state);
-    //   continue;
-    // }
-
-    // int sk_ino = proc_net_reader.get_ino();
-    // if (sk_ino == 0) {
-    //  LOG::debug("sk {:x} sk_ino was 0: {}", sk_p, sk_ino);
-    //  continue; // skip if ino=0 (sk will already be closed)
-    //}
-
-    /* TODO: log? */
-    // std::cout << "successful sk: " << sk_p << "\t sk_ino: " << sk_ino <<
-    // std::endl;
+  int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    LOG::trace_in(AgentLogKind::SOCKET, "could not open {}: {}", filename, strerror(errno));
+    return;
   }
-}
-
-void SocketProber::read_proc_net_udp(const std::string &filename, std::function<void(void)> periodic_cb)
-{
-
-  ProcNetReader proc_net_reader(filename);
 
+  /* the contents are not needed: the kernel calls seq_show for each socket it
+   * writes out, and that is what the BPF probes report */
+  char buf[proc_net_read_size];
   u32 sk_count = 0;
-  while (proc_net_reader.next()) {
-    /* just iterate to get udp sockets in udp_seq_show */
-
-    // every few sk's, call periodic_cb
-    if (((++sk_count) & periodic_cb_mask) == 0)
-      periodic_cb();
+  for (ssize_t n; (n = ::read(fd, buf, sizeof(buf))) > 0;) {
+    char const *const end = buf + n;
+    for (char const *line = buf; (line = static_cast<char const *>(memchr(line, '\n', end - line))); ++line) {
+      // every few sk's, call periodic_cb
+      if (((++sk_count) & periodic_cb_mask) == 0)
+        periodic_cb();
+    }
   }
+
+  ::close(fd);
 }
 
 int SocketProber::get_network_namespace(int pid)
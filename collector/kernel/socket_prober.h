@@ -10,6 +10,7 @@
 
 #include <functional>
 #include <memory>
+#include <string>
 
 #include <platform/types.h>
 
@@ -39,38 +40,55 @@ public:
       std::function<void(std::string)> check_cb,
       logging::Logger &log);
 
-private:
   /**
-   * Fills the given map with a mapping of inode->pid of existing sockets
-   *
-   * @param map: the inode->pid map to fill
-   * @param periodic_cb: callback to call after doing some work.
+   * Reports existing sockets that are not in the BPF socket tables, without
+   *   touching the probes for new sockets. Used to resynchronize after BPF
+   *   samples were lost.
    */
-  void fill_inode_to_pid_map(ebpf::BPFHashTable<u32, u32> &map, std::function<void(void)> periodic_cb);
+  static void probe_existing(
+      ProbeHandler &probe_handler,
+      ebpf::BPFModule &bpf_module,
+      std::function<void(void)> periodic_cb,
+      std::function<void(std::string)> check_cb,
+      logging::Logger &log);
 
   /**
-   * Iterates through proc, and triggers the corresponding seq_show functions
-   *   for all supported types of existing sockets by reading proc namespaces
+   * Reads a file in /proc/<pid>/net/{tcp,tcp6,udp,udp6} to the end, which
+   *   makes the kernel call the corresponding seq_show for every socket
    *
+   * @param filename: the file to read
    * @param periodic_cb: callback to call after doing some work.
    */
-  void trigger_seq_show(std::function<void(void)> periodic_cb);
+  static void read_proc_net(const std::string &filename, std::function<void(void)> periodic_cb);
+
+private:
+  SocketProber(logging::Logger &log);
+
+  /**
+   * Temporarily probes seq_show and iterates existing sockets, so BPF
+   *   reports the ones missing from its socket tables
+   */
+  void probe_existing_sockets(
+      ProbeHandler &probe_handler,
+      ebpf::BPFModule &bpf_module,
+      std::function<void(void)> periodic_cb,
+      std::function<void(std::string)> check_cb);
 
   /**
-   * Reads a file in /proc/<pid>/net/{tcp,tcp6}
+   * Fills the given map with a mapping of inode->pid of existing sockets
    *
-   * @param filename: the file to read
+   * @param map: the inode->pid map to fill
    * @param periodic_cb: callback to call after doing some work.
    */
-  void read_proc_net_tcp(const std::string &filename, std::function<void(void)> periodic_cb);
+  void fill_inode_to_pid_map(ebpf::BPFHashTable<u32, u32> &map, std::function<void(void)> periodic_cb);
 
   /**
-   * Reads a file in /proc/<pid>/net/{udp,udp6}
+   * Iterates through proc, and triggers the corresponding seq_show functions
+   *   for all supported types of existing sockets by reading proc namespaces
    *
-   * @param filename: the file to read
    * @param periodic_cb: callback to call after doing some work.
    */
-  void read_proc_net_udp(const std::string &filename, std::function<void(void)> periodic_cb);
+  void trigger_seq_show(std::function<void(void)> periodic_cb);
 
   /**
    * Returns the network namespace the pid lives in, by reading /proc
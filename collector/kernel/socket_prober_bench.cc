@@ -0,0 +1,135 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+// Measures how long the existing-socket scan takes to read /proc/<pid>/net/{tcp,tcp6,udp,udp6} of every network
+// namespace on this host, with SocketProber::read_proc_net against the line-by-line parse the prober used before
+// (std::getline plus an istringstream per socket). Reading these files is what makes the kernel call the seq_show
+// functions that the BPF probes hook, so this is the userland part of the startup cost that depends on socket count.
+//
+// Usage: socket_prober_bench [iterations]
+
+#include <collector/kernel/proc_reader.h>
+#include <collector/kernel/socket_prober.h>
+#include <util/stop_watch.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <string.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char const *proc_net_files[] = {"tcp", "tcp6", "udp", "udp6"};
+
+/* one /proc/<pid>/net directory per network namespace, like SocketProber::trigger_seq_show picks them */
+std::vector<std::string> network_namespace_dirs()
+{
+  std::vector<std::string> dirs;
+  std::set<std::string> seen;
+
+  ProcReader proc_reader;
+  while (proc_reader.next()) {
+    if (!proc_reader.is_pid()) {
+      continue;
+    }
+
+    std::string const pid_dir = "/proc/" + std::to_string(proc_reader.get_pid());
+    char link_content[64];
+    ssize_t const len = readlink((pid_dir + "/ns/net").c_str(), link_content, sizeof(link_content) - 1);
+    if (len <= 0) {
+      continue;
+    }
+
+    if (seen.emplace(link_content, len).second) {
+      dirs.push_back(pid_dir + "/net/");
+    }
+  }
+  return dirs;
+}
+
+/* the parse the prober did before: every field up to the sk pointer of every line, all of it discarded */
+u64 read_line_by_line(std::string const &filename, u64 &checksum)
+{
+  std::ifstream file(filename);
+  std::string line;
+  getline(file, line);
+
+  u64 sockets = 0;
+  while (getline(file, line) && !line.empty()) {
+    std::istringstream issline(line);
+    std::string tk;
+    int tk_id = 0;
+    unsigned sk_state = 0;
+    int sk_ino = 0;
+    unsigned long sk_p = 0;
+    do {
+      issline >> tk;
+      tk_id++;
+      if (tk_id == 4) {
+        sscanf(tk.c_str(), "%x", &sk_state);
+      } else if (tk_id == 10) {
+        sscanf(tk.c_str(), "%d", &sk_ino);
+      } else if (tk_id == 12) {
+        sscanf(tk.c_str(), "%lx", &sk_p);
+      } else if (tk_id > 12) {
+        break;
+      }
+    } while (issline);
+
+    checksum += sk_state + sk_ino + sk_p;
+    ++sockets;
+  }
+  return sockets;
+}
+
+template <typename Fn> double bench(std::vector<std::string> const &dirs, u64 iterations, Fn &&read_file)
+{
+  StopWatch<> watch;
+  for (u64 i = 0; i < iterations; ++i) {
+    for (auto const &dir : dirs) {
+      for (auto const file : proc_net_files) {
+        read_file(dir + file);
+      }
+    }
+  }
+  return (double)watch.elapsed_ns() / iterations / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  u64 const iterations = argc > 1 ? std::atoll(argv[1]) : 10;
+
+  StopWatch<> watch;
+  auto const dirs = network_namespace_dirs();
+  double const enumerate_ms = (double)watch.elapsed_ns() / 1e6;
+  std::cout << "network namespaces: " << dirs.size() << ", found in " << enumerate_ms << " ms" << std::endl;
+
+  u64 checksum = 0;
+  u64 sockets = 0;
+  double const line_by_line_ms = bench(dirs, iterations, [&](std::string const &filename) {
+    sockets += read_line_by_line(filename, checksum);
+  });
+  sockets /= iterations;
+  std::cout << "sockets: " << sockets << std::endl;
+  std::cout << "line by line:  " << line_by_line_ms << " ms/scan" << std::endl;
+
+  u64 periodic_calls = 0;
+  double const read_proc_net_ms = bench(dirs, iterations, [&](std::string const &filename) {
+    SocketProber::read_proc_net(filename, [&] { ++periodic_calls; });
+  });
+  std::cout << "read_proc_net: " << read_proc_net_ms << " ms/scan, " << periodic_calls / iterations
+            << " periodic_cb calls/scan" << std::endl;
+
+  std::cout << "speedup: " << line_by_line_ms / read_proc_net_ms << "x" << std::endl;
+  std::cout << "checksum: " << checksum << std::endl;
+  return 0;
+}
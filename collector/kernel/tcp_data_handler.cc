@@ -19,11 +19,6 @@
 #include "protocols/protocol_handler_http.h"
 #include "protocols/protocol_handler_unknown.h"
 
-bool TCPDataHandler::tcp_control_key_t_comparator::operator()(const tcp_control_key_t &a, const tcp_control_key_t &b) const
-{
-  return a.sk < b.sk;
-}
-
 TCPDataHandler::TCPDataHandler(
     uv_loop_t &loop,
     ebpf::BPFModule &bpf_module,
@@ -43,35 +38,18 @@ TCPDataHandler::TCPDataHandler(
 
 TCPDataHandler::~TCPDataHandler() {}
 
-std::shared_ptr<ProtocolHandlerBase>
-TCPDataHandler::create_protocol_handler(int protocol, const tcp_control_key_t &key, u32 pid)
+void TCPDataHandler::create_protocol_handler(ProtocolHandler &handler, int protocol, const tcp_control_key_t &key, u32 pid)
 {
   switch (protocol) {
   case TCPPROTO_HTTP:
-    return std::make_shared<ProtocolHandler_HTTP>(this, key, pid);
+    handler.emplace<ProtocolHandler_HTTP>(this, key, pid);
+    break;
   case TCPPROTO_UNKNOWN:
-    return std::make_shared<ProtocolHandler_UNKNOWN>(this, key, pid);
+    handler.emplace<ProtocolHandler_UNKNOWN>(this, key, pid);
+    break;
   default:
     throw std::runtime_error("invalid protocol");
   }
-  return nullptr;
-}
-
-void TCPDataHandler::upgrade_protocol_handler(
-    std::shared_ptr<ProtocolHandlerBase> new_handler, std::shared_ptr<ProtocolHandlerBase> original_handler)
-{
-  tcp_control_key_t key = original_handler->control_key();
-#ifndef NDEBUG
-  tcp_control_key_t newkey = new_handler->control_key();
-  assert(key.sk == newkey.sk);
-#endif
-
-  auto it = protocol_handlers_.find(key);
-  if (it == protocol_handlers_.end()) {
-    throw std::runtime_error("update from invalid protocol");
-  }
-
-  it->second = new_handler;
 }
 
 // toggle enabling one side of a stream
@@ -192,25 +170,67 @@ void TCPDataHandler::update_stream_start(const tcp_control_key_t &key, STREAM_TY
 void TCPDataHandler::process(
     size_t idx, u64 tstamp, u64 sk, u32 pid, u32 length, u64 offset, STREAM_TYPE stream_type, CLIENT_SERVER_TYPE client_server)
 {
-  // Send to the appropriate protocol handler
+  // Gather all the chunks of this message first, so the protocol handler sees them in a single call
+  u32 const data_len = read_data_channel(idx, length);
+  if (data_len == 0) {
+    return;
+  }
+
   tcp_control_key_t key{.sk = sk};
 
   // find the appropriate protocol handler
-  auto phiter = protocol_handlers_.find(key);
-  if (phiter == protocol_handlers_.end()) {
+  auto pos = protocol_handlers_.find(sk);
+  if (pos.entry == nullptr) {
     // data for new socket, so create a protocol handler for it
-    auto ret = protocol_handlers_.insert(std::make_pair(key, create_protocol_handler(TCPPROTO_UNKNOWN, key, pid)));
-    phiter = ret.first;
+    pos = protocol_handlers_.insert(sk, std::in_place_type<ProtocolHandler_UNKNOWN>, this, key, pid);
+    if (pos.entry == nullptr) {
+      // the table has as many entries as BPF tracks connections, so this only happens if socket closes were missed
+      if (handler_table_full_count_++ == 0) {
+        log_.error("tcp_data_handler: protocol handler table full ({} sockets)", protocol_handlers_.size());
+      }
+      enable_stream(key, false);
+      return;
+    }
+  }
+
+  // process the data with the protocol handler, possibly upgrading the handler
+  ProtocolHandler &handler = *pos.entry;
+  const u8 *data = data_buffer_;
+
+  for (;;) {
+    std::optional<int> const upgrade = std::visit(
+        [&](auto &phb) {
+          if (client_server == SC_SERVER) {
+            phb.handle_server_data(tstamp, offset, stream_type, data, data_len);
+          } else {
+            phb.handle_client_data(tstamp, offset, stream_type, data, data_len);
+          }
+          return phb.get_upgrade();
+        },
+        handler);
+
+    if (!upgrade) {
+      break;
+    }
+
+    create_protocol_handler(handler, *upgrade, key, pid);
+  }
+}
+
+u32 TCPDataHandler::read_data_channel(size_t idx, u32 length)
+{
+  if (length > sizeof(data_buffer_)) {
+    log_.error("tcp_data_handler: message longer than data channel maximum: length({}) > {}", length, sizeof(data_buffer_));
+    length = sizeof(data_buffer_);
   }
 
   // Get the data ring for the same cpu as the control ring
   // we're on to ensure we get the right data
   PerfRing &ring = container_.data_ring(idx);
 
-  u32 length_remaining = length;
-  u64 current_offset = offset;
+  u32 data_read = 0;
 
-  while (length_remaining > 0) {
+  while (data_read < length) {
     auto ring_size = ring.peek_size();
 
     if (ring_size == -ENOENT) {
@@ -227,34 +247,25 @@ void TCPDataHandler::process(
       u32 padded_chunk_length = ring_size;
 
       // PERF_SAMPLE_RAW adds 32 bits of length per documentation of perf_event_open
-      const unsigned int min_length = sizeof(u32);
+      const unsigned int min_length = sizeof(u32) + sizeof(data_channel_header_t);
       // round up max_length to a multiple of 8 bytes for padding
       const unsigned int max_length = ((sizeof(u32) + DATA_CHANNEL_CHUNK_MAX) + 7) & ~7;
 
       // Ensure we don't overflow
       if (padded_chunk_length < min_length) {
         log_.error("got message < sizeof header: padded_chunk_length({}) < min_length({})", padded_chunk_length, min_length);
-        return;
+        break;
       }
       if (padded_chunk_length > max_length) {
         log_.error("got message > sizeof message: padded_chunk_length({}) > max_length({})", padded_chunk_length, max_length);
-        return;
+        break;
       }
 
-      // process tcp data
-      LOG::debug_in(AgentLogKind::PROTOCOL, "tcp_data_handler: processing data (padded_chunk_length={})", padded_chunk_length);
+      LOG::debug_in(AgentLogKind::PROTOCOL, "tcp_data_handler: reading data (padded_chunk_length={})", padded_chunk_length);
 
-      char buf[max_length];
-
-      /* copy into buffer */
-      ring.peek_copy(buf, 0, padded_chunk_length);
-      /* release the element */
-      ring.pop();
-
-      // get pointer to data and length of data
-      data_channel_header_t *header = (data_channel_header_t *)(buf + sizeof(u32));
-      const u8 *data = (const u8 *)(buf + sizeof(u32) + sizeof(data_channel_header_t));
-      u32 data_len = header->length;
+      data_channel_header_t header;
+      ring.peek_copy((char *)&header, sizeof(u32), sizeof(header));
+      u32 data_len = header.length;
 
       // make sure we don't read past end
       const unsigned int chunk_length = data_len + sizeof(u32) + sizeof(data_channel_header_t);
@@ -263,41 +274,22 @@ void TCPDataHandler::process(
             "got chunk_length > padded_chunk_length: chunk_length({}) > padded_chunk_length({})",
             chunk_length,
             padded_chunk_length);
-        return;
+        ring.pop();
+        break;
       }
 
       // make sure our read won't take us past the length remaining on this data
-      if (data_len > length_remaining) {
+      if (data_len > length - data_read) {
         // there is more data in the buffer than we need
         // just process the remaining length
-        data_len = length_remaining;
+        data_len = length - data_read;
       }
 
-      // process the data with the protocol handler
-      // possibly upgrading the handler
-      ProtocolHandlerBase::ptr_type phb = phiter->second;
-
-      bool do_upgrade;
-      do {
-        do_upgrade = false;
-
-        if (client_server == SC_SERVER) {
-          phb->handle_server_data(tstamp, current_offset, stream_type, data, data_len);
-        } else {
-          phb->handle_client_data(tstamp, current_offset, stream_type, data, data_len);
-        }
-
-        ProtocolHandlerBase::ptr_type upgrade = phb->get_upgrade();
-        if (upgrade) {
-          upgrade_protocol_handler(upgrade, phb);
-          phb = upgrade;
-          do_upgrade = true;
-        }
-      } while (do_upgrade);
+      /* copy the chunk's data right after the previous chunk's, and release the element */
+      ring.peek_copy((char *)data_buffer_ + data_read, sizeof(u32) + sizeof(data_channel_header_t), data_len);
+      ring.pop();
 
-      // offset for the next chunk
-      current_offset += data_len;
-      length_remaining -= data_len;
+      data_read += data_len;
 
     } else if (type == PERF_RECORD_LOST) {
 
@@ -313,22 +305,13 @@ void TCPDataHandler::process(
       ring.pop();
     }
   }
+
+  return data_read;
 }
 
 void TCPDataHandler::handle_close_socket(u64 sk)
 {
-  // Send to the appropriate protocol handler
-  tcp_control_key_t key{
-      .sk = sk,
-  };
-
-  // end-of-socket
-  auto phiter = protocol_handlers_.find(key);
-  if (phiter == protocol_handlers_.end()) {
-    // This is okay since sockets that send no data won't have a protocol handler
-    // LOG::debug_in(AgentLogKind::PROTOCOL, "missing protocol handler for key(sk={:x})", key.sk);
-  } else {
-    // remove protocol handler at end of socket
-    protocol_handlers_.erase(phiter);
-  }
+  // remove protocol handler at end of socket
+  // sockets that send no data won't have a protocol handler, so it's okay for this to find nothing
+  protocol_handlers_.erase(sk);
 }
@@ -9,19 +9,25 @@
 #include <bcc/bpf_module.h>
 #include <linux/bpf.h>
 
-#include <map>
-#include <memory>
+#include <optional>
+#include <variant>
 
 #include <uv.h>
 
 #include <generated/ebpf_net/ingest/writer.h>
 #include <platform/platform.h>
+#include <util/chunked_pool.h>
+#include <util/fixed_hash.h>
 #include <util/logger.h>
+#include <util/lookup3_hasher.h>
 
 #include "collector/agent_log.h"
+#include "collector/kernel/bpf_src/render_bpf.h"
 #include "collector/kernel/bpf_src/tcp-processor/tcp_processor.h"
 #include "collector/kernel/perf_reader.h"
 #include "protocols/protocol_handler_base.h"
+#include "protocols/protocol_handler_http.h"
+#include "protocols/protocol_handler_unknown.h"
 
 class TCPDataHandler {
 public:
@@ -61,15 +67,24 @@ public:
   void enable_stream(const tcp_control_key_t &key, bool enable);
   void update_stream_start(const tcp_control_key_t &key, STREAM_TYPE stream_type, u64 start);
 
-  // create a new protocol handler, possibly for upgrade
-  ProtocolHandlerBase::ptr_type create_protocol_handler(int protocol, const tcp_control_key_t &key, u32 pid);
-
 protected:
-  void upgrade_protocol_handler(ProtocolHandlerBase::ptr_type new_handler, ProtocolHandlerBase::ptr_type original_handler);
-
-  struct tcp_control_key_t_comparator {
-    bool operator()(const tcp_control_key_t &a, const tcp_control_key_t &b) const;
-  };
+  // protocol handlers are stored in place in the handler table, one per socket. Upgrading a handler replaces it in its
+  // slot, and closing the socket destroys it there, so the data path does no allocation or reference counting.
+  using ProtocolHandler = std::variant<ProtocolHandler_UNKNOWN, ProtocolHandler_HTTP>;
+  using ProtocolHandlerTable = FixedHash<
+      u64,
+      ProtocolHandler,
+      TCP_CONNECTION_HASH_SIZE,
+      util::Lookup3Hasher<u64>,
+      std::equal_to<u64>,
+      std::allocator<ProtocolHandler>,
+      ChunkedPool<ProtocolHandler, TCP_CONNECTION_HASH_SIZE>>;
+
+  // replaces `handler` with a new handler for `protocol`, on the same socket
+  void create_protocol_handler(ProtocolHandler &handler, int protocol, const tcp_control_key_t &key, u32 pid);
+
+  // copies the data of a tcp_data message, which BPF sent in chunks over the data channel, into data_buffer_
+  u32 read_data_channel(size_t idx, u32 length);
 
 protected:
   uv_loop_t &loop_;
@@ -77,7 +92,9 @@ protected:
   ::ebpf_net::ingest::Writer &writer_;
   PerfContainer &container_;
   u64 lost_record_total_count_ = 0;
-  std::map<tcp_control_key_t, std::shared_ptr<ProtocolHandlerBase>, tcp_control_key_t_comparator> protocol_handlers_;
+  u64 handler_table_full_count_ = 0;
+  ProtocolHandlerTable protocol_handlers_;
+  u8 data_buffer_[DATA_CHANNEL_CHUNK_MAX];
   ebpf::TableDesc tcp_control_desc_;
   logging::Logger &log_;
 };
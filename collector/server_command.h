@@ -7,7 +7,38 @@
 
 #include <platform/types.h>
 
+#include <optional>
+
+// Commands sent by the reducer to collectors, as 8 byte big-endian integers.
+// Collectors ignore commands they don't know.
 enum class ServerCommand : u64 {
   NONE,
   DISABLE_SEND = 0xe5c94272c6a3028ful,
+  // The server grants flow-control credits to collectors that answer with a
+  // `flow_control_supported` message.
+  FLOW_CONTROL_OFFERED = 0x3d0a5f1c8e27b946ul,
 };
+
+// Flow-control credit grants are commands with CREDIT_GRANT_TAG in their
+// upper 32 bits, and in their lower 32 bits the number of KiB the collector
+// may send until the next grant, or CREDIT_GRANT_UNLIMITED.
+//
+// Grants are only sent to collectors that answered FLOW_CONTROL_OFFERED with a
+// `flow_control_supported` message. Until they get their first grant, and
+// after reconnecting, collectors are not limited.
+static constexpr u32 CREDIT_GRANT_TAG = 0x63726564; // "cred"
+static constexpr u32 CREDIT_GRANT_UNLIMITED = 0xffffffff;
+
+constexpr u64 make_credit_grant(u32 kib)
+{
+  return (static_cast<u64>(CREDIT_GRANT_TAG) << 32) | kib;
+}
+
+// Returns the KiB granted by |command|, if it is a credit grant.
+constexpr std::optional<u32> parse_credit_grant(u64 command)
+{
+  if ((command >> 32) != CREDIT_GRANT_TAG) {
+    return std::nullopt;
+  }
+  return static_cast<u32>(command);
+}
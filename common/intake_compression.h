@@ -0,0 +1,16 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <util/enum.h>
+
+#define ENUM_NAME IntakeCompression
+#define ENUM_TYPE std::uint8_t
+#define ENUM_ELEMENTS(X)                                                                                                       \
+  X(lz4, 0, "")                                                                                                                \
+  X(zstd, 1, "")
+#define ENUM_DEFAULT lz4
+#include <util/enum_operators.inl>
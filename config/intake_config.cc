@@ -49,6 +49,26 @@ std::unique_ptr<channel::NetworkChannel> IntakeConfig::make_channel(uv_loop_t &l
   return std::make_unique<channel::TCPChannel>(loop, host_, port_);
 }
 
+std::optional<channel::ZstdChannel::Options> IntakeConfig::zstd_options() const
+{
+  if (compression_ != IntakeCompression::zstd) {
+    return std::nullopt;
+  }
+
+  channel::ZstdChannel::Options options{.level = zstd_level_, .window_log = zstd_window_log_};
+
+  if (!zstd_dictionary_path_.empty()) {
+    if (auto dictionary = read_file_as_string(zstd_dictionary_path_.c_str())) {
+      options.dictionary = std::move(*dictionary);
+    } else {
+      LOG::error(
+          "failed to read Zstandard dictionary at `{}`, compressing without it: {}", zstd_dictionary_path_, dictionary.error());
+    }
+  }
+
+  return options;
+}
+
 void IntakeConfig::read_from_env(IntakeConfig &config)
 {
   if (std::string_view value = try_get_env_var(INTAKE_HOST_VAR); !value.empty()) {
@@ -66,6 +86,17 @@ void IntakeConfig::read_from_env(IntakeConfig &config)
   if (std::string_view value = try_get_env_var(INTAKE_INTAKE_ENCODER_VAR); !value.empty()) {
     config.encoder_ = try_enum_from_string(value, IntakeEncoder::binary);
   }
+
+  if (std::string_view value = try_get_env_var(INTAKE_COMPRESSION_VAR); !value.empty()) {
+    config.compression_ = try_enum_from_string(value, IntakeCompression::lz4);
+  }
+
+  config.zstd_level_ = try_get_env_value<int>(INTAKE_ZSTD_LEVEL_VAR, config.zstd_level_);
+  config.zstd_window_log_ = try_get_env_value<int>(INTAKE_ZSTD_WINDOW_LOG_VAR, config.zstd_window_log_);
+
+  if (std::string_view value = try_get_env_var(INTAKE_ZSTD_DICTIONARY_VAR); !value.empty()) {
+    config.zstd_dictionary_path_ = value;
+  }
 }
 
 IntakeConfig::ArgsHandler::ArgsHandler(cli::ArgsParser &parser)
@@ -76,7 +107,16 @@ IntakeConfig::ArgsHandler::ArgsHandler(cli::ArgsParser &parser)
       encoder_(parser.add_arg<IntakeEncoder>(
           "intake-encoder",
           "Chooses the intake encoder to use"
-          " - this relates to the sink used to dump collected telemetry to"))
+          " - this relates to the sink used to dump collected telemetry to")),
+      compression_(parser.add_arg<IntakeCompression>(
+          "intake-compression", "Chooses how to compress telemetry sent to the reducer: lz4 or zstd")),
+      zstd_level_(parser.add_arg<int>("intake-zstd-level", "Zstandard compression level, 0 for the default")),
+      zstd_window_log_(parser.add_arg<int>(
+          "intake-zstd-window-log",
+          "Log2 of the Zstandard window size, which the reducer keeps for each connection,"
+          " 0 for the default for the compression level")),
+      zstd_dictionary_(parser.add_arg<std::string>(
+          "intake-zstd-dictionary", "Path to a Zstandard dictionary trained on recorded telemetry"))
 {}
 
 void IntakeConfig::ArgsHandler::read_config(IntakeConfig &config)
@@ -94,6 +134,22 @@ void IntakeConfig::ArgsHandler::read_config(IntakeConfig &config)
   if (encoder_) {
     config.encoder(*encoder_);
   }
+
+  if (compression_) {
+    config.compression(*compression_);
+  }
+
+  if (zstd_level_) {
+    config.zstd_level(*zstd_level_);
+  }
+
+  if (zstd_window_log_) {
+    config.zstd_window_log(*zstd_window_log_);
+  }
+
+  if (zstd_dictionary_) {
+    config.zstd_dictionary_path(*zstd_dictionary_);
+  }
 }
 
 } // namespace config
@@ -6,6 +6,8 @@
 #pragma once
 
 #include <channel/network_channel.h>
+#include <channel/zstd_channel.h>
+#include <common/intake_compression.h>
 #include <common/intake_encoder.h>
 #include <util/args_parser.h>
 #include <util/file_ops.h>
@@ -27,6 +29,13 @@ class IntakeConfig {
   static constexpr auto INTAKE_PORT_VAR = "EBPF_NET_INTAKE_PORT";
   static constexpr auto INTAKE_INTAKE_ENCODER_VAR = "EBPF_NET_INTAKE_ENCODER";
   static constexpr auto INTAKE_RECORD_OUTPUT_PATH_VAR = "EBPF_NET_RECORD_INTAKE_OUTPUT_PATH";
+  static constexpr auto INTAKE_COMPRESSION_VAR = "EBPF_NET_INTAKE_COMPRESSION";
+  static constexpr auto INTAKE_ZSTD_LEVEL_VAR = "EBPF_NET_INTAKE_ZSTD_LEVEL";
+  static constexpr auto INTAKE_ZSTD_WINDOW_LOG_VAR = "EBPF_NET_INTAKE_ZSTD_WINDOW_LOG";
+  static constexpr auto INTAKE_ZSTD_DICTIONARY_VAR = "EBPF_NET_INTAKE_ZSTD_DICTIONARY";
+
+  // the reducer keeps a window for each connection, so this is smaller than Zstandard's defaults
+  static constexpr int DEFAULT_ZSTD_WINDOW_LOG = 17;
 
 public:
   static const IntakeConfig DEFAULT_CONFIG;
@@ -70,6 +79,21 @@ public:
 
   virtual bool allow_compression() const { return encoder_ == IntakeEncoder::binary; }
 
+  void compression(IntakeCompression compression) { compression_ = compression; }
+  IntakeCompression compression() const { return compression_; }
+
+  void zstd_level(int level) { zstd_level_ = level; }
+  void zstd_window_log(int window_log) { zstd_window_log_ = window_log; }
+  void zstd_dictionary_path(std::string path) { zstd_dictionary_path_ = std::move(path); }
+
+  /**
+   * Returns the options for compressing data with Zstandard, reading the
+   * dictionary file if one is set, or nullopt if LZ4 is to be used.
+   *
+   * If the dictionary can't be read, data is compressed without it.
+   */
+  std::optional<channel::ZstdChannel::Options> zstd_options() const;
+
   virtual std::unique_ptr<channel::NetworkChannel> make_channel(uv_loop_t &loop) const;
 
   std::unique_ptr<::ebpf_net::ingest::Encoder> make_encoder() const
@@ -92,7 +116,7 @@ public:
 
   template <typename Out> friend Out &&operator<<(Out &&out, IntakeConfig const &config)
   {
-    out << config.host_ << ':' << config.port_ << " (" << config.encoder_ << ')';
+    out << config.host_ << ':' << config.port_ << " (" << config.encoder_ << ", " << config.compression_ << ')';
 
     return std::forward<Out>(out);
   }
@@ -104,6 +128,10 @@ private:
   std::string port_;
   std::string record_path_;
   IntakeEncoder encoder_ = IntakeEncoder::binary;
+  IntakeCompression compression_ = IntakeCompression::lz4;
+  int zstd_level_ = 0;
+  int zstd_window_log_ = DEFAULT_ZSTD_WINDOW_LOG;
+  std::string zstd_dictionary_path_;
 };
 
 struct IntakeConfig::ArgsHandler : cli::ArgsParser::Handler {
@@ -115,6 +143,10 @@ private:
   cli::ArgsParser::ArgProxy<std::string> host_;
   cli::ArgsParser::ArgProxy<std::string> port_;
   cli::ArgsParser::ArgProxy<IntakeEncoder> encoder_;
+  cli::ArgsParser::ArgProxy<IntakeCompression> compression_;
+  cli::ArgsParser::ArgProxy<int> zstd_level_;
+  cli::ArgsParser::ArgProxy<int> zstd_window_log_;
+  cli::ArgsParser::ArgProxy<std::string> zstd_dictionary_;
 };
 
 } // namespace config
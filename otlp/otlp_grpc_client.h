@@ -54,41 +54,63 @@ public:
 
   virtual void AsyncExport(TReq const &request)
   {
-    SCOPED_TIMING(OtlpGrpcClientAsyncExport);
-
-    u64 async_response_tag = next_async_response_tag_++;
-
-    auto async_response = std::make_unique<AsyncResponse>();
-    async_response->response_reader_ = stub_->PrepareAsyncExport(&async_response->context_, request, &cq_);
-    async_response->response_reader_->StartCall();
-
-    async_response->response_reader_->Finish(
-        &async_response->response_, &async_response->status_, reinterpret_cast<void *>(async_response_tag));
-
-    async_response->num_bytes = request.ByteSizeLong();
+    u64 num_data_points = 0;
     if constexpr (std::is_same_v<ExportLogsServiceRequest, TReq>) {
       for (auto const &resource_logs : request.resource_logs()) {
         for (auto const &scope_logs : resource_logs.scope_logs()) {
-          async_response->num_data_points += scope_logs.log_records_size();
+          num_data_points += scope_logs.log_records_size();
         }
       }
     } else if constexpr (std::is_same_v<ExportMetricsServiceRequest, TReq>) {
       for (auto const &resource_metrics : request.resource_metrics()) {
         for (auto const &scope_metrics : resource_metrics.scope_metrics()) {
-          async_response->num_data_points += scope_metrics.metrics_size();
+          num_data_points += scope_metrics.metrics_size();
         }
       }
-    } else {
-      async_response->num_data_points = 0;
     }
 
+    AsyncExport(request, num_data_points);
+  }
+
+  // Sends |request|, which holds |num_data_points| data points, as counted by the caller while building it.
+  virtual void AsyncExport(TReq const &request, u64 num_data_points)
+  {
+    SCOPED_TIMING(OtlpGrpcClientAsyncExport);
+
+    u64 async_response_tag = next_async_response_tag_++;
+
+    auto async_response = std::make_unique<AsyncResponse>();
+    async_response->response_reader_ = stub_->PrepareAsyncExport(&async_response->context_, request, &cq_);
+    async_response->response_reader_->StartCall();
+
+    async_response->response_reader_->Finish(
+        &async_response->response_, &async_response->status_, reinterpret_cast<void *>(async_response_tag));
+
+    // The request was serialized when the call was prepared, which computed and cached its size, so there is no need to walk
+    // the whole request again with ByteSizeLong().
+    async_response->num_bytes = request.GetCachedSize();
+    async_response->num_data_points = num_data_points;
+
     bytes_sent_ += async_response->num_bytes;
+    bytes_in_flight_ += async_response->num_bytes;
     data_points_sent_ += async_response->num_data_points;
     ++requests_sent_;
 
     async_responses_.emplace(async_response_tag, std::move(async_response));
   }
 
+  // Accounts for a request that was dropped instead of being sent, e.g. because too many bytes were in flight.
+  void Drop(TReq const &request, u64 num_data_points)
+  {
+    u64 const num_bytes = request.ByteSizeLong();
+    bytes_sent_ += num_bytes;
+    bytes_failed_ += num_bytes;
+    data_points_sent_ += num_data_points;
+    data_points_failed_ += num_data_points;
+    ++requests_sent_;
+    ++requests_failed_;
+  }
+
   void process_async_responses()
   {
     if (async_responses_.empty()) {
@@ -108,6 +130,7 @@ public:
         // Note: Per gRPC docs, for client-side Finish: ok should always be true, so not checking it here.
         if (auto itr = async_responses_.find(reinterpret_cast<u64>(tag)); itr != async_responses_.end()) {
           auto const &async_response = itr->second;
+          bytes_in_flight_ -= async_response->num_bytes;
           if (!async_response->status_.ok()) {
             LOG::debug(
                 "{}: RPC failed for tag={}: {}: {}",
@@ -128,6 +151,8 @@ public:
     }
   }
 
+  // Bytes of the requests that were sent and haven't been responded to yet, as of the last process_async_responses().
+  u64 bytes_in_flight() const { return bytes_in_flight_; }
   u64 bytes_failed() const { return bytes_failed_; }
   u64 bytes_sent() const { return bytes_sent_; }
   u64 data_points_failed() const { return data_points_failed_; }
@@ -155,6 +180,7 @@ private:
   static u64 next_async_response_tag_;
   std::unordered_map<u64, std::unique_ptr<AsyncResponse>> async_responses_;
 
+  u64 bytes_in_flight_ = 0;
   u64 bytes_failed_ = 0;
   u64 bytes_sent_ = 0;
   u64 data_points_failed_ = 0;
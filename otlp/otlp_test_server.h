@@ -6,6 +6,8 @@
 #include <otlp/otlp_util.h>
 #include <util/common_test.h>
 
+#include <atomic>
+#include <mutex>
 #include <vector>
 
 #include <grpcpp/grpcpp.h>
@@ -24,7 +26,12 @@ namespace otlp_test_server {
 
 class OtlpGrpcTestServer {
 public:
-  OtlpGrpcTestServer(std::string const &server_addr) : server_addr_(server_addr) {}
+  // |keep_requests| false only counts the requests received, e.g. to send many of them in benchmarks.
+  OtlpGrpcTestServer(std::string const &server_addr, bool keep_requests = true) : server_addr_(server_addr)
+  {
+    logs_service_.keep_requests_ = keep_requests;
+    metrics_service_.keep_requests_ = keep_requests;
+  }
 
   void start()
   {
@@ -62,10 +69,16 @@ private:
   template <typename TService, typename TReq, typename TResp> class ServiceImpl final : public TService::Service {
     grpc::Status Export(grpc::ServerContext *context, const TReq *request, TResp *response) override
     {
-      LOG::trace("gRPC server {} service Export() received request={}", service_type(), log_waive(get_request_json(*request)));
-      requests_received_.push_back(*request);
-      ++num_requests_received_;
-      LOG::debug("gRPC server {} service received {} request(s)", service_type(), num_requests_received_);
+      if (spdlog::default_logger_raw()->should_log(spdlog::level::trace)) {
+        LOG::trace(
+            "gRPC server {} service Export() received request={}", service_type(), log_waive(get_request_json(*request)));
+      }
+      if (keep_requests_) {
+        std::lock_guard lock(mutex_);
+        requests_received_.push_back(*request);
+      }
+      auto const num_requests_received = ++num_requests_received_;
+      LOG::debug("gRPC server {} service received {} request(s)", service_type(), num_requests_received);
 
       return grpc::Status::OK;
     }
@@ -82,8 +95,11 @@ private:
     }
 
   public:
+    bool keep_requests_ = true;
+    // handlers can run concurrently on the server's threads
+    std::mutex mutex_;
     std::vector<TReq> requests_received_;
-    u64 num_requests_received_ = 0;
+    std::atomic<u64> num_requests_received_ = 0;
   };
 
   std::string const server_addr_;
@@ -81,7 +81,11 @@ AggCore::AggCore(
       core_stats_(index_.core_stats.alloc()),
       agg_core_stats_(index_.agg_core_stats.alloc())
 {
-  add_rpc_clients(matching_to_aggregation_queues.make_readers(shard_num), ClientType::matching, matching_to_aggregation_stats_);
+  add_rpc_clients(
+      matching_to_aggregation_queues.make_readers(shard_num),
+      ClientType::matching,
+      matching_to_aggregation_stats_,
+      matching_to_aggregation_queues.doorbell(shard_num));
 
   if (enable_percentile_latencies)
     p_latencies_ = std::make_unique<PercentileLatencies>();
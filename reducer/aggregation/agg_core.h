@@ -78,7 +78,7 @@ public:
       u64 initial_timestamp);
 
 private:
-  // Stores TDigests to compute p90, p95, p99 latencies
+  // Keeps latency histograms to compute p90, p95, p99 latencies
   std::unique_ptr<PercentileLatencies> p_latencies_;
 
   // Publisher for Prometheus (scrape) style external metrics.
@@ -0,0 +1,21 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <reducer/latency_keys.h>
+
+#include <generated/ebpf_net/aggregation/span_base.h>
+
+namespace reducer::aggregation {
+
+class AzAzSpan : public ::ebpf_net::aggregation::AzAzSpanBase {
+public:
+  // Key of this span's labels in PercentileLatencies, so that samples don't
+  // have to build and hash the labels.
+  LatencyKeyHandle latency_key;
+};
+
+} // namespace reducer::aggregation
@@ -6,6 +6,17 @@
 
 namespace reducer::aggregation {
 
+namespace {
+
+auto labels_of(::ebpf_net::aggregation::weak_refs::az_az &az_az)
+{
+  return [&az_az] { return FlowLabels{az_az.az1(), az_az.az2()}; };
+}
+
+} // namespace
+
+PercentileLatencies::PercentileLatencies() : tcp_(keys_), dns_(keys_), http_(keys_) {}
+
 std::string_view PercentileLatencies::aggregation_name() const
 {
   // We calculate percentile latencies only on the az-az aggregation.
@@ -15,11 +26,10 @@ std::string_view PercentileLatencies::aggregation_name() const
 void PercentileLatencies::operator()(
     u64 t, ::ebpf_net::aggregation::weak_refs::az_az &az_az, ::ebpf_net::metrics::tcp_metrics &metrics, u64 interval)
 {
-  FlowLabels key{az_az.az1(), az_az.az2()};
   double latency = metrics.active_rtts == 0 ? 0 : (double)metrics.sum_srtt / 8 / 1000 / metrics.active_rtts;
   // RTTs are measured in units of 1/8 microseconds.
 
-  tcp_.add(t, std::move(key), latency);
+  tcp_.add(t, az_az.impl().latency_key, labels_of(az_az), latency);
 }
 
 void PercentileLatencies::operator()(
@@ -31,19 +41,17 @@ void PercentileLatencies::operator()(
 void PercentileLatencies::operator()(
     u64 t, ::ebpf_net::aggregation::weak_refs::az_az &az_az, ::ebpf_net::metrics::dns_metrics &metrics, u64 interval)
 {
-  FlowLabels key{az_az.az1(), az_az.az2()};
   double latency = metrics.active_sockets == 0 ? 0 : (double)metrics.sum_total_time_ns / 1000 / 1000 / metrics.active_sockets;
 
-  dns_.add(t, std::move(key), latency);
+  dns_.add(t, az_az.impl().latency_key, labels_of(az_az), latency);
 }
 
 void PercentileLatencies::operator()(
     u64 t, ::ebpf_net::aggregation::weak_refs::az_az &az_az, ::ebpf_net::metrics::http_metrics &metrics, u64 interval)
 {
-  FlowLabels key{az_az.az1(), az_az.az2()};
   double latency = metrics.active_sockets == 0 ? 0 : (double)metrics.sum_total_time_ns / 1000 / 1000 / metrics.active_sockets;
 
-  http_.add(t, std::move(key), latency);
+  http_.add(t, az_az.impl().latency_key, labels_of(az_az), latency);
 }
 
 } // namespace reducer::aggregation
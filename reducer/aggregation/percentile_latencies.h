@@ -18,6 +18,8 @@ class PercentileLatencies {
 public:
   using LatencyAccumulator = ::reducer::LatencyAccumulator<FlowLabels>;
 
+  PercentileLatencies();
+
   LatencyAccumulator const &tcp() const { return tcp_; }
   LatencyAccumulator const &dns() const { return dns_; }
   LatencyAccumulator const &http() const { return http_; }
@@ -34,6 +36,8 @@ public:
   operator()(u64 t, ::ebpf_net::aggregation::weak_refs::az_az &az_az, ::ebpf_net::metrics::http_metrics &metrics, u64 interval);
 
 private:
+  // shared by the accumulators, so that a span's labels are interned once
+  LatencyKeys<FlowLabels> keys_;
   LatencyAccumulator tcp_;
   LatencyAccumulator dns_;
   LatencyAccumulator http_;
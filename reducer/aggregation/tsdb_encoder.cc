@@ -70,25 +70,22 @@ void TsdbEncoder::encode_and_write_p_latencies(const PercentileLatencies &plat)
 
 void TsdbEncoder::encode_and_write_p_latencies(const std::string &proto, const PercentileLatencies::LatencyAccumulator &accum)
 {
-  const std::string metric_name_p90 = proto + "_latency_p90";
-  const std::string metric_name_p95 = proto + "_latency_p95";
-  const std::string metric_name_p99 = proto + "_latency_p99";
-  const std::string metric_name_max = proto + "_latency_max";
+  // built once per call, so that writing each time-series doesn't copy the metric names
+  const MetricInfo metric_p90{proto + "_latency_p90"};
+  const MetricInfo metric_p95{proto + "_latency_p95"};
+  const MetricInfo metric_p99{proto + "_latency_p99"};
+  const MetricInfo metric_max{proto + "_latency_max"};
 
   // TODO: to evenly distribute output to all available writers, we should choose a writer
   //       based on the labels' hash value.
   auto &metric_writer = metric_writers_[0];
 
   for (const auto &l : accum.get_p_latencies()) {
-    prometheus_formatter_->set_labels(l.key);
-    prometheus_formatter_->write(metric_name_p90, l.p90, metric_writer);
-    prometheus_formatter_->write(metric_name_p95, l.p95, metric_writer);
-    prometheus_formatter_->write(metric_name_p99, l.p99, metric_writer);
-  }
-
-  for (const auto &[key, max_latency] : accum.get_max_latencies()) {
-    prometheus_formatter_->set_labels(key);
-    prometheus_formatter_->write(metric_name_max, max_latency, metric_writer);
+    prometheus_formatter_->set_labels(accum.labels(l.key));
+    prometheus_formatter_->write(metric_p90, l.p90, metric_writer);
+    prometheus_formatter_->write(metric_p95, l.p95, metric_writer);
+    prometheus_formatter_->write(metric_p99, l.p99, metric_writer);
+    prometheus_formatter_->write(metric_max, l.max, metric_writer);
   }
 }
 
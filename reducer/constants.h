@@ -70,6 +70,14 @@ static constexpr char GEOIP_PATH_VAR[] = "GEOIP_PATH";
 // Time that RPC handlers wait between checks for messages in message queues.
 static constexpr auto RPC_HANDLE_TIME = 20ms;
 
+// Bounds on how long RPC handlers keep checking for messages before blocking
+// on doorbells, when those are enabled.
+static constexpr auto RPC_MIN_SPIN_TIME = 20us;
+static constexpr auto RPC_MAX_SPIN_TIME = 2ms;
+
+// Time after which RPC handlers blocked on doorbells check for messages anyway.
+static constexpr auto RPC_DOORBELL_FALLBACK_TIME = 1s;
+
 // Maximum number of messages each RPC handlers handles from each queue in each call
 static constexpr auto kMaxRpcBatchPerQueue = 10 * 1000;
 
@@ -11,14 +11,22 @@
 #include <util/time.h>
 #include <util/uv_helpers.h>
 
+#include <algorithm>
+
 #include <math.h>
 
 namespace reducer {
 
 thread_local Core *Core::instance_ = nullptr;
 
+double Core::span_pool_soft_limit_fraction_ = 1.0;
+double Core::span_pool_hard_limit_fraction_ = 1.0;
+
 Core::Core(std::string_view app_name, size_t shard_num, u64 initial_timestamp)
-    : app_name_(app_name), shard_num_(shard_num), current_timestamp_(initial_timestamp)
+    : app_name_(app_name),
+      shard_num_(shard_num),
+      current_timestamp_(initial_timestamp),
+      spin_time_ns_(integer_time<std::chrono::nanoseconds, u64>(RPC_MIN_SPIN_TIME))
 {
   CHECK_UV(uv_loop_init(&loop_));
 
@@ -60,6 +68,12 @@ std::chrono::nanoseconds Core::metrics_timestamp() const
   return std::chrono::nanoseconds(metrics_timestamp);
 }
 
+void Core::set_span_pool_limits(double soft_fraction, double hard_fraction)
+{
+  span_pool_soft_limit_fraction_ = soft_fraction;
+  span_pool_hard_limit_fraction_ = hard_fraction;
+}
+
 void Core::run()
 {
   // save thread-local instance
@@ -70,8 +84,12 @@ void Core::run()
   });
 
   if (!rpc_clients_.empty()) {
-    auto repeat = integer_time<std::chrono::milliseconds>(RPC_HANDLE_TIME);
-    CHECK_UV(uv_timer_start(&rpc_timer_, on_rpc_timer, repeat, repeat));
+    init_doorbells();
+
+    // with doorbells, the timer only checks for messages if no doorbell is rung
+    bool const use_doorbells = !doorbell_polls_.empty();
+    auto repeat = integer_time<std::chrono::milliseconds>(use_doorbells ? RPC_DOORBELL_FALLBACK_TIME : RPC_HANDLE_TIME);
+    CHECK_UV(uv_timer_start(&rpc_timer_, on_rpc_timer, use_doorbells ? 0 : repeat, repeat));
   }
 
   {
@@ -112,15 +130,108 @@ void Core::on_rpc_timer(uv_timer_t *timer)
 {
   auto core = reinterpret_cast<Core *>(timer->data);
 
+  if (core->waiting_on_doorbells_) {
+    // fallback timer fired before any doorbell was rung
+    core->stop_waiting();
+  }
+
   bool any_handled = core->handle_rpc();
 
   if (any_handled) {
+    if (core->idle_since_) {
+      // messages arrived while spinning, so spin for longer next time
+      core->spin_time_ns_ =
+          std::min(core->spin_time_ns_ * 2, integer_time<std::chrono::nanoseconds, u64>(RPC_MAX_SPIN_TIME));
+      core->idle_since_ = 0;
+    }
+
     // restart the timer immediately
     // otherwise the timer will again fire after the normal repeat time
     uv_timer_start(timer, timer->timer_cb, 0, timer->repeat);
+  } else if (!core->doorbell_polls_.empty()) {
+    core->spin_or_wait();
   }
 }
 
+void Core::on_doorbell(uv_poll_t *poll, int status, int events)
+{
+  auto core = reinterpret_cast<Core *>(poll->data);
+
+  core->stop_waiting();
+  uv_timer_start(&core->rpc_timer_, on_rpc_timer, 0, core->rpc_timer_.repeat);
+}
+
+void Core::init_doorbells()
+{
+  std::vector<Doorbell *> doorbells;
+
+  for (auto const &rpc_client : rpc_clients_) {
+    if (!rpc_client.doorbell) {
+      // can't block on doorbells if some client doesn't ring one
+      return;
+    }
+    if (std::find(doorbells.begin(), doorbells.end(), rpc_client.doorbell) == doorbells.end()) {
+      doorbells.push_back(rpc_client.doorbell);
+    }
+  }
+
+  for (auto doorbell : doorbells) {
+    auto &doorbell_poll = doorbell_polls_.emplace_back(std::make_unique<DoorbellPoll>());
+    doorbell_poll->doorbell = doorbell;
+    CHECK_UV(uv_poll_init(&loop_, &doorbell_poll->poll, doorbell->fd()));
+    doorbell_poll->poll.data = this;
+  }
+}
+
+void Core::spin_or_wait()
+{
+  u64 const now = monotonic();
+
+  if (!idle_since_) {
+    idle_since_ = now;
+  }
+
+  if (now - idle_since_ < spin_time_ns_) {
+    // keep checking for messages
+    uv_timer_start(&rpc_timer_, on_rpc_timer, 0, rpc_timer_.repeat);
+    return;
+  }
+
+  for (auto &doorbell_poll : doorbell_polls_) {
+    doorbell_poll->doorbell->arm();
+  }
+
+  // messages written before the doorbells were armed don't ring them
+  if (has_pending_rpc()) {
+    for (auto &doorbell_poll : doorbell_polls_) {
+      doorbell_poll->doorbell->disarm();
+    }
+    uv_timer_start(&rpc_timer_, on_rpc_timer, 0, rpc_timer_.repeat);
+    return;
+  }
+
+  // nothing arrived while spinning, so spin for less time next time
+  spin_time_ns_ = std::max(spin_time_ns_ / 2, integer_time<std::chrono::nanoseconds, u64>(RPC_MIN_SPIN_TIME));
+  idle_since_ = 0;
+
+  for (auto &doorbell_poll : doorbell_polls_) {
+    CHECK_UV(uv_poll_start(&doorbell_poll->poll, UV_READABLE, on_doorbell));
+  }
+  waiting_on_doorbells_ = true;
+
+  // the RPC timer will fire after the fallback time unless a doorbell is rung
+  uv_timer_start(&rpc_timer_, on_rpc_timer, rpc_timer_.repeat, rpc_timer_.repeat);
+}
+
+void Core::stop_waiting()
+{
+  for (auto &doorbell_poll : doorbell_polls_) {
+    uv_poll_stop(&doorbell_poll->poll);
+    doorbell_poll->doorbell->disarm();
+  }
+  waiting_on_doorbells_ = false;
+}
+
 void Core::on_stats_timer(uv_timer_t *timer)
 {
   auto core = reinterpret_cast<Core *>(timer->data);
@@ -216,14 +327,35 @@ bool Core::handle_rpc()
   return any_handled;
 }
 
+bool Core::has_pending_rpc()
+{
+  for (size_t i = 0; i < rpc_clients_.size(); ++i) {
+    if (!virtual_clock_.can_update(i)) {
+      continue;
+    }
+
+    auto &queue = rpc_clients_[i].queue;
+    queue.start_read_batch();
+    bool const pending = (queue.peek() > 0);
+    queue.finish_read_batch();
+
+    if (pending) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 void Core::on_timeslot_complete() {}
 
 void Core::write_internal_stats() {}
 
 ////////////////////////////////////////////////////////////////////////////////
 
-Core::RpcClient::RpcClient(ElementQueue _queue, std::unique_ptr<IRpcHandler> _handler, ClientType _client_type)
-    : queue(std::move(_queue)), handler(std::move(_handler)), client_type(_client_type)
+Core::RpcClient::RpcClient(
+    ElementQueue _queue, std::unique_ptr<IRpcHandler> _handler, ClientType _client_type, Doorbell *_doorbell)
+    : queue(std::move(_queue)), handler(std::move(_handler)), client_type(_client_type), doorbell(_doorbell)
 {}
 
 } // namespace reducer
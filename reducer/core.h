@@ -9,6 +9,7 @@
 
 #include <common/client_type.h>
 
+#include <util/doorbell.h>
 #include <util/element_queue_cpp.h>
 #include <util/fast_div.h>
 
@@ -17,6 +18,7 @@
 
 #include <cassert>
 #include <chrono>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
@@ -56,6 +58,13 @@ public:
   // Returns the current metrics timestamp, for output to a TSDB.
   std::chrono::nanoseconds metrics_timestamp() const;
 
+  // Sets the limits of span pools in indexes created from now on, as
+  // fractions of each span type's pool_size. Fractions are at most 1: pools
+  // can only be limited below their compiled size, never grown past it.
+  static void set_span_pool_limits(double soft_fraction, double hard_fraction);
+  static double span_pool_soft_limit_fraction() { return span_pool_soft_limit_fraction_; }
+  static double span_pool_hard_limit_fraction() { return span_pool_hard_limit_fraction_; }
+
 protected:
   // Subclasses implement to use concrete render-generated classes.
   //
@@ -77,8 +86,10 @@ protected:
     std::unique_ptr<IRpcHandler> handler;
     // Type of this client.
     ClientType client_type;
+    // Rung by the client when it writes to the queue, if not null.
+    Doorbell *doorbell;
 
-    RpcClient(ElementQueue queue, std::unique_ptr<IRpcHandler> handler, ClientType client_type);
+    RpcClient(ElementQueue queue, std::unique_ptr<IRpcHandler> handler, ClientType client_type, Doorbell *doorbell);
   };
 
   // Clients sending RPC messages to this core.
@@ -94,6 +105,10 @@ private:
   // Assigned in run().
   static thread_local Core *instance_;
 
+  // Span pool limits, see set_span_pool_limits().
+  static double span_pool_soft_limit_fraction_;
+  static double span_pool_hard_limit_fraction_;
+
   // This core's application name.
   std::string app_name_;
   // This core's shard number.
@@ -115,6 +130,23 @@ private:
 
   // Timer that services reading RPC messages from the queue.
   uv_timer_t rpc_timer_;
+
+  // Doorbells rung by RPC clients, each with the poll handle used to wait on
+  // it. Only used if every RPC client has a doorbell, otherwise this core
+  // polls its queues periodically with rpc_timer_.
+  struct DoorbellPoll {
+    Doorbell *doorbell;
+    uv_poll_t poll;
+  };
+  std::vector<std::unique_ptr<DoorbellPoll>> doorbell_polls_;
+  // Whether the core is blocked waiting for a doorbell to be rung.
+  bool waiting_on_doorbells_{false};
+  // Monotonic time at which the core found its queues empty, or 0 if it
+  // handled messages since.
+  u64 idle_since_{0};
+  // How long to keep checking for messages before blocking on doorbells.
+  // Adjusted depending on whether messages tend to arrive while spinning.
+  u64 spin_time_ns_;
   // Timer that services writing internal stats to prometheus.
   uv_timer_t stats_timer_;
 
@@ -122,6 +154,8 @@ private:
   static void on_stop_async(uv_async_t *handle);
   // RPC timer callback.
   static void on_rpc_timer(uv_timer_t *timer);
+  // Doorbell poll callback.
+  static void on_doorbell(uv_poll_t *poll, int status, int events);
   // Internal stats timer callback.
   static void on_stats_timer(uv_timer_t *timer);
 
@@ -131,6 +165,17 @@ private:
   // Gets invoked periodically by the RPC timer.
   bool handle_rpc();
 
+  // Whether any RPC client has messages that can be handled right away.
+  bool has_pending_rpc();
+
+  // Sets up doorbell polls if every RPC client has a doorbell.
+  void init_doorbells();
+  // Called when no messages were handled: keeps checking for messages for a
+  // while, then blocks until a doorbell is rung.
+  void spin_or_wait();
+  // Stops waiting on doorbells.
+  void stop_waiting();
+
   // Called when the current timeslot is complete.
   virtual void on_timeslot_complete();
 
@@ -68,16 +68,24 @@ protected:
   template <typename... Args>
   CoreBase(std::string_view app_name, size_t shard_num, u64 initial_timestamp, Args &&...args)
       : Core(app_name, shard_num, initial_timestamp), transform_builder_(), index_(std::forward<Args>(args)...)
-  {}
+  {
+    index_.set_pool_limits(span_pool_soft_limit_fraction(), span_pool_hard_limit_fraction());
+  }
 
-  void add_rpc_clients(std::vector<ElementQueue> const &queues, ClientType client_type, RpcReceiverStats &receiver_stats)
+  // If |doorbell| is given, it must be rung by the writers of all |queues|.
+  void add_rpc_clients(
+      std::vector<ElementQueue> const &queues,
+      ClientType client_type,
+      RpcReceiverStats &receiver_stats,
+      Doorbell *doorbell = nullptr)
   {
     for (auto &queue : queues) {
       const auto client_index = rpc_clients_.size();
       rpc_clients_.emplace_back(
           queue,
           std::make_unique<RpcHandler>(index_, transform_builder_, client_type, client_index, receiver_stats),
-          client_type);
+          client_type,
+          doorbell);
     }
 
     virtual_clock_.add_inputs(queues.size());
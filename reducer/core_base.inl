@@ -21,17 +21,23 @@ void CoreBase<I, P, C, T>::write_common_stats(InternalMetricsEncoder &encoder, u
   const auto module = app_name();
   const auto shard = shard_num();
 
-  index_.size_statistics(
-      [&](std::string_view span_name, std::size_t allocated, std::size_t max_allocated, std::size_t pool_size) {
-        SpanUtilizationStats stats;
-        stats.labels.span = span_name;
-        stats.labels.module = module;
-        stats.labels.shard = std::to_string(shard);
-        stats.metrics.utilization = allocated;
-        stats.metrics.utilization_fraction = (double)allocated / pool_size;
-        stats.metrics.utilization_max = max_allocated;
-        encoder.write_internal_stats(stats, time_ns);
-      });
+  index_.size_statistics([&](std::string_view span_name,
+                              std::size_t allocated,
+                              std::size_t max_allocated,
+                              std::size_t pool_size,
+                              std::size_t committed,
+                              std::size_t soft_limit) {
+    SpanUtilizationStats stats;
+    stats.labels.span = span_name;
+    stats.labels.module = module;
+    stats.labels.shard = std::to_string(shard);
+    stats.metrics.utilization = allocated;
+    stats.metrics.utilization_fraction = (double)allocated / pool_size;
+    stats.metrics.utilization_max = max_allocated;
+    stats.metrics.committed = committed;
+    stats.metrics.soft_limit = soft_limit;
+    encoder.write_internal_stats(stats, time_ns);
+  });
 
   for (size_t conn = 0; conn < rpc_clients_.size(); ++conn) {
     auto &rpc_handler = static_cast<RpcHandler &>(*rpc_clients_[conn].handler);
@@ -79,11 +85,15 @@ void CoreBase<I, P, C, T>::write_common_stats_to_logging_core(CoreStatsHandle &i
   const auto module = app_name();
   const auto shard = shard_num();
 
-  index_.size_statistics(
-      [&](std::string_view span_name, std::size_t allocated, std::size_t max_allocated, std::size_t pool_size) {
-        internal_metrics.span_utilization_stats(
-            jb_blob(span_name), jb_blob(module), shard, allocated, max_allocated, pool_size, time_ns);
-      });
+  index_.size_statistics([&](std::string_view span_name,
+                              std::size_t allocated,
+                              std::size_t max_allocated,
+                              std::size_t pool_size,
+                              std::size_t committed,
+                              std::size_t soft_limit) {
+    internal_metrics.span_utilization_stats(
+        jb_blob(span_name), jb_blob(module), shard, allocated, max_allocated, pool_size, time_ns, committed, soft_limit);
+  });
 
   for (size_t conn = 0; conn < rpc_clients_.size(); ++conn) {
     auto &rpc_handler = static_cast<RpcHandler &>(*rpc_clients_[conn].handler);
@@ -595,6 +595,16 @@ void AgentSpan::heartbeat(::ebpf_net::ingest::weak_refs::agent span_ref, u64 tim
   LOG::trace_in(Component::heartbeat, "Got a heartbeat from {} at '{}' (timestamp={})", type_, hostname_, timestamp);
 }
 
+void AgentSpan::flow_control_supported(
+    ::ebpf_net::ingest::weak_refs::agent span_ref, u64 timestamp, jsrv_ingest__flow_control_supported *msg)
+{
+  auto const npm_connection = local_connection();
+  assert(npm_connection);
+
+  LOG::trace_in(Component::agent, "{} collector at '{}' supports flow control", type_, hostname_);
+  npm_connection->set_flow_control_supported();
+}
+
 void AgentSpan::agent_resource_usage(
     ::ebpf_net::ingest::weak_refs::agent span_ref, u64 timestamp, jsrv_ingest__agent_resource_usage *msg)
 {}
@@ -95,6 +95,8 @@ public:
   void metadata_complete(::ebpf_net::ingest::weak_refs::agent span_ref, u64 timestamp, jsrv_ingest__metadata_complete *msg);
   void bpf_lost_samples(::ebpf_net::ingest::weak_refs::agent span_ref, u64 timestamp, jsrv_ingest__bpf_lost_samples *msg);
   void heartbeat(::ebpf_net::ingest::weak_refs::agent span_ref, u64 timestamp, jsrv_ingest__heartbeat *msg);
+  void flow_control_supported(
+      ::ebpf_net::ingest::weak_refs::agent span_ref, u64 timestamp, jsrv_ingest__flow_control_supported *msg);
   void
   agent_resource_usage(::ebpf_net::ingest::weak_refs::agent span_ref, u64 timestamp, jsrv_ingest__agent_resource_usage *msg);
 
@@ -13,6 +13,7 @@
 #include <reducer/internal_stats.h>
 #include <reducer/rpc_queue_matrix.h>
 #include <reducer/tsdb_formatter.h>
+#include <reducer/util/connection_balancer.h>
 #include <reducer/util/thread_ops.h>
 
 #include <platform/userspace-time.h>
@@ -24,6 +25,7 @@
 
 #include <iomanip>
 #include <sstream>
+#include <system_error>
 
 #include <config.h>
 
@@ -35,6 +37,7 @@ constexpr auto NO_MESSAGE_TIMEOUT = 30s;
 constexpr auto MESSAGE_TIMEOUT_CHECK_INTERVAL = 45s;
 constexpr auto WRITE_INTERNAL_STATS_TIMER_REPEAT = 10s;
 constexpr auto PULSE_TIMER_REPEAT = 1s;
+constexpr auto CONNECTION_REBALANCE_TIMER_REPEAT = 30s;
 } // namespace
 
 void IngestCore::on_write_internal_stats_timer_cb(uv_timer_t *timer)
@@ -49,6 +52,12 @@ void IngestCore::on_pulse_timer_cb(uv_timer_t *timer)
   core->on_pulse_timer();
 }
 
+void IngestCore::on_connection_rebalance_timer_cb(uv_timer_t *timer)
+{
+  auto const core = reinterpret_cast<IngestCore *>(timer->data);
+  core->on_connection_rebalance_timer();
+}
+
 void IngestCore::on_stop_async(uv_async_t *handle)
 {
   auto const core = reinterpret_cast<IngestCore *>(handle->data);
@@ -56,7 +65,15 @@ void IngestCore::on_stop_async(uv_async_t *handle)
 }
 
 IngestCore::IngestCore(
-    RpcQueueMatrix &ingest_to_logging_queues, RpcQueueMatrix &ingest_to_matching_queues, u32 telemetry_port, bool localhost)
+    RpcQueueMatrix &ingest_to_logging_queues,
+    RpcQueueMatrix &ingest_to_matching_queues,
+    u32 telemetry_port,
+    bool localhost,
+    ZstdDecompressionOptions const &zstd,
+    bool io_uring,
+    bool reuseport,
+    bool rebalance_connections,
+    bool flow_control)
 {
   auto const ingest_shard_count = ingest_to_matching_queues.num_senders();
   int res;
@@ -79,9 +96,10 @@ IngestCore::IngestCore(
   std::vector<std::unique_ptr<IngestWorker>> workers;
   workers.reserve(ingest_shard_count);
   for (uint32_t shard = 0; shard < ingest_shard_count; ++shard) {
-    workers.push_back(std::make_unique<IngestWorker>(ingest_to_logging_queues, ingest_to_matching_queues, shard));
+    workers.push_back(std::make_unique<IngestWorker>(
+        ingest_to_logging_queues, ingest_to_matching_queues, shard, zstd, io_uring, flow_control));
   }
-  tcp_server_.reset(new TcpServer(loop_, telemetry_port, localhost, std::move(workers)));
+  tcp_server_.reset(new TcpServer(loop_, telemetry_port, localhost, std::move(workers), io_uring, reuseport));
   index_dumper_.resize(ingest_shard_count);
   TcpServer::singleton()->instance = tcp_server_.get();
 
@@ -112,6 +130,23 @@ IngestCore::IngestCore(
       integer_time<std::chrono::milliseconds>(PULSE_TIMER_REPEAT),
       integer_time<std::chrono::milliseconds>(PULSE_TIMER_REPEAT)));
 
+  if (rebalance_connections && !reuseport) {
+    LOG::warn("ingest connections are only rebalanced when ingest workers listen with SO_REUSEPORT");
+  } else if (rebalance_connections && ingest_shard_count > 1) {
+    connection_balancer_ = std::make_unique<ConnectionBalancer>(ingest_shard_count);
+    last_received_bytes_.resize(ingest_shard_count, 0);
+  }
+
+  CHECK_UV(uv_timer_init(&loop_, &connection_rebalance_timer_));
+  connection_rebalance_timer_.data = this;
+  if (connection_balancer_) {
+    CHECK_UV(uv_timer_start(
+        &connection_rebalance_timer_,
+        on_connection_rebalance_timer_cb,
+        integer_time<std::chrono::milliseconds>(CONNECTION_REBALANCE_TIMER_REPEAT),
+        integer_time<std::chrono::milliseconds>(CONNECTION_REBALANCE_TIMER_REPEAT)));
+  }
+
   connection_timeout_handler_.emplace(loop_, [this] {
     check_connection_timeouts();
     return scheduling::JobFollowUp::ok;
@@ -166,11 +201,23 @@ void IngestCore::on_write_internal_stats_timer()
   /* write span statistics */
   tcp_server_->visit_indexes(
       [&](const int shard, ::ebpf_net::ingest::Index *const index) {
-        index->size_statistics(
-            [&](std::string_view span_name, std::size_t allocated, std::size_t max_allocated, std::size_t pool_size) {
-              local_core_stats_handle().span_utilization_stats(
-                  jb_blob(std::string(span_name)), jb_blob(module), shard, allocated, max_allocated, pool_size, time_ns);
-            });
+        index->size_statistics([&](std::string_view span_name,
+                                   std::size_t allocated,
+                                   std::size_t max_allocated,
+                                   std::size_t pool_size,
+                                   std::size_t committed,
+                                   std::size_t soft_limit) {
+          local_core_stats_handle().span_utilization_stats(
+              jb_blob(std::string(span_name)),
+              jb_blob(module),
+              shard,
+              allocated,
+              max_allocated,
+              pool_size,
+              time_ns,
+              committed,
+              soft_limit);
+        });
 
         local_core_stats_handle().status_stats(
             jb_blob(module), shard, jb_blob(std::string(kServiceName)), jb_blob(to_string(versions::release)), 1u, time_ns);
@@ -362,12 +409,43 @@ void IngestCore::on_pulse_timer()
       [&](const int shard, ::ebpf_net::ingest::Index *const index) { index->send_pulse(); }, false /* block */);
 }
 
+void IngestCore::on_connection_rebalance_timer()
+{
+  auto const received_bytes = tcp_server_->received_bytes();
+  std::vector<u64> deltas(received_bytes.size());
+  for (std::size_t worker = 0; worker < deltas.size(); ++worker) {
+    deltas[worker] = received_bytes[worker] - last_received_bytes_[worker];
+  }
+  last_received_bytes_ = received_bytes;
+
+  auto const migration = connection_balancer_->update_load(deltas);
+
+  if (steer_connections_) {
+    try {
+      tcp_server_->steer_connections(connection_balancer_->steering_weights());
+    } catch (std::system_error const &e) {
+      LOG::warn("could not steer ingest connections, leaving it to the kernel's default: {}", e.what());
+      steer_connections_ = false;
+    }
+  }
+
+  if (migration) {
+    double const interval_sec = integer_time<std::chrono::seconds>(CONNECTION_REBALANCE_TIMER_REPEAT);
+    LOG::info(
+        "rebalancing ingest connections, {} moved so far (busiest worker {} receiving {:.0f} bytes/s)",
+        connection_balancer_->num_migrations(),
+        migration->worker,
+        connection_balancer_->load(migration->worker) / interval_sec);
+    tcp_server_->shed_connection(migration->worker, migration->max_bytes / interval_sec);
+  }
+}
+
 void IngestCore::check_connection_timeouts()
 {
   auto now = std::chrono::nanoseconds(fp_get_time_ns());
 
   tcp_server_->visit_channels(
-      [&](const int shard, channel::TCPChannel *channel, std::chrono::nanoseconds last_message_seen) {
+      [&](const int shard, channel::ServerChannel *channel, std::chrono::nanoseconds last_message_seen) {
         auto time_since_last_message = now - last_message_seen;
         if (time_since_last_message >= NO_MESSAGE_TIMEOUT) {
           LOG::warn("closing connection due to inactivity");
@@ -12,11 +12,17 @@
 
 #include <platform/types.h>
 #include <scheduling/interval_scheduler.h>
+#include <util/zstd_decompressor.h>
 
 #include <absl/synchronization/notification.h>
 
 #include <uv.h>
 
+#include <memory>
+#include <vector>
+
+class ConnectionBalancer;
+
 namespace reducer {
 class RpcQueueMatrix;
 }
@@ -39,11 +45,24 @@ public:
   //   - metrics_tsdb_format - Format of metrics published to TSDB
   //   - localhost - Whether or not the ingest TCP listens to
   //         0.0.0.0 (if `localhost` is false) or 127.0.0.1
+  //   - zstd - How to decompress data from collectors that use Zstandard
+  //   - io_uring - Whether to accept and read connections with io_uring
+  //   - reuseport - Whether each ingest worker listens with a SO_REUSEPORT
+  //         socket of its own
+  //   - rebalance_connections - Whether to balance connections across ingest
+  //         workers by the bytes they receive, requires `reuseport`
+  //   - flow_control - Whether to grant credits to collectors, limiting what
+  //         they send while the queues to the other cores are filling up
   IngestCore(
       RpcQueueMatrix &ingest_to_logging_queues,
       RpcQueueMatrix &ingest_to_matching_queues,
       u32 telemetry_port,
-      bool localhost = false);
+      bool localhost = false,
+      ZstdDecompressionOptions const &zstd = {},
+      bool io_uring = false,
+      bool reuseport = false,
+      bool rebalance_connections = false,
+      bool flow_control = false);
 
   ~IngestCore();
 
@@ -66,6 +85,7 @@ private:
   /* Core callbacks */
   static void on_write_internal_stats_timer_cb(uv_timer_t *timer);
   static void on_pulse_timer_cb(uv_timer_t *timer);
+  static void on_connection_rebalance_timer_cb(uv_timer_t *timer);
 
   /**
    * (internal) called when it's time to drain internal metrics for
@@ -78,6 +98,12 @@ private:
    */
   void on_pulse_timer();
 
+  /**
+   * Feeds the bytes received by ingest workers to the connection balancer,
+   * steers new connections and moves existing ones accordingly.
+   */
+  void on_connection_rebalance_timer();
+
   /**
    * Scans for timed-out connections and disconnects them.
    */
@@ -93,10 +119,16 @@ private:
   absl::Notification done_;
 
   std::unique_ptr<TcpServer> tcp_server_;
+
+  // Balances connections across ingest workers, if enabled.
+  std::unique_ptr<ConnectionBalancer> connection_balancer_;
+  std::vector<u64> last_received_bytes_;
+  bool steer_connections_ = true;
   std::vector<IndexDumper> index_dumper_;
 
   uv_timer_t write_internal_stats_timer_;
   uv_timer_t pulse_timer_;
+  uv_timer_t connection_rebalance_timer_;
   std::optional<scheduling::IntervalScheduler> connection_timeout_handler_;
 
   friend void __on_signal_cb(uv_signal_t *, int);
@@ -5,9 +5,12 @@
 #include "npm_connection.h"
 #include "shared_state.h"
 
+#include <reducer/core.h>
 #include <reducer/rpc_queue_matrix.h>
 #include <reducer/worker.h>
 
+#include <collector/server_command.h>
+
 #include <generated/ebpf_net/ingest/index.h>
 #include <generated/ebpf_net/ingest/modifiers.h>
 
@@ -18,26 +21,48 @@
 #include <util/boot_time.h>
 #include <util/error_handling.h>
 #include <util/log.h>
+#include <util/uv_helpers.h>
 
 #include <absl/time/time.h>
 
 #include <uv.h>
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <optional>
 
 namespace reducer::ingest {
 
-IngestWorker::IngestWorker(RpcQueueMatrix &ingest_to_logging_queues, RpcQueueMatrix &ingest_to_matching_queues, u32 shard_num)
-    : ingest_to_logging_stats_(shard_num, "ingest", "logging", ingest_to_logging_queues),
+namespace {
+
+// How often collectors are granted credits. Grants are for the bytes a
+// collector may send until the next one.
+constexpr auto flow_control_interval = std::chrono::seconds(1);
+
+} // namespace
+
+IngestWorker::IngestWorker(
+    RpcQueueMatrix &ingest_to_logging_queues,
+    RpcQueueMatrix &ingest_to_matching_queues,
+    u32 shard_num,
+    ZstdDecompressionOptions zstd,
+    bool io_uring,
+    bool flow_control)
+    : Worker(io_uring),
+      ingest_to_logging_stats_(shard_num, "ingest", "logging", ingest_to_logging_queues),
       ingest_to_matching_stats_(shard_num, "ingest", "matching", ingest_to_matching_queues),
       index_(std::make_unique<ebpf_net::ingest::Index>(
           ingest_to_logging_queues.make_writers<ebpf_net::logging::Writer>(shard_num, monotonic, get_boot_time()),
           ingest_to_matching_queues.make_writers<ebpf_net::matching::Writer>(shard_num, monotonic, get_boot_time()))),
       logger_(index_->logger.alloc()),
       core_stats_(index_->core_stats.alloc()),
-      ingest_core_stats_(index_->ingest_core_stats.alloc())
-{}
+      ingest_core_stats_(index_->ingest_core_stats.alloc()),
+      zstd_pool_(std::move(zstd)),
+      flow_control_(flow_control)
+{
+  index_->set_pool_limits(Core::span_pool_soft_limit_fraction(), Core::span_pool_hard_limit_fraction());
+}
 
 IngestWorker::~IngestWorker() {}
 
@@ -46,6 +71,11 @@ void IngestWorker::register_close_callback(OnCloseCallback on_close_cb)
   on_close_cb_ = std::move(on_close_cb);
 }
 
+void IngestWorker::register_open_callback(OnOpenCallback on_open_cb)
+{
+  on_open_cb_ = std::move(on_open_cb);
+}
+
 std::shared_ptr<absl::Notification> IngestWorker::visit_index(IndexCb cb)
 {
   return visit_thread([this, captured_cb = std::move(cb)] { captured_cb(index_.get()); });
@@ -81,6 +111,14 @@ void IngestWorker::on_thread_start()
   set_local_logger(&logger_);
   set_local_core_stats_handle(&core_stats_);
   set_local_ingest_core_stats_handle(&ingest_core_stats_);
+
+  if (flow_control_) {
+    // closed along with the loop when the thread stops
+    CHECK_UV(uv_timer_init(&loop(), &flow_control_timer_));
+    flow_control_timer_.data = this;
+    auto const interval_ms = std::chrono::duration_cast<std::chrono::milliseconds>(flow_control_interval).count();
+    CHECK_UV(uv_timer_start(&flow_control_timer_, &IngestWorker::flow_control_timer_cb, interval_ms, interval_ms));
+  }
 }
 
 void IngestWorker::on_thread_stop()
@@ -92,13 +130,32 @@ void IngestWorker::on_thread_stop()
   set_local_connection(nullptr);
 }
 
-std::unique_ptr<::channel::Callbacks> IngestWorker::create_callbacks(uv_loop_t &loop, ::channel::TCPChannel *const tcp_channel)
+void IngestWorker::flow_control_timer_cb(uv_timer_t *const timer)
 {
-  return std::make_unique<IngestWorker::Callbacks>(this, tcp_channel);
+  auto *const worker = reinterpret_cast<IngestWorker *>(timer->data);
+  worker->update_flow_control();
 }
 
-IngestWorker::Callbacks::Callbacks(IngestWorker *worker, channel::TCPChannel *channel)
-    : worker_(worker), channel_(channel), decompressor_(Worker::kBufferSize)
+void IngestWorker::update_flow_control()
+{
+  double const utilization =
+      std::max(ingest_to_logging_stats_.current_utilization(), ingest_to_matching_stats_.current_utilization());
+
+  for_each_connection([this, utilization](::channel::Callbacks *const callbacks, u64 const received_bytes) {
+    static_cast<IngestWorker::Callbacks *>(callbacks)->grant_credits(credit_policy_, received_bytes, utilization);
+  });
+}
+
+std::unique_ptr<::channel::Callbacks> IngestWorker::create_callbacks(uv_loop_t &loop, ::channel::ServerChannel *const channel)
+{
+  if (on_open_cb_) {
+    on_open_cb_();
+  }
+  return std::make_unique<IngestWorker::Callbacks>(this, channel);
+}
+
+IngestWorker::Callbacks::Callbacks(IngestWorker *worker, channel::ServerChannel *channel)
+    : worker_(worker), channel_(channel)
 {
   assert(local_index() == worker_->index_.get());
 
@@ -113,7 +170,6 @@ uint32_t IngestWorker::Callbacks::received_data(const u8 *data, int data_len)
 {
   const u8 *begin = data;
   const u8 *const end = data + data_len;
-  u16 count = 0;
 
   // Process the raw data as-is if the decompressor is not active.
   while (!decompressor_active_) {
@@ -132,7 +188,6 @@ uint32_t IngestWorker::Callbacks::received_data(const u8 *data, int data_len)
     // Increment the begin pointer by the bytes consumed.
     ASSUME(static_cast<int>(*bytes_consumed) <= (end - begin));
     begin += *bytes_consumed;
-    ++count;
 
     if (begin == end) {
       // Everything has been consumed.
@@ -144,16 +199,50 @@ uint32_t IngestWorker::Callbacks::received_data(const u8 *data, int data_len)
   // 1) The first message received (and whether or not compression is being
   //    used is being negotiated).
   // 2) This is a subsequent data message, and it is compressed.
+  if (std::holds_alternative<std::monostate>(decompressor_)) {
+    // Collectors compress with LZ4 unless configured to use Zstandard, which
+    // is told apart by the magic number at the start of its frame.
+    if (end - begin < static_cast<std::ptrdiff_t>(sizeof(u32))) {
+      return begin - data;
+    }
+
+    if (ZstdDecompressor::is_frame(begin, end - begin)) {
+      try {
+        decompressor_.emplace<ZstdDecompressor>(Worker::kBufferSize, worker_->zstd_pool_);
+      } catch (std::exception const &e) {
+        decompressor_.emplace<std::monostate>();
+        local_logger().ingest_decompression_error(
+            static_cast<u8>(connection_->client_type()),
+            jb_blob(connection_->client_hostname()),
+            jb_blob(std::string_view(e.what())));
+        channel_->close_permanently();
+        return 0;
+      }
+    } else {
+      decompressor_.emplace<Lz4Decompressor>(Worker::kBufferSize);
+    }
+  }
+
+  if (auto *const zstd_decompressor = std::get_if<ZstdDecompressor>(&decompressor_)) {
+    return received_compressed_data(*zstd_decompressor, data, begin, end);
+  }
+  return received_compressed_data(std::get<Lz4Decompressor>(decompressor_), data, begin, end);
+}
+
+template <typename Decompressor>
+uint32_t IngestWorker::Callbacks::received_compressed_data(
+    Decompressor &decompressor, const u8 *const data, const u8 *begin, const u8 *const end)
+{
   size_t consumed_len = 0;
   do {
-    const size_t res = decompressor_.process(begin, end - begin, &consumed_len);
+    const size_t res = decompressor.process(begin, end - begin, &consumed_len);
 
     // Check if decompression failed.
     if (res != 0) {
       local_logger().ingest_decompression_error(
           static_cast<u8>(connection_->client_type()),
           jb_blob(connection_->client_hostname()),
-          jb_blob(std::string_view(LZ4F_getErrorName(res))));
+          jb_blob(std::string_view(Decompressor::error_name(res))));
       channel_->close_permanently();
       return 0;
     }
@@ -163,7 +252,7 @@ uint32_t IngestWorker::Callbacks::received_data(const u8 *data, int data_len)
 
     ASSUME(decompressor_active_);
     const std::optional<uint32_t> consumed_uncompressed =
-        received_data_internal(decompressor_.output_buf(), decompressor_.output_buf_size());
+        received_data_internal(decompressor.output_buf(), decompressor.output_buf_size());
 
     // An error occurred, close.
     if (!consumed_uncompressed) {
@@ -172,8 +261,7 @@ uint32_t IngestWorker::Callbacks::received_data(const u8 *data, int data_len)
     }
 
     // Remove the handled bytes from decompression buffer.
-    decompressor_.discard(*consumed_uncompressed);
-    ++count;
+    decompressor.discard(*consumed_uncompressed);
 
     // * if we weren't able to decompress any bytes, can exit -- another
     //   iteration will not make progress.
@@ -222,6 +310,11 @@ std::optional<uint32_t> IngestWorker::Callbacks::received_data_internal(const u8
     if (!first_message_seen_) {
       decompressor_active_ = true;
       first_message_seen_ = true;
+
+      // collectors that don't know the command ignore it
+      if (worker_->flow_control_) {
+        send_command(static_cast<u64>(ServerCommand::FLOW_CONTROL_OFFERED));
+      }
     }
 
     return res;
@@ -233,6 +326,49 @@ std::optional<uint32_t> IngestWorker::Callbacks::received_data_internal(const u8
   }
 }
 
+void IngestWorker::Callbacks::grant_credits(CreditPolicy const &policy, u64 const received_bytes, double const utilization)
+{
+  u64 const sent_bytes = received_bytes - last_received_bytes_;
+  last_received_bytes_ = received_bytes;
+
+  if (!connection_->flow_control_supported()) {
+    return;
+  }
+
+  auto const grant = policy.next_grant(credit_grant_, sent_bytes, utilization);
+  if (!grant && !credit_grant_) {
+    // collectors are not limited until told otherwise
+    return;
+  }
+
+  if (grant.has_value() != credit_grant_.has_value()) {
+    LOG::debug(
+        "{} {} collector at '{}' ({} bytes in the last interval, queues at {:.0f}%)",
+        grant ? "Limiting" : "No longer limiting",
+        connection_->client_type(),
+        connection_->client_hostname(),
+        sent_bytes,
+        utilization * 100);
+  }
+  credit_grant_ = grant;
+
+  u32 const kib =
+      grant ? static_cast<u32>(std::min<u64>((*grant + 1023) >> 10, CREDIT_GRANT_UNLIMITED - 1)) : CREDIT_GRANT_UNLIMITED;
+  send_command(make_credit_grant(kib));
+}
+
+void IngestWorker::Callbacks::send_command(u64 const command)
+{
+  // commands are sent big-endian
+  u8 buf[sizeof(command)];
+  for (std::size_t i = 0; i < sizeof(command); ++i) {
+    buf[i] = static_cast<u8>(command >> (8 * (sizeof(command) - 1 - i)));
+  }
+
+  // on failure the connection's error callback has been invoked
+  static_cast<void>(channel_->send(buf, sizeof(buf)));
+}
+
 void IngestWorker::Callbacks::on_error(const int err)
 {
   const ClientType client_type = connection_->client_type();
@@ -8,6 +8,7 @@
 #include "npm_connection.h"
 
 #include <reducer/rpc_stats.h>
+#include <reducer/util/credit_policy.h>
 #include <reducer/worker.h>
 
 #include <generated/ebpf_net/ingest/index.h>
@@ -18,12 +19,14 @@
 
 #include <util/log.h>
 #include <util/lz4_decompressor.h>
+#include <util/zstd_decompressor.h>
 
 #include <absl/time/time.h>
 #include <uv.h>
 
 #include <memory>
 #include <optional>
+#include <variant>
 
 namespace reducer {
 class RpcQueueMatrix;
@@ -36,12 +39,24 @@ namespace reducer::ingest {
 //
 class IngestWorker : public Worker {
 public:
+  using OnOpenCallback = std::function<void()>;
   using OnCloseCallback = std::function<void()>;
 
   // Arguments:
   // - index - The ingest index that will be owned by this class.
+  // - zstd - How to decompress data from collectors that use Zstandard.
+  // - io_uring - Whether to read connections with io_uring, see `Worker`.
+  // - flow_control - Whether to grant credits to the collectors that support
+  //     it, from the utilization of the queues to the logging and matching
+  //     cores, see CreditPolicy.
   // Calling this constructor will set the `local_index()` value.
-  IngestWorker(RpcQueueMatrix &ingest_to_logging_queues, RpcQueueMatrix &ingest_to_matching_queues, u32 shard_num);
+  IngestWorker(
+      RpcQueueMatrix &ingest_to_logging_queues,
+      RpcQueueMatrix &ingest_to_matching_queues,
+      u32 shard_num,
+      ZstdDecompressionOptions zstd = {},
+      bool io_uring = false,
+      bool flow_control = false);
   ~IngestWorker() override;
 
   // Registers a callback that will be invoked everytime a TCP connection
@@ -49,13 +64,18 @@ public:
   // been called.
   void register_close_callback(OnCloseCallback on_close_cb);
 
+  // Same as above, for the callback invoked everytime a TCP connection is
+  // opened. Only needed for connections this worker accepts itself, see
+  // `Worker::listen()`.
+  void register_open_callback(OnOpenCallback on_open_cb);
+
   // The set of callbacks invoked when data arrives over a TCP connection.
   // There will be an instance of this class for every established connection.
   // When `received_data` is invoked, `local_connection` will be overwritten by
   // the NpmConnection instance owned by this class.
   class Callbacks : public ::channel::Callbacks {
   public:
-    Callbacks(IngestWorker *worker, channel::TCPChannel *tcp_channel);
+    Callbacks(IngestWorker *worker, channel::ServerChannel *channel);
     ~Callbacks() override;
 
     uint32_t received_data(const u8 *data, int data_len) override;
@@ -70,15 +90,34 @@ public:
     // the connection to close).
     std::optional<uint32_t> received_data_internal(const u8 *data, int data_len);
 
+    // Processes the compressed data in [begin, end), |data| being the start
+    // of the data passed to `received_data`. Returns what `received_data`
+    // returns.
+    template <typename Decompressor>
+    uint32_t received_compressed_data(Decompressor &decompressor, const u8 *data, const u8 *begin, const u8 *end);
+
+    // Grants the collector credits for the next interval, given the bytes
+    // received on the connection so far and the queues' utilization.
+    void grant_credits(CreditPolicy const &policy, u64 received_bytes, double utilization);
+
+    // Sends one of the commands in collector/server_command.h.
+    void send_command(u64 command);
+
     IngestWorker *worker_;
-    channel::TCPChannel *channel_;
-    Lz4Decompressor decompressor_;
+    channel::ServerChannel *channel_;
+    // picked by the magic number of the first compressed frame
+    std::variant<std::monostate, Lz4Decompressor, ZstdDecompressor> decompressor_;
 
     std::unique_ptr<NpmConnection> connection_;
 
     bool decompressor_active_ = false;
     bool first_message_seen_ = false;
     std::chrono::nanoseconds last_message_seen_;
+
+    // Credits granted to the collector for the current interval, none
+    // meaning it is not limited.
+    std::optional<u64> credit_grant_;
+    u64 last_received_bytes_ = 0;
   };
 
   // Invokes the provided callback in this worker's thread, allowing one to
@@ -93,7 +132,7 @@ public:
   [[nodiscard]] std::shared_ptr<absl::Notification> visit_connections(ConnectionCb cb);
 
   // Same as above, but runs `cb` on each of this class's channel.
-  using ChannelCb = std::function<void(channel::TCPChannel *, std::chrono::nanoseconds)>;
+  using ChannelCb = std::function<void(channel::ServerChannel *, std::chrono::nanoseconds)>;
   [[nodiscard]] std::shared_ptr<absl::Notification> visit_channels(ChannelCb cb);
 
   // Same as above, but runs `b` on worker's RpcSenderStats.
@@ -104,9 +143,15 @@ protected:
   void on_thread_start() override;
   void on_thread_stop() override;
 
-  std::unique_ptr<::channel::Callbacks> create_callbacks(uv_loop_t &loop, ::channel::TCPChannel *tcp_channel) override;
+  std::unique_ptr<::channel::Callbacks> create_callbacks(uv_loop_t &loop, ::channel::ServerChannel *channel) override;
 
 private:
+  static void flow_control_timer_cb(uv_timer_t *timer);
+
+  // Grants credits to the collectors of all connections, see CreditPolicy.
+  void update_flow_control();
+
+  OnOpenCallback on_open_cb_;
   OnCloseCallback on_close_cb_;
   RpcSenderStats ingest_to_logging_stats_;
   RpcSenderStats ingest_to_matching_stats_;
@@ -114,6 +159,11 @@ private:
   ::ebpf_net::ingest::auto_handles::logger logger_;
   ::ebpf_net::ingest::auto_handles::core_stats core_stats_;
   ::ebpf_net::ingest::auto_handles::ingest_core_stats ingest_core_stats_;
+  ZstdContextPool zstd_pool_;
+
+  bool const flow_control_;
+  CreditPolicy const credit_policy_;
+  uv_timer_t flow_control_timer_;
 
   friend class Callbacks;
 };
@@ -5,8 +5,21 @@
 
 namespace reducer::ingest {
 
+namespace {
+
+// Transforms are the same for every agent connection and are never modified
+// once built, so all connections, in all ingest workers, share one builder
+// instead of building a table each time an agent connects.
+::ebpf_net::ingest::TransformBuilder &shared_transform_builder()
+{
+  static ::ebpf_net::ingest::TransformBuilder builder;
+  return builder;
+}
+
+} // namespace
+
 NpmConnection::NpmConnection(::ebpf_net::ingest::Index &index)
-    : transform_builder_(), protocol_(transform_builder_), connection_(protocol_, index), time_tracker_()
+    : protocol_(shared_transform_builder()), connection_(protocol_, index), time_tracker_()
 {}
 
 int NpmConnection::handle(const char *msg, uint32_t len)
@@ -37,13 +37,18 @@ public:
 
   ClientType client_type() const { return client_type_; }
 
+  // Whether the collector adapts to the credits granted by the reducer, see
+  // collector/server_command.h.
+  bool flow_control_supported() const { return flow_control_supported_; }
+  void set_flow_control_supported() { flow_control_supported_ = true; }
+
 private:
-  ebpf_net::ingest::TransformBuilder transform_builder_;
   ebpf_net::ingest::Protocol protocol_;
   ebpf_net::ingest::Connection connection_;
   TimeTracker time_tracker_;
   std::string_view client_hostname_ = kUnknown;
   ClientType client_type_ = ClientType::unknown;
+  bool flow_control_supported_ = false;
 };
 
 } // namespace reducer::ingest
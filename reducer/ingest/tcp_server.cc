@@ -5,15 +5,31 @@
 
 #include <reducer/ingest/ingest_worker.h>
 
+#include <util/reuseport_steering.h>
 #include <util/uv_helpers.h>
 
+#include <cassert>
+#include <cerrno>
+#include <cstring>
 #include <iomanip>
 #include <memory>
 #include <signal.h>
 #include <sstream>
+#include <system_error>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #define SERVER_LISTEN_BACKLOG 128
 
+// Entries of the ring used to accept connections with io_uring.
+#define ACCEPT_RING_ENTRIES 8
+
+// How long to wait before accepting again after an accept failed, e.g.
+// because the process ran out of file descriptors.
+#define ACCEPT_RETRY_DELAY_MS 100
+
 using std::placeholders::_1;
 using std::placeholders::_2;
 
@@ -31,19 +47,53 @@ void TcpServer::on_new_connection_cb(uv_stream_t *stream, int status)
   server->on_new_connection();
 }
 
-TcpServer::TcpServer(uv_loop_t &loop, u32 telemetry_port, bool localhost, std::vector<std::unique_ptr<IngestWorker>> workers)
-    : loop_(loop), workers_(std::move(workers))
+TcpServer::TcpServer(
+    uv_loop_t &loop,
+    u32 telemetry_port,
+    bool localhost,
+    std::vector<std::unique_ptr<IngestWorker>> workers,
+    bool io_uring,
+    bool reuseport)
+    : loop_(loop), workers_(std::move(workers)), reuseport_(reuseport)
 {
-  // Initialize the workers.
+  struct sockaddr_in addr;
+  CHECK_UV(uv_ip4_addr(localhost ? "127.0.0.1" : "0.0.0.0", telemetry_port, &addr));
+
+  // Workers accepting connections themselves use the load balancer as soon
+  // as they start.
   std::vector<Worker *> worker_ptrs;
+  for (auto const &worker : workers_) {
+    worker_ptrs.push_back(worker.get());
+  }
+  worker_balancer_ = std::make_unique<LoadBalancer<Worker *>>(absl::MakeSpan(worker_ptrs));
+
+  // Initialize the workers.
   for (std::size_t i = 0; i < workers_.size(); ++i) {
     IngestWorker *const worker_ptr = workers_[i].get();
-    worker_ptrs.push_back(worker_ptr);
 
     worker_ptr->register_close_callback([this, worker_ptr] { on_connection_close(worker_ptr); });
+    if (reuseport_) {
+      // workers listen in order, so that the index of a worker's socket in
+      // the SO_REUSEPORT group is the worker's index
+      worker_ptr->register_open_callback([this, worker_ptr] { on_connection_open(worker_ptr); });
+      try {
+        worker_ptr->listen(addr, SERVER_LISTEN_BACKLOG);
+      } catch (std::system_error const &e) {
+        LOG::critical("Could not listen on the telemetry port: {}", e.what());
+        std::exit(1);
+      }
+    }
     worker_ptr->start(i);
   }
-  worker_balancer_ = std::make_unique<LoadBalancer<Worker *>>(absl::MakeSpan(worker_ptrs));
+
+  if (reuseport_) {
+    LOG::info("ingest workers accept connections on {} SO_REUSEPORT sockets", workers_.size());
+    return;
+  }
+
+  if (io_uring && listen_with_io_uring(addr)) {
+    return;
+  }
 
   /* Listen for telemetry connections */
   CHECK_UV(uv_tcp_init(&loop_, &server_));
@@ -51,8 +101,6 @@ TcpServer::TcpServer(uv_loop_t &loop, u32 telemetry_port, bool localhost, std::v
   server_.data = this;
 
   /* bind + listen */
-  struct sockaddr_in addr;
-  CHECK_UV(uv_ip4_addr(localhost ? "127.0.0.1" : "0.0.0.0", telemetry_port, &addr));
   CHECK_UV(uv_tcp_bind(&server_, (struct sockaddr *)&addr, 0));
   CHECK_UV(uv_listen((uv_stream_t *)&server_, SERVER_LISTEN_BACKLOG, on_new_connection_cb));
 }
@@ -62,6 +110,119 @@ TcpServer::~TcpServer()
   for (auto &worker : workers_) {
     worker->stop();
   }
+
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+  }
+}
+
+bool TcpServer::listen_with_io_uring(struct sockaddr_in const &addr)
+{
+  try {
+    accept_ring_ = std::make_unique<IoUring>(ACCEPT_RING_ENTRIES);
+  } catch (std::system_error const &e) {
+    LOG::warn("io_uring is not available, accepting connections with libuv instead: {}", e.what());
+    return false;
+  }
+
+  listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listen_fd_ < 0) {
+    LOG::critical("Could not create the telemetry socket: {}", strerror(errno));
+    std::exit(1);
+  }
+
+  int const reuse = 1;
+  if (setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+      bind(listen_fd_, reinterpret_cast<struct sockaddr const *>(&addr), sizeof(addr)) != 0 ||
+      listen(listen_fd_, SERVER_LISTEN_BACKLOG) != 0) {
+    LOG::critical("Could not listen on the telemetry port: {}", strerror(errno));
+    std::exit(1);
+  }
+
+  CHECK_UV(uv_poll_init(&loop_, &accept_poll_, accept_ring_->fd()));
+  accept_poll_.data = this;
+  CHECK_UV(uv_poll_start(&accept_poll_, UV_READABLE, &accept_poll_cb));
+
+  CHECK_UV(uv_timer_init(&loop_, &accept_retry_timer_));
+  accept_retry_timer_.data = this;
+
+  start_accept();
+  accept_ring_->submit();
+
+  LOG::info("accepting connections with io_uring");
+  return true;
+}
+
+void TcpServer::start_accept()
+{
+  io_uring_sqe *const sqe = accept_ring_->get_sqe();
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = listen_fd_;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+}
+
+void TcpServer::accept_poll_cb(uv_poll_t *handle, int status, int events)
+{
+  auto *const server = reinterpret_cast<TcpServer *>(handle->data);
+
+  if (status < 0) {
+    LOG::error("Error polling for new connections: {}", uv_strerror(status));
+    return;
+  }
+  server->on_accept_completions();
+}
+
+void TcpServer::accept_retry_timer_cb(uv_timer_t *timer)
+{
+  auto *const server = reinterpret_cast<TcpServer *>(timer->data);
+  server->start_accept();
+  server->accept_ring_->submit();
+}
+
+void TcpServer::on_accept_completions()
+{
+  bool stopped = false;
+  int error = 0;
+
+  accept_ring_->for_each_completion([&](io_uring_cqe const &cqe) {
+    if (cqe.res >= 0) {
+      // Hand off connection to worker, which takes ownership of it.
+      assign_worker()->assign_fd(cqe.res);
+    } else {
+      error = -cqe.res;
+    }
+
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+      stopped = true;
+    }
+  });
+
+  if (stopped && error == EINVAL) {
+    // multishot accepts need Linux 5.19 or later: the listening socket is
+    // handed to libuv instead
+    LOG::warn("io_uring can't accept connections, accepting them with libuv instead");
+    CHECK_UV(uv_poll_stop(&accept_poll_));
+    CHECK_UV(uv_tcp_init(&loop_, &server_));
+    server_.data = this;
+    CHECK_UV(uv_tcp_open(&server_, listen_fd_));
+    listen_fd_ = -1;
+    CHECK_UV(uv_listen((uv_stream_t *)&server_, SERVER_LISTEN_BACKLOG, on_new_connection_cb));
+    return;
+  }
+
+  if (error) {
+    LOG::error("Error accepting new connection: {}", strerror(error));
+  }
+
+  if (stopped) {
+    if (error) {
+      CHECK_UV(uv_timer_start(&accept_retry_timer_, &accept_retry_timer_cb, ACCEPT_RETRY_DELAY_MS, 0));
+    } else {
+      start_accept();
+      accept_ring_->submit();
+    }
+  }
 }
 
 TcpServer::Stats TcpServer::get_stats()
@@ -70,6 +231,29 @@ TcpServer::Stats TcpServer::get_stats()
   return stats_;
 }
 
+std::vector<u64> TcpServer::received_bytes() const
+{
+  std::vector<u64> bytes;
+  bytes.reserve(workers_.size());
+  for (auto const &worker : workers_) {
+    bytes.push_back(worker->received_bytes());
+  }
+  return bytes;
+}
+
+void TcpServer::steer_connections(std::vector<double> const &weights)
+{
+  assert(reuseport_ && weights.size() == workers_.size());
+
+  // the program is shared by all the sockets of the group
+  ReuseportSteering(weights).attach(workers_.front()->listen_fd());
+}
+
+void TcpServer::shed_connection(std::size_t worker_index, double max_rate)
+{
+  workers_[worker_index]->shed_connection(max_rate);
+}
+
 void TcpServer::visit_indexes(const IndexCb &cb, const bool block)
 {
   visit_internal(
@@ -124,18 +308,36 @@ void TcpServer::on_new_connection()
   CHECK_UV(uv_accept(reinterpret_cast<uv_stream_t *>(&server_), reinterpret_cast<uv_stream_t *>(conn)));
 
   // Hand off connection to worker.
-  Worker *const worker = worker_balancer_->least_loaded();
-  worker_balancer_->increment_load(worker, 1);
-  worker->assign(*conn);
+  assign_worker()->assign(*conn);
 
   // Close the connnection.
   uv_close(reinterpret_cast<uv_handle_t *>(conn), reinterpret_cast<uv_close_cb>(&std::free));
+}
+
+Worker *TcpServer::assign_worker()
+{
+  Worker *const worker = worker_balancer_->least_loaded();
+  worker_balancer_->increment_load(worker, 1);
 
   // Update the stats
   {
     absl::MutexLock l(&stats_mu_);
     stats_.connection_counter++;
   }
+
+  return worker;
+}
+
+void TcpServer::on_connection_open(IngestWorker *const worker)
+{
+  // Keep the load balancer in step with `on_connection_close`.
+  worker_balancer_->increment_load(worker, 1);
+
+  // Update the connection stats.
+  {
+    absl::MutexLock l(&stats_mu_);
+    stats_.connection_counter++;
+  }
 }
 
 void TcpServer::on_connection_close(IngestWorker *const worker)
@@ -12,9 +12,13 @@
 
 #include <generated/ebpf_net/ingest/index.h>
 
+#include <util/io_uring.h>
+
 #include <uv.h>
 
 #include <cstddef>
+#include <memory>
+#include <vector>
 
 namespace reducer::ingest {
 
@@ -36,7 +40,18 @@ public:
   // * localhsot - If true, connects to 127.0.0.1, otherwise uses 0.0.0.0
   // * workers - The ingest workers owned by this class. This constructor
   //    will overwrite the close callback used by these workers.
-  TcpServer(uv_loop_t &loop, u32 telemetry_port, bool localhost, std::vector<std::unique_ptr<IngestWorker>> workers);
+  // * io_uring - If true, accepts connections with a multishot io_uring
+  //    accept when the kernel allows it, otherwise with libuv.
+  // * reuseport - If true, each worker listens on the port with a socket of
+  //    its own and accepts its connections itself (see `Worker::listen()`),
+  //    instead of this class accepting them and handing them to workers.
+  TcpServer(
+      uv_loop_t &loop,
+      u32 telemetry_port,
+      bool localhost,
+      std::vector<std::unique_ptr<IngestWorker>> workers,
+      bool io_uring = false,
+      bool reuseport = false);
   ~TcpServer();
 
   // Returns various stats related to connects/disconnects, etc.
@@ -57,7 +72,7 @@ public:
   void visit_connections(const ConnectionCb &cb, bool block);
 
   // Same as above, but for channels.
-  using ChannelCb = std::function<void(int, channel::TCPChannel *, std::chrono::nanoseconds)>;
+  using ChannelCb = std::function<void(int, channel::ServerChannel *, std::chrono::nanoseconds)>;
   void visit_channels(const ChannelCb &cb, bool block);
 
   // Same as above, but for RpcSenderStats.
@@ -66,6 +81,21 @@ public:
 
   std::size_t workers_count() const { return workers_.size(); }
 
+  // Whether workers accept connections on their own sockets.
+  bool reuseport() const { return reuseport_; }
+
+  // Bytes received so far by each worker.
+  std::vector<u64> received_bytes() const;
+
+  // Sets the odds of new connections going to each worker, see
+  // ReuseportSteering. Requires `reuseport()`.
+  //
+  // Throws std::system_error on failure.
+  void steer_connections(std::vector<double> const &weights);
+
+  // Closes a connection of the given worker, see `Worker::shed_connection()`.
+  void shed_connection(std::size_t worker_index, double max_rate);
+
   // Global accessor for the TcpSever. Used by classes who want use the
   // `visit_*` functions but do not have direct access to a `TcpSever` instance
   // for whatever reason (e.g. render-instantiated `*Span` classes).
@@ -96,6 +126,25 @@ private:
   // Basically same as above, but as member function.
   void on_new_connection();
 
+  // Sets up the listening socket and the multishot accept. Returns false if
+  // io_uring can't be used, in which case nothing was set up.
+  bool listen_with_io_uring(struct sockaddr_in const &addr);
+
+  // Queues the multishot accept.
+  void start_accept();
+
+  // Callbacks for the accepts made with io_uring.
+  static void accept_poll_cb(uv_poll_t *handle, int status, int events);
+  static void accept_retry_timer_cb(uv_timer_t *timer);
+  void on_accept_completions();
+
+  // Picks the worker for a new connection and accounts for it.
+  Worker *assign_worker();
+
+  // Callback invoked when a connection accepted by `worker` itself has been
+  // opened.
+  void on_connection_open(IngestWorker *worker);
+
   // Callback invoked when a connection on `worker` has been closed.
   void on_connection_close(IngestWorker *worker);
 
@@ -106,7 +155,14 @@ private:
   uv_loop_t &loop_;
   uv_tcp_t server_;
 
+  // Only used when accepting with io_uring.
+  int listen_fd_ = -1;
+  std::unique_ptr<IoUring> accept_ring_;
+  uv_poll_t accept_poll_;
+  uv_timer_t accept_retry_timer_;
+
   std::vector<std::unique_ptr<IngestWorker>> workers_;
+  bool reuseport_ = false;
   std::unique_ptr<LoadBalancer<Worker *>> worker_balancer_;
 
   Stats stats_ ABSL_GUARDED_BY(stats_mu_);
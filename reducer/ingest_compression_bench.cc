@@ -0,0 +1,302 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+// Compares LZ4 and Zstandard on recorded ingest streams: compression ratio, and the CPU both ends spend on it. Streams
+// are cut into sends the way collectors' buffered writers do, compressed with the channels collectors use and
+// decompressed with the decompressors ingest workers use. Throughputs are in MB of uncompressed data per second.
+//
+// Zstandard is run at several levels, with and without a dictionary trained on the recordings. With at least two
+// collector connections in the recordings, the dictionary is trained on every other connection, so that the ratio is not
+// measured on its own training data.
+//
+// Recordings are made by collectors with EBPF_NET_RECORD_INTAKE_OUTPUT_PATH set. The trained dictionary can be saved for
+// EBPF_NET_INTAKE_ZSTD_DICTIONARY and the reducer's --zstd-dictionary.
+//
+// Usage: ingest_compression_bench [--dictionary-out file] [--dictionary-size bytes] recording...
+
+#include <channel/lz4_channel.h>
+#include <channel/zstd_channel.h>
+#include <collector/constants.h>
+#include <reducer/ingest_recording.h>
+#include <util/lz4_decompressor.h>
+#include <util/stop_watch.h>
+#include <util/zstd_decompressor.h>
+
+#include <zdict.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+/* what ingest workers allocate for decompressed data */
+constexpr std::size_t output_buffer_size = 64 * 1024;
+
+/* the collectors' and the reducer's default */
+constexpr int window_log = 17;
+
+/* dictionaries are trained on pieces of sends this large */
+constexpr std::size_t sample_size = 4 * 1024;
+
+/* the sends of one collector connection */
+using Stream = std::vector<std::string>;
+
+class CapturingChannel : public channel::Channel {
+public:
+  std::error_code send(const u8 *data, int data_len) override
+  {
+    sends_.emplace_back(reinterpret_cast<char const *>(data), data_len);
+    return {};
+  }
+
+  bool is_open() const override { return true; }
+
+  Stream take() { return std::exchange(sends_, {}); }
+
+private:
+  Stream sends_;
+};
+
+// Cuts each session of |recording| into sends of up to WRITE_BUFFER_SIZE bytes.
+void cut_into_streams(reducer::IngestRecording const &recording, std::vector<Stream> &streams)
+{
+  for (auto const &session : recording.sessions()) {
+    Stream stream(1);
+    for (std::size_t i = session.begin; i < session.end; ++i) {
+      auto const message = recording.message(recording.messages()[i]);
+      if (stream.back().size() + message.size() > WRITE_BUFFER_SIZE) {
+        stream.emplace_back();
+      }
+      stream.back().append(message);
+    }
+    streams.push_back(std::move(stream));
+  }
+}
+
+std::string train_dictionary(std::vector<Stream const *> const &streams, std::size_t dictionary_size)
+{
+  std::string samples;
+  std::vector<size_t> sizes;
+  for (auto const *stream : streams) {
+    for (auto const &send : *stream) {
+      for (std::size_t offset = 0; offset < send.size(); offset += sample_size) {
+        sizes.push_back(std::min(sample_size, send.size() - offset));
+        samples.append(send, offset, sizes.back());
+      }
+    }
+  }
+
+  std::string dictionary(dictionary_size, '\0');
+  size_t const size =
+      ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(), samples.data(), sizes.data(), sizes.size());
+  if (ZDICT_isError(size)) {
+    std::cerr << "dictionary training failed: " << ZDICT_getErrorName(size) << std::endl;
+    return {};
+  }
+  dictionary.resize(size);
+  return dictionary;
+}
+
+// Decompresses |stream| with |decompressor|. Returns the number of bytes out, or nullopt on error.
+template <typename Decompressor> std::optional<u64> decompress(Decompressor &decompressor, Stream const &stream)
+{
+  u64 out = 0;
+  for (auto const &send : stream) {
+    auto const *data = reinterpret_cast<u8 const *>(send.data());
+    for (std::size_t remaining = send.size(); remaining > 0;) {
+      size_t consumed = 0;
+      if (decompressor.process(data, remaining, &consumed) != 0) {
+        return std::nullopt;
+      }
+      out += decompressor.output_buf_size();
+      decompressor.discard(decompressor.output_buf_size());
+      data += consumed;
+      remaining -= consumed;
+    }
+  }
+  return out;
+}
+
+struct Codec {
+  std::string name;
+  std::function<std::unique_ptr<channel::CompressingChannel>(channel::Channel &)> make_channel;
+  std::function<std::optional<u64>(Stream const &)> decompress;
+};
+
+void run(Codec const &codec, std::vector<Stream const *> const &streams)
+{
+  u64 uncompressed = 0;
+  u64 compressed = 0;
+
+  CapturingChannel downstream;
+  std::vector<Stream> compressed_streams;
+  compressed_streams.reserve(streams.size());
+
+  StopWatch<> watch;
+  for (auto const *stream : streams) {
+    auto const channel = codec.make_channel(downstream);
+    channel->set_compression(true);
+    for (auto const &send : *stream) {
+      channel->send(reinterpret_cast<u8 const *>(send.data()), send.size());
+      uncompressed += send.size();
+    }
+    compressed_streams.push_back(downstream.take());
+  }
+  double const compress_ns = watch.elapsed_ns();
+
+  watch.reset();
+  u64 decompressed = 0;
+  for (auto const &stream : compressed_streams) {
+    auto const out = codec.decompress(stream);
+    if (!out) {
+      std::cout << "  " << codec.name << ": decompression failed" << std::endl;
+      return;
+    }
+    decompressed += *out;
+  }
+  double const decompress_ns = watch.elapsed_ns();
+
+  for (auto const &stream : compressed_streams) {
+    for (auto const &send : stream) {
+      compressed += send.size();
+    }
+  }
+
+  if (decompressed != uncompressed) {
+    std::cout << "  " << codec.name << ": decompressed " << decompressed << " bytes out of " << uncompressed << std::endl;
+    return;
+  }
+
+  std::cout << "  " << std::left << std::setw(24) << codec.name << std::right << std::fixed << std::setprecision(2)
+            << " ratio " << std::setw(6) << static_cast<double>(uncompressed) / compressed << "  compress " << std::setw(8)
+            << uncompressed * 1e3 / compress_ns << " MB/s  decompress " << std::setw(8) << uncompressed * 1e3 / decompress_ns
+            << " MB/s" << std::endl;
+}
+
+Codec lz4_codec()
+{
+  return {
+      .name = "lz4",
+      .make_channel =
+          [](channel::Channel &downstream) { return std::make_unique<channel::Lz4Channel>(downstream, WRITE_BUFFER_SIZE); },
+      .decompress =
+          [](Stream const &stream) {
+            Lz4Decompressor decompressor(output_buffer_size);
+            return decompress(decompressor, stream);
+          },
+  };
+}
+
+Codec zstd_codec(int level, std::string const &dictionary, std::shared_ptr<ZstdContextPool> const &pool)
+{
+  channel::ZstdChannel::Options const options{.level = level, .window_log = window_log, .dictionary = dictionary};
+
+  return {
+      .name = "zstd -" + std::to_string(level) + (dictionary.empty() ? "" : " dictionary"),
+      .make_channel =
+          [options](channel::Channel &downstream) {
+            return std::make_unique<channel::ZstdChannel>(downstream, WRITE_BUFFER_SIZE, options);
+          },
+      .decompress =
+          [pool](Stream const &stream) {
+            ZstdDecompressor decompressor(output_buffer_size, *pool);
+            return decompress(decompressor, stream);
+          },
+  };
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  char const *dictionary_out = nullptr;
+  std::size_t dictionary_size = 112 * 1024;
+  std::vector<char const *> paths;
+
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--dictionary-out") && i + 1 < argc) {
+      dictionary_out = argv[++i];
+    } else if (!strcmp(argv[i], "--dictionary-size") && i + 1 < argc) {
+      dictionary_size = std::atoll(argv[++i]);
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+
+  if (paths.empty()) {
+    std::cerr << "usage: " << argv[0] << " [--dictionary-out file] [--dictionary-size bytes] recording..." << std::endl;
+    return 1;
+  }
+
+  std::vector<Stream> streams;
+  for (auto const *path : paths) {
+    try {
+      cut_into_streams(reducer::IngestRecording::load(path), streams);
+    } catch (std::exception const &e) {
+      std::cerr << "cannot load " << path << ": " << e.what() << std::endl;
+      return 1;
+    }
+  }
+
+  std::vector<Stream const *> measured;
+  std::vector<Stream const *> training;
+  for (std::size_t i = 0; i < streams.size(); ++i) {
+    (streams.size() > 1 && i % 2 == 0 ? training : measured).push_back(&streams[i]);
+  }
+
+  u64 n_sends = 0;
+  u64 n_bytes = 0;
+  for (auto const *stream : measured) {
+    n_sends += stream->size();
+    for (auto const &send : *stream) {
+      n_bytes += send.size();
+    }
+  }
+  std::cout << measured.size() << " connections, " << n_sends << " sends, " << n_bytes << " bytes" << std::endl;
+
+  auto const dictionary = train_dictionary(training.empty() ? measured : training, dictionary_size);
+  if (training.empty()) {
+    std::cout << "single connection: the dictionary is trained on the data it compresses" << std::endl;
+  }
+  if (!dictionary.empty()) {
+    std::cout << "dictionary: " << dictionary.size() << " bytes, id " << ZDICT_getDictID(dictionary.data(), dictionary.size())
+              << std::endl;
+  }
+
+  if (dictionary_out && !dictionary.empty()) {
+    std::ofstream file(dictionary_out, std::ios::binary);
+    file.write(dictionary.data(), dictionary.size());
+    if (!file) {
+      std::cerr << "cannot write " << dictionary_out << std::endl;
+      return 1;
+    }
+  }
+
+  auto const pool = std::make_shared<ZstdContextPool>(ZstdDecompressionOptions{.window_log_max = window_log});
+
+  auto dictionaries = std::make_shared<ZstdDictionaries>();
+  if (!dictionary.empty()) {
+    dictionaries->add(dictionary);
+  }
+  auto const dictionary_pool = std::make_shared<ZstdContextPool>(
+      ZstdDecompressionOptions{.dictionaries = dictionaries, .window_log_max = window_log});
+
+  run(lz4_codec(), measured);
+  for (int level : {1, 3, 6, 9, 15}) {
+    run(zstd_codec(level, {}, pool), measured);
+    if (!dictionary.empty()) {
+      run(zstd_codec(level, dictionary, dictionary_pool), measured);
+    }
+  }
+
+  return 0;
+}
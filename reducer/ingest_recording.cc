@@ -0,0 +1,306 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <reducer/ingest_recording.h>
+
+#include <generated/ebpf_net/ingest/meta.h>
+#include <generated/ebpf_net/ingest/wire_message.h>
+
+#include <util/file_ops.h>
+#include <util/meta.h>
+
+#include <absl/container/flat_hash_map.h>
+
+#include <spdlog/fmt/fmt.h>
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+
+namespace reducer {
+
+namespace {
+
+namespace ingest = ebpf_net::ingest;
+
+// Offset of a field of an ingest wire message, from the start of the message's timestamp.
+#define WIRE_OFFSET(message, field) (sizeof(u64) + offsetof(ingest::message##_message_metadata::wire_message, field))
+
+struct MessageLayout {
+  u16 size;
+  /* the wire message starts with u16 rpc_id + u16 _len */
+  bool dynamic_size;
+};
+
+absl::flat_hash_map<u16, MessageLayout> make_message_layouts()
+{
+  absl::flat_hash_map<u16, MessageLayout> layouts;
+
+  meta::foreach<ebpf_net::ingest_metadata::messages>([&](auto tag) {
+    using message = decltype(meta::tag_type(tag));
+    constexpr bool dynamic_size = requires(typename message::wire_message const &msg) { msg._len; };
+
+    layouts.emplace(message::rpc_id, MessageLayout{.size = message::wire_message_size, .dynamic_size = dynamic_size});
+  });
+
+  return layouts;
+}
+
+u16 read_u16(char const *data)
+{
+  u16 value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+void write_u16(char *data, u16 value)
+{
+  memcpy(data, &value, sizeof(value));
+}
+
+// |addr| in network byte order.
+u32 shift_ipv4_addr(u32 addr, u32 group)
+{
+  u32 const host = ntohl(addr);
+  if (host == INADDR_ANY || (host >> 24) == (INADDR_LOOPBACK >> 24)) {
+    return addr;
+  }
+  return htonl(host + (group << 16));
+}
+
+void shift_ipv4(char *message, std::size_t offset, u32 group)
+{
+  u32 addr;
+  memcpy(&addr, message + offset, sizeof(addr));
+  addr = shift_ipv4_addr(addr, group);
+  memcpy(message + offset, &addr, sizeof(addr));
+}
+
+void shift_ipv6(char *message, std::size_t offset, u32 group)
+{
+  in6_addr addr;
+  memcpy(&addr, message + offset, sizeof(addr));
+
+  if (IN6_IS_ADDR_UNSPECIFIED(&addr) || IN6_IS_ADDR_LOOPBACK(&addr)) {
+    return;
+  }
+
+  u32 part;
+  if (IN6_IS_ADDR_V4MAPPED(&addr)) {
+    memcpy(&part, &addr.s6_addr[12], sizeof(part));
+    part = shift_ipv4_addr(part, group);
+    memcpy(&addr.s6_addr[12], &part, sizeof(part));
+  } else {
+    memcpy(&part, &addr.s6_addr[8], sizeof(part));
+    part = htonl(ntohl(part) + group);
+    memcpy(&addr.s6_addr[8], &part, sizeof(part));
+  }
+
+  memcpy(message + offset, &addr, sizeof(addr));
+}
+
+// Appends |message| to |out| with |suffix| appended to one of its strings.
+//
+// Strings follow the fixed-size part of the message, those with a length
+// field in the order of their length fields, then the last string, which has
+// no length field and takes the rest of the message. |length_offsets| are
+// the offsets of the length fields, in order, and |index| is the position of
+// the string to change in that order, |length_offsets.size()| for the last.
+template <std::size_t N>
+void append_with_suffix(
+    std::string &out,
+    std::string_view message,
+    std::size_t fixed_size,
+    std::size_t len_offset,
+    std::array<std::size_t, N> const &length_offsets,
+    std::size_t index,
+    std::string_view suffix)
+{
+  std::size_t position = fixed_size;
+  for (std::size_t i = 0; i < index; ++i) {
+    position += read_u16(message.data() + length_offsets[i]);
+  }
+  std::size_t const end = index < N ? position + read_u16(message.data() + length_offsets[index]) : message.size();
+
+  std::size_t const new_len = message.size() - sizeof(u64) + suffix.size();
+  if (end > message.size() || new_len > 0xffff) {
+    out.append(message);
+    return;
+  }
+
+  std::size_t const start = out.size();
+  out.append(message.substr(0, end));
+  out.append(suffix);
+  out.append(message.substr(end));
+
+  char *const rewritten = out.data() + start;
+  if (index < N) {
+    write_u16(rewritten + length_offsets[index], read_u16(message.data() + length_offsets[index]) + suffix.size());
+  }
+  write_u16(rewritten + len_offset, new_len);
+}
+
+void append_connect(std::string &out, std::string_view message, std::string_view suffix)
+{
+  // the hostname is the only string, so it takes the rest of the message
+  append_with_suffix(
+      out,
+      message,
+      sizeof(u64) + ingest::connect_message_metadata::wire_message_size,
+      WIRE_OFFSET(connect, _len),
+      std::array<std::size_t, 0>{},
+      0,
+      suffix);
+}
+
+void append_set_node_info(std::string &out, std::string_view message, std::string_view suffix)
+{
+  // instance_type is the last string, the others have length fields
+  std::array<std::size_t, 3> length_offsets = {
+      WIRE_OFFSET(set_node_info, az), WIRE_OFFSET(set_node_info, role), WIRE_OFFSET(set_node_info, instance_id)};
+  std::sort(length_offsets.begin(), length_offsets.end());
+
+  std::size_t const index =
+      std::find(length_offsets.begin(), length_offsets.end(), WIRE_OFFSET(set_node_info, instance_id)) - length_offsets.begin();
+
+  append_with_suffix(
+      out,
+      message,
+      sizeof(u64) + ingest::set_node_info_message_metadata::wire_message_size,
+      WIRE_OFFSET(set_node_info, _len),
+      length_offsets,
+      index,
+      suffix);
+}
+
+} // namespace
+
+IngestRecording::IngestRecording(std::string data) : data_(std::move(data))
+{
+  static auto const layouts = make_message_layouts();
+
+  std::string_view const recording(data_);
+
+  for (std::size_t offset = 0; offset < recording.size();) {
+    std::string_view const remaining = recording.substr(offset);
+    if (remaining.size() < sizeof(u64) + 2 * sizeof(u16)) {
+      truncated_bytes_ = remaining.size();
+      break;
+    }
+
+    u16 const rpc_id = read_u16(remaining.data() + sizeof(u64));
+
+    auto const layout = layouts.find(rpc_id);
+    if (layout == layouts.end()) {
+      throw std::runtime_error(fmt::format("ingest recording: unknown rpc_id {} at offset {}", rpc_id, offset));
+    }
+
+    std::size_t length = layout->second.size;
+    if (layout->second.dynamic_size) {
+      length = read_u16(remaining.data() + sizeof(u64) + sizeof(u16));
+      if (length < layout->second.size) {
+        throw std::runtime_error(fmt::format("ingest recording: invalid length {} at offset {}", length, offset));
+      }
+    }
+
+    if (remaining.size() < sizeof(u64) + length) {
+      truncated_bytes_ = remaining.size();
+      break;
+    }
+
+    if (rpc_id == ingest::connect_message_metadata::rpc_id && !messages_.empty()) {
+      sessions_.push_back({.begin = sessions_.empty() ? 0 : sessions_.back().end, .end = messages_.size()});
+    }
+
+    u64 timestamp;
+    memcpy(&timestamp, remaining.data(), sizeof(timestamp));
+
+    messages_.push_back(
+        {.offset = offset, .size = static_cast<u32>(sizeof(u64) + length), .rpc_id = rpc_id, .timestamp = timestamp});
+    offset += sizeof(u64) + length;
+  }
+
+  if (!messages_.empty()) {
+    sessions_.push_back({.begin = sessions_.empty() ? 0 : sessions_.back().end, .end = messages_.size()});
+  }
+}
+
+IngestRecording IngestRecording::load(char const *path)
+{
+  return IngestRecording(*read_file_as_string(path).try_raise());
+}
+
+void rewrite_ingest_message(std::string &out, std::string_view message, u16 rpc_id, u64 timestamp, u32 group)
+{
+  std::size_t const start = out.size();
+
+  if (group == 0) {
+    out.append(message);
+  } else {
+    std::string const suffix = fmt::format("-replay{}", group);
+
+    switch (rpc_id) {
+    case ingest::connect_message_metadata::rpc_id:
+      append_connect(out, message, suffix);
+      break;
+    case ingest::set_node_info_message_metadata::rpc_id:
+      append_set_node_info(out, message, suffix);
+      break;
+    default:
+      out.append(message);
+      break;
+    }
+  }
+
+  char *const rewritten = out.data() + start;
+  memcpy(rewritten, &timestamp, sizeof(timestamp));
+
+  if (group == 0) {
+    return;
+  }
+
+  switch (rpc_id) {
+  case ingest::set_state_ipv4_message_metadata::rpc_id:
+    shift_ipv4(rewritten, WIRE_OFFSET(set_state_ipv4, src), group);
+    shift_ipv4(rewritten, WIRE_OFFSET(set_state_ipv4, dest), group);
+    break;
+  case ingest::set_state_ipv6_message_metadata::rpc_id:
+    shift_ipv6(rewritten, WIRE_OFFSET(set_state_ipv6, src), group);
+    shift_ipv6(rewritten, WIRE_OFFSET(set_state_ipv6, dest), group);
+    break;
+  case ingest::nat_remapping_message_metadata::rpc_id:
+    shift_ipv4(rewritten, WIRE_OFFSET(nat_remapping, src), group);
+    shift_ipv4(rewritten, WIRE_OFFSET(nat_remapping, dst), group);
+    break;
+  case ingest::private_ipv4_addr_message_metadata::rpc_id:
+    shift_ipv4(rewritten, WIRE_OFFSET(private_ipv4_addr, addr), group);
+    break;
+  case ingest::ipv6_addr_message_metadata::rpc_id:
+    shift_ipv6(rewritten, WIRE_OFFSET(ipv6_addr, addr), group);
+    break;
+  case ingest::public_to_private_ipv4_message_metadata::rpc_id:
+    shift_ipv4(rewritten, WIRE_OFFSET(public_to_private_ipv4, public_addr), group);
+    shift_ipv4(rewritten, WIRE_OFFSET(public_to_private_ipv4, private_addr), group);
+    break;
+  case ingest::udp_new_socket_message_metadata::rpc_id:
+    shift_ipv6(rewritten, WIRE_OFFSET(udp_new_socket, laddr), group);
+    break;
+  case ingest::udp_stats_addr_changed_v4_message_metadata::rpc_id:
+    shift_ipv4(rewritten, WIRE_OFFSET(udp_stats_addr_changed_v4, raddr), group);
+    break;
+  case ingest::udp_stats_addr_changed_v6_message_metadata::rpc_id:
+    shift_ipv6(rewritten, WIRE_OFFSET(udp_stats_addr_changed_v6, raddr), group);
+    break;
+  default:
+    break;
+  }
+}
+
+#undef WIRE_OFFSET
+
+} // namespace reducer
@@ -0,0 +1,82 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <platform/types.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace reducer {
+
+// Ingest messages recorded by a collector to the file named by the
+// EBPF_NET_RECORD_INTAKE_OUTPUT_PATH environment variable.
+//
+// The recording is the concatenation of the messages the collector sent
+// upstream, before compression, each starting at its timestamp:
+//    [ u64 timestamp + wire message ]
+// Messages carry no length prefix, so lengths come from the ingest message
+// metadata: fixed-size messages have a known size, and dynamic-size messages
+// carry their wire length in `_len`.
+class IngestRecording {
+public:
+  struct Message {
+    u64 offset;
+    u32 size;
+    u16 rpc_id;
+    u64 timestamp;
+  };
+
+  // Messages the collector sent on one connection, from a `connect` message up
+  // to the next one, as indexes into messages().
+  struct Session {
+    std::size_t begin;
+    std::size_t end;
+  };
+
+  // Splits |data| into messages and sessions.
+  //
+  // Throws if a message has an unknown rpc_id. A truncated last message, left
+  // by a collector that was stopped while writing it, is dropped.
+  explicit IngestRecording(std::string data);
+
+  // Reads the recording at |path|. Throws if it can't be read.
+  static IngestRecording load(char const *path);
+
+  std::vector<Message> const &messages() const { return messages_; }
+  std::vector<Session> const &sessions() const { return sessions_; }
+
+  // Bytes of the message, starting at its timestamp.
+  std::string_view message(Message const &message) const
+  {
+    return std::string_view(data_).substr(message.offset, message.size);
+  }
+
+  // Number of bytes dropped at the end of the recording.
+  std::size_t truncated_bytes() const { return truncated_bytes_; }
+
+private:
+  std::string data_;
+  std::vector<Message> messages_;
+  std::vector<Session> sessions_;
+  std::size_t truncated_bytes_ = 0;
+};
+
+// Appends |message|, as split by IngestRecording, to |out| with its timestamp
+// set to |timestamp| and, for |group| > 0, the identity of the collector moved to
+// synthetic node group |group|:
+//   * the hostname in `connect` and the instance id in `set_node_info` get a
+//     "-replay<group>" suffix
+//   * IPv4 addresses, and IPv4-mapped IPv6 ones, are shifted by |group| << 16,
+//     other IPv6 addresses by |group| in their ninth to twelfth byte; loopback
+//     and unspecified addresses are kept
+//
+// Addresses are shifted the same way in all recordings, so recordings taken
+// from collectors that talk to each other still do within each group.
+void rewrite_ingest_message(std::string &out, std::string_view message, u16 rpc_id, u64 timestamp, u32 group);
+
+} // namespace reducer
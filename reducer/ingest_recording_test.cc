@@ -0,0 +1,145 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <reducer/ingest_recording.h>
+
+#include <channel/buffered_writer.h>
+#include <channel/test_channel.h>
+#include <common/client_type.h>
+#include <util/json.h>
+#include <util/json_converter.h>
+
+#include <generated/ebpf_net/ingest/meta.h>
+#include <generated/ebpf_net/ingest/writer.h>
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+#include <arpa/inet.h>
+
+namespace reducer {
+
+namespace {
+
+constexpr u64 recorded_timestamp = 1000;
+
+jb_blob blob(std::string_view s)
+{
+  return jb_blob(s);
+}
+
+// Writes a recording of two connections of a kernel collector.
+std::string make_recording()
+{
+  channel::TestChannel channel;
+  channel::BufferedWriter buffer(channel, 4096);
+  ebpf_net::ingest::Writer writer(buffer, [] { return recorded_timestamp; });
+
+  for (int i = 0; i < 2; ++i) {
+    writer.connect(static_cast<u8>(ClientType::kernel), blob("node-a"));
+    writer.set_node_info(blob("us-east-1a"), blob("worker"), blob("i-0123"), blob("m5.large"));
+    writer.set_state_ipv4(inet_addr("10.1.2.3"), inet_addr("10.1.0.5"), 80, 40000, 0x1234, 1);
+    writer.set_state_ipv4(inet_addr("127.0.0.1"), inet_addr("0.0.0.0"), 80, 40001, 0x1235, 1);
+  }
+  buffer.flush();
+
+  std::string recording;
+  for (auto const &message : channel.get_binary_messages()) {
+    recording.append(message.begin(), message.end());
+  }
+  return recording;
+}
+
+nlohmann::json to_json(std::string_view data)
+{
+  std::stringstream ss;
+  json_converter::WireToJsonConverter<ebpf_net::ingest_metadata> converter(ss);
+  auto const handled = converter.process(data.data(), data.size());
+  EXPECT_TRUE(handled);
+  EXPECT_EQ(*handled, data.size());
+  return nlohmann::json::parse("[" + ss.str() + "]");
+}
+
+} // namespace
+
+TEST(IngestRecordingTest, SplitsMessagesAndSessions)
+{
+  std::string data = make_recording();
+  data.append("\x01\x02\x03", 3);
+
+  IngestRecording recording(std::move(data));
+
+  ASSERT_EQ(recording.messages().size(), 8u);
+  EXPECT_EQ(recording.truncated_bytes(), 3u);
+
+  ASSERT_EQ(recording.sessions().size(), 2u);
+  EXPECT_EQ(recording.sessions()[0].begin, 0u);
+  EXPECT_EQ(recording.sessions()[0].end, 4u);
+  EXPECT_EQ(recording.sessions()[1].begin, 4u);
+  EXPECT_EQ(recording.sessions()[1].end, 8u);
+
+  for (auto const &message : recording.messages()) {
+    EXPECT_EQ(message.timestamp, recorded_timestamp);
+  }
+  EXPECT_EQ(recording.messages()[0].rpc_id, ebpf_net::ingest::connect_message_metadata::rpc_id);
+  EXPECT_EQ(recording.messages()[4].rpc_id, ebpf_net::ingest::connect_message_metadata::rpc_id);
+}
+
+TEST(IngestRecordingTest, KeepsIdentityOfFirstGroup)
+{
+  IngestRecording recording(make_recording());
+
+  std::string out;
+  for (auto const &message : recording.messages()) {
+    rewrite_ingest_message(out, recording.message(message), message.rpc_id, 5000, 0);
+  }
+
+  auto const messages = to_json(out);
+  ASSERT_EQ(messages.size(), 8u);
+  EXPECT_EQ(messages[0]["timestamp"], 5000);
+  EXPECT_EQ(messages[0]["data"]["hostname"], "node-a");
+  EXPECT_EQ(messages[2]["data"]["dest"], inet_addr("10.1.2.3"));
+}
+
+TEST(IngestRecordingTest, RewritesIdentity)
+{
+  IngestRecording recording(make_recording());
+
+  std::string out;
+  for (auto const &message : recording.messages()) {
+    rewrite_ingest_message(out, recording.message(message), message.rpc_id, 5000, 3);
+  }
+
+  auto const messages = to_json(out);
+  ASSERT_EQ(messages.size(), 8u);
+
+  for (auto const &message : messages) {
+    EXPECT_EQ(message["timestamp"], 5000);
+  }
+
+  EXPECT_EQ(messages[0]["name"], "connect");
+  EXPECT_EQ(messages[0]["data"]["collector_type"], static_cast<u8>(ClientType::kernel));
+  EXPECT_EQ(messages[0]["data"]["hostname"], "node-a-replay3");
+
+  EXPECT_EQ(messages[1]["name"], "set_node_info");
+  EXPECT_EQ(messages[1]["data"]["az"], "us-east-1a");
+  EXPECT_EQ(messages[1]["data"]["role"], "worker");
+  EXPECT_EQ(messages[1]["data"]["instance_id"], "i-0123-replay3");
+  EXPECT_EQ(messages[1]["data"]["instance_type"], "m5.large");
+
+  EXPECT_EQ(messages[2]["name"], "set_state_ipv4");
+  EXPECT_EQ(messages[2]["data"]["dest"], inet_addr("10.4.2.3"));
+  EXPECT_EQ(messages[2]["data"]["src"], inet_addr("10.4.0.5"));
+  EXPECT_EQ(messages[2]["data"]["dport"], 80);
+  EXPECT_EQ(messages[2]["data"]["sk"], 0x1234);
+
+  // loopback and unspecified addresses are kept
+  EXPECT_EQ(messages[3]["data"]["dest"], inet_addr("127.0.0.1"));
+  EXPECT_EQ(messages[3]["data"]["src"], inet_addr("0.0.0.0"));
+
+  EXPECT_EQ(messages[4]["data"]["hostname"], "node-a-replay3");
+}
+
+} // namespace reducer
@@ -23,7 +23,7 @@ public:
 
   void write_metric(
       const EbpfNetMetricInfo &metric,
-      TsdbFormatter::labels_t labels,
+      TsdbFormatter::labels_t const &labels,
       TsdbFormatter::value_t value,
       TsdbFormatter::timestamp_t time_ns)
   {
@@ -40,7 +40,7 @@ public:
     formatter_->write(metric, value, writer_);
   }
 
-  void add_label(std::string name, std::string value) { formatter_->assign_label(name, value); }
+  void add_label(std::string_view name, std::string_view value) { formatter_->assign_label(name, value); }
 
   void remove_label(std::string_view name) { formatter_->remove_label(name); }
 
@@ -52,9 +52,9 @@ public:
   {
     clear_labels();
 
-    stats.labels.foreach_label([&](std::string_view name, std::string value) { add_label(std::string(name), value); });
+    stats.labels.foreach_label([&](std::string_view name, std::string_view value) { add_label(name, value); });
 
-    stats.metrics.foreach_metric([&](EbpfNetMetricInfo metric, std::variant<u32, u64, double> value) {
+    stats.metrics.foreach_metric([&](EbpfNetMetricInfo const &metric, std::variant<u32, u64, double> value) {
       if (!disabled_metrics_.is_metric_disabled(metric.metric)) {
         write_metric(metric, value, time_ns);
       }
@@ -67,7 +67,7 @@ namespace reducer {
 
 #define BEGIN_LABELS                                                                                                           \
   struct Labels {                                                                                                              \
-    using label_fn_t = std::function<void(std::string_view, std::string)>;                                                     \
+    using label_fn_t = std::function<void(std::string_view, std::string_view)>;                                                \
     void foreach_label(label_fn_t func) { __foreach_label(_FirstLabelType(), func, *this); }                                   \
     struct _FirstLabelType {                                                                                                   \
     };                                                                                                                         \
@@ -136,6 +136,19 @@ struct SpanUtilizationStats {
   METRIC(EbpfNetMetricInfo::span_utilization, utilization)
   METRIC(EbpfNetMetricInfo::span_utilization_fraction, utilization_fraction)
   METRIC(EbpfNetMetricInfo::span_utilization_max, utilization_max)
+  METRIC(EbpfNetMetricInfo::span_committed, committed)
+  METRIC(EbpfNetMetricInfo::span_soft_limit, soft_limit)
+  END_METRICS
+};
+
+struct SpanSoftLimitStats {
+  BEGIN_LABELS
+  COMMON_LABELS
+  LABEL(span)
+  END_LABELS
+
+  BEGIN_METRICS
+  METRIC(EbpfNetMetricInfo::span_soft_limit_exceeded, exceeded)
   END_METRICS
 };
 
@@ -394,6 +407,9 @@ struct PromStats {
   BEGIN_METRICS
   METRIC(EbpfNetMetricInfo::prometheus_bytes_ingested, bytes_ingested)
   METRIC(EbpfNetMetricInfo::prometheus_failed_scrapes, failed_scrapes)
+  METRIC(EbpfNetMetricInfo::prometheus_scrapes, scrapes)
+  METRIC(EbpfNetMetricInfo::prometheus_scrape_duration_ns, scrape_duration_ns)
+  METRIC(EbpfNetMetricInfo::prometheus_write_stall_ns, write_stall_ns)
   END_METRICS
 };
 
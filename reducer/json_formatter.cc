@@ -25,7 +25,7 @@ json_format_prefix(char *buf_ptr, size_t buf_size, std::string_view metric, std:
   return std::string_view(buf_ptr, std::min(len, buf_size));
 }
 
-std::string_view json_format_labels(char *buff_ptr, size_t buff_size, TsdbFormatter::labels_t const &labels)
+std::string_view json_format_labels(char *buff_ptr, size_t buff_size, TsdbFormatter::label_set_t const &labels)
 {
   size_t written = 0;
   auto write = [&written, buff_ptr, buff_size](void const *ptr, size_t len) {
@@ -49,8 +49,8 @@ std::string_view json_format_labels(char *buff_ptr, size_t buff_size, TsdbFormat
     write_str("\",");
   };
 
-  for (auto const &[name, value] : labels) {
-    write_label(name, value);
+  for (auto const &label : labels) {
+    write_label(label.name, label.value);
   }
 
   return std::string_view(buff_ptr, written);
@@ -81,7 +81,7 @@ void JsonTsdbFormatter::format(
     bool aggregation_changed,
     rollup_t rollup,
     bool rollup_changed,
-    labels_t labels,
+    label_set_t const &labels,
     bool labels_changed,
     timestamp_t timestamp,
     bool timestamp_changed,
@@ -0,0 +1,98 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include "label_set.h"
+
+#include <algorithm>
+
+namespace reducer {
+
+LabelSet::LabelSet(std::initializer_list<std::pair<std::string_view, std::string_view>> labels)
+{
+  for (auto const &[name, value] : labels) {
+    assign(name, value);
+  }
+}
+
+void LabelSet::assign(std::string_view name, std::string_view value)
+{
+  auto entry = lower_bound(name);
+  if (entry == entries_.end() || names_[entry->name_id].name != name) {
+    entry = entries_.insert(entry, Entry{.name_id = intern(name), .value_offset = 0, .value_size = 0});
+  }
+
+  /* reuse the old value's space when the new value fits */
+  if (value.size() > entry->value_size) {
+    entry->value_offset = values_.size();
+    values_.append(value);
+  } else {
+    values_.replace(entry->value_offset, value.size(), value);
+  }
+  entry->value_size = value.size();
+}
+
+void LabelSet::remove(std::string_view name)
+{
+  if (auto entry = lower_bound(name); entry != entries_.end() && names_[entry->name_id].name == name) {
+    entries_.erase(entry);
+  }
+}
+
+void LabelSet::clear()
+{
+  entries_.clear();
+  values_.clear();
+}
+
+bool LabelSet::contains(std::string_view name) const
+{
+  auto entry = lower_bound(name);
+  return entry != entries_.end() && names_[entry->name_id].name == name;
+}
+
+std::string_view LabelSet::get(std::string_view name) const
+{
+  if (auto entry = lower_bound(name); entry != entries_.end() && names_[entry->name_id].name == name) {
+    return label(*entry).value;
+  }
+  return {};
+}
+
+std::map<std::string, std::string> LabelSet::to_map() const
+{
+  std::map<std::string, std::string> out;
+  for (auto const &label : *this) {
+    out.emplace(label.name, label.value);
+  }
+  return out;
+}
+
+u32 LabelSet::intern(std::string_view name)
+{
+  if (auto found = name_ids_.find(name); found != name_ids_.end()) {
+    return found->second;
+  }
+
+  auto &interned = names_.emplace_back(Name{.name = std::string(name), .sanitized = std::string(name)});
+  std::replace(interned.sanitized.begin(), interned.sanitized.end(), '.', '_');
+
+  u32 const id = names_.size() - 1;
+  name_ids_.emplace(interned.name, id);
+  return id;
+}
+
+std::vector<LabelSet::Entry>::iterator LabelSet::lower_bound(std::string_view name)
+{
+  return std::lower_bound(entries_.begin(), entries_.end(), name, [this](Entry const &entry, std::string_view name) {
+    return names_[entry.name_id].name < name;
+  });
+}
+
+std::vector<LabelSet::Entry>::const_iterator LabelSet::lower_bound(std::string_view name) const
+{
+  return std::lower_bound(entries_.begin(), entries_.end(), name, [this](Entry const &entry, std::string_view name) {
+    return names_[entry.name_id].name < name;
+  });
+}
+
+} // namespace reducer
@@ -0,0 +1,129 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <platform/types.h>
+
+#include <absl/container/flat_hash_map.h>
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace reducer {
+
+// Set of time-series labels (name/value pairs), ordered by name.
+//
+// Label names are interned: the first time a name is seen, it is copied along
+// with its sanitized form (dots replaced by underscores, as Prometheus
+// requires). Values are copied into an arena that is reset by `clear()` but
+// keeps its capacity.
+//
+// Once every label name has been seen and the arena has grown to fit the
+// largest set of labels, assigning labels does not allocate.
+//
+class LabelSet {
+  struct Entry {
+    u32 name_id;
+    u32 value_offset;
+    u32 value_size;
+  };
+
+public:
+  struct Label {
+    std::string_view name;
+    // Name with dots replaced by underscores.
+    std::string_view sanitized_name;
+    std::string_view value;
+  };
+
+  class const_iterator {
+  public:
+    Label operator*() const { return set_->label(*entry_); }
+
+    const_iterator &operator++()
+    {
+      ++entry_;
+      return *this;
+    }
+
+    bool operator==(const_iterator const &rhs) const { return entry_ == rhs.entry_; }
+    bool operator!=(const_iterator const &rhs) const { return entry_ != rhs.entry_; }
+
+  private:
+    friend class LabelSet;
+
+    const_iterator(LabelSet const *set, std::vector<Entry>::const_iterator entry) : set_(set), entry_(entry) {}
+
+    LabelSet const *set_;
+    std::vector<Entry>::const_iterator entry_;
+  };
+
+  LabelSet() = default;
+  LabelSet(std::initializer_list<std::pair<std::string_view, std::string_view>> labels);
+
+  // Interned names are referred to by views, so only moving is allowed.
+  LabelSet(LabelSet const &) = delete;
+  LabelSet(LabelSet &&) = default;
+  LabelSet &operator=(LabelSet const &) = delete;
+  LabelSet &operator=(LabelSet &&) = default;
+
+  // Assigns `value` to the label `name`, adding the label if needed.
+  void assign(std::string_view name, std::string_view value);
+
+  // Removes the label `name`, if present.
+  void remove(std::string_view name);
+
+  // Removes all labels, keeping interned names and the arena's capacity.
+  void clear();
+
+  bool empty() const { return entries_.empty(); }
+  std::size_t size() const { return entries_.size(); }
+
+  bool contains(std::string_view name) const;
+
+  // Returns the value of label `name`, or an empty string if not present.
+  std::string_view get(std::string_view name) const;
+
+  const_iterator begin() const { return {this, entries_.begin()}; }
+  const_iterator end() const { return {this, entries_.end()}; }
+
+  // Copies the labels into a map, for tests and debugging.
+  std::map<std::string, std::string> to_map() const;
+
+private:
+  struct Name {
+    std::string name;
+    std::string sanitized;
+  };
+
+  Label label(Entry const &entry) const
+  {
+    auto const &name = names_[entry.name_id];
+    return {name.name, name.sanitized, std::string_view(values_).substr(entry.value_offset, entry.value_size)};
+  }
+
+  // Returns the id of interned `name`, interning it if needed.
+  u32 intern(std::string_view name);
+
+  // Returns the first entry whose name is not less than `name`.
+  std::vector<Entry>::iterator lower_bound(std::string_view name);
+  std::vector<Entry>::const_iterator lower_bound(std::string_view name) const;
+
+  // Interned names. A deque, so that views into names stay valid as it grows.
+  std::deque<Name> names_;
+  absl::flat_hash_map<std::string_view, u32> name_ids_;
+
+  // Labels, sorted by name.
+  std::vector<Entry> entries_;
+  // Arena holding label values.
+  std::string values_;
+};
+
+} // namespace reducer
@@ -0,0 +1,95 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <reducer/label_set.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+using reducer::LabelSet;
+
+TEST(label_set, sorted_by_name)
+{
+  LabelSet labels{{"workload", "b"}, {"az", "a"}, {"source.ip", "1.2.3.4"}};
+  labels.assign("dest.ip", "5.6.7.8");
+
+  std::vector<std::string> names;
+  for (auto const &label : labels) {
+    names.emplace_back(label.name);
+  }
+  EXPECT_EQ((std::vector<std::string>{"az", "dest.ip", "source.ip", "workload"}), names);
+  EXPECT_EQ(4u, labels.size());
+}
+
+TEST(label_set, sanitized_names)
+{
+  LabelSet labels{{"source.workload.name", "svc"}};
+
+  auto const label = *labels.begin();
+  EXPECT_EQ("source.workload.name", label.name);
+  EXPECT_EQ("source_workload_name", label.sanitized_name);
+  EXPECT_EQ("svc", label.value);
+}
+
+TEST(label_set, assign_get_remove)
+{
+  LabelSet labels;
+  EXPECT_TRUE(labels.empty());
+  EXPECT_EQ("", labels.get("missing"));
+
+  labels.assign("a", "short");
+  labels.assign("b", "value");
+  EXPECT_EQ("short", labels.get("a"));
+
+  /* shorter and longer values both overwrite the previous one */
+  labels.assign("a", "x");
+  EXPECT_EQ("x", labels.get("a"));
+  labels.assign("a", "a much longer value");
+  EXPECT_EQ("a much longer value", labels.get("a"));
+  EXPECT_EQ("value", labels.get("b"));
+  EXPECT_EQ(2u, labels.size());
+
+  labels.remove("a");
+  labels.remove("missing");
+  EXPECT_FALSE(labels.contains("a"));
+  EXPECT_TRUE(labels.contains("b"));
+  EXPECT_EQ((std::map<std::string, std::string>{{"b", "value"}}), labels.to_map());
+
+  labels.clear();
+  EXPECT_TRUE(labels.empty());
+  EXPECT_FALSE(labels.contains("b"));
+}
+
+TEST(label_set, empty_values)
+{
+  LabelSet labels{{"a", ""}, {"b", "x"}};
+  EXPECT_TRUE(labels.contains("a"));
+  EXPECT_EQ("", labels.get("a"));
+
+  labels.assign("b", "");
+  EXPECT_EQ((std::map<std::string, std::string>{{"a", ""}, {"b", ""}}), labels.to_map());
+}
+
+TEST(label_set, survives_move)
+{
+  LabelSet labels;
+  for (int i = 0; i < 100; ++i) {
+    labels.assign("label." + std::to_string(i), std::to_string(i * i));
+  }
+
+  LabelSet moved(std::move(labels));
+  EXPECT_EQ(100u, moved.size());
+  EXPECT_EQ("2500", moved.get("label.50"));
+  EXPECT_EQ("label_50", [&] {
+    for (auto const &label : moved) {
+      if (label.name == "label.50") {
+        return std::string(label.sanitized_name);
+      }
+    }
+    return std::string();
+  }());
+}
@@ -5,45 +5,77 @@
 
 #pragma once
 
-#include <util/tdigest.h>
+#include <reducer/latency_keys.h>
+#include <util/log_histogram.h>
 
-#include <absl/container/flat_hash_map.h>
-
-#include <queue>
-#include <string>
+#include <memory>
+#include <vector>
 
 namespace reducer {
 
-template <typename Key> class LatencyAccumulator {
+// Computes p90, p95, p99 and max latencies of each key over a sliding window
+// of |window_slots| time slots.
+//
+// Each key has a histogram of the latencies in the window: samples are added
+// to it as they come, and subtracted from it when their slot expires, so
+// computing the percentiles only looks at the keys that have samples in the
+// window, and each key takes a fixed amount of memory.
+template <typename Labels> class LatencyAccumulator {
 public:
   struct PLatencies {
-    Key key;
-    double p90, p95, p99;
+    u32 key;
+    double p90, p95, p99, max;
   };
 
-  LatencyAccumulator() : queue_max_size_(30), delta_ns_(10'000'000'000) {}
+  static constexpr u32 window_slots = 30;
+
+  LatencyAccumulator(LatencyKeys<Labels> &keys) : keys_(keys), delta_ns_(10'000'000'000), slots_(window_slots) {}
 
+  // Latencies of the keys that had samples in the window when it last rotated.
   const std::vector<PLatencies> &get_p_latencies() const { return latencies_; }
 
-  const absl::flat_hash_map<Key, double> &get_max_latencies() const { return max_latencies_; }
+  Labels const &labels(u32 key) const { return keys_.labels(key); }
 
-  void add(u64 t, Key key, double latency);
+  // Adds a |latency| sample, in milliseconds, for the labels |handle| refers to.
+  template <typename MakeLabels> void add(u64 t, LatencyKeyHandle &handle, MakeLabels &&make_labels, double latency);
 
 private:
+  struct Sample {
+    u32 key;
+    u32 bucket;
+  };
+
   struct QueueElem {
     u64 t = 0;
-    absl::flat_hash_map<Key, util::TDigest> digests;
-    absl::flat_hash_map<Key, double> max_latencies;
+    std::vector<Sample> samples;
+  };
+
+  struct KeyWindow {
+    util::LogHistogram histogram;
+    double max_latencies[window_slots] = {};
+    // position in active_keys_, if active
+    u32 active_pos = 0;
+    bool active = false;
   };
 
   void compute_latencies();
   void rotate_window(u64 t);
+  void expire(u32 slot);
+  KeyWindow &activate(u32 key);
+  void deactivate(u32 key);
 
-  const size_t queue_max_size_;
+  LatencyKeys<Labels> &keys_;
   const u64 delta_ns_;
-  std::deque<QueueElem> queue_;
+
+  // ring of time slots, the current one being |head_|
+  std::vector<QueueElem> slots_;
+  u32 head_ = 0;
+  u32 slot_count_ = 0;
+
+  // indexed by key; kept when a key is deactivated, for the next key that gets its id
+  std::vector<std::unique_ptr<KeyWindow>> windows_;
+  std::vector<u32> active_keys_;
   std::vector<PLatencies> latencies_;
-  absl::flat_hash_map<Key, double> max_latencies_;
 };
 
 } // namespace reducer
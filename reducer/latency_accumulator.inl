@@ -5,63 +5,136 @@
 
 #include "latency_accumulator.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
 namespace reducer {
 
-template <typename Key> void LatencyAccumulator<Key>::compute_latencies()
+namespace latency_accumulator_detail {
+
+// Latencies are bucketed in microseconds, so that sub-millisecond latencies
+// keep their precision.
+inline u32 bucket_of(double latency_ms)
 {
-  latencies_.clear();
-  max_latencies_.clear();
+  return util::LogHistogram::bucket_of(latency_ms > 0 ? static_cast<u64>(std::llround(latency_ms * 1000)) : 0);
+}
 
-  absl::flat_hash_map<Key, util::TDigest> digests;
+inline double estimate_ms(util::LogHistogram const &histogram, double q)
+{
+  return histogram.estimate_value_at_quantile(q) / 1000;
+}
 
-  for (const auto &t : queue_) {
-    for (const auto &[k, v] : t.digests) {
-      digests[k].merge(v);
-    }
-    for (const auto &[k, v] : t.max_latencies) {
-      if (max_latencies_[k] < v)
-        max_latencies_[k] = v;
-    }
-  }
+} // namespace latency_accumulator_detail
 
-  for (const auto &[k, v] : digests) {
+template <typename Labels> void LatencyAccumulator<Labels>::compute_latencies()
+{
+  using latency_accumulator_detail::estimate_ms;
+
+  latencies_.clear();
+
+  for (u32 key : active_keys_) {
+    auto const &window = *windows_[key];
+    double const max = *std::max_element(std::begin(window.max_latencies), std::end(window.max_latencies));
     latencies_.push_back(
-        {k, v.estimate_value_at_quantile(0.90), v.estimate_value_at_quantile(0.95), v.estimate_value_at_quantile(0.99)});
+        {key,
+         estimate_ms(window.histogram, 0.90),
+         estimate_ms(window.histogram, 0.95),
+         estimate_ms(window.histogram, 0.99),
+         max});
   }
 }
 
-template <typename Key> void LatencyAccumulator<Key>::rotate_window(u64 t)
+template <typename Labels> void LatencyAccumulator<Labels>::rotate_window(u64 t)
 {
-  if (queue_.empty()) {
-    queue_.push_back({});
-    queue_.back().t = t;
+  if (slot_count_ == 0) {
+    slot_count_ = 1;
+    slots_[head_].t = t;
     return;
   }
-  auto delta = t - queue_.back().t;
+  auto delta = t - slots_[head_].t;
   if (delta > delta_ns_) {
-    queue_.push_back({});
-    queue_.back().t = t;
-    if (queue_.size() > queue_max_size_) {
-      queue_.pop_front();
+    head_ = (head_ + 1) % window_slots;
+    if (slot_count_ == window_slots) {
+      expire(head_);
+    } else {
+      ++slot_count_;
     }
+    slots_[head_].t = t;
     compute_latencies();
   }
 }
 
-template <typename Key> void LatencyAccumulator<Key>::add(u64 t, Key key, double latency)
+template <typename Labels> void LatencyAccumulator<Labels>::expire(u32 slot)
 {
-  rotate_window(t);
+  auto &samples = slots_[slot].samples;
+
+  for (auto const &sample : samples) {
+    auto &window = *windows_[sample.key];
+    window.histogram.remove_from_bucket(sample.bucket);
+    window.max_latencies[slot] = 0;
+    if (window.histogram.empty()) {
+      deactivate(sample.key);
+    }
+  }
 
-  auto &digests = queue_.back().digests;
+  // keeps the capacity for the slot's next samples
+  samples.clear();
+}
+
+template <typename Labels> auto LatencyAccumulator<Labels>::activate(u32 key) -> KeyWindow &
+{
+  if (key >= windows_.size()) {
+    windows_.resize(keys_.capacity());
+  }
+  auto &window = windows_[key];
+  if (!window) {
+    window = std::make_unique<KeyWindow>();
+  }
+
+  if (!window->active) {
+    keys_.acquire(key);
+    window->active = true;
+    window->active_pos = active_keys_.size();
+    active_keys_.push_back(key);
+  }
+
+  return *window;
+}
+
+template <typename Labels> void LatencyAccumulator<Labels>::deactivate(u32 key)
+{
+  auto &window = *windows_[key];
+  assert(window.active);
+
+  // all of the key's samples have expired, so its histogram and maximums are back to zero
+  u32 const last = active_keys_.back();
+  active_keys_[window.active_pos] = last;
+  windows_[last]->active_pos = window.active_pos;
+  active_keys_.pop_back();
+  window.active = false;
+
+  keys_.release(key);
+}
+
+template <typename Labels>
+template <typename MakeLabels>
+void LatencyAccumulator<Labels>::add(u64 t, LatencyKeyHandle &handle, MakeLabels &&make_labels, double latency)
+{
+  // rotating can release keys, so it has to come before looking up the key
+  rotate_window(t);
 
-  util::TDigestAccumulator acc(digests[key]);
-  acc.add(latency); // millisec
-  acc.flush();
+  u32 const key = keys_.get(handle, std::forward<MakeLabels>(make_labels));
+  u32 const bucket = latency_accumulator_detail::bucket_of(latency);
 
-  auto &max_latencies = queue_.back().max_latencies;
+  auto &window = activate(key);
+  window.histogram.add_to_bucket(bucket);
+  slots_[head_].samples.push_back({key, bucket});
 
-  if (max_latencies[key] < latency) {
-    max_latencies[key] = latency;
+  if (window.max_latencies[head_] < latency) {
+    window.max_latencies[head_] = latency;
   }
 }
 
@@ -0,0 +1,102 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <reducer/latency_accumulator.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace reducer {
+namespace {
+
+constexpr u64 slot_ns = 10'000'001'000;
+
+auto labels(std::string name)
+{
+  return [name] { return name; };
+}
+
+TEST(latency_accumulator, percentiles_per_key)
+{
+  LatencyKeys<std::string> keys;
+  LatencyAccumulator<std::string> accumulator(keys);
+  LatencyKeyHandle a, b;
+
+  for (int i = 1; i <= 100; ++i) {
+    accumulator.add(0, a, labels("a"), i);
+    accumulator.add(0, b, labels("b"), i * 0.01);
+  }
+  EXPECT_TRUE(accumulator.get_p_latencies().empty());
+
+  // latencies are computed when the window rotates
+  accumulator.add(slot_ns, a, labels("a"), 1);
+  ASSERT_EQ(accumulator.get_p_latencies().size(), 2u);
+  EXPECT_EQ(keys.size(), 2u);
+
+  for (auto const &l : accumulator.get_p_latencies()) {
+    double const scale = accumulator.labels(l.key) == "a" ? 1 : 0.01;
+    EXPECT_NEAR(l.p90, 90 * scale, 90 * scale / 64);
+    EXPECT_NEAR(l.p95, 95 * scale, 95 * scale / 64);
+    EXPECT_NEAR(l.p99, 99 * scale, 99 * scale / 64);
+    EXPECT_EQ(l.max, 100 * scale);
+  }
+}
+
+TEST(latency_accumulator, samples_expire)
+{
+  LatencyKeys<std::string> keys;
+  LatencyAccumulator<std::string> accumulator(keys);
+  LatencyKeyHandle a, b;
+
+  accumulator.add(0, a, labels("a"), 500);
+  for (u64 slot = 1; slot <= LatencyAccumulator<std::string>::window_slots; ++slot) {
+    accumulator.add(slot * slot_ns, b, labels("b"), 5);
+  }
+
+  // the first slot has just expired, taking all of a's samples with it
+  ASSERT_EQ(accumulator.get_p_latencies().size(), 1u);
+  auto const &l = accumulator.get_p_latencies()[0];
+  EXPECT_EQ(accumulator.labels(l.key), "b");
+  EXPECT_NEAR(l.p99, 5, 5.0 / 64);
+  EXPECT_EQ(l.max, 5);
+
+  // a's key was freed, and its handle no longer refers to it
+  EXPECT_EQ(keys.size(), 1u);
+  u32 const old_a = a.id;
+  LatencyKeyHandle c;
+  accumulator.add(31 * slot_ns, c, labels("c"), 1);
+  EXPECT_EQ(c.id, old_a);
+  EXPECT_NE(c.generation, a.generation);
+
+  accumulator.add(31 * slot_ns, a, labels("a"), 2);
+  EXPECT_NE(a.id, c.id);
+  EXPECT_EQ(keys.labels(a.id), "a");
+  EXPECT_EQ(keys.labels(c.id), "c");
+}
+
+TEST(latency_accumulator, keys_are_shared)
+{
+  LatencyKeys<std::string> keys;
+  LatencyAccumulator<std::string> tcp(keys);
+  LatencyAccumulator<std::string> dns(keys);
+  LatencyKeyHandle a;
+
+  tcp.add(0, a, labels("a"), 1);
+  dns.add(0, a, labels("a"), 2);
+  EXPECT_EQ(keys.size(), 1u);
+
+  // the key stays while dns still has samples for it
+  for (u64 slot = 1; slot <= LatencyAccumulator<std::string>::window_slots; ++slot) {
+    tcp.add(slot * slot_ns, a, labels("a"), 1);
+  }
+  u32 const key = a.id;
+  for (u64 slot = 1; slot <= LatencyAccumulator<std::string>::window_slots; ++slot) {
+    dns.add(slot * slot_ns, a, labels("a"), 2);
+  }
+  EXPECT_EQ(a.id, key);
+  EXPECT_EQ(keys.size(), 1u);
+}
+
+} // namespace
+} // namespace reducer
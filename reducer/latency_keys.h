@@ -0,0 +1,103 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <platform/types.h>
+
+#include <absl/container/node_hash_map.h>
+
+#include <cassert>
+#include <limits>
+#include <vector>
+
+namespace reducer {
+
+// Caches the key of a span's labels in LatencyKeys, so that looking the key up
+// again does not need to build or hash the labels.
+struct LatencyKeyHandle {
+  u32 id = std::numeric_limits<u32>::max();
+  u32 generation = 0;
+};
+
+// Interns labels into small integer keys, shared by the latency accumulators
+// of an aggregation.
+//
+// Keys are reference counted by the accumulators that have samples for them,
+// and freed once none has. A freed key's id is reused for other labels, so
+// each id has a generation that is incremented when it is freed: a handle is
+// only valid while its generation matches.
+template <typename Labels> class LatencyKeys {
+public:
+  // Returns the key of the labels that |handle| is for, building them with
+  // |make_labels()| only if the handle is no longer valid.
+  // The key is only guaranteed to stay valid until the next call to release().
+  template <typename MakeLabels> u32 get(LatencyKeyHandle &handle, MakeLabels &&make_labels)
+  {
+    if (handle.id < entries_.size() && entries_[handle.id].generation == handle.generation &&
+        entries_[handle.id].labels != nullptr) {
+      return handle.id;
+    }
+
+    auto [it, inserted] = ids_.try_emplace(make_labels(), 0);
+    if (inserted) {
+      u32 id;
+      if (!free_ids_.empty()) {
+        id = free_ids_.back();
+        free_ids_.pop_back();
+      } else {
+        id = entries_.size();
+        entries_.emplace_back();
+      }
+      it->second = id;
+      entries_[id].labels = &it->first;
+    }
+
+    handle.id = it->second;
+    handle.generation = entries_[it->second].generation;
+    return it->second;
+  }
+
+  Labels const &labels(u32 id) const
+  {
+    assert(entries_[id].labels != nullptr);
+    return *entries_[id].labels;
+  }
+
+  void acquire(u32 id) { ++entries_[id].refs; }
+
+  void release(u32 id)
+  {
+    auto &entry = entries_[id];
+    assert(entry.refs > 0);
+
+    if (--entry.refs == 0) {
+      ids_.erase(*entry.labels);
+      entry.labels = nullptr;
+      ++entry.generation;
+      free_ids_.push_back(id);
+    }
+  }
+
+  // Number of keys currently interned.
+  std::size_t size() const { return ids_.size(); }
+
+  // Upper bound of the ids, e.g. to size tables indexed by key.
+  std::size_t capacity() const { return entries_.size(); }
+
+private:
+  struct Entry {
+    // points into ids_, which keeps its keys at a stable address
+    Labels const *labels = nullptr;
+    u32 refs = 0;
+    u32 generation = 0;
+  };
+
+  absl::node_hash_map<Labels, u32> ids_;
+  std::vector<Entry> entries_;
+  std::vector<u32> free_ids_;
+};
+
+} // namespace reducer
@@ -34,17 +34,63 @@ void CoreStatsSpan::span_utilization_stats(
   stats.metrics.utilization = std::size_t(msg->allocated);
   stats.metrics.utilization_fraction = (double)msg->allocated / msg->pool_size_;
   stats.metrics.utilization_max = std::size_t(msg->max_allocated);
+  stats.metrics.committed = std::size_t(msg->committed);
+  stats.metrics.soft_limit = std::size_t(msg->soft_limit);
 
   encoder.write_internal_stats(stats, msg->time_ns);
 
+  // only log when a pool crosses its soft limit, the metric counts how long it stays over
+  bool const over = msg->allocated > msg->soft_limit;
+  auto const key = fmt::format("{}/{}/{}", msg->module.string_view(), msg->shard, msg->span_name.string_view());
+  auto it = soft_limit_states_.find(key);
+  if (over && it == soft_limit_states_.end()) {
+    it = soft_limit_states_.emplace(key, SoftLimitState{}).first;
+  }
+
+  if (it != soft_limit_states_.end()) {
+    auto &state = it->second;
+    if (over && !state.over) {
+      LOG::warn(
+          "span pool went over its soft limit: module={} shard={} span_name={} allocated={} soft_limit={} hard_limit={}",
+          msg->module,
+          msg->shard,
+          msg->span_name,
+          msg->allocated,
+          msg->soft_limit,
+          msg->pool_size_);
+    } else if (!over && state.over) {
+      LOG::info(
+          "span pool back under its soft limit: module={} shard={} span_name={} allocated={} soft_limit={}",
+          msg->module,
+          msg->shard,
+          msg->span_name,
+          msg->allocated,
+          msg->soft_limit);
+    }
+    state.over = over;
+    if (over) {
+      ++state.intervals_over;
+    }
+
+    SpanSoftLimitStats soft_limit_stats;
+    soft_limit_stats.labels.span = msg->span_name;
+    soft_limit_stats.labels.module = msg->module;
+    soft_limit_stats.labels.shard = std::to_string(msg->shard);
+    soft_limit_stats.metrics.exceeded = state.intervals_over;
+    encoder.write_internal_stats(soft_limit_stats, msg->time_ns);
+  }
+
   LOG::debug_in(
       reducer::logging::Component::internal_metrics,
-      "CoreStatsSpan::span_utilization_stats: module={} span_name={} allocated={} max_allocated={} pool_size_={} timestamp={} ",
+      "CoreStatsSpan::span_utilization_stats: module={} span_name={} allocated={} max_allocated={} pool_size_={} committed={}"
+      " soft_limit={} timestamp={} ",
       msg->module,
       msg->span_name,
       msg->allocated,
       msg->max_allocated,
       msg->pool_size_,
+      msg->committed,
+      msg->soft_limit,
       msg->time_ns);
 }
 
@@ -5,6 +5,10 @@
 
 #include <generated/ebpf_net/logging/span_base.h>
 
+#include <absl/container/flat_hash_map.h>
+
+#include <string>
+
 namespace reducer::logging {
 
 class CoreStatsSpan : public ::ebpf_net::logging::CoreStatsSpanBase {
@@ -26,6 +30,18 @@ public:
       ::ebpf_net::logging::weak_refs::core_stats span_ref, u64 timestamp, jsrv_logging__rpc_write_utilization_stats *msg);
   void
   code_timing_stats(::ebpf_net::logging::weak_refs::core_stats span_ref, u64 timestamp, jsrv_logging__code_timing_stats *msg);
+
+private:
+  struct SoftLimitState {
+    // whether the pool was over its soft limit in the last stats interval
+    bool over = false;
+    // number of stats intervals in which the pool was over its soft limit
+    u64 intervals_over = 0;
+  };
+
+  // Span pools that went over their soft limit, keyed by module, shard and
+  // span name.
+  absl::flat_hash_map<std::string, SoftLimitState> soft_limit_states_;
 };
 
 }; // namespace reducer::logging
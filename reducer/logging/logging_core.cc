@@ -40,26 +40,39 @@ LoggingCore::LoggingCore(
     RpcQueueMatrix &matching_to_logging_queues,
     RpcQueueMatrix &aggregation_to_logging_queues,
     Publisher::WriterPtr stats_writer,
+    std::unique_ptr<Publisher> &metrics_publisher,
     const DisabledMetrics &disabled_metrics,
     size_t shard_num,
     u64 initial_timestamp)
     : CoreBase("logging", shard_num, initial_timestamp),
       stats_writer_(std::move(stats_writer)),
       encoder_(get_tsdb_format(), stats_writer_, disabled_metrics),
+      metrics_publisher_(metrics_publisher),
       ingest_to_logging_stats_(shard_num, "ingest", "logging"),
       matching_to_logging_stats_(shard_num, "matching", "logging"),
       aggregation_to_logging_stats_(shard_num, "aggregation", "logging"),
       logger_(index_.logger.alloc())
 {
   // ingest->this
-  add_rpc_clients(ingest_to_logging_queues.make_readers(shard_num), ClientType::ingest, ingest_to_logging_stats_);
+  add_rpc_clients(
+      ingest_to_logging_queues.make_readers(shard_num),
+      ClientType::ingest,
+      ingest_to_logging_stats_,
+      ingest_to_logging_queues.doorbell(shard_num));
 
   // matching->this
-  add_rpc_clients(matching_to_logging_queues.make_readers(shard_num), ClientType::matching, matching_to_logging_stats_);
+  add_rpc_clients(
+      matching_to_logging_queues.make_readers(shard_num),
+      ClientType::matching,
+      matching_to_logging_stats_,
+      matching_to_logging_queues.doorbell(shard_num));
 
   // aggregation->this
   add_rpc_clients(
-      aggregation_to_logging_queues.make_readers(shard_num), ClientType::aggregation, aggregation_to_logging_stats_);
+      aggregation_to_logging_queues.make_readers(shard_num),
+      ClientType::aggregation,
+      aggregation_to_logging_stats_,
+      aggregation_to_logging_queues.doorbell(shard_num));
 }
 
 void LoggingCore::write_internal_stats()
@@ -78,6 +91,10 @@ void LoggingCore::write_internal_stats()
 
   stats_writer_->write_internal_stats(encoder_, time_ns, shard, module);
 
+  if (metrics_publisher_) {
+    metrics_publisher_->write_internal_stats(encoder_, time_ns);
+  }
+
   encoder_.flush();
   stats_writer_->flush();
 
@@ -38,6 +38,7 @@ public:
       RpcQueueMatrix &matching_to_logging_queues,
       RpcQueueMatrix &aggregation_to_logging_queues,
       Publisher::WriterPtr stats_writer,
+      std::unique_ptr<Publisher> &metrics_publisher,
       const DisabledMetrics &disabled_metrics,
       size_t shard_num,
       u64 initial_timestamp);
@@ -54,6 +55,10 @@ public:
   static TsdbFormat get_tsdb_format();
 
 private:
+  // Publisher of the aggregation cores' metrics, whose stats are written with
+  // the internal stats. Can be null.
+  std::unique_ptr<Publisher> &metrics_publisher_;
+
   // Keeper of ingest->this RPC stats.
   RpcReceiverStats ingest_to_logging_stats_;
   // Keeper of matching->this RPC stats.
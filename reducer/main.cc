@@ -32,6 +32,37 @@ int main(int argc, char *argv[])
   args::Flag print_config(*parser, "print_config", "Print configuration values to stdout", {"print-config"});
   args::ValueFlag<u32> telemetry_port(
       *parser, "port", "TCP port to listen on for incoming connections from collectors", {'p', "port"});
+  args::ValueFlagList<std::string> zstd_dictionaries(
+      *parser,
+      "path",
+      "Zstandard dictionary used by collectors that compress with Zstandard, can be given more than once",
+      {"zstd-dictionary"});
+  args::ValueFlag<u32> zstd_window_log_max(
+      *parser,
+      "log2",
+      "Log2 of the largest Zstandard window collectors can use, the reducer keeps a window for each connection",
+      {"zstd-window-log-max"});
+  args::Flag enable_ingest_io_uring(
+      *parser,
+      "enable_ingest_io_uring",
+      "Accepts and reads connections from collectors with io_uring (Linux 6.0 or later), falling back to libuv",
+      {"enable-ingest-io-uring"});
+  args::Flag enable_ingest_reuseport(
+      *parser,
+      "enable_ingest_reuseport",
+      "Has each ingest shard accept connections from collectors on a SO_REUSEPORT socket of its own",
+      {"enable-ingest-reuseport"});
+  args::Flag enable_ingest_rebalancing(
+      *parser,
+      "enable_ingest_rebalancing",
+      "Balances connections from collectors across ingest shards by the bytes they receive, "
+      "requires --enable-ingest-reuseport",
+      {"enable-ingest-rebalancing"});
+  args::Flag enable_ingest_flow_control(
+      *parser,
+      "enable_ingest_flow_control",
+      "Grants credits to collectors, having them send less while the reducer falls behind",
+      {"enable-ingest-flow-control"});
   args::ValueFlag<std::string> metrics_tsdb_format_flag(
       *parser, "prometheus|json", "Format of TSDB data for scraped metrics", {"metrics-tsdb-format"}, "prometheus");
 
@@ -67,6 +98,22 @@ int main(int argc, char *argv[])
       *parser, "num_aggregation_shards", "How many aggregation shards to run.", {"num-aggregation-shards"});
   args::ValueFlag<u32> partitions_per_shard(
       *parser, "count", "How many partitions per aggregation shard to write metrics into.", {"partitions-per-shard"});
+  args::Flag enable_rpc_doorbells(
+      *parser,
+      "enable_rpc_doorbells",
+      "Wake up shards as soon as messages are sent to them, instead of polling for messages periodically.",
+      {"enable-rpc-doorbells"});
+  args::ValueFlag<double> span_pool_soft_limit_fraction(
+      *parser,
+      "fraction",
+      "Fraction, between 0 and 1, of each span type's compiled pool size above which to warn about memory pressure.",
+      {"span-pool-soft-limit-fraction"});
+  args::ValueFlag<double> span_pool_hard_limit_fraction(
+      *parser,
+      "fraction",
+      "Fraction, between 0 and 1, of each span type's compiled pool size that can be allocated. Limits can only shrink "
+      "pools, never grow them past their compiled size.",
+      {"span-pool-hard-limit-fraction"});
 
   // Prometheus output.
   //
@@ -91,6 +138,18 @@ int main(int argc, char *argv[])
   args::ValueFlag<u32> otlp_grpc_metrics_port(
       *parser, "otlp_grpc_metrics_port", "TCP port to send OTLP gRPC metrics", {"otlp-grpc-metrics-port"});
   args::ValueFlag<int> otlp_grpc_batch_size(*parser, "otlp_grpc_batch_size", "", {"otlp-grpc-batch-size"});
+  args::ValueFlag<u32> otlp_grpc_streams(
+      *parser,
+      "otlp_grpc_streams",
+      "Number of connections each aggregation shard spreads its OTLP gRPC metrics requests on",
+      {"otlp-grpc-streams"},
+      1);
+  args::ValueFlag<u64> otlp_grpc_max_in_flight_bytes(
+      *parser,
+      "otlp_grpc_max_in_flight_bytes",
+      "Bytes of OTLP gRPC metrics requests each aggregation shard can have in flight before dropping requests, 0 for no limit",
+      {"otlp-grpc-max-in-flight-bytes"},
+      0);
   args::Flag enable_otlp_grpc_metric_descriptions(
       *parser,
       "enable_otlp_grpc_metric_descriptions",
@@ -163,11 +222,20 @@ int main(int argc, char *argv[])
   }
 
   SET_CONFIG(config.telemetry_port, telemetry_port);
+  SET_CONFIG(config.zstd_dictionaries, zstd_dictionaries);
+  SET_CONFIG(config.zstd_window_log_max, zstd_window_log_max);
+  SET_CONFIG(config.enable_ingest_io_uring, enable_ingest_io_uring);
+  SET_CONFIG(config.enable_ingest_reuseport, enable_ingest_reuseport);
+  SET_CONFIG(config.enable_ingest_rebalancing, enable_ingest_rebalancing);
+  SET_CONFIG(config.enable_ingest_flow_control, enable_ingest_flow_control);
 
   SET_CONFIG(config.num_ingest_shards, num_ingest_shards);
   SET_CONFIG(config.num_matching_shards, num_matching_shards);
   SET_CONFIG(config.num_aggregation_shards, num_aggregation_shards);
   SET_CONFIG(config.partitions_per_shard, partitions_per_shard);
+  SET_CONFIG(config.enable_rpc_doorbells, enable_rpc_doorbells);
+  SET_CONFIG(config.span_pool_soft_limit_fraction, span_pool_soft_limit_fraction);
+  SET_CONFIG(config.span_pool_hard_limit_fraction, span_pool_hard_limit_fraction);
 
   SET_CONFIG(config.enable_id_id, enable_id_id);
   SET_CONFIG(config.enable_az_id, enable_az_id);
@@ -177,6 +245,8 @@ int main(int argc, char *argv[])
   SET_CONFIG(config.otlp_grpc_metrics_address, otlp_grpc_metrics_address);
   SET_CONFIG(config.otlp_grpc_metrics_port, otlp_grpc_metrics_port);
   SET_CONFIG(config.otlp_grpc_batch_size, otlp_grpc_batch_size);
+  SET_CONFIG(config.otlp_grpc_streams, otlp_grpc_streams);
+  SET_CONFIG(config.otlp_grpc_max_in_flight_bytes, otlp_grpc_max_in_flight_bytes);
   SET_CONFIG(config.enable_otlp_grpc_metric_descriptions, enable_otlp_grpc_metric_descriptions);
 
   SET_CONFIG(config.disable_prometheus_metrics, disable_prometheus_metrics);
@@ -219,6 +289,15 @@ int main(int argc, char *argv[])
     return 1;
   }
 
+  if (!(config.span_pool_hard_limit_fraction > 0 && config.span_pool_hard_limit_fraction <= 1) ||
+      !(config.span_pool_soft_limit_fraction >= 0 && config.span_pool_soft_limit_fraction <= 1)) {
+    LOG::critical(
+        "Span pool limit fractions must be between 0 and 1, and the hard limit above 0: soft={} hard={}",
+        config.span_pool_soft_limit_fraction,
+        config.span_pool_hard_limit_fraction);
+    return 1;
+  }
+
   if (auto val = std::getenv(GEOIP_PATH_VAR); (val != nullptr) && (strlen(val) > 0)) {
     config.geoip_path = val;
   }
@@ -79,7 +79,11 @@ MatchingCore::MatchingCore(
       core_stats_(index_.core_stats.alloc()),
       logger_(index_.logger.alloc())
 {
-  add_rpc_clients(ingest_to_matching_queues.make_readers(shard_num), ClientType::ingest, ingest_to_matching_stats_);
+  add_rpc_clients(
+      ingest_to_matching_queues.make_readers(shard_num),
+      ClientType::ingest,
+      ingest_to_matching_stats_,
+      ingest_to_matching_queues.doorbell(shard_num));
 }
 
 ebpf_net::matching::weak_refs::logger MatchingCore::logger()
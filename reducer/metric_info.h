@@ -5,6 +5,7 @@
 
 #include "outbound_metrics.h"
 
+#include <algorithm>
 #include <string>
 #include <string_view>
 
@@ -29,11 +30,21 @@ struct MetricInfo {
   const std::string unit;
   // Metric Type
   MetricType type;
+  // Name with dots replaced by underscores, as Prometheus requires (e.g. `tcp_bytes`).
+  const std::string prometheus_name;
 
   explicit MetricInfo(
       std::string_view name_, std::string_view description_ = "", std::string_view unit_ = "", MetricType type_ = MetricTypeSum)
-      : name(name_), description(description_), unit(unit_), type(type_)
+      : name(name_), description(description_), unit(unit_), type(type_), prometheus_name(sanitize(name_))
   {}
+
+private:
+  static std::string sanitize(std::string_view name)
+  {
+    std::string sanitized(name);
+    std::replace(sanitized.begin(), sanitized.end(), '.', '_');
+    return sanitized;
+  }
 };
 
 // Used for information on outbound metrics.
@@ -48,7 +48,7 @@ public:
   ~Writer();
 
   void write(ExportLogsServiceRequest &request) override;
-  void write(ExportMetricsServiceRequest &request) override;
+  void write(ExportMetricsServiceRequest &request, u64 num_data_points) override;
 
   // Writes provided stream's content.
   void write(std::stringstream &ss) override;
@@ -19,6 +19,7 @@
 
 #include <generated/ebpf_net/metrics.h>
 
+#include <algorithm>
 #include <ctime>
 #include <stdexcept>
 
@@ -26,6 +27,23 @@ int global_otlp_grpc_batch_size = 1000;
 
 namespace reducer {
 
+namespace {
+
+// Bounds the memory kept by each formatter between metrics requests.
+constexpr size_t max_metrics_arena_block_size = 64 * 1024 * 1024;
+
+template <typename T> T *create_in_arena(google::protobuf::Arena *arena)
+{
+#if GOOGLE_PROTOBUF_VERSION >= 5026000
+  return google::protobuf::Arena::Create<T>(arena);
+#else
+  // older versions' Arena::Create doesn't make the message allocate its fields in the arena
+  return google::protobuf::Arena::CreateMessage<T>(arena);
+#endif
+}
+
+} // namespace
+
 bool OtlpGrpcFormatter::metric_description_field_enabled_ = false;
 
 void OtlpGrpcFormatter::set_metric_description_field_enabled(bool enabled)
@@ -43,14 +61,7 @@ OtlpGrpcFormatter::OtlpGrpcFormatter(Publisher::WriterPtr const &writer) : write
   auto resource_logs = logs_request_.add_resource_logs();
   scope_logs_ = resource_logs->add_scope_logs();
 
-  auto resource_metrics = metrics_request_.add_resource_metrics();
-  scope_metrics_ = resource_metrics->add_scope_metrics();
-
-  sum_.set_aggregation_temporality(opentelemetry::proto::metrics::v1::AggregationTemporality::AGGREGATION_TEMPORALITY_DELTA);
-  sum_.set_is_monotonic(true);
-  sum_.add_data_points();
-
-  gauge_.add_data_points();
+  reset_metrics_request();
 }
 
 OtlpGrpcFormatter::~OtlpGrpcFormatter()
@@ -65,32 +76,31 @@ void OtlpGrpcFormatter::format(
     bool aggregation_changed,
     rollup_t rollup,
     bool rollup_changed,
-    labels_t labels,
+    label_set_t const &labels,
     bool labels_changed,
     timestamp_t timestamp,
     bool timestamp_changed,
     Publisher::WriterPtr const &unused_writer)
 {
   START_TIMING(OtlpGrpcFormatterFormatMetric);
-  opentelemetry::proto::metrics::v1::Metric metric;
 
 #if !NDEBUG
   // Determine if string contains anything besides ASCII printable characters
-  auto is_non_ascii = [](const std::string &str) {
+  auto is_non_ascii = [](std::string_view str) {
     return std::any_of(str.begin(), str.end(), [](char ch) {
       auto uch = static_cast<unsigned char>(ch);
       return uch < 32 || uch > 127;
     });
   };
 
-  auto print_ascii = [&](const std::string &str) { return is_non_ascii(str) ? "<ERROR_NON_ASCII>" : str; };
+  auto print_ascii = [&](std::string_view str) -> std::string_view { return is_non_ascii(str) ? "<ERROR_NON_ASCII>" : str; };
 
   DEBUG_ASSUME(!metric_info.name.empty()).else_log("empty metric name");
   bool found_non_ascii = false;
   found_non_ascii |= is_non_ascii(metric_info.name);
   found_non_ascii |= is_non_ascii(metric_info.unit);
   found_non_ascii |= is_non_ascii(metric_info.description);
-  for (auto const &[key, value] : labels) {
+  for (auto const &[key, sanitized_key, value] : labels) {
     if (key.empty()) {
       throw std::invalid_argument(fmt::format("empty label key for metric={}", metric_info.name));
     }
@@ -111,7 +121,7 @@ void OtlpGrpcFormatter::format(
     if (!labels.empty()) {
       metric_string += " labels:{";
       bool first_label = true;
-      for (auto const &[key, value] : labels) {
+      for (auto const &[key, sanitized_key, value] : labels) {
         if (!first_label) {
           metric_string += ",";
         }
@@ -124,44 +134,52 @@ void OtlpGrpcFormatter::format(
   }
 #endif
 
-  metric.set_name(metric_info.name.data(), metric_info.name.size());
-  metric.set_unit(metric_info.unit.data(), metric_info.unit.size());
-  if (metric_description_field_enabled()) {
-    metric.set_description(metric_info.description.data(), metric_info.description.size());
-  }
-
   if (labels_changed) {
     SCOPED_TIMING(OtlpGrpcFormatterFormatLabelsChanged);
-    data_point_.clear_attributes();
-    for (auto const &[key, value] : labels) {
-      auto attribute = data_point_.add_attributes();
-      attribute->set_key(key.data(), key.size());
-      attribute->mutable_value()->set_string_value(value.data(), value.size());
+    attributes_.Clear();
+    for (auto const &label : labels) {
+      auto attribute = attributes_.Add();
+      attribute->set_key(label.name.data(), label.name.size());
+      attribute->mutable_value()->set_string_value(label.value.data(), label.value.size());
     }
   }
 
   if (timestamp_changed) {
     // set the start time to the timestamp minus 30 seconds.
-    data_point_.set_start_time_unix_nano(integer_time<std::chrono::nanoseconds>(timestamp) - int64_t(30000000000));
-    data_point_.set_time_unix_nano(integer_time<std::chrono::nanoseconds>(timestamp));
+    time_unix_nano_ = integer_time<std::chrono::nanoseconds>(timestamp);
+    start_time_unix_nano_ = time_unix_nano_ - int64_t(30000000000);
   }
 
-  std::visit(
-      overloaded_visitor{
-          [&](auto val) { data_point_.set_as_int(val); },
-          [&](double val) { data_point_.set_as_double(val); },
-      },
-      metric_value);
+  // the metric is built in place, in the request's arena
+  auto metric = scope_metrics_->add_metrics();
+  metric->set_name(metric_info.name.data(), metric_info.name.size());
+  metric->set_unit(metric_info.unit.data(), metric_info.unit.size());
+  if (metric_description_field_enabled()) {
+    metric->set_description(metric_info.description.data(), metric_info.description.size());
+  }
 
+  opentelemetry::proto::metrics::v1::NumberDataPoint *data_point;
   if (metric_info.type == MetricTypeSum) {
-    *sum_.mutable_data_points(0) = data_point_;
-    *metric.mutable_sum() = sum_;
+    auto sum = metric->mutable_sum();
+    sum->set_aggregation_temporality(opentelemetry::proto::metrics::v1::AggregationTemporality::AGGREGATION_TEMPORALITY_DELTA);
+    sum->set_is_monotonic(true);
+    data_point = sum->add_data_points();
   } else {
-    *gauge_.mutable_data_points(0) = data_point_;
-    *metric.mutable_gauge() = gauge_;
+    data_point = metric->mutable_gauge()->add_data_points();
   }
 
-  *scope_metrics_->add_metrics() = std::move(metric);
+  *data_point->mutable_attributes() = attributes_;
+  data_point->set_start_time_unix_nano(start_time_unix_nano_);
+  data_point->set_time_unix_nano(time_unix_nano_);
+
+  std::visit(
+      overloaded_visitor{
+          [&](auto val) { data_point->set_as_int(val); },
+          [&](double val) { data_point->set_as_double(val); },
+      },
+      metric_value);
+
+  ++metrics_request_data_points_;
   STOP_TIMING(OtlpGrpcFormatterFormatMetric);
 
   if (scope_metrics_->metrics_size() >= global_otlp_grpc_batch_size) {
@@ -171,7 +189,7 @@ void OtlpGrpcFormatter::format(
 
 void OtlpGrpcFormatter::format_flow_log(
     ebpf_net::metrics::tcp_metrics const &tcp_metrics,
-    labels_t labels,
+    label_set_t const &labels,
     bool labels_changed,
     timestamp_t timestamp,
     bool timestamp_changed)
@@ -188,10 +206,10 @@ void OtlpGrpcFormatter::format_flow_log(
 
   auto message = fmt::format(
       "{} {} {} {} {} {} {} {} {} {} {} {} {}",
-      labels["source.ip"],
-      labels["source.workload.name"],
-      labels["dest.ip"],
-      labels["dest.workload.name"],
+      labels.get("source.ip"),
+      labels.get("source.workload.name"),
+      labels.get("dest.ip"),
+      labels.get("dest.workload.name"),
       tcp_metrics.sum_bytes,
       tcp_metrics.active_rtts,
       tcp_metrics.active_sockets,
@@ -250,13 +268,37 @@ void OtlpGrpcFormatter::send_metrics_request()
 
 #if DEBUG_OTLP_JSON_PRINT
   LOG::trace(
-      "JSON view of ExportMetricsServiceRequest being sent: {}", log_waive(otlp_client::get_request_json(metrics_request_)));
+      "JSON view of ExportMetricsServiceRequest being sent: {}", log_waive(otlp_client::get_request_json(*metrics_request_)));
 #endif
 
-  writer_->write(metrics_request_);
+  writer_->write(*metrics_request_, metrics_request_data_points_);
+
+  reset_metrics_request();
+}
+
+void OtlpGrpcFormatter::reset_metrics_request()
+{
+  if (metrics_arena_ &&
+      (metrics_arena_->SpaceAllocated() <= metrics_arena_block_size_ ||
+       metrics_arena_block_size_ == max_metrics_arena_block_size)) {
+    // the request fit in the first block, or that block can't grow anymore: Reset() keeps it
+    metrics_arena_->Reset();
+  } else {
+    // grow the first block to fit requests this large
+    size_t const space_allocated = metrics_arena_ ? metrics_arena_->SpaceAllocated() : 0;
+    metrics_arena_.reset();
+    metrics_arena_block_size_ = std::min(space_allocated, max_metrics_arena_block_size);
+    metrics_arena_block_.reset(metrics_arena_block_size_ ? new char[metrics_arena_block_size_] : nullptr);
+
+    google::protobuf::ArenaOptions options;
+    options.initial_block = metrics_arena_block_.get();
+    options.initial_block_size = metrics_arena_block_size_;
+    metrics_arena_.emplace(options);
+  }
 
-  // clear the metrics portion of metrics_request_, leaving the common portions to reuse
-  scope_metrics_->clear_metrics();
+  metrics_request_ = create_in_arena<ExportMetricsServiceRequest>(&*metrics_arena_);
+  scope_metrics_ = metrics_request_->add_resource_metrics()->add_scope_metrics();
+  metrics_request_data_points_ = 0;
 }
 
 } // namespace reducer
@@ -8,6 +8,11 @@
 #include "otlp_grpc_publisher.h"
 #include "tsdb_formatter.h"
 
+#include <google/protobuf/arena.h>
+
+#include <memory>
+#include <optional>
+
 extern int global_otlp_grpc_batch_size;
 
 namespace reducer {
@@ -40,7 +45,7 @@ protected:
       bool aggregation_changed,
       rollup_t rollup,
       bool rollup_changed,
-      labels_t labels,
+      label_set_t const &labels,
       bool labels_changed,
       timestamp_t timestamp,
       bool timestamp_changed,
@@ -49,7 +54,7 @@ protected:
   // Format tcp_metrics as a flow log.
   void format_flow_log(
       ebpf_net::metrics::tcp_metrics const &tcp_metrics,
-      labels_t labels,
+      label_set_t const &labels,
       bool labels_changed,
       timestamp_t timestamp,
       bool timestamp_changed) override;
@@ -57,18 +62,28 @@ protected:
   void send_logs_request();
   void send_metrics_request();
 
+  // Starts a new, empty metrics_request_, releasing the previous one's memory back to metrics_arena_.
+  void reset_metrics_request();
+
   // A single ExportLogsServiceRequest is used to send logs, batching multiple logs per request, and it is reused to
   // avoid regenerating common portions.
   ExportLogsServiceRequest logs_request_;
   opentelemetry::proto::logs::v1::ScopeLogs *scope_logs_;
 
-  // A single ExportMetricsServiceRequest is used to send metrics, batching multiple metrics per request, and it is reused to
-  // avoid regenerating common portions.
-  ExportMetricsServiceRequest metrics_request_;
-  opentelemetry::proto::metrics::v1::Sum sum_;
-  opentelemetry::proto::metrics::v1::Gauge gauge_;
-  opentelemetry::proto::metrics::v1::NumberDataPoint data_point_;
-  opentelemetry::proto::metrics::v1::ScopeMetrics *scope_metrics_;
+  // Metrics are batched in an ExportMetricsServiceRequest allocated in an arena, which is reset once the request is sent.
+  // The arena's first block is kept across requests, and grown to fit the largest request so far, so that building
+  // requests of a steady-state size doesn't allocate.
+  std::unique_ptr<char[]> metrics_arena_block_;
+  size_t metrics_arena_block_size_ = 0;
+  std::optional<google::protobuf::Arena> metrics_arena_;
+  ExportMetricsServiceRequest *metrics_request_ = nullptr;
+  opentelemetry::proto::metrics::v1::ScopeMetrics *scope_metrics_ = nullptr;
+  u64 metrics_request_data_points_ = 0;
+
+  // Attributes of the current labels, built when the labels change and copied to each of their data points.
+  google::protobuf::RepeatedPtrField<opentelemetry::proto::common::v1::KeyValue> attributes_;
+  u64 start_time_unix_nano_ = 0;
+  u64 time_unix_nano_ = 0;
 
   OtlpGrpcPublisher::WriterPtr const &writer_;
 };
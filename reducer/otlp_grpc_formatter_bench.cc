@@ -0,0 +1,198 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+// Measures OTLP gRPC metrics output. Flows carry the full set of FlowLabels, and each flow is written as the TCP metrics,
+// like TsdbEncoder does.
+//
+// The first pass measures how fast the formatter builds requests, and how many heap allocations it makes doing so, with a
+// publisher writer that only serializes requests, like gRPC does before sending them. The second pass sends the same
+// time-series to the local OTLP test server, spreading requests on the given number of streams.
+//
+// Usage: otlp_grpc_formatter_bench [n_flows] [n_streams] [batch_size]
+
+#include <otlp/otlp_test_server.h>
+#include <reducer/aggregation/labels.h>
+#include <reducer/metric_info.h>
+#include <reducer/otlp_grpc_formatter.h>
+#include <reducer/otlp_grpc_publisher.h>
+#include <reducer/tsdb_formatter.h>
+#include <util/stop_watch.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<u64> n_allocations = 0;
+
+constexpr u64 distinct_flows = 10'000;
+constexpr u64 metrics_per_flow = 9;
+constexpr auto server_timeout = std::chrono::seconds(60);
+
+class SerializingWriter : public reducer::Publisher::Writer {
+public:
+  void write(ExportMetricsServiceRequest &request, u64 num_data_points) override
+  {
+    request.SerializeToString(&buffer_);
+    bytes_ += buffer_.size();
+    data_points_ += num_data_points;
+    ++requests_;
+  }
+
+  void flush() override {}
+
+  u64 bytes_written() const override { return bytes_; }
+  u64 data_points() const { return data_points_; }
+  u64 requests() const { return requests_; }
+
+private:
+  std::string buffer_;
+  u64 bytes_ = 0;
+  u64 data_points_ = 0;
+  u64 requests_ = 0;
+};
+
+reducer::aggregation::NodeLabels make_node(u64 i, std::string_view side)
+{
+  reducer::aggregation::NodeLabels node;
+  node.id = "i-0" + std::to_string(0x1234567890ull + i);
+  node.ip = "10." + std::to_string((i >> 16) & 0xff) + "." + std::to_string((i >> 8) & 0xff) + "." + std::to_string(i & 0xff);
+  node.az = "us-west-2" + std::string(1, 'a' + i % 3);
+  node.role = std::string(side) + "-service-" + std::to_string(i % 50);
+  node.role_uid = "0f1e2d3c-4b5a-6978-8796-a5b4c3d2e1f0";
+  node.version = "v1." + std::to_string(i % 7);
+  node.env = "production";
+  node.ns = "namespace-" + std::to_string(i % 10);
+  node.type = "K8S_CONTAINER";
+  node.process = "java";
+  node.container = std::string(side) + "-container";
+  node.pod = node.role + "-7d9f8b6c5d-" + std::to_string(10000 + i % 90000);
+  return node;
+}
+
+void write_flow(
+    reducer::TsdbFormatter &formatter,
+    reducer::aggregation::FlowLabels const &flow,
+    u64 i,
+    reducer::Publisher::WriterPtr const &writer)
+{
+  using reducer::TcpMetricInfo;
+
+  formatter.set_labels(flow);
+  formatter.set_aggregation("az_az");
+
+  formatter.write(TcpMetricInfo::bytes, u64(i * 1500), writer);
+  formatter.write(TcpMetricInfo::rtt_num_measurements, u32(i % 100), writer);
+  formatter.write(TcpMetricInfo::active, u32(i % 10), writer);
+  formatter.write(TcpMetricInfo::rtt_average, double(i % 1000) / 10, writer);
+  formatter.write(TcpMetricInfo::packets, u64(i), writer);
+  formatter.write(TcpMetricInfo::retrans, u32(i % 3), writer);
+  formatter.write(TcpMetricInfo::syn_timeouts, u32(0), writer);
+  formatter.write(TcpMetricInfo::new_sockets, u32(i % 5), writer);
+  formatter.write(TcpMetricInfo::resets, u32(i % 2), writer);
+}
+
+void write_flows(
+    reducer::TsdbFormatter &formatter,
+    std::vector<reducer::aggregation::FlowLabels> const &flows,
+    u64 n_flows,
+    reducer::Publisher::WriterPtr const &writer)
+{
+  formatter.set_timestamp(std::chrono::nanoseconds(1'700'000'000'000'000'000));
+  for (u64 i = 0; i < n_flows; ++i) {
+    write_flow(formatter, flows[i % flows.size()], i, writer);
+  }
+  formatter.flush();
+}
+
+} // namespace
+
+void *operator new(std::size_t size)
+{
+  n_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+int main(int argc, char *argv[])
+{
+  u64 const n_flows = argc > 1 ? std::atoll(argv[1]) : 100'000;
+  u32 const n_streams = argc > 2 ? std::atoi(argv[2]) : 1;
+  global_otlp_grpc_batch_size = argc > 3 ? std::atoi(argv[3]) : 1000;
+
+  std::vector<reducer::aggregation::FlowLabels> flows(distinct_flows);
+  for (u64 i = 0; i < distinct_flows; ++i) {
+    flows[i].src = make_node(i, "client");
+    flows[i].dst = make_node(i * 7919 % distinct_flows, "server");
+  }
+
+  u64 const n_series = n_flows * metrics_per_flow;
+  u64 n_requests = 0;
+
+  {
+    auto serializing_writer = new SerializingWriter();
+    reducer::Publisher::WriterPtr writer(serializing_writer);
+    auto formatter = reducer::TsdbFormatter::make(reducer::TsdbFormat::otlp_grpc, writer);
+
+    /* the first pass interns label names and sizes the request arena */
+    write_flows(*formatter, flows, distinct_flows, writer);
+
+    u64 const requests_before = serializing_writer->requests();
+    u64 const allocations_before = n_allocations.load();
+    StopWatch<> watch;
+    write_flows(*formatter, flows, n_flows, writer);
+    double const ns = watch.elapsed_ns();
+    u64 const allocations = n_allocations.load() - allocations_before;
+    n_requests = serializing_writer->requests() - requests_before;
+
+    std::cout << "format and serialize: " << n_flows << " flows, " << n_series << " time-series, " << n_requests
+              << " requests" << std::endl;
+    std::cout << "  " << ns / n_series << " ns/series, " << n_series * 1e3 / ns << " Mseries/s" << std::endl;
+    std::cout << "  " << allocations << " allocations, " << double(allocations) / n_series << " allocations/series"
+              << std::endl;
+  }
+
+  std::string const server_address = "localhost:54329";
+  otlp_test_server::OtlpGrpcTestServer server(server_address, false);
+  server.start();
+
+  {
+    reducer::OtlpGrpcPublisher publisher(1, server_address, n_streams);
+    auto writer = publisher.make_writer(0);
+    auto formatter = reducer::TsdbFormatter::make(reducer::TsdbFormat::otlp_grpc, writer);
+
+    StopWatch<> watch;
+    write_flows(*formatter, flows, n_flows, writer);
+    while (server.get_num_metric_requests_received() < n_requests && !watch.elapsed(server_timeout)) {
+      writer->flush();
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    double const ns = watch.elapsed_ns();
+
+    std::cout << "send to the test server on " << n_streams << " stream(s): " << server.get_num_metric_requests_received()
+              << " of " << n_requests << " requests received" << std::endl;
+    std::cout << "  " << ns / n_series << " ns/series, " << n_series * 1e3 / ns << " Mseries/s, "
+              << writer->bytes_written() * 1e3 / ns << " MB/s" << std::endl;
+  }
+
+  server.stop();
+  return 0;
+}
@@ -19,8 +19,12 @@ namespace reducer {
 class TestPublisherWriter : public Publisher::Writer {
 public:
   TestPublisherWriter(
-      ExportLogsServiceRequest &logs_request_to_validate, ExportMetricsServiceRequest &metrics_request_to_validate)
-      : logs_request_to_validate_(logs_request_to_validate), metrics_request_to_validate_(metrics_request_to_validate){};
+      ExportLogsServiceRequest &logs_request_to_validate,
+      ExportMetricsServiceRequest &metrics_request_to_validate,
+      u64 &metrics_data_points_to_validate)
+      : logs_request_to_validate_(logs_request_to_validate),
+        metrics_request_to_validate_(metrics_request_to_validate),
+        metrics_data_points_to_validate_(metrics_data_points_to_validate){};
 
   TestPublisherWriter(TestPublisherWriter const &) = delete;
   TestPublisherWriter(TestPublisherWriter &&) = default;
@@ -28,13 +32,18 @@ public:
   ~TestPublisherWriter(){};
 
   void write(ExportLogsServiceRequest &request) override { logs_request_to_validate_ = request; };
-  void write(ExportMetricsServiceRequest &request) override { metrics_request_to_validate_ = request; };
+  void write(ExportMetricsServiceRequest &request, u64 num_data_points) override
+  {
+    metrics_request_to_validate_ = request;
+    metrics_data_points_to_validate_ = num_data_points;
+  };
 
   void flush() override{};
 
 private:
   ExportLogsServiceRequest &logs_request_to_validate_;
   ExportMetricsServiceRequest &metrics_request_to_validate_;
+  u64 &metrics_data_points_to_validate_;
 };
 
 class OtlpGrpcFormatterTest : public CommonTest {
@@ -43,7 +52,8 @@ protected:
   {
     CommonTest::SetUp();
 
-    writer_ = std::make_unique<TestPublisherWriter>(logs_request_to_validate_, metrics_request_to_validate_);
+    writer_ = std::make_unique<TestPublisherWriter>(
+        logs_request_to_validate_, metrics_request_to_validate_, metrics_data_points_to_validate_);
     formatter_ = TsdbFormatter::make(TsdbFormat::otlp_grpc, writer_);
   }
 
@@ -80,8 +90,8 @@ protected:
             EXPECT_EQ("INFO", log.at("severityText"));
             double sum_srtt = double(tcp_metrics.sum_srtt) / 8 / 1'000'000; // RTTs are measured in units of 1/8 microseconds.
             std::string log_message(
-                formatter_->labels_["source.ip"] + " " + formatter_->labels_["source.workload.name"] + " " +
-                formatter_->labels_["dest.ip"] + " " + formatter_->labels_["dest.workload.name"] + " " +
+                std::string(formatter_->labels_.get("source.ip")) + " " + std::string(formatter_->labels_.get("source.workload.name")) + " " +
+                std::string(formatter_->labels_.get("dest.ip")) + " " + std::string(formatter_->labels_.get("dest.workload.name")) + " " +
                 std::to_string(tcp_metrics.sum_bytes) + " " + std::to_string(tcp_metrics.active_rtts) + " " +
                 std::to_string(tcp_metrics.active_sockets) + " " +
                 fmt::format("{} ", tcp_metrics.active_rtts ? sum_srtt / tcp_metrics.active_rtts : 0.0) +
@@ -116,7 +126,7 @@ protected:
     auto request_json_str = get_request_json(metrics_request_to_validate_);
     LOG::trace("JSON view of ExportMetricsServiceRequest: {}", request_json_str);
 
-    auto labels_to_validate = formatter_->labels_;
+    auto labels_to_validate = formatter_->labels_.to_map();
 
     nlohmann::json request_json;
     try {
@@ -127,9 +137,11 @@ protected:
     }
 
     try {
+      u64 num_data_points = 0;
       for (auto const &rm : request_json.at("resourceMetrics")) {
         for (auto const &sm : rm.at("scopeMetrics")) {
           for (auto const &metric : sm.at("metrics")) {
+            ++num_data_points;
             EXPECT_EQ(name, metric.at("name"));
             auto const &sum = metric.at("sum");
             EXPECT_EQ("AGGREGATION_TEMPORALITY_DELTA", sum.at("aggregationTemporality"));
@@ -155,6 +167,7 @@ protected:
           }
         }
       }
+      EXPECT_EQ(num_data_points, metrics_data_points_to_validate_);
     } catch (std::exception &ex) {
       LOG::error("Exception during validation.  request_json={} ex.what()={}", log_waive(request_json.dump()), ex.what());
       FAIL();
@@ -165,6 +178,7 @@ protected:
   std::unique_ptr<Publisher::Writer> writer_;
   ExportLogsServiceRequest logs_request_to_validate_;
   ExportMetricsServiceRequest metrics_request_to_validate_;
+  u64 metrics_data_points_to_validate_ = 0;
 };
 
 TEST_F(OtlpGrpcFormatterTest, ValidateLogsRequest)
@@ -9,17 +9,22 @@
 #include <reducer/internal_stats.h>
 #include <util/time.h>
 
+#include <algorithm>
+
 namespace reducer {
 
-OtlpGrpcPublisher::OtlpGrpcPublisher(size_t num_writer_threads, const std::string &server_address_and_port)
-    : server_address_and_port_(server_address_and_port)
+OtlpGrpcPublisher::OtlpGrpcPublisher(
+    size_t num_writer_threads, const std::string &server_address_and_port, u32 num_metrics_streams, u64 max_in_flight_bytes)
+    : server_address_and_port_(server_address_and_port),
+      num_metrics_streams_(std::max<u32>(num_metrics_streams, 1)),
+      max_in_flight_bytes_(max_in_flight_bytes)
 {}
 
 OtlpGrpcPublisher::~OtlpGrpcPublisher() {}
 
 Publisher::WriterPtr OtlpGrpcPublisher::make_writer(size_t thread_num)
 {
-  return std::make_unique<Writer>(thread_num, server_address_and_port_);
+  return std::make_unique<Writer>(thread_num, server_address_and_port_, num_metrics_streams_, max_in_flight_bytes_);
 }
 
 void OtlpGrpcPublisher::write_internal_stats(InternalMetricsEncoder &encoder, u64 time_ns) const {}
@@ -28,12 +33,27 @@ void OtlpGrpcPublisher::write_internal_stats(InternalMetricsEncoder &encoder, u6
 // Writer
 //
 
-OtlpGrpcPublisher::Writer::Writer(size_t thread_num, std::string const &server_address_and_port)
+OtlpGrpcPublisher::Writer::Writer(
+    size_t thread_num, std::string const &server_address_and_port, u32 num_metrics_streams, u64 max_in_flight_bytes)
     : thread_num_(thread_num),
       server_address_and_port_(server_address_and_port),
-      logs_client_(grpc::CreateChannel(server_address_and_port, grpc::InsecureChannelCredentials())),
-      metrics_client_(grpc::CreateChannel(server_address_and_port, grpc::InsecureChannelCredentials()))
-{}
+      max_in_flight_bytes_(max_in_flight_bytes),
+      logs_client_(grpc::CreateChannel(server_address_and_port, grpc::InsecureChannelCredentials()))
+{
+  if (num_metrics_streams <= 1) {
+    metrics_clients_.push_back(
+        std::make_unique<MetricsClient>(grpc::CreateChannel(server_address_and_port, grpc::InsecureChannelCredentials())));
+    return;
+  }
+
+  // channels to the same target share their connection, unless each has its own subchannel pool
+  grpc::ChannelArguments args;
+  args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+  for (u32 i = 0; i < num_metrics_streams; ++i) {
+    metrics_clients_.push_back(std::make_unique<MetricsClient>(
+        grpc::CreateCustomChannel(server_address_and_port, grpc::InsecureChannelCredentials(), args)));
+  }
+}
 
 OtlpGrpcPublisher::Writer::~Writer() {}
 
@@ -42,15 +62,48 @@ void OtlpGrpcPublisher::Writer::write(ExportLogsServiceRequest &request)
   logs_client_.AsyncExport(request);
 }
 
-void OtlpGrpcPublisher::Writer::write(ExportMetricsServiceRequest &request)
+void OtlpGrpcPublisher::Writer::write(ExportMetricsServiceRequest &request, u64 num_data_points)
 {
-  metrics_client_.AsyncExport(request);
+  auto least_loaded = [this] {
+    return std::min_element(metrics_clients_.begin(), metrics_clients_.end(), [](auto const &lhs, auto const &rhs) {
+      return lhs->bytes_in_flight() < rhs->bytes_in_flight();
+    });
+  };
+
+  if (max_in_flight_bytes_ && sum_metrics_stat(&MetricsClient::bytes_in_flight) >= max_in_flight_bytes_) {
+    for (auto &client : metrics_clients_) {
+      client->process_async_responses();
+    }
+
+    if (auto const in_flight = sum_metrics_stat(&MetricsClient::bytes_in_flight); in_flight >= max_in_flight_bytes_) {
+      LOG::debug(
+          "metrics client: dropping request with {} data points, {} bytes in flight exceed the limit of {}",
+          num_data_points,
+          in_flight,
+          max_in_flight_bytes_);
+      (*least_loaded())->Drop(request, num_data_points);
+      return;
+    }
+  }
+
+  (*least_loaded())->AsyncExport(request, num_data_points);
 }
 
 void OtlpGrpcPublisher::Writer::flush()
 {
   logs_client_.process_async_responses();
-  metrics_client_.process_async_responses();
+  for (auto &client : metrics_clients_) {
+    client->process_async_responses();
+  }
+}
+
+u64 OtlpGrpcPublisher::Writer::sum_metrics_stat(u64 (MetricsClient::*stat)() const) const
+{
+  u64 sum = 0;
+  for (auto const &client : metrics_clients_) {
+    sum += ((*client).*stat)();
+  }
+  return sum;
 }
 
 void OtlpGrpcPublisher::Writer::write_internal_stats(
@@ -61,13 +114,13 @@ void OtlpGrpcPublisher::Writer::write_internal_stats(
   stats.labels.module = module;
 
   stats.labels.client_type = "metrics";
-  stats.metrics.bytes_failed = metrics_client_.bytes_failed();
-  stats.metrics.bytes_sent = metrics_client_.bytes_sent();
-  stats.metrics.metrics_failed = metrics_client_.data_points_failed();
-  stats.metrics.metrics_sent = metrics_client_.data_points_sent();
-  stats.metrics.requests_failed = metrics_client_.requests_failed();
-  stats.metrics.requests_sent = metrics_client_.requests_sent();
-  stats.metrics.unknown_response_tags = metrics_client_.unknown_response_tags();
+  stats.metrics.bytes_failed = sum_metrics_stat(&MetricsClient::bytes_failed);
+  stats.metrics.bytes_sent = sum_metrics_stat(&MetricsClient::bytes_sent);
+  stats.metrics.metrics_failed = sum_metrics_stat(&MetricsClient::data_points_failed);
+  stats.metrics.metrics_sent = sum_metrics_stat(&MetricsClient::data_points_sent);
+  stats.metrics.requests_failed = sum_metrics_stat(&MetricsClient::requests_failed);
+  stats.metrics.requests_sent = sum_metrics_stat(&MetricsClient::requests_sent);
+  stats.metrics.unknown_response_tags = sum_metrics_stat(&MetricsClient::unknown_response_tags);
   encoder.write_internal_stats(stats, time_ns);
 
   stats.labels.client_type = "logs";
@@ -91,13 +144,13 @@ void OtlpGrpcPublisher::Writer::write_internal_stats_to_logging_core(
       jb_blob(module),
       shard,
       jb_blob(std::string_view("metrics")),
-      metrics_client_.bytes_failed(),
-      metrics_client_.bytes_sent(),
-      metrics_client_.data_points_failed(),
-      metrics_client_.data_points_sent(),
-      metrics_client_.requests_failed(),
-      metrics_client_.requests_sent(),
-      metrics_client_.unknown_response_tags(),
+      sum_metrics_stat(&MetricsClient::bytes_failed),
+      sum_metrics_stat(&MetricsClient::bytes_sent),
+      sum_metrics_stat(&MetricsClient::data_points_failed),
+      sum_metrics_stat(&MetricsClient::data_points_sent),
+      sum_metrics_stat(&MetricsClient::requests_failed),
+      sum_metrics_stat(&MetricsClient::requests_sent),
+      sum_metrics_stat(&MetricsClient::unknown_response_tags),
       time_ns);
 
   agg_core_stats.agg_otlp_grpc_stats(
@@ -11,6 +11,7 @@
 
 #include <otlp/otlp_grpc_client.h>
 
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
@@ -34,8 +35,15 @@ public:
   //
   // \param num_writer_threads the number of threads that will be writing
   // \param server_address_and_port IP address and port of OTLP gRPC server
+  // \param num_metrics_streams number of connections each writer spreads its metrics requests on
+  // \param max_in_flight_bytes bytes of metrics requests each writer can have in flight before dropping requests,
+  //                            0 for no limit
   //
-  OtlpGrpcPublisher(size_t num_writer_threads, const std::string &server_address_and_port);
+  OtlpGrpcPublisher(
+      size_t num_writer_threads,
+      const std::string &server_address_and_port,
+      u32 num_metrics_streams = 1,
+      u64 max_in_flight_bytes = 0);
 
   virtual ~OtlpGrpcPublisher();
 
@@ -47,13 +55,15 @@ public:
 
 private:
   std::string server_address_and_port_;
+  u32 num_metrics_streams_;
+  u64 max_in_flight_bytes_;
 };
 
 // Writer for OtlpGrpcPublisher.
 //
 class OtlpGrpcPublisher::Writer : public Publisher::Writer {
 public:
-  Writer(size_t thread_num, std::string const &server_address_and_port);
+  Writer(size_t thread_num, std::string const &server_address_and_port, u32 num_metrics_streams, u64 max_in_flight_bytes);
 
   Writer(Writer const &) = delete;
   Writer(Writer &&) = default;
@@ -61,15 +71,15 @@ public:
   ~Writer();
 
   void write(ExportLogsServiceRequest &request) override;
-  void write(ExportMetricsServiceRequest &request) override;
+  void write(ExportMetricsServiceRequest &request, u64 num_data_points) override;
 
   // Note that there are no buffered metrics in this Writer to send when flush is called - OtlpGrpcFormatter::flush() deals with
   // buffered metrics that need to be sent - but this will process any outstanding async responses that have been received.
   void flush() override;
 
-  u64 bytes_written() const override { return metrics_client_.bytes_sent() - metrics_client_.bytes_failed(); }
+  u64 bytes_written() const override { return sum_metrics_stat(&MetricsClient::bytes_sent) - bytes_failed_to_write(); }
 
-  u64 bytes_failed_to_write() const override { return metrics_client_.bytes_failed(); }
+  u64 bytes_failed_to_write() const override { return sum_metrics_stat(&MetricsClient::bytes_failed); }
 
   void write_internal_stats(InternalMetricsEncoder &encoder, u64 time_ns, int shard, std::string_view module) const override;
 
@@ -80,10 +90,17 @@ public:
       std::string_view module) const override;
 
 private:
+  using MetricsClient = otlp_client::OtlpGrpcClient<MetricsService, ExportMetricsServiceRequest, ExportMetricsServiceResponse>;
+
+  // Sums a stat over all the metrics clients.
+  u64 sum_metrics_stat(u64 (MetricsClient::*stat)() const) const;
+
   size_t thread_num_;
   std::string server_address_and_port_;
+  u64 max_in_flight_bytes_;
   otlp_client::OtlpGrpcClient<LogsService, ExportLogsServiceRequest, ExportLogsServiceResponse> logs_client_;
-  otlp_client::OtlpGrpcClient<MetricsService, ExportMetricsServiceRequest, ExportMetricsServiceResponse> metrics_client_;
+  // One client per stream, each on its own connection.
+  std::vector<std::unique_ptr<MetricsClient>> metrics_clients_;
 };
 
 } // namespace reducer
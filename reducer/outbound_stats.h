@@ -62,6 +62,12 @@
   X(span_utilization_max,                0x0000'0020'0000'0000, INTERNAL_PREFIX "span_utilization_max") \
   X(time_since_last_message_ns,          0x0000'0040'0000'0000, INTERNAL_PREFIX "time_since_last_message_ns") \
   X(up,                                  0x0000'0080'0000'0000, INTERNAL_PREFIX "up") \
+  X(span_committed,                      0x0000'0100'0000'0000, INTERNAL_PREFIX "span_committed") \
+  X(span_soft_limit,                     0x0000'0200'0000'0000, INTERNAL_PREFIX "span_soft_limit") \
+  X(prometheus_scrapes,                  0x0000'0400'0000'0000, INTERNAL_PREFIX "prometheus.scrapes") \
+  X(prometheus_scrape_duration_ns,       0x0000'0800'0000'0000, INTERNAL_PREFIX "prometheus.scrape_duration_ns") \
+  X(prometheus_write_stall_ns,           0x0000'1000'0000'0000, INTERNAL_PREFIX "prometheus.write_stall_ns") \
+  X(span_soft_limit_exceeded,            0x0000'2000'0000'0000, INTERNAL_PREFIX "span_soft_limit_exceeded") \
   X(all,                                 0xFFFF'FFFF'FFFF'FFFF, INTERNAL_PREFIX "all")
 // clang-format on
 #define ENUM_DEFAULT unknown
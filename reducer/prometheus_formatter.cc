@@ -14,7 +14,7 @@
 namespace reducer {
 namespace {
 
-std::string_view prom_format_labels(char *buff_ptr, size_t buff_size, TsdbFormatter::labels_t const &labels)
+std::string_view prom_format_labels(char *buff_ptr, size_t buff_size, TsdbFormatter::label_set_t const &labels)
 {
   size_t written = 0;
   auto write = [&written, buff_ptr, buff_size](void const *ptr, size_t len) {
@@ -40,13 +40,8 @@ std::string_view prom_format_labels(char *buff_ptr, size_t buff_size, TsdbFormat
 
   write_str("{");
 
-  for (auto const &[name, value] : labels) {
-    std::string label_name_sanitized;
-    std::transform(name.begin(), name.end(), std::back_inserter(label_name_sanitized), [](unsigned char c) -> unsigned char {
-      return c == '.' ? '_' : c;
-    });
-
-    write_label(label_name_sanitized, value);
+  for (auto const &label : labels) {
+    write_label(label.sanitized_name, label.value);
   }
 
   write_str("}");
@@ -69,7 +64,7 @@ void PrometheusFormatter::format(
     bool aggregation_changed,
     rollup_t rollup,
     bool rollup_changed,
-    labels_t labels,
+    label_set_t const &labels,
     bool labels_changed,
     timestamp_t timestamp,
     bool timestamp_changed,
@@ -87,16 +82,10 @@ void PrometheusFormatter::format(
   auto suffix = std::visit(
       [&](auto &&val) -> std::string_view { return prom_format_suffix(suffix_buf_, sizeof(suffix_buf_), val, timestamp_str_); },
       value);
-
-  std::string metric_name_sanitized;
-  std::transform(
-      metric.name.begin(), metric.name.end(), std::back_inserter(metric_name_sanitized), [](unsigned char c) -> unsigned char {
-        return c == '.' ? '_' : c;
-      });
   STOP_TIMING(PrometheusFormatterFormat);
 
   SCOPED_TIMING(PrometheusFormatterFormatWriterWrite);
-  writer->write(metric_name_sanitized, labels_, suffix);
+  writer->write(metric.prometheus_name, labels_, suffix);
 }
 
 } // namespace reducer
@@ -25,7 +25,7 @@ protected:
       bool aggregation_changed,
       rollup_t rollup,
       bool rollup_changed,
-      labels_t labels,
+      label_set_t const &labels,
       bool labels_changed,
       timestamp_t timestamp,
       bool timestamp_changed,
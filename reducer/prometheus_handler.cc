@@ -3,9 +3,11 @@
 
 #include "prometheus_handler.h"
 
+#include <platform/userspace-time.h>
 #include <util/log.h>
 
 #include <charconv>
+#include <limits>
 #include <optional>
 #include <string>
 
@@ -13,50 +15,39 @@ namespace reducer {
 
 namespace {
 
-static constexpr size_t chunk_buffer_size = (1 << 20);
+static constexpr size_t chunk_size = (1 << 20);
 
 static constexpr char const *response_content_type = "text/plain;version=0.0.4";
 
 static const auto default_timeout = std::chrono::seconds(5);
 
-// Returns number of bytes read and an indication whether there is more
-// content in the queue to be read.
-std::pair<u32, bool> read_from_queue(ElementQueue &queue, char *buffer, u32 buffer_size)
+// Starts a chunked response whose content has |encoding| applied.
+bool send_response_header(mg_connection *conn, ContentEncoding encoding)
 {
-  u32 len = 0;
-  bool more = false;
-
-  queue.start_read_batch();
-
-  while ((more = (queue.peek() > 0)) == true) {
-    if ((len + queue.peek()) > buffer_size) {
-      break; /* we've filled the buffer */
-    }
-
-    char *elem_buf = nullptr;
-    int elem_len = queue.read(elem_buf);
-    assert(elem_len >= 0);
-
-    memcpy(buffer + len, elem_buf, elem_len);
-    len += elem_len;
+  std::string content_encoding;
+  if (auto coding = content_encoding_header(encoding); !coding.empty()) {
+    content_encoding = "Content-Encoding: " + std::string(coding) + "\r\n";
   }
 
-  queue.finish_read_batch();
-
-  return std::make_pair(len, more);
+  return mg_printf(
+             conn,
+             "HTTP/1.1 200 OK\r\n"
+             "Content-Type: %s\r\n"
+             "%s"
+             "Vary: Accept-Encoding\r\n"
+             "Cache-Control: no-cache, no-store, must-revalidate, private, max-age=0\r\n"
+             "Transfer-Encoding: chunked\r\n"
+             "\r\n",
+             response_content_type,
+             content_encoding.c_str()) > 0;
 }
 
 } // namespace
 
 PrometheusHandler::PrometheusHandler(
-    std::vector<ElementQueueStoragePtr> const &queues, std::optional<u64> scrape_size_limit_bytes)
-    : queue_mutex_(queues.size()), scrape_size_limit_bytes_(scrape_size_limit_bytes)
-{
-  queues_.reserve(queues.size());
-  for (auto &queue_storage : queues) {
-    queues_.emplace_back(queue_storage);
-  }
-}
+    std::vector<std::shared_ptr<PrometheusSnapshotSlot>> const &slots, std::optional<u64> scrape_size_limit_bytes)
+    : slots_(slots), scrape_size_limit_bytes_(scrape_size_limit_bytes)
+{}
 
 std::optional<PrometheusHandler::timeout_t> PrometheusHandler::get_scrape_timeout(CivetServer *server, mg_connection *conn)
 {
@@ -79,124 +70,34 @@ std::optional<PrometheusHandler::timeout_t> PrometheusHandler::get_scrape_timeou
 
 void PrometheusHandler::write_content_from_queues(CivetServer *server, mg_connection *conn)
 {
-  // max duration of the request
-  timeout_t timeout = default_timeout;
+  std::vector<PrometheusSnapshotPtr> snapshots;
+  snapshots.reserve(slots_.size());
 
-  if (auto scrape_timeout = get_scrape_timeout(server, conn); scrape_timeout) {
-    timeout = *scrape_timeout;
-
-    // leave some time for network
-    //
-    if (timeout > 1s) {
-      // trim half a second
-      timeout -= 500ms;
-    } else {
-      // halve the value
-      timeout /= 2;
+  size_t const first = next_queue_.fetch_add(1, std::memory_order_relaxed) % slots_.size();
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    if (auto snapshot = slots_[(first + i) % slots_.size()]->load()) {
+      snapshots.push_back(std::move(snapshot));
     }
   }
 
-  // absolute time at which to finish sending
-  u64 timeout_ns = monotonic() + std::chrono::nanoseconds(timeout).count();
-
-  char chunk_buffer[chunk_buffer_size];
-  u32 chunk_len = 0;
-  u64 bytes_sent = 0;
-  bool error = false;
-
-  auto send_chunk = [&]() {
-    if (auto nsent = mg_send_chunk(conn, chunk_buffer, chunk_len); nsent > 0) {
-      bytes_sent += nsent;
-      chunk_len = 0;
-    } else {
-      error = true;
-    }
-  };
-
-  std::lock_guard<std::mutex> lock(handler_mutex_);
-
-  // start the response
-  if (mg_send_http_ok(conn, response_content_type, -1) == -1) {
-    ++num_failed_scrapes_;
-    return;
-  }
-
-  u64 scrape_limit = scrape_size_limit_bytes_.value_or(std::numeric_limits<u64>::max());
-
-  // This will get set when a read from a queue can't be performed because
-  // the scrape size limit would be exceeded. In that case we will complete
-  // the request even if a read some other queue would succeed.
-  bool scrape_size_limited = false;
-
-  for (size_t i = 0; i < queues_.size(); ++i) {
-    if (error) {
-      break;
-    }
-
-    if (monotonic() >= timeout_ns) {
-      break;
-    }
-
-    if (scrape_size_limited) {
-      break;
-    }
-
-    if (bytes_sent >= scrape_limit) {
-      break;
-    }
-
-    auto &queue = queues_[next_queue_];
-    next_queue_ = (next_queue_ + 1) % queues_.size();
-
-    bool more;
-    u32 repeat = 0;
-    do {
-      u64 scrape_remaining = scrape_limit - bytes_sent;
-      u64 chunk_remaining = chunk_buffer_size - chunk_len;
-
-      u32 nread;
-      std::tie(nread, more) = read_from_queue(queue, chunk_buffer + chunk_len, std::min(chunk_remaining, scrape_remaining));
-
-      if (nread > 0) {
-        // something was read and added to the chunk buffer
-        chunk_len += nread;
-      }
-
-      if (more) {
-        if (chunk_remaining < scrape_remaining) {
-          // There was more to read but didn't fit in the chunk buffer.
-          // We will flush the chunk buffer and try again.
-          send_chunk();
-        } else {
-          // There was more to read but it would go over the scrape size limit.
-          // Setting this flag will conclude this request.
-          scrape_size_limited = true;
-          break;
-        }
-      }
-
-      // If there is more to read it is because there was not enough space in
-      // the chunk buffer. We will repeat the read -- only once, otherwise we
-      // can get into a race with the producer.
-    } while (more && !error && (bytes_sent < scrape_limit) && (repeat++ < 2));
-  }
+  write_snapshots(server, conn, snapshots);
+}
 
-  if (!error && (chunk_len > 0)) {
-    // send what is left to send
-    send_chunk();
+void PrometheusHandler::write_content_from_queue(CivetServer *server, mg_connection *conn, size_t queue_num)
+{
+  std::vector<PrometheusSnapshotPtr> snapshots;
+  if (auto snapshot = slots_[queue_num]->load()) {
+    snapshots.push_back(std::move(snapshot));
   }
 
-  // terminating chunk
-  mg_send_chunk(conn, nullptr, 0);
-
-  bytes_served_ += bytes_sent;
-  if (error) {
-    ++num_failed_scrapes_;
-  }
+  write_snapshots(server, conn, snapshots);
 }
 
-void PrometheusHandler::write_content_from_queue(CivetServer *server, mg_connection *conn, size_t queue_num)
+void PrometheusHandler::write_snapshots(
+    CivetServer *server, mg_connection *conn, std::vector<PrometheusSnapshotPtr> const &snapshots)
 {
+  u64 const start_ns = monotonic();
+
   // max duration of the request
   timeout_t timeout = default_timeout;
 
@@ -215,79 +116,108 @@ void PrometheusHandler::write_content_from_queue(CivetServer *server, mg_connect
   }
 
   // absolute time at which to finish sending
-  u64 timeout_ns = monotonic() + std::chrono::nanoseconds(timeout).count();
-
-  char chunk_buffer[chunk_buffer_size];
-  u64 bytes_sent = 0;
-  bool error = false;
+  u64 timeout_ns = start_ns + std::chrono::nanoseconds(timeout).count();
 
-  std::lock_guard<std::mutex> lock(queue_mutex_[queue_num]);
-
-  auto &queue = queues_[queue_num];
+  u64 scrape_limit = scrape_size_limit_bytes_.value_or(std::numeric_limits<u64>::max());
 
-  // start the response
-  if (mg_send_http_ok(conn, response_content_type, -1) == -1) {
-    ++num_failed_scrapes_;
-    return;
+  // An empty body is not a valid compressed stream, so responses without any
+  // snapshot to send are not compressed.
+  ContentEncoding encoding = ContentEncoding::identity;
+  if (char const *hdr = server->getHeader(conn, "Accept-Encoding"); hdr != nullptr && !snapshots.empty()) {
+    encoding = negotiate_content_encoding(hdr);
   }
 
-  while (monotonic() < timeout_ns) {
-    u64 read_size = chunk_buffer_size;
-
-    if (scrape_size_limit_bytes_.has_value()) {
-      // Limit this read so the total number of bytes returned doesn't go
-      // over the scrape limit.
-      if (*scrape_size_limit_bytes_ > bytes_sent) {
-        read_size = std::min(chunk_buffer_size, *scrape_size_limit_bytes_ - bytes_sent);
-      } else {
-        // Already went over the limit. This can happen because mg_send_chunk
-        // is writing additional data (chunk headers, etc.)
+  // Compressed content cannot be cut short without making the whole response
+  // undecodable, so compressed snapshots are only sent whole, as many as fit
+  // within the scrape size limit. They are compressed before the header is
+  // sent, stopping at the first one that does not fit, so that the response
+  // can still be sent uncompressed if the first one does not fit or any of
+  // them fails to compress.
+  std::size_t num_snapshots = snapshots.size();
+  if (encoding != ContentEncoding::identity) {
+    u64 encoded_bytes = 0;
+    for (num_snapshots = 0; num_snapshots < snapshots.size(); ++num_snapshots) {
+      auto const &snapshot = snapshots[num_snapshots];
+      if (!snapshot->can_encode(encoding)) {
+        encoding = ContentEncoding::identity;
+        break;
+      }
+      auto const size = snapshot->content(encoding).size();
+      if (size > scrape_limit - encoded_bytes) {
         break;
       }
+      encoded_bytes += size;
     }
 
-    auto [nread, more] = read_from_queue(queue, chunk_buffer, read_size);
+    if (encoding == ContentEncoding::identity || num_snapshots == 0) {
+      encoding = ContentEncoding::identity;
+      num_snapshots = snapshots.size();
+    }
+  }
+
+  u64 bytes_sent = 0;
+  bool error = false;
+
+  // start the response
+  if (!send_response_header(conn, encoding)) {
+    error = true;
+  }
 
-    if (nread == 0) {
-      // nothing more to read from the queue
-      // assert(!more)
+  // Snapshots are sent as long as they fit within the scrape size limit and
+  // the scrape timeout. Uncompressed content that does not fit is cut after its
+  // last line that fits.
+  for (std::size_t i = 0; i < num_snapshots; ++i) {
+    if (error || (monotonic() >= timeout_ns) || (bytes_sent >= scrape_limit)) {
       break;
     }
 
-    // NOTE: mg_send_chunk doesn't do partial writes
-    auto nsent = mg_send_chunk(conn, chunk_buffer, nread);
+    // compressed content was computed above
+    std::string_view content = snapshots[i]->content(encoding);
 
-    if (nsent > 0) {
-      bytes_sent += nsent;
-    } else {
-      // zero signifies connection closed -- we count that also as failed write
-      error = true;
-      break;
+    bool scrape_size_limited = false;
+    if (content.size() > scrape_limit - bytes_sent) {
+      scrape_size_limited = true;
+      auto const last_line_end = content.substr(0, scrape_limit - bytes_sent).rfind('\n');
+      content = content.substr(0, last_line_end == std::string_view::npos ? 0 : last_line_end + 1);
+    }
+
+    // NOTE: mg_send_chunk doesn't do partial writes
+    while (!content.empty()) {
+      auto const chunk = content.substr(0, chunk_size);
+      if (mg_send_chunk(conn, chunk.data(), chunk.size()) <= 0) {
+        // zero signifies connection closed -- we count that also as failed write
+        error = true;
+        break;
+      }
+      bytes_sent += chunk.size();
+      content.remove_prefix(chunk.size());
     }
 
-    if (!more) {
-      // Exhausted the queue. We don't want to try to read again as that can get
-      // us into a race with the producer.
+    if (scrape_size_limited) {
       break;
     }
   }
 
-  // terminating chunk
-  mg_send_chunk(conn, nullptr, 0);
+  if (!error) {
+    // terminating chunk
+    mg_send_chunk(conn, nullptr, 0);
+  }
 
   bytes_served_ += bytes_sent;
   if (error) {
     ++num_failed_scrapes_;
   }
+  ++num_scrapes_;
+  scrape_duration_ns_ += monotonic() - start_ns;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 PortRangePromHandler::PortRangePromHandler(
-    std::vector<ElementQueueStoragePtr> const &queues,
+    std::vector<std::shared_ptr<PrometheusSnapshotSlot>> const &slots,
     std::optional<u64> scrape_size_limit_bytes,
     std::optional<u16> extra_ports_base)
-    : PrometheusHandler(queues, scrape_size_limit_bytes), extra_ports_base_(extra_ports_base)
+    : PrometheusHandler(slots, scrape_size_limit_bytes), extra_ports_base_(extra_ports_base)
 {}
 
 int PortRangePromHandler::choose_queue(CivetServer *server, mg_connection *conn)
@@ -390,8 +320,8 @@ bool PortRangePromHandler::handleGet(CivetServer *server, mg_connection *conn)
 ////////////////////////////////////////////////////////////////////////////////
 
 SinglePortPromHandler::SinglePortPromHandler(
-    std::vector<ElementQueueStoragePtr> const &queues, std::optional<u64> scrape_size_limit_bytes)
-    : PrometheusHandler(queues, scrape_size_limit_bytes)
+    std::vector<std::shared_ptr<PrometheusSnapshotSlot>> const &slots, std::optional<u64> scrape_size_limit_bytes)
+    : PrometheusHandler(slots, scrape_size_limit_bytes)
 {}
 
 bool SinglePortPromHandler::handleGet(CivetServer *server, mg_connection *conn)
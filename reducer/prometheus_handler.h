@@ -5,20 +5,22 @@
 
 #pragma once
 
-#include <util/element_queue_cpp.h>
+#include "prometheus_snapshot.h"
 
 #include <CivetServer.h>
 
 #include <atomic>
 #include <chrono>
-#include <mutex>
+#include <memory>
 #include <optional>
+#include <vector>
 
 namespace reducer {
 
 class PrometheusHandler : public CivetHandler {
 public:
-  PrometheusHandler(std::vector<ElementQueueStoragePtr> const &queues, std::optional<u64> scrape_size_limit_bytes);
+  PrometheusHandler(
+      std::vector<std::shared_ptr<PrometheusSnapshotSlot>> const &slots, std::optional<u64> scrape_size_limit_bytes);
 
   // Number of bytes of content served by this handler.
   u64 bytes_served() const { return bytes_served_; };
@@ -26,8 +28,14 @@ public:
   // Number of times writing a response has failed.
   u64 num_failed_scrapes() const { return num_failed_scrapes_; }
 
-  // Number of queues this handler is reading from.
-  size_t num_queues() const { return queues_.size(); }
+  // Number of scrapes served, including failed ones.
+  u64 num_scrapes() const { return num_scrapes_; }
+
+  // Total time spent serving scrapes, in nanoseconds.
+  u64 scrape_duration_ns() const { return scrape_duration_ns_; }
+
+  // Number of snapshot slots this handler is reading from.
+  size_t num_queues() const { return slots_.size(); }
 
 protected:
   using timeout_t = std::chrono::milliseconds;
@@ -36,19 +44,19 @@ protected:
   // X-Prometheus-Scrape-Timeout-Seconds header.
   std::optional<timeout_t> get_scrape_timeout(CivetServer *server, mg_connection *conn);
 
-  // Writes the content response by reading from all queues.
+  // Writes the content response from the latest snapshots of all slots.
   void write_content_from_queues(CivetServer *server, mg_connection *conn);
 
-  // Writes the content response by reading from the specified queue.
+  // Writes the content response from the latest snapshot of the specified slot.
   void write_content_from_queue(CivetServer *server, mg_connection *conn, size_t queue_num);
 
 private:
-  // Queues from which the content will be read from.
-  std::vector<ElementQueue> queues_;
-  // A mutex for each individual queue.
-  std::vector<std::mutex> queue_mutex_;
-  // This mutex needs to be locked when reading from multiple queues.
-  std::mutex handler_mutex_;
+  // Sends the snapshots' content in a chunked response, with the content
+  // coding negotiated from the request's Accept-Encoding header.
+  void write_snapshots(CivetServer *server, mg_connection *conn, std::vector<PrometheusSnapshotPtr> const &snapshots);
+
+  // Slots from which the content will be read from.
+  std::vector<std::shared_ptr<PrometheusSnapshotSlot>> slots_;
 
   // Maximum number of bytes to return in one response.
   std::optional<u64> scrape_size_limit_bytes_;
@@ -57,13 +65,17 @@ private:
   std::atomic<u64> bytes_served_{0};
   // Number of times writing a response has failed.
   std::atomic<u64> num_failed_scrapes_{0};
+  // Number of scrapes served.
+  std::atomic<u64> num_scrapes_{0};
+  // Time spent serving scrapes.
+  std::atomic<u64> scrape_duration_ns_{0};
 
-  // Next queue to be scraped.
+  // Next slot to start a scrape of all slots with.
   //
-  // This is used in `write_content_from_queues()`, where reading from queues
-  // can be interrupted by timeout or scrape size limit. In such case, on the
-  // next scrape request it is important to start on the next queue in line.
-  size_t next_queue_{0};
+  // Responses can be cut short by the scrape timeout or the scrape size limit,
+  // so each scrape starts on the next slot in line, for all slots to get their
+  // turn at being sent first.
+  std::atomic<size_t> next_queue_{0};
 };
 
 // Prometheus handler for scraping on a port range.
@@ -74,7 +86,7 @@ private:
 class PortRangePromHandler : public PrometheusHandler {
 public:
   PortRangePromHandler(
-      std::vector<ElementQueueStoragePtr> const &queues,
+      std::vector<std::shared_ptr<PrometheusSnapshotSlot>> const &slots,
       std::optional<u64> scrape_size_limit_bytes,
       std::optional<u16> extra_ports_base = std::nullopt);
 
@@ -92,7 +104,8 @@ private:
 //
 class SinglePortPromHandler : public PrometheusHandler {
 public:
-  SinglePortPromHandler(std::vector<ElementQueueStoragePtr> const &queues, std::optional<u64> scrape_size_limit_bytes);
+  SinglePortPromHandler(
+      std::vector<std::shared_ptr<PrometheusSnapshotSlot>> const &slots, std::optional<u64> scrape_size_limit_bytes);
 
 private:
   bool handleGet(CivetServer *server, mg_connection *conn) override;
@@ -23,18 +23,18 @@ namespace {
 // 1MB upper limit
 constexpr std::streamoff UPPER_LIMIT = 1 * 1024 * 1024;
 
-std::vector<ElementQueueStoragePtr> make_queue_buffers(size_t n)
-{
-  static constexpr u32 queue_n_elems = (1 << 19);
-  // Each element is 4 bytes
-  static constexpr u32 queue_buf_len = (queue_n_elems << 5);
+// Maximum size of one writer's snapshot; writes that would grow it past this
+// are counted as failed.
+constexpr std::size_t max_snapshot_size = 16 * 1024 * 1024;
 
+std::vector<std::shared_ptr<PrometheusSnapshotSlot>> make_snapshot_slots(size_t n)
+{
   assert(n > 0);
 
-  std::vector<ElementQueueStoragePtr> result;
+  std::vector<std::shared_ptr<PrometheusSnapshotSlot>> result;
 
   for (size_t i = 0; i < n; ++i) {
-    result.emplace_back(std::make_shared<MemElementQueueStorage>(queue_n_elems, queue_buf_len));
+    result.emplace_back(std::make_shared<PrometheusSnapshotSlot>());
   }
 
   return result;
@@ -75,8 +75,8 @@ PrometheusPublisher::PrometheusPublisher(
     std::string_view http_bind_addr,
     int http_num_threads,
     std::optional<u64> scrape_size_limit_bytes)
-    : queue_buffers_(make_queue_buffers(num_writer_threads)),
-      http_handler_(make_handler(handler_type, queue_buffers_, scrape_size_limit_bytes)),
+    : snapshot_slots_(make_snapshot_slots(num_writer_threads)),
+      http_handler_(make_handler(handler_type, snapshot_slots_, scrape_size_limit_bytes)),
       http_server_(make_http_server(http_bind_addr, http_num_threads))
 {
   http_server_->addHandler("", *http_handler_);
@@ -86,8 +86,8 @@ PrometheusPublisher::~PrometheusPublisher() {}
 
 Publisher::WriterPtr PrometheusPublisher::make_writer(size_t thread_num)
 {
-  assert(thread_num < queue_buffers_.size());
-  return std::make_unique<Writer>(queue_buffers_[thread_num]);
+  assert(thread_num < snapshot_slots_.size());
+  return std::make_unique<Writer>(snapshot_slots_[thread_num]);
 }
 
 u64 PrometheusPublisher::bytes_served() const
@@ -100,11 +100,33 @@ u64 PrometheusPublisher::num_failed_scrapes() const
   return http_handler_->num_failed_scrapes();
 }
 
+u64 PrometheusPublisher::num_scrapes() const
+{
+  return http_handler_->num_scrapes();
+}
+
+u64 PrometheusPublisher::scrape_duration_ns() const
+{
+  return http_handler_->scrape_duration_ns();
+}
+
+u64 PrometheusPublisher::write_stall_ns() const
+{
+  u64 result = 0;
+  for (auto const &slot : snapshot_slots_) {
+    result += slot->publish_ns();
+  }
+  return result;
+}
+
 void PrometheusPublisher::write_internal_stats(InternalMetricsEncoder &encoder, u64 time_ns) const
 {
   PromStats stats;
   stats.metrics.bytes_ingested = bytes_served();
   stats.metrics.failed_scrapes = num_failed_scrapes();
+  stats.metrics.scrapes = num_scrapes();
+  stats.metrics.scrape_duration_ns = scrape_duration_ns();
+  stats.metrics.write_stall_ns = write_stall_ns();
   encoder.write_internal_stats(stats, time_ns);
 }
 
@@ -112,45 +134,13 @@ void PrometheusPublisher::write_internal_stats(InternalMetricsEncoder &encoder,
 // Writer
 //
 
-namespace {
-
-ssize_t write_to_queue(ElementQueue &write_queue, std::stringstream &ss)
-{
-  size_t len = ss.tellp();
-
-  // write msg to queue to be read by by prometheus handler
-  int res = eq_write(&write_queue, len);
-
-  if (res == -EINVAL) {
-    // attempted to write more than the queue size! This is never okay,
-    // and should never happen. In this catastrophic case, throw an
-    // exception so we can know about it and debug.
-    throw std::runtime_error("tried to write more than queue length");
-  }
-
-  if (res == -ENOSPC) {
-    // no space in the queue
-    return -1;
-  }
-
-  assert(res >= 0);
-
-  // if we reached here, can write the element to offset
-  ss.read((char *)write_queue.data + res, len);
-
-  return len;
-}
-
-} // namespace
-
-PrometheusPublisher::Writer::Writer(ElementQueueStoragePtr const &queue) : write_queue_(queue)
-{
-  write_queue_.start_write_batch();
-}
+PrometheusPublisher::Writer::Writer(std::shared_ptr<PrometheusSnapshotSlot> slot) : slot_(std::move(slot)) {}
 
 PrometheusPublisher::Writer::~Writer()
 {
-  write_queue_.finish_write_batch();
+  if (slot_) {
+    slot_->publish(std::move(buffer_));
+  }
 }
 
 void PrometheusPublisher::Writer::write(std::stringstream &stream)
@@ -171,42 +161,38 @@ void PrometheusPublisher::Writer::write(std::stringstream &stream)
     return;
   }
 
-  auto n = write_to_queue(write_queue_, stream);
+  size_t len = stream.tellp();
 
-  if (n < 0) {
-    bytes_failed_to_write_ += stream.tellp();
-  } else {
-    bytes_written_ += n;
+  if (buffer_.size() + len > max_snapshot_size) {
+    bytes_failed_to_write_ += len;
+    return;
   }
+
+  size_t const offset = buffer_.size();
+  buffer_.resize(offset + len);
+  stream.read(buffer_.data() + offset, len);
+
+  bytes_written_ += len;
 }
 
 void PrometheusPublisher::Writer::write(std::string_view prefix, std::string_view labels, std::string_view suffix)
 {
   u32 len = prefix.size() + labels.size() + suffix.size();
 
-  int res = eq_write(&write_queue_, len);
-
-  if (res == -EINVAL) {
-    throw std::runtime_error("tried to write more than queue length");
-  } else if (res == -ENOSPC) {
+  if (buffer_.size() + len > max_snapshot_size) {
     bytes_failed_to_write_ += len;
     return;
   }
-  assert(res >= 0);
-
-  char *cur = write_queue_.data + res;
 
-  memcpy(cur, prefix.data(), prefix.size());
-  memcpy(cur + prefix.size(), labels.data(), labels.size());
-  memcpy(cur + prefix.size() + labels.size(), suffix.data(), suffix.size());
+  buffer_.append(prefix).append(labels).append(suffix);
 
   bytes_written_ += len;
 }
 
 void PrometheusPublisher::Writer::flush()
 {
-  write_queue_.finish_write_batch();
-  write_queue_.start_write_batch();
+  // reuses the previous snapshot's buffer, if no scrape is still sending it
+  buffer_ = slot_->publish(std::move(buffer_));
 }
 
 void PrometheusPublisher::Writer::write_internal_stats(
@@ -6,13 +6,13 @@
 #pragma once
 
 #include "prometheus_handler.h"
+#include "prometheus_snapshot.h"
 #include "publisher.h"
 
-#include <util/element_queue_cpp.h>
-
 #include <iosfwd>
 #include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 
 class CivetServer;
@@ -27,7 +27,12 @@ class PrometheusHandler;
 // a HTTP server to serve requests.
 //
 // As publishing to Prometheus is usually done from multiple threads, this
-// class allows for it by keeping a queue for each publishing thread.
+// class allows for it by keeping a snapshot slot for each publishing thread.
+// Each writer serializes the time-series of a batch into a buffer, and
+// publishes it as an immutable snapshot when the batch is flushed. Scrapes
+// are served from the latest snapshots, so a slow scrape never stalls the
+// writers, and each batch is serialized (and compressed) once, however many
+// scrapes it is served to.
 //
 // To write time-series data the |make_writer| method is first used.
 // It creates an object that exposes various writing functions.
@@ -72,12 +77,21 @@ public:
   // Number of times scraping by prometheus has failed.
   u64 num_failed_scrapes() const;
 
+  // Number of scrapes served.
+  u64 num_scrapes() const;
+
+  // Total time spent serving scrapes, in nanoseconds.
+  u64 scrape_duration_ns() const;
+
+  // Total time writers spent publishing snapshots, in nanoseconds.
+  u64 write_stall_ns() const;
+
   // Gets this writer's stats encoded for TSDB output.
   virtual void write_internal_stats(InternalMetricsEncoder &encoder, u64 time_ns) const override;
 
 private:
-  // Queue buffer for sending to prometheus handler.
-  std::vector<ElementQueueStoragePtr> queue_buffers_;
+  // Latest snapshot of each writer, read by the prometheus handler.
+  std::vector<std::shared_ptr<PrometheusSnapshotSlot>> snapshot_slots_;
   // Handler for HTTP requests.
   std::unique_ptr<PrometheusHandler> http_handler_;
   // HTTP server for prometheus to query.
@@ -88,7 +102,7 @@ private:
 //
 class PrometheusPublisher::Writer : public Publisher::Writer {
 public:
-  Writer(ElementQueueStoragePtr const &queue);
+  Writer(std::shared_ptr<PrometheusSnapshotSlot> slot);
 
   Writer(Writer const &) = delete;
   Writer(Writer &&) = default;
@@ -101,7 +115,7 @@ public:
   // Writes prefix, followed by labels, finished with suffix.
   void write(std::string_view prefix, std::string_view labels, std::string_view suffix) override;
 
-  // Finishes this and starts a new batch.
+  // Publishes this batch as the latest snapshot, and starts a new batch.
   void flush() override;
 
   // Number of bytes successfully written.
@@ -114,7 +128,9 @@ public:
   void write_internal_stats(InternalMetricsEncoder &encoder, u64 time_ns, int shard, std::string_view module) const override;
 
 private:
-  ElementQueue write_queue_;
+  std::shared_ptr<PrometheusSnapshotSlot> slot_;
+  // Content of the current batch.
+  std::string buffer_;
   u64 bytes_written_{0};
   u64 bytes_failed_to_write_{0};
 
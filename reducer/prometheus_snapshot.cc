@@ -0,0 +1,244 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include "prometheus_snapshot.h"
+
+#include <platform/userspace-time.h>
+#include <util/log.h>
+
+#include <zlib.h>
+#include <zstd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+
+namespace reducer {
+
+namespace {
+
+// Snapshots are compressed by the scrape that first asks for them, within the
+// scrape's timeout, so these favor speed over ratio. The Prometheus text format
+// is repetitive enough that fast levels already compress it well.
+constexpr int gzip_level = Z_BEST_SPEED;
+constexpr int zstd_level = 3;
+
+std::string gzip_compress(std::string_view content)
+{
+  if (content.size() > std::numeric_limits<uInt>::max()) {
+    LOG::error("PrometheusSnapshot: content too large to compress with gzip: {} bytes", content.size());
+    return {};
+  }
+
+  z_stream stream = {};
+  // 16 added to the window bits writes a gzip header and trailer instead of zlib's
+  if (deflateInit2(&stream, gzip_level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    LOG::error("PrometheusSnapshot: failed to initialize gzip compression");
+    return {};
+  }
+
+  std::string compressed(deflateBound(&stream, content.size()), '\0');
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(content.data()));
+  stream.avail_in = content.size();
+  stream.next_out = reinterpret_cast<Bytef *>(compressed.data());
+  stream.avail_out = compressed.size();
+
+  int const result = deflate(&stream, Z_FINISH);
+  compressed.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  if (result != Z_STREAM_END) {
+    LOG::error("PrometheusSnapshot: gzip compression failed: {}", result);
+    return {};
+  }
+
+  return compressed;
+}
+
+std::string zstd_compress(std::string_view content)
+{
+  std::string compressed(ZSTD_compressBound(content.size()), '\0');
+
+  std::size_t const size = ZSTD_compress(compressed.data(), compressed.size(), content.data(), content.size(), zstd_level);
+  if (ZSTD_isError(size)) {
+    LOG::error("PrometheusSnapshot: zstd compression failed: {}", ZSTD_getErrorName(size));
+    return {};
+  }
+
+  compressed.resize(size);
+  return compressed;
+}
+
+std::string_view trim(std::string_view s)
+{
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+    s.remove_prefix(1);
+  }
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+    s.remove_suffix(1);
+  }
+  return s;
+}
+
+bool equals_ignore_case(std::string_view a, std::string_view b)
+{
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Parses the quality value of one Accept-Encoding element, e.g. ";q=0.5".
+// Returns it in thousandths, 1000 if there is none.
+int parse_quality(std::string_view params)
+{
+  while (!params.empty()) {
+    auto const sep = params.find(';');
+    auto param = trim(params.substr(0, sep));
+    params = sep == std::string_view::npos ? std::string_view() : params.substr(sep + 1);
+
+    if (param.size() < 2 || std::tolower(static_cast<unsigned char>(param[0])) != 'q' || param[1] != '=') {
+      continue;
+    }
+    param.remove_prefix(2);
+
+    // qvalue = ( "0" [ "." 0*3DIGIT ] ) / ( "1" [ "." 0*3("0") ] )
+    if (param.empty() || (param[0] != '0' && param[0] != '1')) {
+      return 0;
+    }
+    int quality = (param[0] - '0') * 1000;
+    if (param.size() > 2 && param[1] == '.') {
+      int scale = 100;
+      for (char c : param.substr(2, 3)) {
+        if (c < '0' || c > '9') {
+          break;
+        }
+        quality += (c - '0') * scale;
+        scale /= 10;
+      }
+    }
+    return std::min(quality, 1000);
+  }
+
+  return 1000;
+}
+
+} // namespace
+
+std::string_view content_encoding_header(ContentEncoding encoding)
+{
+  switch (encoding) {
+  case ContentEncoding::gzip:
+    return "gzip";
+  case ContentEncoding::zstd:
+    return "zstd";
+  default:
+    return {};
+  }
+}
+
+ContentEncoding negotiate_content_encoding(std::string_view accept_encoding)
+{
+  // quality values of the codings we support, -1 if not listed
+  int gzip = -1;
+  int zstd = -1;
+  int any = -1;
+
+  while (!accept_encoding.empty()) {
+    auto const sep = accept_encoding.find(',');
+    auto element = accept_encoding.substr(0, sep);
+    accept_encoding = sep == std::string_view::npos ? std::string_view() : accept_encoding.substr(sep + 1);
+
+    auto const params = element.find(';');
+    auto const coding = trim(element.substr(0, params));
+    int const quality = params == std::string_view::npos ? 1000 : parse_quality(element.substr(params + 1));
+
+    if (equals_ignore_case(coding, "gzip") || equals_ignore_case(coding, "x-gzip")) {
+      gzip = quality;
+    } else if (equals_ignore_case(coding, "zstd")) {
+      zstd = quality;
+    } else if (coding == "*") {
+      any = quality;
+    }
+  }
+
+  if (gzip < 0) {
+    gzip = any;
+  }
+  if (zstd < 0) {
+    zstd = any;
+  }
+
+  if (zstd > 0 && zstd >= gzip) {
+    return ContentEncoding::zstd;
+  }
+  if (gzip > 0) {
+    return ContentEncoding::gzip;
+  }
+  return ContentEncoding::identity;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+PrometheusSnapshot::PrometheusSnapshot(std::string content) : content_(std::move(content)) {}
+
+std::string_view PrometheusSnapshot::content(ContentEncoding encoding) const
+{
+  switch (encoding) {
+  case ContentEncoding::gzip:
+    std::call_once(gzip_once_, [this] { gzip_ = gzip_compress(content_); });
+    return gzip_;
+  case ContentEncoding::zstd:
+    std::call_once(zstd_once_, [this] { zstd_ = zstd_compress(content_); });
+    return zstd_;
+  default:
+    return content_;
+  }
+}
+
+bool PrometheusSnapshot::can_encode(ContentEncoding encoding) const
+{
+  // a gzip member or zstd frame is never empty, even for empty content
+  return encoding == ContentEncoding::identity || !content(encoding).empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+PrometheusSnapshotPtr PrometheusSnapshotSlot::load() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return snapshot_;
+}
+
+std::string PrometheusSnapshotSlot::publish(std::string content)
+{
+  u64 const start = monotonic();
+
+  auto snapshot = std::make_shared<PrometheusSnapshot>(std::move(content));
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    snapshot_.swap(snapshot);
+  }
+
+  // |snapshot| now holds the previous one, which scrapes can no longer get
+  // from the slot: if none is holding it, its buffer can be reused.
+  std::string buffer;
+  if (snapshot && snapshot.use_count() == 1) {
+    // pairs with the release of the last scrape's reference, so that its reads
+    // of the content happen before the buffer is reused
+    std::atomic_thread_fence(std::memory_order_acquire);
+    buffer = std::move(snapshot->content_);
+    buffer.clear();
+  }
+  snapshot.reset();
+
+  publish_ns_.fetch_add(monotonic() - start, std::memory_order_relaxed);
+  return buffer;
+}
+
+} // namespace reducer
@@ -0,0 +1,100 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <platform/types.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace reducer {
+
+// Content codings a scrape response can be sent with.
+enum class ContentEncoding {
+  identity,
+  gzip,
+  zstd,
+};
+
+// Value of the Content-Encoding header for |encoding|, empty for identity.
+std::string_view content_encoding_header(ContentEncoding encoding);
+
+// Picks the content coding to respond with from the value of a request's
+// Accept-Encoding header, preferring zstd, then gzip, among the codings with
+// the highest quality value.
+ContentEncoding negotiate_content_encoding(std::string_view accept_encoding);
+
+// Time-series serialized in the Prometheus text format by one writer during
+// one timeslot.
+//
+// Snapshots are immutable once published, so any number of scrapes can send
+// one without copying or locking it. Compressed content is computed the first
+// time a scrape asks for it and kept with the snapshot, so that it is only
+// computed once per timeslot. Compressed content is a complete gzip member or
+// zstd frame, so the content of several snapshots can be sent one after the
+// other in the same response.
+class PrometheusSnapshot {
+public:
+  explicit PrometheusSnapshot(std::string content);
+
+  PrometheusSnapshot(PrometheusSnapshot const &) = delete;
+  PrometheusSnapshot &operator=(PrometheusSnapshot const &) = delete;
+
+  // The content with the given coding applied, empty if it failed to compress.
+  std::string_view content(ContentEncoding encoding) const;
+
+  // Whether the content could be compressed with |encoding|, compressing it if
+  // no scrape asked for this coding yet.
+  bool can_encode(ContentEncoding encoding) const;
+
+  // Size of the uncompressed content.
+  std::size_t size() const { return content_.size(); }
+
+private:
+  friend class PrometheusSnapshotSlot;
+
+  std::string content_;
+
+  mutable std::once_flag gzip_once_;
+  mutable std::string gzip_;
+  mutable std::once_flag zstd_once_;
+  mutable std::string zstd_;
+};
+
+using PrometheusSnapshotPtr = std::shared_ptr<PrometheusSnapshot const>;
+
+// The latest snapshot published by a writer.
+//
+// The writer publishes a snapshot at the end of each timeslot and scrapes read
+// the latest one. The mutex is only held to copy or swap the pointer, so a
+// slow scrape never holds up the writer, and the writer never holds up a
+// scrape by more than a pointer swap.
+class PrometheusSnapshotSlot {
+public:
+  // Latest published snapshot, null if none was published yet.
+  PrometheusSnapshotPtr load() const;
+
+  // Publishes |content| as the latest snapshot.
+  //
+  // Returns the previous snapshot's buffer, emptied, if no scrape is still
+  // sending it, so that the writer can build its next snapshot in it without
+  // growing a new buffer; or an empty string otherwise.
+  std::string publish(std::string content);
+
+  // Time the writer spent publishing snapshots, in nanoseconds.
+  u64 publish_ns() const { return publish_ns_.load(std::memory_order_relaxed); }
+
+private:
+  mutable std::mutex mutex_;
+  std::shared_ptr<PrometheusSnapshot> snapshot_;
+
+  std::atomic<u64> publish_ns_{0};
+};
+
+} // namespace reducer
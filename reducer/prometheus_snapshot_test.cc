@@ -0,0 +1,173 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include "prometheus_snapshot.h"
+
+#include <zlib.h>
+#include <zstd.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace reducer {
+
+namespace {
+
+std::string make_content(int n_lines)
+{
+  std::string content;
+  for (int i = 0; i < n_lines; ++i) {
+    content += "tcp_bytes{sf_product=\"network-explorer\",source.workload.name=\"client-" + std::to_string(i % 17) +
+               "\",dest.workload.name=\"server\"} " + std::to_string(i * 1500) + " 1700000000000\n";
+  }
+  return content;
+}
+
+// Decompresses a sequence of gzip members.
+std::string gunzip(std::string_view compressed)
+{
+  std::string result;
+
+  while (!compressed.empty()) {
+    z_stream stream = {};
+    // 32 added to the window bits accepts a gzip header
+    EXPECT_EQ(inflateInit2(&stream, 15 + 32), Z_OK);
+
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(compressed.data()));
+    stream.avail_in = compressed.size();
+
+    int status;
+    do {
+      char buffer[4096];
+      stream.next_out = reinterpret_cast<Bytef *>(buffer);
+      stream.avail_out = sizeof(buffer);
+      status = inflate(&stream, Z_NO_FLUSH);
+      EXPECT_TRUE(status == Z_OK || status == Z_STREAM_END);
+      result.append(buffer, sizeof(buffer) - stream.avail_out);
+    } while (status == Z_OK);
+
+    compressed.remove_prefix(compressed.size() - stream.avail_in);
+    inflateEnd(&stream);
+
+    if (status != Z_STREAM_END) {
+      break;
+    }
+  }
+
+  return result;
+}
+
+// Decompresses a sequence of zstd frames.
+std::string unzstd(std::string_view compressed, std::size_t size)
+{
+  std::string result(size, '\0');
+  std::size_t const n = ZSTD_decompress(result.data(), result.size(), compressed.data(), compressed.size());
+  EXPECT_FALSE(ZSTD_isError(n)) << ZSTD_getErrorName(n);
+  result.resize(ZSTD_isError(n) ? 0 : n);
+  return result;
+}
+
+} // namespace
+
+TEST(PrometheusSnapshotTest, NegotiatesContentEncoding)
+{
+  EXPECT_EQ(negotiate_content_encoding(""), ContentEncoding::identity);
+  EXPECT_EQ(negotiate_content_encoding("identity"), ContentEncoding::identity);
+  EXPECT_EQ(negotiate_content_encoding("deflate, br"), ContentEncoding::identity);
+
+  // what Prometheus sends
+  EXPECT_EQ(negotiate_content_encoding("gzip"), ContentEncoding::gzip);
+  EXPECT_EQ(negotiate_content_encoding("x-gzip"), ContentEncoding::gzip);
+  EXPECT_EQ(negotiate_content_encoding("GZIP"), ContentEncoding::gzip);
+
+  EXPECT_EQ(negotiate_content_encoding("zstd"), ContentEncoding::zstd);
+  EXPECT_EQ(negotiate_content_encoding("gzip, zstd"), ContentEncoding::zstd);
+  EXPECT_EQ(negotiate_content_encoding("gzip,deflate,br,zstd"), ContentEncoding::zstd);
+  EXPECT_EQ(negotiate_content_encoding("*"), ContentEncoding::zstd);
+
+  // quality values
+  EXPECT_EQ(negotiate_content_encoding("zstd;q=0.5, gzip"), ContentEncoding::gzip);
+  EXPECT_EQ(negotiate_content_encoding("zstd ; q=1.0, gzip;q=0.999"), ContentEncoding::zstd);
+  EXPECT_EQ(negotiate_content_encoding("zstd;q=0, gzip;q=0"), ContentEncoding::identity);
+  EXPECT_EQ(negotiate_content_encoding("*;q=0.1, zstd;q=0"), ContentEncoding::gzip);
+  EXPECT_EQ(negotiate_content_encoding("gzip;q=0, *"), ContentEncoding::zstd);
+}
+
+TEST(PrometheusSnapshotTest, CompressesContent)
+{
+  std::string const content = make_content(1000);
+  PrometheusSnapshot snapshot(content);
+
+  EXPECT_EQ(snapshot.content(ContentEncoding::identity), content);
+
+  auto const gzip = snapshot.content(ContentEncoding::gzip);
+  EXPECT_LT(gzip.size(), content.size() / 4);
+  EXPECT_EQ(gunzip(gzip), content);
+
+  auto const zstd = snapshot.content(ContentEncoding::zstd);
+  EXPECT_LT(zstd.size(), content.size() / 4);
+  EXPECT_EQ(unzstd(zstd, content.size()), content);
+
+  // compressed once, then kept
+  EXPECT_EQ(snapshot.content(ContentEncoding::gzip).data(), gzip.data());
+  EXPECT_EQ(snapshot.content(ContentEncoding::zstd).data(), zstd.data());
+}
+
+TEST(PrometheusSnapshotTest, CanEncodeEmptyContent)
+{
+  PrometheusSnapshot empty("");
+
+  EXPECT_TRUE(empty.can_encode(ContentEncoding::identity));
+  EXPECT_TRUE(empty.can_encode(ContentEncoding::gzip));
+  EXPECT_TRUE(empty.can_encode(ContentEncoding::zstd));
+  EXPECT_EQ(gunzip(empty.content(ContentEncoding::gzip)), "");
+}
+
+TEST(PrometheusSnapshotTest, ConcatenatesCompressedSnapshots)
+{
+  std::string const content_a = make_content(100);
+  std::string const content_b = make_content(50);
+  PrometheusSnapshot a(content_a);
+  PrometheusSnapshot b(content_b);
+  PrometheusSnapshot empty("");
+
+  std::string gzip;
+  gzip += a.content(ContentEncoding::gzip);
+  gzip += empty.content(ContentEncoding::gzip);
+  gzip += b.content(ContentEncoding::gzip);
+  EXPECT_EQ(gunzip(gzip), content_a + content_b);
+
+  std::string zstd;
+  zstd += a.content(ContentEncoding::zstd);
+  zstd += empty.content(ContentEncoding::zstd);
+  zstd += b.content(ContentEncoding::zstd);
+  EXPECT_EQ(unzstd(zstd, content_a.size() + content_b.size()), content_a + content_b);
+}
+
+TEST(PrometheusSnapshotTest, PublishesLatestSnapshot)
+{
+  PrometheusSnapshotSlot slot;
+  EXPECT_EQ(slot.load(), nullptr);
+
+  std::string const first_content = make_content(10);
+  EXPECT_TRUE(slot.publish(first_content).empty());
+  auto first = slot.load();
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(first->content(ContentEncoding::identity), first_content);
+
+  // a scrape still holds the first snapshot, so its buffer is not reused
+  std::string const second_content = make_content(20);
+  EXPECT_LT(slot.publish(second_content).capacity(), first_content.size());
+  EXPECT_EQ(first->content(ContentEncoding::identity), first_content);
+  EXPECT_EQ(slot.load()->content(ContentEncoding::identity), second_content);
+  first.reset();
+
+  // nothing holds the second snapshot, so its buffer comes back
+  auto buffer = slot.publish("third\n");
+  EXPECT_TRUE(buffer.empty());
+  EXPECT_GE(buffer.capacity(), second_content.size());
+  EXPECT_EQ(slot.load()->content(ContentEncoding::identity), "third\n");
+}
+
+} // namespace reducer
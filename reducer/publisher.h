@@ -51,8 +51,8 @@ public:
       std::abort();
     }
 
-    // Writes provided ExportMetricsServiceRequest.
-    virtual void write(ExportMetricsServiceRequest &request)
+    // Writes provided ExportMetricsServiceRequest, which holds |num_data_points| data points.
+    virtual void write(ExportMetricsServiceRequest &request, u64 num_data_points)
     {
       std::cerr << "Publisher::Writer::write(ExportMetricsServiceRequest) not supported" << std::endl;
       std::abort();
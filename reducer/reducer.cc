@@ -29,6 +29,7 @@
 #include <util/file_ops.h>
 #include <util/log.h>
 #include <util/uv_helpers.h>
+#include <util/zstd_decompressor.h>
 
 #include <spdlog/spdlog.h>
 
@@ -41,14 +42,28 @@
 
 namespace reducer {
 
+namespace {
+
+RpcQueueMatrix make_queues(size_t num_senders, size_t num_receivers, ReducerConfig const &config)
+{
+  return RpcQueueMatrix(
+      num_senders,
+      num_receivers,
+      RpcQueueMatrix::default_queue_n_elems,
+      RpcQueueMatrix::default_queue_buf_len,
+      config.enable_rpc_doorbells);
+}
+
+} // namespace
+
 Reducer::Reducer(uv_loop_t &loop, ReducerConfig &config)
     : loop_(loop),
       config_(config),
-      ingest_to_matching_queues_(config_.num_ingest_shards, config_.num_matching_shards),
-      ingest_to_logging_queues_(config_.num_ingest_shards, 1),
-      matching_to_logging_queues_(config_.num_matching_shards, 1),
-      matching_to_aggregation_queues_(config_.num_matching_shards, config_.num_aggregation_shards),
-      aggregation_to_logging_queues_(config_.num_aggregation_shards, 1)
+      ingest_to_matching_queues_(make_queues(config_.num_ingest_shards, config_.num_matching_shards, config_)),
+      ingest_to_logging_queues_(make_queues(config_.num_ingest_shards, 1, config_)),
+      matching_to_logging_queues_(make_queues(config_.num_matching_shards, 1, config_)),
+      matching_to_aggregation_queues_(make_queues(config_.num_matching_shards, config_.num_aggregation_shards, config_)),
+      aggregation_to_logging_queues_(make_queues(config_.num_aggregation_shards, 1, config_))
 {}
 
 void Reducer::startup()
@@ -182,7 +197,9 @@ void Reducer::init_cores()
   if (config_.enable_otlp_grpc_metrics) {
     otlp_metrics_publisher_ = std::make_unique<reducer::OtlpGrpcPublisher>(
         config_.num_aggregation_shards,
-        std::string(config_.otlp_grpc_metrics_address + ":" + std::to_string(config_.otlp_grpc_metrics_port)));
+        std::string(config_.otlp_grpc_metrics_address + ":" + std::to_string(config_.otlp_grpc_metrics_port)),
+        config_.otlp_grpc_streams,
+        config_.otlp_grpc_max_in_flight_bytes);
   }
 
   // index of the next stat writer thread to make a writer for
@@ -194,12 +211,15 @@ void Reducer::init_cores()
 
   auto initial_timestamp = monotonic() + get_boot_time();
 
+  reducer::Core::set_span_pool_limits(config_.span_pool_soft_limit_fraction, config_.span_pool_hard_limit_fraction);
+
   reducer::DisabledMetrics disabled_metrics(config_.disable_metrics, config_.enable_metrics);
   logging_core_ = std::make_unique<reducer::logging::LoggingCore>(
       ingest_to_logging_queues_,
       matching_to_logging_queues_,
       aggregation_to_logging_queues_,
       stats_publisher_->make_writer(stat_writer_num++),
+      prom_metrics_publisher_,
       disabled_metrics,
       /* shard */ 0,
       initial_timestamp);
@@ -255,8 +275,26 @@ void Reducer::init_cores()
     matching_cores_.push_back(std::move(matching_core));
   }
 
+  auto zstd_dictionaries = std::make_shared<ZstdDictionaries>();
+  for (auto const &path : config_.zstd_dictionaries) {
+    try {
+      zstd_dictionaries->load(path.c_str());
+      LOG::info("Loaded Zstandard dictionary from '{}'.", path);
+    } catch (std::exception const &exc) {
+      LOG::error("Failed to load Zstandard dictionary from '{}': {}.", path, exc.what());
+    }
+  }
+
   ingest_core_ = std::make_unique<reducer::ingest::IngestCore>(
-      ingest_to_logging_queues_, ingest_to_matching_queues_, config_.telemetry_port);
+      ingest_to_logging_queues_,
+      ingest_to_matching_queues_,
+      config_.telemetry_port,
+      /* localhost */ false,
+      ZstdDecompressionOptions{.dictionaries = std::move(zstd_dictionaries), .window_log_max = config_.zstd_window_log_max},
+      config_.enable_ingest_io_uring,
+      config_.enable_ingest_reuseport,
+      config_.enable_ingest_rebalancing,
+      config_.enable_ingest_flow_control);
 
   // all writers created
   ASSUME(stat_writer_num == num_stat_writers);
@@ -13,11 +13,20 @@ namespace reducer {
 
 const ReducerConfig DEFAULT_REDUCER_CONFIG = {
     .telemetry_port = 8000,
+    .zstd_dictionaries = {},
+    .zstd_window_log_max = 17,
+    .enable_ingest_io_uring = false,
+    .enable_ingest_reuseport = false,
+    .enable_ingest_rebalancing = false,
+    .enable_ingest_flow_control = false,
 
     .num_ingest_shards = 1,
     .num_matching_shards = 1,
     .num_aggregation_shards = 1,
     .partitions_per_shard = 1,
+    .enable_rpc_doorbells = false,
+    .span_pool_soft_limit_fraction = 0.8,
+    .span_pool_hard_limit_fraction = 1.0,
 
     .enable_id_id = false,
     .enable_az_id = false,
@@ -27,6 +36,8 @@ const ReducerConfig DEFAULT_REDUCER_CONFIG = {
     .otlp_grpc_metrics_address = "localhost",
     .otlp_grpc_metrics_port = 4317,
     .otlp_grpc_batch_size = 1000,
+    .otlp_grpc_streams = 1,
+    .otlp_grpc_max_in_flight_bytes = 0,
     .enable_otlp_grpc_metric_descriptions = false,
 
     .disable_prometheus_metrics = false,
@@ -76,11 +87,20 @@ void read_config_from_yaml(ReducerConfig &config, std::string const &path)
   }
 
   LOAD_FIELD(telemetry_port);
+  LOAD_FIELD(zstd_dictionaries);
+  LOAD_FIELD(zstd_window_log_max);
+  LOAD_FIELD(enable_ingest_io_uring);
+  LOAD_FIELD(enable_ingest_reuseport);
+  LOAD_FIELD(enable_ingest_rebalancing);
+  LOAD_FIELD(enable_ingest_flow_control);
 
   LOAD_FIELD(num_ingest_shards);
   LOAD_FIELD(num_matching_shards);
   LOAD_FIELD(num_aggregation_shards);
   LOAD_FIELD(partitions_per_shard);
+  LOAD_FIELD(enable_rpc_doorbells);
+  LOAD_FIELD(span_pool_soft_limit_fraction);
+  LOAD_FIELD(span_pool_hard_limit_fraction);
 
   LOAD_FIELD(enable_id_id);
   LOAD_FIELD(enable_az_id);
@@ -90,6 +110,8 @@ void read_config_from_yaml(ReducerConfig &config, std::string const &path)
   LOAD_FIELD(otlp_grpc_metrics_address);
   LOAD_FIELD(otlp_grpc_metrics_port);
   LOAD_FIELD(otlp_grpc_batch_size);
+  LOAD_FIELD(otlp_grpc_streams);
+  LOAD_FIELD(otlp_grpc_max_in_flight_bytes);
   LOAD_FIELD(enable_otlp_grpc_metric_descriptions);
 
   LOAD_FIELD(disable_prometheus_metrics);
@@ -10,6 +10,7 @@
 
 #include <optional>
 #include <string>
+#include <vector>
 
 namespace reducer {
 
@@ -20,11 +21,20 @@ namespace reducer {
 //
 struct ReducerConfig {
   u32 telemetry_port = 0;
+  std::vector<std::string> zstd_dictionaries;
+  u32 zstd_window_log_max = 0;
+  bool enable_ingest_io_uring = false;
+  bool enable_ingest_reuseport = false;
+  bool enable_ingest_rebalancing = false;
+  bool enable_ingest_flow_control = false;
 
   u32 num_ingest_shards = 0;
   u32 num_matching_shards = 0;
   u32 num_aggregation_shards = 0;
   u32 partitions_per_shard = 0;
+  bool enable_rpc_doorbells = false;
+  double span_pool_soft_limit_fraction = 0;
+  double span_pool_hard_limit_fraction = 0;
 
   bool enable_id_id = false;
   bool enable_az_id = false;
@@ -34,6 +44,8 @@ struct ReducerConfig {
   std::string otlp_grpc_metrics_address;
   u32 otlp_grpc_metrics_port = 0;
   int otlp_grpc_batch_size = 0;
+  u32 otlp_grpc_streams = 1;
+  u64 otlp_grpc_max_in_flight_bytes = 0;
   bool enable_otlp_grpc_metric_descriptions = false;
 
   bool disable_prometheus_metrics = false;
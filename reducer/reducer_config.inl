@@ -12,10 +12,23 @@ namespace reducer {
 template <typename Out> Out &&operator<<(Out &&out, ReducerConfig const &config)
 {
   out << "telemetry_port: " << config.telemetry_port << "\n"
+      << "zstd_dictionaries:";
+  for (auto const &path : config.zstd_dictionaries) {
+    out << " " << path;
+  }
+  out << "\n"
+      << "zstd_window_log_max: " << config.zstd_window_log_max << "\n"
+      << "enable_ingest_io_uring: " << config.enable_ingest_io_uring << "\n"
+      << "enable_ingest_reuseport: " << config.enable_ingest_reuseport << "\n"
+      << "enable_ingest_rebalancing: " << config.enable_ingest_rebalancing << "\n"
+      << "enable_ingest_flow_control: " << config.enable_ingest_flow_control << "\n"
       << "num_ingest_shards: " << config.num_ingest_shards << "\n"
       << "num_matching_shards: " << config.num_matching_shards << "\n"
       << "num_aggregation_shards: " << config.num_aggregation_shards << "\n"
       << "partitions_per_shard: " << config.partitions_per_shard << "\n"
+      << "enable_rpc_doorbells: " << config.enable_rpc_doorbells << "\n"
+      << "span_pool_soft_limit_fraction: " << config.span_pool_soft_limit_fraction << "\n"
+      << "span_pool_hard_limit_fraction: " << config.span_pool_hard_limit_fraction << "\n"
       << "enable_id_id: " << config.enable_id_id << "\n"
       << "enable_az_id: " << config.enable_az_id << "\n"
       << "enable_flow_logs: " << config.enable_flow_logs << "\n"
@@ -23,6 +36,8 @@ template <typename Out> Out &&operator<<(Out &&out, ReducerConfig const &config)
       << "otlp_grpc_metrics_address: " << config.otlp_grpc_metrics_address << "\n"
       << "otlp_grpc_metrics_port: " << config.otlp_grpc_metrics_port << "\n"
       << "otlp_grpc_batch_size: " << config.otlp_grpc_batch_size << "\n"
+      << "otlp_grpc_streams: " << config.otlp_grpc_streams << "\n"
+      << "otlp_grpc_max_in_flight_bytes: " << config.otlp_grpc_max_in_flight_bytes << "\n"
       << "enable_otlp_grpc_metric_descriptions: " << config.enable_otlp_grpc_metric_descriptions << "\n"
       << "disable_prometheus_metrics: " << config.disable_prometheus_metrics << "\n"
       << "shard_prometheus_metrics: " << config.shard_prometheus_metrics << "\n"
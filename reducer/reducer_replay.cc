@@ -0,0 +1,801 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+// Replays ingest streams recorded by collectors with EBPF_NET_RECORD_INTAKE_OUTPUT_PATH as any number of synthetic
+// collectors, connected over TCP to a reducer running in this process, to find out how much load a reducer
+// configuration takes.
+//
+// With R recordings, agent k replays recording k % R with the identity of node group k / R: group 0 keeps the recorded
+// identity, other groups get their own hostnames, instance ids and addresses (see rewrite_ingest_message()), so that a
+// capture of a few nodes scales to thousands of distinct ones. Timestamps are rebased to the time messages are sent.
+// Recordings spanning several connections are replayed one connection after the other.
+//
+// Reports:
+//   * messages and bytes sent per second: sends block when the reducer falls behind, so this is what it ingested
+//   * per-stage queue latency, from the `ebpf_net.rpc_latency_ns` internal stat: max and mean of the per-interval maxima
+//   * memory per flow: growth of the peak RSS over the peak number of flows in the matching shards
+//   * throughput of scrapes of the metrics endpoint
+//
+// Caveats:
+//   * sender threads run on the same machine as the reducer, keep them to a few cores with --threads
+//   * internal stats are read from the internal Prometheus endpoint, they aren't reported with OTLP internal metrics
+//   * the reducer can't be shut down cleanly yet (see reducer_test.cc), so this exits without destroying it
+//
+// Usage: reducer_replay [--agents=N] [--speed=X] [--duration-sec=S] [--config-file=reducer.yaml] <recording>...
+
+#include <reducer/ingest_recording.h>
+#include <reducer/reducer.h>
+#include <reducer/reducer_config.h>
+
+#include <platform/userspace-time.h>
+#include <scheduling/timer.h>
+#include <util/args_parser.h>
+#include <util/file_ops.h>
+#include <util/json.h>
+#include <util/log.h>
+#include <util/raii.h>
+#include <util/stop_watch.h>
+#include <util/system_ops.h>
+
+#include <curlpp/Easy.hpp>
+#include <curlpp/Infos.hpp>
+#include <curlpp/Options.hpp>
+#include <curlpp/cURLpp.hpp>
+
+#include <spdlog/fmt/fmt.h>
+
+#include <lz4frame.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+namespace {
+
+using reducer::IngestRecording;
+
+// Uncompressed bytes of messages sent in one LZ4 frame.
+constexpr std::size_t batch_size = 64 * 1024;
+
+// How long to wait for the reducer to accept a connection.
+constexpr auto connect_timeout = 10s;
+
+struct ReplayConfig {
+  u32 num_agents;
+  u32 num_threads;
+  // 0 sends as fast as the reducer takes messages, otherwise multiplies the recorded pace
+  double speed;
+  u32 loops;
+  std::chrono::seconds duration;
+  std::chrono::seconds ramp_up;
+  std::chrono::seconds scrape_interval;
+  std::chrono::seconds settle;
+  u32 port;
+};
+
+struct Counters {
+  std::atomic<u64> messages{0};
+  std::atomic<u64> bytes{0};
+  std::atomic<u64> wire_bytes{0};
+  std::atomic<u64> connections{0};
+  std::atomic<u64> failed_connections{0};
+  std::atomic<u64> failed_sends{0};
+};
+
+struct Agent {
+  IngestRecording const *recording;
+  u32 group;
+  // when the agent first connects, on the fp_get_time_ns() clock
+  u64 start_ns;
+
+  FileDescriptor socket;
+  std::size_t session = 0;
+  std::size_t next = 0;
+  u32 loop = 0;
+  u64 session_start_ns = 0;
+  bool done = false;
+};
+
+FileDescriptor connect_to_reducer(u32 port)
+{
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  StopWatch<> watch;
+  for (;;) {
+    FileDescriptor socket(::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (!socket) {
+      LOG::error("reducer_replay: failed to create socket: {}", strerror(errno));
+      return {};
+    }
+
+    if (::connect(*socket, reinterpret_cast<sockaddr const *>(&addr), sizeof(addr)) == 0) {
+      return socket;
+    }
+
+    // the reducer might still be starting up
+    if (errno != ECONNREFUSED || watch.elapsed(connect_timeout)) {
+      LOG::error("reducer_replay: failed to connect to port {}: {}", port, strerror(errno));
+      return {};
+    }
+    std::this_thread::sleep_for(100ms);
+  }
+}
+
+// Sends the messages of a share of the agents, one batch per agent in turn.
+//
+// Sockets are blocking, so a reducer that falls behind slows down all agents
+// of a sender, like it would slow down collectors.
+class Sender {
+public:
+  Sender(ReplayConfig const &config, Counters &counters, std::atomic<bool> const &stop)
+      : config_(config),
+        counters_(counters),
+        stop_(stop),
+        compressed_(LZ4F_compressBound(2 * batch_size, nullptr) + LZ4F_HEADER_SIZE_MAX)
+  {
+    if (LZ4F_cctx *lz4_context = nullptr; LZ4F_isError(LZ4F_createCompressionContext(&lz4_context, LZ4F_VERSION))) {
+      throw std::runtime_error("reducer_replay: failed to create LZ4 context");
+    } else {
+      lz4_ctx_.reset(lz4_context);
+    }
+  }
+
+  void add_agent(Agent agent) { agents_.push_back(std::move(agent)); }
+
+  bool done() const { return done_.load(std::memory_order_acquire); }
+
+  void run()
+  {
+    while (!stop_.load(std::memory_order_relaxed)) {
+      u64 const now = fp_get_time_ns();
+      u64 next_due = std::numeric_limits<u64>::max();
+      bool active = false;
+      bool sent = false;
+
+      for (auto &agent : agents_) {
+        if (agent.done) {
+          continue;
+        }
+        active = true;
+
+        if (now < agent.start_ns) {
+          next_due = std::min(next_due, agent.start_ns);
+          continue;
+        }
+
+        sent |= step(agent, now, next_due);
+      }
+
+      if (!active) {
+        break;
+      }
+
+      if (!sent && next_due > now) {
+        std::this_thread::sleep_for(std::min(std::chrono::nanoseconds(next_due - now), std::chrono::nanoseconds(1ms)));
+      }
+    }
+
+    for (auto &agent : agents_) {
+      agent.socket.close();
+    }
+
+    done_.store(true, std::memory_order_release);
+  }
+
+private:
+  // Sends the agent's next batch of messages that are due. Returns whether
+  // anything was sent.
+  bool step(Agent &agent, u64 now, u64 &next_due)
+  {
+    auto const &messages = agent.recording->messages();
+    auto const &session = agent.recording->sessions()[agent.session];
+
+    if (!agent.socket) {
+      agent.socket = connect_to_reducer(config_.port);
+      if (!agent.socket) {
+        ++counters_.failed_connections;
+        agent.done = true;
+        return false;
+      }
+      ++counters_.connections;
+
+      agent.next = session.begin;
+      agent.session_start_ns = now;
+
+      // the reducer reads the first message as is, and LZ4 frames after it
+      batch_.clear();
+      append(agent, messages[agent.next++], now);
+      if (!send(agent, batch_, false)) {
+        return false;
+      }
+    }
+
+    batch_.clear();
+    while (agent.next < session.end && batch_.size() < batch_size) {
+      auto const &message = messages[agent.next];
+
+      u64 timestamp = now;
+      if (config_.speed > 0) {
+        u64 const first = messages[session.begin].timestamp;
+        u64 const offset = message.timestamp > first ? message.timestamp - first : 0;
+        timestamp = agent.session_start_ns + static_cast<u64>(offset / config_.speed);
+        if (timestamp > now) {
+          next_due = std::min(next_due, timestamp);
+          break;
+        }
+      }
+
+      append(agent, message, timestamp);
+      ++agent.next;
+    }
+
+    bool const sent = !batch_.empty();
+    if (sent && !send(agent, batch_, true)) {
+      return false;
+    }
+
+    if (agent.next == session.end) {
+      agent.socket.close();
+      if (++agent.session == agent.recording->sessions().size()) {
+        agent.session = 0;
+        if (++agent.loop == config_.loops) {
+          agent.done = true;
+        }
+      }
+    }
+
+    return sent;
+  }
+
+  void append(Agent const &agent, IngestRecording::Message const &message, u64 timestamp)
+  {
+    reducer::rewrite_ingest_message(
+        batch_, agent.recording->message(message), message.rpc_id, timestamp, agent.group);
+    ++counters_.messages;
+  }
+
+  bool send(Agent &agent, std::string_view data, bool compress)
+  {
+    counters_.bytes += data.size();
+
+    if (compress) {
+      data = compress_frame(data);
+    }
+
+    counters_.wire_bytes += data.size();
+
+    if (auto const error = agent.socket.write_all(data)) {
+      LOG::error("reducer_replay: failed to send {} bytes: {}", data.size(), error.message());
+      ++counters_.failed_sends;
+      agent.socket.close();
+      agent.done = true;
+      return false;
+    }
+
+    return true;
+  }
+
+  // Same framing as Lz4Channel: one LZ4 frame per send.
+  std::string_view compress_frame(std::string_view data)
+  {
+    auto check = [](std::size_t result) {
+      if (LZ4F_isError(result)) {
+        throw std::runtime_error(fmt::format("reducer_replay: compression failed: {}", LZ4F_getErrorName(result)));
+      }
+      return result;
+    };
+
+    std::size_t tail = check(LZ4F_compressBegin(lz4_ctx_.get(), compressed_.data(), compressed_.size(), nullptr));
+    tail += check(LZ4F_compressUpdate(
+        lz4_ctx_.get(), compressed_.data() + tail, compressed_.size() - tail, data.data(), data.size(), nullptr));
+    tail += check(LZ4F_compressEnd(lz4_ctx_.get(), compressed_.data() + tail, compressed_.size() - tail, nullptr));
+
+    return std::string_view(compressed_.data(), tail);
+  }
+
+  ReplayConfig const &config_;
+  Counters &counters_;
+  std::atomic<bool> const &stop_;
+  std::atomic<bool> done_{false};
+
+  std::vector<Agent> agents_;
+  std::string batch_;
+  std::vector<char> compressed_;
+  pod_unique_ptr<LZ4F_cctx, LZ4F_errorCode_t, LZ4F_freeCompressionContext> lz4_ctx_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct ScrapeResult {
+  std::string content;
+  u64 wire_bytes = 0;
+  u64 duration_ns = 0;
+};
+
+// Scrapes |url|, accepting any content coding curl supports, like Prometheus does.
+std::optional<ScrapeResult> scrape(std::string const &url)
+{
+  ScrapeResult result;
+
+  try {
+    curlpp::Easy request;
+    request.setOpt(new curlpp::options::Url(url));
+    request.setOpt(new curlpp::options::Encoding(""));
+    request.setOpt(new curlpp::options::WriteFunction([&result](char *ptr, size_t size, size_t nmemb) {
+      result.content.append(ptr, size * nmemb);
+      return size * nmemb;
+    }));
+
+    StopWatch<> watch;
+    request.perform();
+    result.duration_ns = watch.elapsed_ns();
+    result.wire_bytes = static_cast<u64>(curlpp::infos::SizeDownload::get(request));
+  } catch (std::exception const &e) {
+    LOG::error("reducer_replay: failed to scrape {}: {}", url, e.what());
+    return std::nullopt;
+  }
+
+  return result;
+}
+
+// Value of label |name| in the label set of a Prometheus sample, without braces.
+std::string_view label_value(std::string_view labels, std::string_view name)
+{
+  for (std::size_t pos = 0; pos < labels.size();) {
+    std::size_t const equals = labels.find("=\"", pos);
+    if (equals == std::string_view::npos) {
+      break;
+    }
+    std::size_t const end = labels.find('"', equals + 2);
+    if (end == std::string_view::npos) {
+      break;
+    }
+    if (labels.substr(pos, equals - pos) == name) {
+      return labels.substr(equals + 2, end - equals - 2);
+    }
+    pos = end + 2; // past the closing quote and the comma
+  }
+  return {};
+}
+
+// Calls |fn(name, labels, value, timestamp)| for each sample in Prometheus text format |content|.
+template <typename Fn> void foreach_sample(std::string_view content, Fn &&fn)
+{
+  while (!content.empty()) {
+    std::size_t const eol = content.find('\n');
+    std::string_view line = content.substr(0, eol);
+    content = eol == std::string_view::npos ? std::string_view() : content.substr(eol + 1);
+
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+
+    std::size_t const name_end = line.find_first_of("{ ");
+    if (name_end == std::string_view::npos) {
+      continue;
+    }
+    std::string_view const name = line.substr(0, name_end);
+
+    std::string_view labels;
+    std::size_t value_pos = name_end;
+    if (line[name_end] == '{') {
+      std::size_t const labels_end = line.find("} ", name_end);
+      if (labels_end == std::string_view::npos) {
+        continue;
+      }
+      labels = line.substr(name_end + 1, labels_end - name_end - 1);
+      value_pos = labels_end + 1;
+    }
+
+    std::string_view const rest = line.substr(value_pos + 1);
+    std::size_t const value_end = rest.find(' ');
+    std::string const value(rest.substr(0, value_end));
+    std::string_view const timestamp = value_end == std::string_view::npos ? std::string_view() : rest.substr(value_end + 1);
+
+    fn(name, labels, std::strtod(value.c_str(), nullptr), timestamp);
+  }
+}
+
+struct LatencyStats {
+  u64 max_ns = 0;
+  u64 sum_ns = 0;
+  u64 count = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class Replay {
+public:
+  Replay(
+      ReplayConfig config,
+      std::vector<IngestRecording> const &recordings,
+      reducer::ReducerConfig const &reducer_config,
+      std::optional<std::string> report_path)
+      : config_(std::move(config)),
+        recordings_(recordings),
+        stats_url_(local_url(reducer_config.internal_prom_bind)),
+        report_path_(std::move(report_path))
+  {
+    if (!reducer_config.disable_prometheus_metrics) {
+      metrics_url_ = local_url(reducer_config.prom_bind);
+    }
+    if (reducer_config.enable_otlp_grpc_metrics) {
+      LOG::warn("reducer_replay: internal stats are sent with OTLP, queue latency and memory per flow won't be reported");
+    }
+  }
+
+  // Called once a second on the reducer's main loop, until it calls |shutdown|.
+  void on_timer(std::function<void()> const &shutdown)
+  {
+    if (!started_) {
+      start();
+    }
+
+    if (scrape_watch_.elapsed(config_.scrape_interval)) {
+      scrape_watch_.reset();
+      scrape_all();
+    }
+
+    if (!finished_) {
+      if (config_.duration.count() > 0 && watch_.elapsed(config_.duration)) {
+        stop_ = true;
+      }
+
+      if (std::all_of(senders_.begin(), senders_.end(), [](auto const &sender) { return sender->done(); })) {
+        elapsed_ns_ = watch_.elapsed_ns();
+        finished_ = true;
+        for (auto &thread : threads_) {
+          thread.join();
+        }
+        LOG::info("reducer_replay: replay done, waiting {}s for the last stats", config_.settle.count());
+        settle_watch_.reset();
+      }
+      return;
+    }
+
+    if (settle_watch_.elapsed(config_.settle)) {
+      scrape_all();
+      report();
+      shutdown();
+    }
+  }
+
+private:
+  static std::string local_url(std::string_view bind)
+  {
+    return fmt::format("http://127.0.0.1:{}/", bind.substr(bind.rfind(':') + 1));
+  }
+
+  void start()
+  {
+    started_ = true;
+    baseline_rss_ = peak_rss();
+
+    u64 const now = fp_get_time_ns();
+    u64 const ramp_up_ns = integer_time<std::chrono::nanoseconds>(config_.ramp_up);
+
+    for (u32 i = 0; i < config_.num_threads; ++i) {
+      senders_.push_back(std::make_unique<Sender>(config_, counters_, stop_));
+    }
+
+    for (u32 k = 0; k < config_.num_agents; ++k) {
+      Agent agent{
+          .recording = &recordings_[k % recordings_.size()],
+          .group = static_cast<u32>(k / recordings_.size()),
+          .start_ns = now + ramp_up_ns * k / config_.num_agents,
+      };
+      senders_[k % senders_.size()]->add_agent(std::move(agent));
+    }
+
+    watch_.reset();
+    scrape_watch_.reset();
+    for (auto &sender : senders_) {
+      threads_.emplace_back(&Sender::run, sender.get());
+    }
+
+    LOG::info(
+        "reducer_replay: replaying {} recordings as {} agents on {} threads",
+        recordings_.size(),
+        config_.num_agents,
+        threads_.size());
+  }
+
+  static u64 peak_rss()
+  {
+    auto const usage = get_resource_usage();
+    return usage ? usage->max_resident_set_size : 0;
+  }
+
+  void scrape_all()
+  {
+    if (auto stats = scrape(stats_url_)) {
+      add_stats(stats->content);
+    }
+
+    if (metrics_url_) {
+      if (auto metrics = scrape(*metrics_url_)) {
+        ++num_scrapes_;
+        scrape_content_bytes_ += metrics->content.size();
+        scrape_wire_bytes_ += metrics->wire_bytes;
+        scrape_duration_ns_ += metrics->duration_ns;
+        max_scrape_duration_ns_ = std::max(max_scrape_duration_ns_, metrics->duration_ns);
+      }
+    }
+  }
+
+  void add_stats(std::string_view content)
+  {
+    u64 flows = 0;
+
+    foreach_sample(content, [&](std::string_view name, std::string_view labels, double value, std::string_view timestamp) {
+      if (name == "ebpf_net_rpc_latency_ns") {
+        // the same interval can be returned to more than one scrape
+        auto &last_timestamp = last_timestamps_[std::string(labels)];
+        if (last_timestamp == timestamp) {
+          return;
+        }
+        last_timestamp = timestamp;
+
+        auto const latency = static_cast<u64>(value);
+        if (latency == 0) {
+          return;
+        }
+        auto &stats = latencies_[fmt::format("{} -> {}", label_value(labels, "peer"), label_value(labels, "module"))];
+        stats.max_ns = std::max(stats.max_ns, latency);
+        stats.sum_ns += latency;
+        ++stats.count;
+      } else if (name == "ebpf_net_span_utilization") {
+        if (label_value(labels, "module") == "matching" && label_value(labels, "span") == "flow") {
+          flows += static_cast<u64>(value);
+        }
+      }
+    });
+
+    peak_flows_ = std::max(peak_flows_, flows);
+  }
+
+  void report()
+  {
+    double const seconds = elapsed_ns_ / 1e9;
+    u64 const messages = counters_.messages;
+    u64 const bytes = counters_.bytes;
+    u64 const wire_bytes = counters_.wire_bytes;
+    u64 const rss_growth = peak_rss() - baseline_rss_;
+
+    nlohmann::json json;
+
+    std::cout << "agents: " << config_.num_agents << ", connections: " << counters_.connections
+              << ", failed connections: " << counters_.failed_connections << ", failed sends: " << counters_.failed_sends
+              << std::endl;
+    std::cout << "replay time: " << seconds << " s" << std::endl;
+    std::cout << "messages/sec: " << messages / seconds << std::endl;
+    std::cout << "MB/sec: " << bytes / seconds / 1e6 << " (" << wire_bytes / seconds / 1e6 << " compressed)" << std::endl;
+
+    json["agents"] = config_.num_agents;
+    json["connections"] = counters_.connections.load();
+    json["failed_connections"] = counters_.failed_connections.load();
+    json["failed_sends"] = counters_.failed_sends.load();
+    json["replay_sec"] = seconds;
+    json["messages"] = messages;
+    json["messages_per_sec"] = messages / seconds;
+    json["bytes_per_sec"] = bytes / seconds;
+    json["wire_bytes_per_sec"] = wire_bytes / seconds;
+
+    std::cout << std::endl << "queue latency (max / mean of per-interval max):" << std::endl;
+    for (auto const &[stage, stats] : latencies_) {
+      double const mean_ns = static_cast<double>(stats.sum_ns) / stats.count;
+      std::cout << "  " << stage << ": " << stats.max_ns / 1e6 << " ms / " << mean_ns / 1e6 << " ms" << std::endl;
+      json["queue_latency"][stage] = {{"max_ns", stats.max_ns}, {"mean_ns", mean_ns}};
+    }
+
+    std::cout << std::endl << "peak flows: " << peak_flows_ << ", peak RSS growth: " << rss_growth / (1 << 20) << " MiB";
+    json["peak_flows"] = peak_flows_;
+    json["rss_growth_bytes"] = rss_growth;
+    if (peak_flows_ > 0) {
+      std::cout << ", bytes/flow: " << rss_growth / peak_flows_;
+      json["bytes_per_flow"] = rss_growth / peak_flows_;
+    }
+    std::cout << std::endl;
+
+    if (num_scrapes_ > 0) {
+      double const scrape_seconds = scrape_duration_ns_ / 1e9;
+      std::cout << std::endl
+                << "scrapes: " << num_scrapes_ << ", mean size: " << scrape_content_bytes_ / num_scrapes_ << " bytes ("
+                << scrape_wire_bytes_ / num_scrapes_ << " on the wire)"
+                << ", mean time: " << scrape_seconds * 1e3 / num_scrapes_ << " ms"
+                << ", max time: " << max_scrape_duration_ns_ / 1e6 << " ms"
+                << ", MB/sec: " << scrape_content_bytes_ / scrape_seconds / 1e6 << std::endl;
+      json["scrapes"] = {
+          {"count", num_scrapes_},
+          {"content_bytes", scrape_content_bytes_},
+          {"wire_bytes", scrape_wire_bytes_},
+          {"duration_ns", scrape_duration_ns_},
+          {"max_duration_ns", max_scrape_duration_ns_},
+      };
+    }
+
+    if (report_path_) {
+      std::ofstream out(*report_path_);
+      out << json.dump(2) << std::endl;
+      if (!out) {
+        LOG::error("reducer_replay: failed to write report to {}", *report_path_);
+      }
+    }
+  }
+
+  ReplayConfig const config_;
+  std::vector<IngestRecording> const &recordings_;
+  std::string const stats_url_;
+  std::optional<std::string> metrics_url_;
+  std::optional<std::string> report_path_;
+
+  Counters counters_;
+  std::atomic<bool> stop_{false};
+  std::vector<std::unique_ptr<Sender>> senders_;
+  std::vector<std::thread> threads_;
+
+  bool started_ = false;
+  bool finished_ = false;
+  StopWatch<> watch_;
+  StopWatch<> scrape_watch_;
+  StopWatch<> settle_watch_;
+  u64 elapsed_ns_ = 0;
+
+  u64 baseline_rss_ = 0;
+  u64 peak_flows_ = 0;
+  std::map<std::string, LatencyStats> latencies_;
+  std::map<std::string, std::string, std::less<>> last_timestamps_;
+
+  u64 num_scrapes_ = 0;
+  u64 scrape_content_bytes_ = 0;
+  u64 scrape_wire_bytes_ = 0;
+  u64 scrape_duration_ns_ = 0;
+  u64 max_scrape_duration_ns_ = 0;
+};
+
+// Each agent holds a socket.
+void raise_open_files_limit(u32 num_agents)
+{
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+    return;
+  }
+
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+
+  // the reducer has a socket for each agent too, and then some
+  if (limit.rlim_cur < 2 * static_cast<rlim_t>(num_agents) + 1024) {
+    LOG::warn("reducer_replay: open files limit of {} might be too low for {} agents", limit.rlim_cur, num_agents);
+  }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  uv_loop_t loop;
+  CHECK_UV(uv_loop_init(&loop));
+
+  cli::ArgsParser parser("Replays recorded collector ingest streams against an in-process reducer.");
+
+  args::HelpFlag help(*parser, "help", "Display this help menu", {'h', "help"});
+  args::ValueFlag<std::string> config_file(
+      *parser, "config_file", "Path to the reducer configuration file", {"c", "config-file"});
+  args::ValueFlag<u32> telemetry_port(*parser, "port", "TCP port for the reducer to listen on for agents", {'p', "port"});
+  args::ValueFlag<u32> num_agents(*parser, "count", "Number of synthetic agents", {"agents"}, 1);
+  args::ValueFlag<u32> num_threads(*parser, "count", "Number of threads sending the agents' messages", {"threads"}, 2);
+  args::ValueFlag<double> speed(
+      *parser, "factor", "Multiplies the recorded pace, 0 sends messages as fast as the reducer takes them", {"speed"}, 0);
+  args::ValueFlag<u32> loops(*parser, "count", "Number of times each agent replays its recording", {"loops"}, 1);
+  args::ValueFlag<u32> duration_sec(*parser, "seconds", "Stops replaying after this long, 0 for no limit", {"duration-sec"}, 0);
+  args::ValueFlag<u32> ramp_up_sec(*parser, "seconds", "Spreads agents' first connections over this long", {"ramp-up-sec"}, 0);
+  args::ValueFlag<u32> scrape_interval_sec(
+      *parser, "seconds", "Interval between scrapes of the reducer's metrics and internal stats", {"scrape-interval-sec"}, 10);
+  args::ValueFlag<u32> settle_sec(
+      *parser, "seconds", "Time to wait after the replay for the reducer to publish its last stats", {"settle-sec"}, 15);
+  args::ValueFlag<std::string> report_json(*parser, "path", "Also writes the report to this file in JSON", {"report-json"});
+  args::PositionalList<std::string> recording_paths(*parser, "recording", "Recorded ingest streams to replay");
+
+  if (auto result = parser.process(argc, argv); !result) {
+    return result.error();
+  }
+
+  if (recording_paths.Get().empty()) {
+    std::cerr << "no recordings to replay" << std::endl;
+    return 1;
+  }
+
+  ReplayConfig config{
+      .num_agents = num_agents.Get(),
+      .num_threads = std::max(1u, std::min(num_threads.Get(), num_agents.Get())),
+      .speed = speed.Get(),
+      .loops = std::max(1u, loops.Get()),
+      .duration = std::chrono::seconds(duration_sec.Get()),
+      .ramp_up = std::chrono::seconds(ramp_up_sec.Get()),
+      .scrape_interval = std::chrono::seconds(scrape_interval_sec.Get()),
+      .settle = std::chrono::seconds(settle_sec.Get()),
+      .port = 0,
+  };
+
+  std::vector<IngestRecording> recordings;
+  for (auto const &path : recording_paths.Get()) {
+    try {
+      recordings.push_back(IngestRecording::load(path.c_str()));
+    } catch (std::exception const &e) {
+      std::cerr << "unable to load recording " << path << ": " << e.what() << std::endl;
+      return 1;
+    }
+
+    auto const &recording = recordings.back();
+    std::cout << path << ": " << recording.messages().size() << " messages, " << recording.sessions().size() << " connections";
+    if (recording.truncated_bytes()) {
+      std::cout << ", " << recording.truncated_bytes() << " bytes truncated";
+    }
+    std::cout << std::endl;
+
+    if (recording.messages().empty()) {
+      std::cerr << "no messages to replay in " << path << std::endl;
+      return 1;
+    }
+  }
+
+  reducer::ReducerConfig reducer_config = reducer::DEFAULT_REDUCER_CONFIG;
+  if (config_file) {
+    try {
+      reducer::read_config_from_yaml(reducer_config, config_file.Get());
+    } catch (std::exception const &exc) {
+      std::cerr << "Unable to load configuration file: " << exc.what() << std::endl;
+      return 1;
+    }
+  }
+  if (telemetry_port) {
+    reducer_config.telemetry_port = telemetry_port.Get();
+  }
+  config.port = reducer_config.telemetry_port;
+
+  // queue latency and flow counts come from internal stats
+  if (reducer_config.enable_metrics.empty()) {
+    reducer_config.enable_metrics = "ebpf_net.all";
+  } else {
+    reducer_config.enable_metrics += ",ebpf_net.all";
+  }
+
+  raise_open_files_limit(config.num_agents);
+  // agents' sockets are closed by the reducer when it stops
+  signal(SIGPIPE, SIG_IGN);
+
+  curlpp::Cleanup curl_cleanup;
+
+  reducer::Reducer reducer(loop, reducer_config);
+  Replay replay(config, recordings, reducer_config, report_json ? std::make_optional(report_json.Get()) : std::nullopt);
+
+  std::function<void()> const shutdown = [&reducer] { reducer.shutdown(); };
+  scheduling::Timer timer(loop, [&replay, &shutdown] { replay.on_timer(shutdown); });
+  timer.start(1s, 1s);
+
+  reducer.startup();
+
+  // see the caveat on shutting down the reducer at the top
+  std::exit(0);
+}
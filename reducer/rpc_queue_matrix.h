@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <util/doorbell.h>
 #include <util/element_queue_cpp.h>
 #include <util/element_queue_writer.h>
 
@@ -26,19 +27,31 @@ public:
 
   // Constructs the object for |num_senders| senders and |num_receivers|
   // receivers.
+  //
+  // If |enable_doorbells| is set, each receiver gets a doorbell that is rung
+  // by writers to its queues, see doorbell().
   RpcQueueMatrix(
       size_t num_senders,
       size_t num_receivers,
       u32 queue_n_elems = default_queue_n_elems,
-      u32 queue_buf_len = default_queue_buf_len)
+      u32 queue_buf_len = default_queue_buf_len,
+      bool enable_doorbells = false)
       : num_senders_(num_senders), num_receivers_(num_receivers)
   {
+    if (enable_doorbells) {
+      doorbells_.reserve(num_receivers);
+      for (size_t i = 0; i < num_receivers; ++i) {
+        doorbells_.push_back(std::make_unique<Doorbell>());
+      }
+    }
+
     size_t const num_entries = num_receivers * num_senders;
 
     entries_.reserve(num_entries);
 
     for (size_t i = 0; i < num_entries; ++i) {
-      entries_.emplace_back(make_storage(queue_n_elems, queue_buf_len));
+      // receiver-major ordering
+      entries_.emplace_back(make_storage(queue_n_elems, queue_buf_len), doorbell(i / num_senders));
     }
   }
 
@@ -91,6 +104,14 @@ public:
     return writers;
   }
 
+  // Returns the doorbell rung when messages are written to any of the
+  // specified receiver's queues, or nullptr if doorbells are not enabled.
+  Doorbell *doorbell(size_t receiver) const
+  {
+    assert(receiver < num_receivers_);
+    return doorbells_.empty() ? nullptr : doorbells_[receiver].get();
+  }
+
   // Returns the number of senders this matrix is constructed for.
   size_t num_senders() const { return num_senders_; }
   // Returns the number of receivers this matrix is constructed for.
@@ -103,12 +124,17 @@ private:
     ElementQueue writer_queue;
     ElementQueueWriter queue_writer;
 
-    Entry(ElementQueueStoragePtr s) : storage(s), writer_queue(storage), queue_writer(writer_queue) {}
+    Entry(ElementQueueStoragePtr s, Doorbell *doorbell)
+        : storage(s), writer_queue(storage), queue_writer(writer_queue, doorbell)
+    {}
   };
 
   size_t num_senders_;
   size_t num_receivers_;
 
+  // One per receiver, if enabled.
+  std::vector<std::unique_ptr<Doorbell>> doorbells_;
+
   std::vector<Entry> entries_;
 
   static ElementQueueStoragePtr make_storage(u32 num_elems, u32 buf_len)
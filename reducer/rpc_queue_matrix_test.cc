@@ -8,6 +8,8 @@
 
 #include <string>
 
+#include <poll.h>
+
 namespace reducer {
 namespace {
 
@@ -106,5 +108,38 @@ TEST(RpcQueueMatrixTest, TestMessaging)
   }
 }
 
+TEST(RpcQueueMatrixTest, TestDoorbells)
+{
+  size_t const num_senders = 2;
+  size_t const num_receivers = 2;
+
+  RpcQueueMatrix without_doorbells(num_senders, num_receivers);
+  EXPECT_EQ(without_doorbells.doorbell(0), nullptr);
+
+  RpcQueueMatrix queues(
+      num_senders, num_receivers, RpcQueueMatrix::default_queue_n_elems, RpcQueueMatrix::default_queue_buf_len, true);
+  ASSERT_THAT(queues.doorbell(0), NotNull());
+  ASSERT_THAT(queues.doorbell(1), NotNull());
+  EXPECT_NE(queues.doorbell(0), queues.doorbell(1));
+
+  auto const is_readable = [](Doorbell *doorbell) {
+    pollfd pfd{.fd = doorbell->fd(), .events = POLLIN, .revents = 0};
+    return poll(&pfd, 1, 0) == 1;
+  };
+
+  queues.doorbell(0)->arm();
+  queues.doorbell(1)->arm();
+
+  std::vector<Writer> writers = queues.make_writers<Writer>(1);
+  std::string msg = make_msg(1, 1);
+  writers[1].write(msg.c_str(), msg.size());
+
+  EXPECT_FALSE(is_readable(queues.doorbell(0)));
+  EXPECT_TRUE(is_readable(queues.doorbell(1)));
+
+  queues.doorbell(0)->disarm();
+  queues.doorbell(1)->disarm();
+}
+
 } // namespace
 } // namespace reducer
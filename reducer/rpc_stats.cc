@@ -40,6 +40,17 @@ void RpcSenderStats::check_utilization()
   }
 }
 
+double RpcSenderStats::current_utilization() const
+{
+  double utilization = 0;
+  for (auto const &writer_ref : writers_) {
+    ElementQueue const &queue = writer_ref.get().queue();
+    utilization = std::max(utilization, queue.buf_used() / (double)queue.buf_capacity());
+    utilization = std::max(utilization, queue.elem_count() / (double)queue.elem_capacity());
+  }
+  return utilization;
+}
+
 void RpcSenderStats::write_internal_stats(InternalMetricsEncoder &encoder, u64 time_ns)
 {
   u64 num_write_stalls{0};
@@ -39,6 +39,11 @@ public:
   // Checks utilization of all queues this sender is writing to.
   void check_utilization();
 
+  // Returns the current utilization of the fullest queue this sender is
+  // writing to, as the ratio of usage and capacity of its buffer or elements,
+  // whichever is higher.
+  double current_utilization() const;
+
   // Writes stats out.
   void write_internal_stats(InternalMetricsEncoder &encoder, u64 time_ns);
 
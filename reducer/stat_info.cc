@@ -256,4 +256,40 @@ EbpfNetMetricInfo EbpfNetMetricInfo::rpc_write_stalls{
     " some definitions"
     " some description.",
     UNIT_DIMENSIONLESS};
+
+EbpfNetMetricInfo EbpfNetMetricInfo::span_committed{
+    EbpfNetMetrics::span_committed,
+    " Number of spans the span's pool has committed memory for."
+    " Grows in chunks with the number of allocated spans.",
+    UNIT_DIMENSIONLESS};
+
+EbpfNetMetricInfo EbpfNetMetricInfo::span_soft_limit{
+    EbpfNetMetrics::span_soft_limit,
+    " Number of allocated spans above which the span's pool is"
+    " considered under memory pressure.",
+    UNIT_DIMENSIONLESS};
+
+EbpfNetMetricInfo EbpfNetMetricInfo::prometheus_scrapes{
+    EbpfNetMetrics::prometheus_scrapes,
+    " Number of scrapes of the Prometheus metrics endpoint,"
+    " including failed ones.",
+    UNIT_DIMENSIONLESS};
+
+EbpfNetMetricInfo EbpfNetMetricInfo::prometheus_scrape_duration_ns{
+    EbpfNetMetrics::prometheus_scrape_duration_ns,
+    " Total time spent serving scrapes of the Prometheus metrics endpoint,"
+    " in nanoseconds, including compressing metrics for them.",
+    UNIT_DIMENSIONLESS};
+
+EbpfNetMetricInfo EbpfNetMetricInfo::prometheus_write_stall_ns{
+    EbpfNetMetrics::prometheus_write_stall_ns,
+    " Total time the aggregation cores spent publishing their metrics"
+    " for Prometheus to scrape, in nanoseconds.",
+    UNIT_DIMENSIONLESS};
+
+EbpfNetMetricInfo EbpfNetMetricInfo::span_soft_limit_exceeded{
+    EbpfNetMetrics::span_soft_limit_exceeded,
+    " Number of stats intervals in which the span's pool had more"
+    " allocated spans than its soft limit.",
+    UNIT_DIMENSIONLESS};
 } // namespace reducer
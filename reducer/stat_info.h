@@ -56,6 +56,12 @@ struct EbpfNetMetricInfo : public OutboundMetricInfo<EbpfNetMetrics> {
   static EbpfNetMetricInfo span_utilization_max;
   static EbpfNetMetricInfo time_since_last_message_ns;
   static EbpfNetMetricInfo up;
+  static EbpfNetMetricInfo span_committed;
+  static EbpfNetMetricInfo span_soft_limit;
+  static EbpfNetMetricInfo prometheus_scrapes;
+  static EbpfNetMetricInfo prometheus_scrape_duration_ns;
+  static EbpfNetMetricInfo prometheus_write_stall_ns;
+  static EbpfNetMetricInfo span_soft_limit_exceeded;
 };
 
 } // namespace reducer
@@ -54,9 +54,12 @@ void TsdbFormatter::set_timestamp(timestamp_t timestamp)
   timestamp_changed_ = true;
 }
 
-void TsdbFormatter::set_labels(labels_t labels)
+void TsdbFormatter::set_labels(labels_t const &labels)
 {
-  labels_ = std::move(labels);
+  labels_.clear();
+  for (auto const &[name, value] : labels) {
+    labels_.assign(name, value);
+  }
   labels_changed_ = true;
 }
 
@@ -64,25 +67,20 @@ void TsdbFormatter::set_labels(std::initializer_list<std::tuple<std::string_view
 {
   labels_.clear();
   for (auto const &[name, value] : labels) {
-    assign_label(name, value);
+    labels_.assign(name, value);
   }
   labels_changed_ = true;
 }
 
 void TsdbFormatter::assign_label(std::string_view name, std::string_view value)
 {
-  assign_label(std::string(name), std::string(value));
-}
-
-void TsdbFormatter::assign_label(std::string name, std::string value)
-{
-  labels_.insert_or_assign(name, value);
+  labels_.assign(name, value);
   labels_changed_ = true;
 }
 
 void TsdbFormatter::remove_label(std::string_view name)
 {
-  labels_.erase(std::string(name));
+  labels_.remove(name);
   labels_changed_ = true;
 }
 
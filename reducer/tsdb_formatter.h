@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include "label_set.h"
 #include "metric_info.h"
 #include "publisher.h"
 #include "tsdb_format.h"
@@ -40,6 +41,10 @@ namespace reducer {
 // to format and cache portions of the output that doesn't change between calls
 // to `write`.
 //
+// Labels are kept in a LabelSet that is reused from one time-series to the
+// next, so that formatting does not allocate once label names and values of
+// the expected sizes have been seen.
+//
 class TsdbFormatter {
   friend class OtlpGrpcFormatterTest;
 
@@ -51,6 +56,7 @@ public:
   using value_t = std::variant<u32, u64, double>;
   using rollup_t = std::optional<int>;
   using labels_t = std::map<std::string, std::string>;
+  using label_set_t = LabelSet;
   using timestamp_t = std::chrono::nanoseconds;
 
   virtual ~TsdbFormatter() {}
@@ -66,7 +72,7 @@ public:
   void set_timestamp(timestamp_t timestamp);
 
   // Assigns time-series labels (set of key/value pairs).
-  void set_labels(labels_t labels);
+  void set_labels(labels_t const &labels);
   void set_labels(std::initializer_list<std::tuple<std::string_view, std::string_view>> labels);
 
   // Helper function to set labels from NodeLabels, FlowLabels objects.
@@ -75,14 +81,14 @@ public:
     labels_.clear();
     labels.foreach ([this](std::string_view name, std::string_view value) {
       if (!value.empty()) {
-        assign_label(name, value);
+        labels_.assign(name, value);
       };
     });
+    labels_changed_ = true;
   }
 
   // Assigns a specific label.
   void assign_label(std::string_view name, std::string_view value);
-  void assign_label(std::string name, std::string value);
 
   // Removes a specific label.
   void remove_label(std::string_view name);
@@ -116,7 +122,7 @@ protected:
       bool aggregation_changed,
       rollup_t rollup,
       bool rollup_changed,
-      labels_t labels,
+      label_set_t const &labels,
       bool labels_changed,
       timestamp_t timestamp,
       bool timestamp_changed,
@@ -125,7 +131,7 @@ protected:
   // Subclasses that support formatting metrics as flow logs implement this function to do the actual formatting.
   virtual void format_flow_log(
       ebpf_net::metrics::tcp_metrics const &tcp_metrics,
-      labels_t labels,
+      label_set_t const &labels,
       bool labels_changed,
       timestamp_t timestamp,
       bool timestamp_changed){};
@@ -137,7 +143,7 @@ private:
   rollup_t rollup_;
   bool rollup_changed_{false};
 
-  labels_t labels_;
+  label_set_t labels_;
   bool labels_changed_{false};
 
   timestamp_t timestamp_{0};
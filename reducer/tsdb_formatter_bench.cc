@@ -0,0 +1,142 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+// Measures how fast the Prometheus formatter turns flows into time-series, and how many heap allocations it makes doing
+// so. Flows carry the full set of FlowLabels, and each flow is written as the TCP metrics, like TsdbEncoder does. The
+// publisher writer only counts bytes, so that formatting is what is being measured.
+//
+// Usage: tsdb_formatter_bench [n_flows] [distinct_flows]
+
+#include <reducer/aggregation/labels.h>
+#include <reducer/metric_info.h>
+#include <reducer/tsdb_formatter.h>
+#include <util/stop_watch.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::atomic<u64> n_allocations = 0;
+
+class CountingWriter : public reducer::Publisher::Writer {
+public:
+  void write(std::string_view prefix, std::string_view labels, std::string_view suffix) override
+  {
+    bytes_ += prefix.size() + labels.size() + suffix.size();
+  }
+
+  void flush() override {}
+
+  u64 bytes_written() const override { return bytes_; }
+
+private:
+  u64 bytes_ = 0;
+};
+
+reducer::aggregation::NodeLabels make_node(u64 i, std::string_view side)
+{
+  reducer::aggregation::NodeLabels node;
+  node.id = "i-0" + std::to_string(0x1234567890ull + i);
+  node.ip = "10." + std::to_string((i >> 16) & 0xff) + "." + std::to_string((i >> 8) & 0xff) + "." + std::to_string(i & 0xff);
+  node.az = "us-west-2" + std::string(1, 'a' + i % 3);
+  node.role = std::string(side) + "-service-" + std::to_string(i % 50);
+  node.role_uid = "0f1e2d3c-4b5a-6978-8796-a5b4c3d2e1f0";
+  node.version = "v1." + std::to_string(i % 7);
+  node.env = "production";
+  node.ns = "namespace-" + std::to_string(i % 10);
+  node.type = "K8S_CONTAINER";
+  node.process = "java";
+  node.container = std::string(side) + "-container";
+  node.pod = node.role + "-7d9f8b6c5d-" + std::to_string(10000 + i % 90000);
+  return node;
+}
+
+void write_flow(
+    reducer::TsdbFormatter &formatter,
+    reducer::aggregation::FlowLabels const &flow,
+    u64 i,
+    reducer::Publisher::WriterPtr const &writer)
+{
+  using reducer::TcpMetricInfo;
+
+  formatter.set_labels(flow);
+  formatter.set_aggregation("az_az");
+
+  formatter.write(TcpMetricInfo::bytes, u64(i * 1500), writer);
+  formatter.write(TcpMetricInfo::rtt_num_measurements, u32(i % 100), writer);
+  formatter.write(TcpMetricInfo::active, u32(i % 10), writer);
+  formatter.write(TcpMetricInfo::rtt_average, double(i % 1000) / 10, writer);
+  formatter.write(TcpMetricInfo::packets, u64(i), writer);
+  formatter.write(TcpMetricInfo::retrans, u32(i % 3), writer);
+  formatter.write(TcpMetricInfo::syn_timeouts, u32(0), writer);
+  formatter.write(TcpMetricInfo::new_sockets, u32(i % 5), writer);
+  formatter.write(TcpMetricInfo::resets, u32(i % 2), writer);
+}
+
+} // namespace
+
+void *operator new(std::size_t size)
+{
+  n_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+int main(int argc, char *argv[])
+{
+  u64 const n_flows = argc > 1 ? std::atoll(argv[1]) : 2'000'000;
+  u64 const distinct_flows = argc > 2 ? std::atoll(argv[2]) : 10'000;
+
+  if (distinct_flows == 0) {
+    std::cerr << "distinct_flows must be positive" << std::endl;
+    return 1;
+  }
+
+  std::vector<reducer::aggregation::FlowLabels> flows(distinct_flows);
+  for (u64 i = 0; i < distinct_flows; ++i) {
+    flows[i].src = make_node(i, "client");
+    flows[i].dst = make_node(i * 7919 % distinct_flows, "server");
+  }
+
+  auto formatter = reducer::TsdbFormatter::make(reducer::TsdbFormat::prometheus);
+  reducer::Publisher::WriterPtr writer = std::make_unique<CountingWriter>();
+  formatter->set_timestamp(std::chrono::nanoseconds(1'700'000'000'000'000'000));
+
+  /* the first pass interns label names and sizes the label arena */
+  for (u64 i = 0; i < distinct_flows; ++i) {
+    write_flow(*formatter, flows[i], i, writer);
+  }
+
+  u64 const allocations_before = n_allocations.load();
+  StopWatch<> watch;
+  for (u64 i = 0; i < n_flows; ++i) {
+    write_flow(*formatter, flows[i % distinct_flows], i, writer);
+  }
+  double const ns = watch.elapsed_ns();
+  u64 const allocations = n_allocations.load() - allocations_before;
+
+  u64 const n_series = n_flows * 9;
+  std::cout << n_flows << " flows, " << n_series << " time-series, " << writer->bytes_written() << " bytes" << std::endl;
+  std::cout << "  " << ns / n_series << " ns/series, " << n_series * 1e3 / ns << " Mseries/s" << std::endl;
+  std::cout << "  " << allocations << " allocations, " << double(allocations) / n_series << " allocations/series"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,66 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include "connection_balancer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+#include <stdexcept>
+
+ConnectionBalancer::ConnectionBalancer(std::size_t num_workers, Options const &options)
+    : options_(options), loads_(num_workers, 0.0)
+{
+  if (num_workers == 0) {
+    throw std::invalid_argument("ConnectionBalancer: need at least one worker");
+  }
+}
+
+std::optional<ConnectionBalancer::Migration> ConnectionBalancer::update_load(std::vector<u64> const &received_bytes)
+{
+  assert(received_bytes.size() == num_workers());
+
+  for (std::size_t i = 0; i < loads_.size(); ++i) {
+    loads_[i] += options_.smoothing * (received_bytes[i] - loads_[i]);
+  }
+
+  if (num_workers() < 2) {
+    return std::nullopt;
+  }
+
+  auto const [min, max] = std::minmax_element(loads_.begin(), loads_.end());
+
+  bool const imbalanced = (*max >= options_.min_bytes) && (*max >= options_.imbalance_ratio * *min);
+  if (!imbalanced) {
+    imbalanced_updates_ = 0;
+    return std::nullopt;
+  }
+
+  if (++imbalanced_updates_ < options_.sustained_updates) {
+    return std::nullopt;
+  }
+
+  // wait for the imbalance to be sustained again before the next move, giving
+  // the collector time to reconnect and the loads time to reflect it
+  imbalanced_updates_ = 0;
+  ++num_migrations_;
+
+  return Migration{
+      .worker = static_cast<std::size_t>(max - loads_.begin()),
+      .max_bytes = (*max - *min) / 2,
+  };
+}
+
+std::vector<double> ConnectionBalancer::steering_weights() const
+{
+  double const mean = std::accumulate(loads_.begin(), loads_.end(), 0.0) / loads_.size();
+
+  // the floor of a quarter of the mean caps how much an idle worker is
+  // favored over an averagely loaded one
+  std::vector<double> weights;
+  weights.reserve(loads_.size());
+  for (double const load : loads_) {
+    weights.push_back((mean + 1) / (load + mean / 4 + 1));
+  }
+  return weights;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <platform/types.h>
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+// Balances collector connections across ingest workers by the bytes they
+// receive, rather than by how many connections they have.
+//
+// New connections are steered away from busy workers (see
+// `steering_weights()`). When one worker stays busier than the others, a
+// connection is moved away from it: it is closed, and the collector's
+// reconnection lands on another worker.
+//
+// Must be used from a single thread.
+//
+class ConnectionBalancer {
+public:
+  struct Options {
+    // The busiest worker is considered imbalanced when its load is at least
+    // this many times the least busy worker's load...
+    double imbalance_ratio = 2.0;
+    // ...and at least this many bytes per update.
+    double min_bytes = 64 << 20;
+    // Consecutive imbalanced updates needed before moving a connection.
+    u32 sustained_updates = 3;
+    // Weight of each new sample in the smoothed load, between 0 and 1.
+    double smoothing = 0.5;
+  };
+
+  // A connection to move away from `worker`. Moving more than `max_bytes` per
+  // update would make `worker` the least busy worker, swapping the imbalance.
+  struct Migration {
+    std::size_t worker;
+    double max_bytes;
+  };
+
+  // Constructs a balancer for `num_workers` workers, with `num_workers` > 0.
+  explicit ConnectionBalancer(std::size_t num_workers) : ConnectionBalancer(num_workers, Options{}) {}
+  ConnectionBalancer(std::size_t num_workers, Options const &options);
+
+  // Feeds the bytes received by each worker since the previous update.
+  // Returns the connection to move if the imbalance has been sustained.
+  std::optional<Migration> update_load(std::vector<u64> const &received_bytes);
+
+  // Odds of new connections going to each worker, inversely related to the
+  // workers' load. The least busy worker is favored at most by a factor of a
+  // few, so that a burst of reconnections doesn't all land on it.
+  std::vector<double> steering_weights() const;
+
+  std::size_t num_workers() const { return loads_.size(); }
+
+  // Smoothed bytes per update received by `worker`.
+  double load(std::size_t worker) const { return loads_[worker]; }
+  // Number of connections moved so far.
+  u64 num_migrations() const { return num_migrations_; }
+
+private:
+  Options options_;
+
+  std::vector<double> loads_;
+
+  u32 imbalanced_updates_{0};
+  u64 num_migrations_{0};
+};
@@ -0,0 +1,92 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include "connection_balancer.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+static constexpr u64 MB = 1 << 20;
+
+TEST(connection_balancer, single_worker)
+{
+  ConnectionBalancer balancer(1);
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_FALSE(balancer.update_load({1000 * MB}));
+  }
+  ASSERT_EQ(balancer.steering_weights().size(), 1u);
+  EXPECT_GT(balancer.steering_weights()[0], 0.0);
+}
+
+TEST(connection_balancer, balanced_load_does_not_move)
+{
+  ConnectionBalancer balancer(4);
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_FALSE(balancer.update_load({500 * MB, 400 * MB, 450 * MB, 300 * MB}));
+  }
+  EXPECT_EQ(balancer.num_migrations(), 0u);
+}
+
+TEST(connection_balancer, light_load_does_not_move)
+{
+  ConnectionBalancer balancer(2);
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_FALSE(balancer.update_load({10 * MB, 0}));
+  }
+  EXPECT_EQ(balancer.num_migrations(), 0u);
+}
+
+TEST(connection_balancer, sustained_imbalance_moves_from_busiest)
+{
+  ConnectionBalancer::Options options;
+  options.smoothing = 1.0;
+  ConnectionBalancer balancer(3, options);
+
+  EXPECT_FALSE(balancer.update_load({100 * MB, 900 * MB, 300 * MB}));
+  EXPECT_FALSE(balancer.update_load({100 * MB, 900 * MB, 300 * MB}));
+
+  auto const migration = balancer.update_load({100 * MB, 900 * MB, 300 * MB});
+  ASSERT_TRUE(migration);
+  EXPECT_EQ(migration->worker, 1u);
+  EXPECT_DOUBLE_EQ(migration->max_bytes, 400.0 * MB);
+  EXPECT_EQ(balancer.num_migrations(), 1u);
+
+  // the imbalance has to be sustained again before the next move
+  EXPECT_FALSE(balancer.update_load({100 * MB, 900 * MB, 300 * MB}));
+}
+
+TEST(connection_balancer, interrupted_imbalance_does_not_move)
+{
+  ConnectionBalancer::Options options;
+  options.smoothing = 1.0;
+  ConnectionBalancer balancer(2, options);
+
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_FALSE(balancer.update_load({100 * MB, 900 * MB}));
+    EXPECT_FALSE(balancer.update_load({100 * MB, 900 * MB}));
+    EXPECT_FALSE(balancer.update_load({500 * MB, 500 * MB}));
+  }
+}
+
+TEST(connection_balancer, steering_favors_least_busy)
+{
+  ConnectionBalancer::Options options;
+  options.smoothing = 1.0;
+  ConnectionBalancer balancer(3, options);
+
+  auto weights = balancer.steering_weights();
+  EXPECT_EQ(weights[0], weights[1]);
+  EXPECT_EQ(weights[1], weights[2]);
+
+  balancer.update_load({0, 100 * MB, 500 * MB});
+  weights = balancer.steering_weights();
+  EXPECT_GT(weights[0], weights[1]);
+  EXPECT_GT(weights[1], weights[2]);
+
+  // an idle worker is favored, but not without bounds
+  EXPECT_LT(weights[0], 5 * weights[1]);
+}
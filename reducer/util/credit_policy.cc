@@ -0,0 +1,41 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include "credit_policy.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+CreditPolicy::CreditPolicy(Options const &options) : options_(options)
+{
+  if (!(options_.low_watermark >= 0 && options_.low_watermark < options_.high_watermark && options_.high_watermark <= 1)) {
+    throw std::invalid_argument("CreditPolicy: watermarks must be ordered, between 0 and 1");
+  }
+  if (options_.min_grant == 0 || options_.min_grant > options_.max_grant) {
+    throw std::invalid_argument("CreditPolicy: grants must be positive, the minimum below the maximum");
+  }
+}
+
+std::optional<u64> CreditPolicy::next_grant(std::optional<u64> last_grant, u64 sent_bytes, double utilization) const
+{
+  if (utilization <= options_.low_watermark) {
+    if (!last_grant) {
+      return std::nullopt;
+    }
+    // a collector not using half of its grant is no longer held back
+    if (sent_bytes < *last_grant / 2 || *last_grant >= options_.max_grant / 2) {
+      return std::nullopt;
+    }
+    return *last_grant * 2;
+  }
+
+  if (utilization >= options_.high_watermark) {
+    return options_.min_grant;
+  }
+
+  double const position = (utilization - options_.low_watermark) / (options_.high_watermark - options_.low_watermark);
+  double const scale = 1 - position * (1 - options_.min_scale);
+
+  u64 const sent = last_grant ? std::min(*last_grant, sent_bytes) : sent_bytes;
+  return std::max(options_.min_grant, static_cast<u64>(sent * scale));
+}
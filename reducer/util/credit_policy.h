@@ -0,0 +1,49 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <platform/types.h>
+
+#include <optional>
+
+// Decides how many bytes each collector connection may send in the next
+// interval, from the utilization of the queues the connection's data goes to.
+//
+// While the queues have room, collectors are not limited. As they fill up,
+// each collector is held to a shrinking share of what it sent in the last
+// interval, down to a floor that keeps heartbeats flowing. Once the queues
+// drain, limits are raised gradually and then lifted, so that the data
+// collectors held back doesn't fill the queues right away.
+//
+class CreditPolicy {
+public:
+  struct Options {
+    // Below this queue utilization, collectors are not limited, or have their
+    // limit raised if they were.
+    double low_watermark = 0.5;
+    // At this queue utilization and above, collectors only get `min_grant`.
+    double high_watermark = 0.9;
+    // Between the watermarks, a collector gets what it sent in the last
+    // interval, scaled from 1 at the low watermark down to this at the high
+    // watermark.
+    double min_scale = 0.5;
+    // Smallest grant, in bytes per interval.
+    u64 min_grant = 64 << 10;
+    // Raised limits are lifted once they reach this many bytes per interval.
+    u64 max_grant = 64 << 20;
+  };
+
+  CreditPolicy() : CreditPolicy(Options{}) {}
+  explicit CreditPolicy(Options const &options);
+
+  // Returns the bytes to grant for the next interval to a connection that was
+  // granted |last_grant| for the last one and sent |sent_bytes| in it, with
+  // the queues at |utilization|, between 0 and 1. No grant means no limit.
+  std::optional<u64> next_grant(std::optional<u64> last_grant, u64 sent_bytes, double utilization) const;
+
+private:
+  Options options_;
+};
@@ -0,0 +1,72 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include "credit_policy.h"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+static constexpr u64 KB = 1 << 10;
+static constexpr u64 MB = 1 << 20;
+
+TEST(credit_policy, no_limit_while_queues_have_room)
+{
+  CreditPolicy const policy;
+
+  EXPECT_FALSE(policy.next_grant(std::nullopt, 0, 0.0));
+  EXPECT_FALSE(policy.next_grant(std::nullopt, 100 * MB, 0.5));
+}
+
+TEST(credit_policy, limit_shrinks_as_queues_fill)
+{
+  CreditPolicy const policy;
+
+  EXPECT_EQ(policy.next_grant(std::nullopt, 10 * MB, 0.7), 7.5 * MB);
+
+  // a limited collector can't be granted more than it was
+  EXPECT_EQ(policy.next_grant(4 * MB, 10 * MB, 0.7), 3 * MB);
+
+  auto const fuller = policy.next_grant(std::nullopt, 10 * MB, 0.8);
+  ASSERT_TRUE(fuller);
+  EXPECT_LT(*fuller, 7.5 * MB);
+}
+
+TEST(credit_policy, floor_when_queues_are_full)
+{
+  CreditPolicy::Options options;
+  options.min_grant = 16 * KB;
+  CreditPolicy const policy(options);
+
+  EXPECT_EQ(policy.next_grant(std::nullopt, 10 * MB, 0.9), 16 * KB);
+  EXPECT_EQ(policy.next_grant(1 * MB, 1 * MB, 1.0), 16 * KB);
+
+  // heartbeats keep flowing at any utilization
+  EXPECT_EQ(policy.next_grant(16 * KB, 1 * KB, 0.8), 16 * KB);
+}
+
+TEST(credit_policy, limit_is_raised_then_lifted)
+{
+  CreditPolicy::Options options;
+  options.max_grant = 8 * MB;
+  CreditPolicy const policy(options);
+
+  EXPECT_EQ(policy.next_grant(1 * MB, 1 * MB, 0.2), 2 * MB);
+  EXPECT_EQ(policy.next_grant(2 * MB, 2 * MB, 0.2), 4 * MB);
+  EXPECT_FALSE(policy.next_grant(4 * MB, 4 * MB, 0.2));
+
+  // no need for a limit the collector doesn't reach
+  EXPECT_FALSE(policy.next_grant(1 * MB, 100 * KB, 0.2));
+}
+
+TEST(credit_policy, rejects_invalid_options)
+{
+  CreditPolicy::Options options;
+  options.low_watermark = 0.9;
+  options.high_watermark = 0.5;
+  EXPECT_THROW(CreditPolicy{options}, std::invalid_argument);
+
+  options = {};
+  options.min_grant = 0;
+  EXPECT_THROW(CreditPolicy{options}, std::invalid_argument);
+}
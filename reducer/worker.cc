@@ -4,6 +4,7 @@
 #include <reducer/worker.h>
 
 #include <channel/callbacks.h>
+#include <channel/io_uring_channel.h>
 #include <channel/tcp_channel.h>
 #include <reducer/ingest/component.h>
 #include <reducer/util/thread_ops.h>
@@ -17,16 +18,34 @@
 #include <absl/synchronization/notification.h>
 #include <uv.h>
 
+#include <cerrno>
+#include <cstring>
 #include <iostream>
 #include <memory>
+#include <system_error>
 #include <thread>
 #include <unistd.h>
 #include <vector>
 
+#include <sys/socket.h>
+
 namespace reducer {
 
 namespace {
 
+// Buffers shared by the connections of a worker when reading with io_uring,
+// sized after the collectors' writes.
+constexpr u32 io_uring_buffer_count = 1024;
+constexpr u32 io_uring_buffer_size = 16 * 1024;
+
+// How long to wait before accepting again after an accept failed, e.g.
+// because the process ran out of file descriptors.
+constexpr auto accept_retry_delay = std::chrono::milliseconds(100);
+
+// Connections younger than this are not shed, their receive rate being
+// dominated by the initial burst of a collector's state.
+constexpr auto min_shed_connection_age = std::chrono::minutes(1);
+
 // Decorator class for the user-provided Callbacks to provide some Worker
 // class state management.
 class WorkerCallbacksDecorator : public ::channel::Callbacks {
@@ -34,15 +53,23 @@ public:
   WorkerCallbacksDecorator(
       std::unique_ptr<::channel::Callbacks> underlying_callbacks,
       std::function<void()> close_cb,
-      ::channel::TCPChannel *const tcp_channel)
-      : underlying_callbacks_(std::move(underlying_callbacks)), close_cb_(std::move(close_cb)), tcp_channel_(tcp_channel)
+      ::channel::ServerChannel *const channel,
+      std::atomic<u64> &worker_received_bytes)
+      : underlying_callbacks_(std::move(underlying_callbacks)),
+        close_cb_(std::move(close_cb)),
+        channel_(channel),
+        worker_received_bytes_(worker_received_bytes),
+        opened_at_(std::chrono::steady_clock::now())
   {}
 
   ~WorkerCallbacksDecorator() override = default;
 
   uint32_t received_data(const uint8_t *const data, const int data_len) override
   {
-    return underlying_callbacks_->received_data(data, data_len);
+    uint32_t const consumed = underlying_callbacks_->received_data(data, data_len);
+    received_bytes_ += consumed;
+    worker_received_bytes_.fetch_add(consumed, std::memory_order_relaxed);
+    return consumed;
   }
 
   void on_error(int err) override
@@ -51,7 +78,7 @@ public:
 
     // UV_EOF indicates that the connection has closed.
     if (err == UV_EOF) {
-      tcp_channel_->close_permanently();
+      channel_->close_permanently();
     }
   }
 
@@ -65,19 +92,42 @@ public:
 
   ::channel::Callbacks *underlying_callbacks() { return underlying_callbacks_.get(); }
 
+  // Time since the connection was opened.
+  std::chrono::steady_clock::duration age() const { return std::chrono::steady_clock::now() - opened_at_; }
+
+  // Bytes received since the connection was opened.
+  u64 received_bytes() const { return received_bytes_; }
+
+  // Bytes received per second on average since the connection was opened.
+  double receive_rate() const
+  {
+    return received_bytes_ / std::chrono::duration_cast<std::chrono::duration<double>>(age()).count();
+  }
+
 private:
   std::unique_ptr<::channel::Callbacks> underlying_callbacks_;
   const std::function<void()> close_cb_;
-  ::channel::TCPChannel *const tcp_channel_;
+  ::channel::ServerChannel *const channel_;
+  std::atomic<u64> &worker_received_bytes_;
+  const std::chrono::steady_clock::time_point opened_at_;
+  u64 received_bytes_ = 0;
 };
 
 } // namespace
 
-Worker::Worker()
+Worker::Worker(bool io_uring)
 {
   // Initialize the uv loop.
   CHECK_UV(uv_loop_init(&loop_));
 
+  if (io_uring) {
+    try {
+      io_uring_receiver_ = std::make_unique<::channel::IoUringReceiver>(loop_, io_uring_buffer_count, io_uring_buffer_size);
+    } catch (std::system_error const &e) {
+      LOG::warn("Worker: io_uring is not available, reading connections with libuv instead: {}", e.what());
+    }
+  }
+
   // Initialize the async for opening tcp sockets.
   CHECK_UV(uv_async_init(&loop_, &open_tcp_socks_async_, &Worker::open_tcp_socks_async_cb));
   open_tcp_socks_async_.data = this;
@@ -94,6 +144,10 @@ Worker::Worker()
 Worker::~Worker()
 {
   stop();
+
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+  }
 }
 
 void Worker::start(std::size_t thread_num)
@@ -106,6 +160,7 @@ void Worker::start(std::size_t thread_num)
     on_thread_start();
     thread_started_.Notify();
     uv_run(&loop_, UV_RUN_DEFAULT);
+    close_io_uring_channels();
     close_uv_loop_cleanly(&loop_);
     on_thread_stop();
   });
@@ -115,6 +170,38 @@ void Worker::start(std::size_t thread_num)
   LOG::trace_in(ingest::Component::worker, "Worker {:p} started", (void *)this);
 }
 
+void Worker::listen(struct sockaddr_in const &addr, int backlog)
+{
+  // Verify that start() has not been called.
+  if (started_) {
+    LOG::critical("Make sure to call Worker::listen() before Worker::start()");
+    std::exit(1);
+  }
+
+  int const fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(), "could not create listening socket");
+  }
+
+  int const reuse = 1;
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+      setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) != 0 ||
+      bind(fd, reinterpret_cast<struct sockaddr const *>(&addr), sizeof(addr)) != 0 || ::listen(fd, backlog) != 0) {
+    int const error = errno;
+    close(fd);
+    throw std::system_error(error, std::generic_category(), "could not listen");
+  }
+  listen_fd_ = fd;
+
+  // the loop isn't running yet, so its handles can be set up from this thread
+  CHECK_UV(uv_poll_init(&loop_, &listen_poll_, listen_fd_));
+  listen_poll_.data = this;
+  CHECK_UV(uv_poll_start(&listen_poll_, UV_READABLE, &Worker::listen_poll_cb));
+
+  CHECK_UV(uv_timer_init(&loop_, &accept_retry_timer_));
+  accept_retry_timer_.data = this;
+}
+
 void Worker::stop()
 {
   if (!started_) {
@@ -143,17 +230,26 @@ void Worker::assign(const uv_tcp_t &tcp_conn)
   CHECK_UV(uv_fileno(reinterpret_cast<const uv_handle_t *>(&tcp_conn), reinterpret_cast<uv_os_fd_t *>(&fd)));
 
   // Duplicate the file descriptor and add it to the fd queue.
-  const uv_os_sock_t fd_dupe = dup(fd);
+  assign_fd(dup(fd));
+}
+
+void Worker::assign_fd(const uv_os_sock_t fd)
+{
+  // Verify that start() has been called.
+  if (!started_) {
+    LOG::critical("Make sure to call Worker::start() before accepting tcp connections");
+    std::exit(1);
+  }
+
   {
     absl::MutexLock l(&mu_);
-    tcp_sock_fds_.push_back(fd_dupe);
+    tcp_sock_fds_.push_back(fd);
   }
 
   // Tell the uv loop to open the TCP connection.
   CHECK_UV(uv_async_send(&open_tcp_socks_async_));
 
-  LOG::trace_in(
-      ingest::Component::worker, "Worker {:p}: assigned file descriptor {}", (void *)this, reinterpret_cast<int>(fd_dupe));
+  LOG::trace_in(ingest::Component::worker, "Worker {:p}: assigned file descriptor {}", (void *)this, reinterpret_cast<int>(fd));
 }
 
 std::shared_ptr<absl::Notification> Worker::visit_thread(std::function<void()> cb)
@@ -190,7 +286,47 @@ std::shared_ptr<absl::Notification> Worker::visit_callbacks(CallbacksCb cb)
   });
 }
 
-std::unique_ptr<channel::Callbacks> Worker::create_callbacks(uv_loop_t &loop, ::channel::TCPChannel * /* unused */)
+void Worker::for_each_connection(ConnectionBytesCb const &cb)
+{
+  for (auto &kv : tcp_channel_to_payload_) {
+    auto *const callbacks_decorator = static_cast<WorkerCallbacksDecorator *>(kv.second.callbacks.get());
+    cb(callbacks_decorator->underlying_callbacks(), callbacks_decorator->received_bytes());
+  }
+}
+
+void Worker::shed_connection(double max_rate)
+{
+  static_cast<void>(visit_thread([this, max_rate] {
+    if (tcp_channel_to_payload_.size() < 2) {
+      return;
+    }
+
+    ::channel::ServerChannel *shed = nullptr;
+    double shed_rate = 0;
+    for (auto const &kv : tcp_channel_to_payload_) {
+      auto const *const callbacks = static_cast<WorkerCallbacksDecorator const *>(kv.second.callbacks.get());
+      if (callbacks->age() < min_shed_connection_age) {
+        continue;
+      }
+      double const rate = callbacks->receive_rate();
+      if (rate <= max_rate && (!shed || rate > shed_rate)) {
+        shed = kv.first;
+        shed_rate = rate;
+      }
+    }
+
+    if (!shed) {
+      LOG::debug("Worker {:p}: no connection to shed under {} bytes/s", (void *)this, max_rate);
+      return;
+    }
+
+    LOG::info(
+        "Worker {:p}: closing a connection receiving {:.0f} bytes/s to move it to another worker", (void *)this, shed_rate);
+    shed->close_permanently();
+  }));
+}
+
+std::unique_ptr<channel::Callbacks> Worker::create_callbacks(uv_loop_t &loop, ::channel::ServerChannel * /* unused */)
 {
   return std::make_unique<channel::Callbacks>();
 }
@@ -208,26 +344,113 @@ void Worker::open_tcp_socks_async_cb(uv_async_t *const handle)
 
   // Create a new tcp connection for each socket fd.
   for (const uv_os_sock_t &fd : tcp_sock_fds) {
-    TcpPayload payload;
+    worker->open_channel(fd);
+  }
+
+  // Submit the receives of all new connections at once.
+  if (worker->io_uring_receiver_) {
+    worker->io_uring_receiver_->submit();
+  }
+}
+
+void Worker::listen_poll_cb(uv_poll_t *const handle, int status, int events)
+{
+  auto *const worker = reinterpret_cast<Worker *>(handle->data);
+
+  if (status < 0) {
+    LOG::error("Worker {:p}: error polling for new connections: {}", (void *)worker, uv_strerror(status));
+    return;
+  }
+  worker->accept_connections();
+}
+
+void Worker::accept_retry_timer_cb(uv_timer_t *const timer)
+{
+  auto *const worker = reinterpret_cast<Worker *>(timer->data);
+  CHECK_UV(uv_poll_start(&worker->listen_poll_, UV_READABLE, &Worker::listen_poll_cb));
+}
+
+void Worker::accept_connections()
+{
+  for (;;) {
+    int const fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd >= 0) {
+      open_channel(fd);
+      continue;
+    }
+
+    if (errno == EINTR || errno == ECONNABORTED) {
+      continue;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      // the connection stays pending, accepting it again right away would spin
+      LOG::error("Worker {:p}: error accepting new connection: {}", (void *)this, strerror(errno));
+      CHECK_UV(uv_poll_stop(&listen_poll_));
+      CHECK_UV(uv_timer_start(
+          &accept_retry_timer_,
+          &Worker::accept_retry_timer_cb,
+          std::chrono::duration_cast<std::chrono::milliseconds>(accept_retry_delay).count(),
+          0));
+    }
+    break;
+  }
+
+  // Submit the receives of all new connections at once.
+  if (io_uring_receiver_) {
+    io_uring_receiver_->submit();
+  }
+}
+
+void Worker::open_channel(const uv_os_sock_t fd)
+{
+  TcpPayload payload;
+
+  // Instantiate the channel.
+  ::channel::TCPChannel *tcp_channel = nullptr;
+  ::channel::IoUringChannel *io_uring_channel = nullptr;
+  if (io_uring_receiver_) {
+    auto channel = std::make_unique<::channel::IoUringChannel>(*io_uring_receiver_);
+    io_uring_channel = channel.get();
+    payload.channel = std::move(channel);
+  } else {
+    auto channel = std::make_unique<::channel::TCPChannel>(loop_);
+    tcp_channel = channel.get();
+    payload.channel = std::move(channel);
+  }
+  auto *const channel_ptr = payload.channel.get();
+
+  // Create the callbacks.
+  payload.callbacks = std::make_unique<WorkerCallbacksDecorator>(
+      create_callbacks(loop_, channel_ptr),
+      [this, channel_ptr] { tcp_channel_to_payload_.erase(channel_ptr); },
+      channel_ptr,
+      received_bytes_);
 
-    // Instantiate the TCP channel.
-    payload.tcp_channel = std::make_unique<::channel::TCPChannel>(worker->loop_);
-    auto *const tcp_channel_ptr = payload.tcp_channel.get();
+  // Store the payload.
+  TcpPayload *const payload_ptr = &tcp_channel_to_payload_.emplace(channel_ptr, std::move(payload)).first->second;
 
-    // Create the callbacks.
-    payload.callbacks = std::make_unique<WorkerCallbacksDecorator>(
-        worker->create_callbacks(worker->loop_, tcp_channel_ptr),
-        [worker, tcp_channel_ptr] { worker->tcp_channel_to_payload_.erase(tcp_channel_ptr); },
-        tcp_channel_ptr);
+  payload_ptr->callbacks->on_connect();
 
-    // Store the payload.
-    TcpPayload *const payload_ptr = &worker->tcp_channel_to_payload_.emplace(tcp_channel_ptr, std::move(payload)).first->second;
+  // Start accepting messages.
+  if (io_uring_channel) {
+    io_uring_channel->open_fd(*payload_ptr->callbacks, fd);
+  } else {
+    tcp_channel->open_fd(*payload_ptr->callbacks, fd);
+  }
+}
 
-    payload_ptr->callbacks->on_connect();
+void Worker::close_io_uring_channels()
+{
+  if (!io_uring_receiver_) {
+    return;
+  }
 
-    // Start accepting messages.
-    tcp_channel_ptr->open_fd(*payload_ptr->callbacks, fd);
+  // channels are removed from the map once their receive completes
+  for (auto &kv : tcp_channel_to_payload_) {
+    kv.first->close_permanently();
   }
+  io_uring_receiver_->drain();
+  io_uring_receiver_.reset();
 }
 
 void Worker::stop_async_cb(uv_async_t *const handle)
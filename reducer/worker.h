@@ -6,6 +6,8 @@
 #pragma once
 
 #include "channel/callbacks.h"
+#include "channel/io_uring_channel.h"
+#include "channel/server_channel.h"
 #include "channel/tcp_channel.h"
 
 #include "absl/base/thread_annotations.h"
@@ -15,10 +17,14 @@
 
 #include <uv.h>
 
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <thread>
 #include <vector>
 
+#include <netinet/in.h>
+
 namespace reducer {
 
 // This class is responsible for accepting TCP connections (presumably from a
@@ -30,7 +36,9 @@ public:
   // The size of the internally allocated buffer in which messages are stored.
   static const std::size_t kBufferSize = 64 << 10; // 64 KiB
 
-  Worker();
+  // If |io_uring| is set, connections are read with io_uring rather than
+  // libuv, when the kernel allows it (see channel::IoUringReceiver).
+  explicit Worker(bool io_uring = false);
   virtual ~Worker();
 
   // Starts the event-processing thread for this worker
@@ -47,6 +55,36 @@ public:
   // Requires that `start()` was already called.
   void assign(const uv_tcp_t &tcp_conn);
 
+  // Same as above, for the file descriptor of an accepted connection, which
+  // this function takes ownership of.
+  // Requires that `start()` was already called.
+  void assign_fd(uv_os_sock_t fd);
+
+  // Whether connections are read with io_uring.
+  bool uses_io_uring() const { return io_uring_receiver_ != nullptr; }
+
+  // Opens a listening socket of its own on |addr|, with SO_REUSEPORT so that
+  // the listening sockets of several workers share the port, and accepts
+  // connections on it. The kernel spreads connections across the sockets of
+  // the port, see ReuseportSteering.
+  // Requires that `start()` was not called yet.
+  //
+  // Throws std::system_error on failure.
+  void listen(struct sockaddr_in const &addr, int backlog);
+
+  // The socket opened by `listen()`, or -1.
+  int listen_fd() const { return listen_fd_; }
+
+  // Bytes received so far on all of this worker's connections.
+  u64 received_bytes() const { return received_bytes_.load(std::memory_order_relaxed); }
+
+  // Closes the connection with the highest average receive rate not above
+  // |max_rate| bytes per second, among connections open for a while, so that
+  // its collector reconnects, possibly to another worker. Does nothing if this
+  // worker has a single connection.
+  // Requires that `start()` was already called. Runs asynchronously.
+  void shed_connection(double max_rate);
+
   // Invokes the provided callback in the context of this class's worker thread.
   // Can be used to inspect thread-local values for this class's owned thread.
   // Must not be invoked from within this class's thread itself.
@@ -78,17 +116,38 @@ protected:
   // Returns a set of callbacks to be invoked. Each time a new connection
   // arrives it will be assigned a new set of callbacks provided by this
   // function.
-  virtual std::unique_ptr<channel::Callbacks> create_callbacks(uv_loop_t &loop, ::channel::TCPChannel *tcp_channel);
+  virtual std::unique_ptr<channel::Callbacks> create_callbacks(uv_loop_t &loop, ::channel::ServerChannel *channel);
+
+  // The loop run by this worker's thread.
+  uv_loop_t &loop() { return loop_; }
+
+  // Invokes |cb| on the callbacks of each of this worker's connections, along
+  // with the number of bytes received on the connection so far.
+  // Must be called from this worker's thread.
+  using ConnectionBytesCb = std::function<void(::channel::Callbacks *, u64)>;
+  void for_each_connection(ConnectionBytesCb const &cb);
 
 private:
   // Callbacks used by libuv.
   static void open_tcp_socks_async_cb(uv_async_t *handle);
   static void stop_async_cb(uv_async_t *handle);
   static void visit_async_cb(uv_async_t *handle);
+  static void listen_poll_cb(uv_poll_t *handle, int status, int events);
+  static void accept_retry_timer_cb(uv_timer_t *timer);
+
+  // Accepts the pending connections on `listen_fd_`.
+  void accept_connections();
+
+  // Starts reading the connection |fd|, taking ownership of it.
+  void open_channel(uv_os_sock_t fd);
+
+  // Closes the connections read with io_uring, and waits for their receives
+  // to complete.
+  void close_io_uring_channels();
 
   // The contents of the `data` pointer in a uv_tcp_t object.
   struct TcpPayload {
-    std::unique_ptr<::channel::TCPChannel> tcp_channel;
+    std::unique_ptr<::channel::ServerChannel> channel;
     std::unique_ptr<channel::Callbacks> callbacks;
   };
 
@@ -104,8 +163,18 @@ private:
   // The thread that runs `loop_`.
   std::thread thread_;
 
+  // Reads connections with io_uring, if enabled and available.
+  std::unique_ptr<::channel::IoUringReceiver> io_uring_receiver_;
+
+  // Only used when listening with `listen()`.
+  int listen_fd_ = -1;
+  uv_poll_t listen_poll_;
+  uv_timer_t accept_retry_timer_;
+
+  std::atomic<u64> received_bytes_{0};
+
   // A mapping of each tcp connection to its payload.
-  absl::node_hash_map<::channel::TCPChannel *, TcpPayload> tcp_channel_to_payload_;
+  absl::node_hash_map<::channel::ServerChannel *, TcpPayload> tcp_channel_to_payload_;
 
   // Various fields that deal with the queueing and processing of
   // newly-assigned TCP sockets.
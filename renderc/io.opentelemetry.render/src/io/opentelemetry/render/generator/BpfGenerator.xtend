@@ -124,7 +124,7 @@ class BpfGenerator {
      * «msg.name»
      ************************************/
     struct «bpf_struct_name» {
-      u32 dummy; // needed for 64 bit aligned
+      u32 dummy; // needed for 64 bit aligned, holds the cpu when using a BPF ring buffer
         u32 unpadded_size;
         u64 timestamp;
         struct «jmsg.struct_name» jb;
@@ -170,7 +170,7 @@ class BpfGenerator {
     {
       struct «bpf_struct_name» __msg = {};
       bpf_fill_«app.name»__«msg.name»(&__msg, __now «msg.commaCallPrototype»);
-      return events.perf_submit(ctx, &__msg.unpadded_size, «bpf_struct_name»__perf_size);
+      return events_output(ctx, &__msg, «bpf_struct_name»__perf_size);
     }
     '''
   }
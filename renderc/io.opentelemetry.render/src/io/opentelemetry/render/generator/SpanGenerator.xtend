@@ -326,9 +326,9 @@ class SpanGenerator {
     /**
      * Index: a container for all types of spans, with reference counting.
      *
-     * Each container for a type of span keeps constant-sized pools of that
-     * span, maps so spans can be found by keys, and metric stores for
-     * metrics associated with the span
+     * Each container for a type of span keeps a pool of that span, which
+     * grows in chunks up to a compile-time ceiling, maps so spans can be
+     * found by keys, and metric stores for metrics associated with the span
      */
     class Index {
     public:
@@ -347,16 +347,27 @@ class SpanGenerator {
       /**
        * Extract size statistics for each container type.
        *
-       * The given functor is called with (span name, num_allocated_spans, pool_size)
+       * The given functor is called with (span name, num_allocated_spans,
+       * max_allocated_spans, capacity, committed_spans, soft_limit), where
+       * capacity is the pool's hard limit.
        */
       using size_statistics_cb =
         std::function<void(
           std::string_view span_name,
           std::size_t allocated,
           std::size_t max_allocated,
-          std::size_t pool_size)>;
+          std::size_t pool_size,
+          std::size_t committed,
+          std::size_t soft_limit)>;
       void size_statistics(size_statistics_cb f);
 
+      /**
+       * Limits every container's pool to the given fractions of its
+       * pool_size. Allocation fails above the hard limit, the soft limit is
+       * only reported.
+       */
+      void set_pool_limits(double soft_fraction, double hard_fraction);
+
       /**
        * forbid copy constructor
        */
@@ -399,6 +410,8 @@ class SpanGenerator {
 
     #include "index.h"
 
+    #include <cmath>
+
     «app.pkg.name»::«app.name»::Index::Index(«indexConstructorSignature(app)»)
     «FOR span : app.spans BEFORE " : " SEPARATOR ","»
       «span.name»()
@@ -411,7 +424,21 @@ class SpanGenerator {
     void «app.pkg.name»::«app.name»::Index::size_statistics(size_statistics_cb f)
     {
       «FOR span : app.spans»
-        f("«span.name»", «span.name».size(), «span.name».max_size(), «span.pool_size»);
+        f("«span.name»",
+          «span.name».size(),
+          «span.name».max_size(),
+          «span.name».capacity(),
+          «span.name».committed(),
+          «span.name».soft_limit());
+      «ENDFOR»
+    }
+
+    void «app.pkg.name»::«app.name»::Index::set_pool_limits(double soft_fraction, double hard_fraction)
+    {
+      «FOR span : app.spans»
+        «span.name».set_limits(
+          std::size_t(std::ceil(containers::«span.name»::pool_size * soft_fraction)),
+          std::size_t(std::ceil(containers::«span.name»::pool_size * hard_fraction)));
       «ENDFOR»
     }
 
@@ -460,6 +487,7 @@ class SpanGenerator {
     #include "../metrics.h"
 
     #include <util/short_string.h>
+    #include <util/chunked_pool.h>
     #include <util/fixed_hash.h>
     #include <util/metric_store.h>
 
@@ -473,9 +501,9 @@ class SpanGenerator {
       /**
        * Container for span «span.name».
        *
-       * The container maintains a constant-sized pool from which spans are
-       * allocated, and if the span is indexd, a map from the index key
-       * to the spans.
+       * The container maintains a pool from which spans are allocated, and
+       * if the span is indexd, a map from the index key to the spans. The
+       * pool commits memory in chunks as it grows, up to pool_size spans.
        *
        * Access to elements is performed through handles which keep a reference
        * to an allocated span, or through a weak reference ("weak_ref"),
@@ -484,7 +512,7 @@ class SpanGenerator {
       class «span.name» {
       public:
         /**
-         * pool_size: size of the constant-sized pool of spans available
+         * pool_size: maximum number of spans the pool can hold
          */
         static constexpr u32 pool_size = «span.pool_size»;
 
@@ -540,6 +568,26 @@ class SpanGenerator {
          */
         std::size_t max_size() const;
 
+        /**
+         * @return number of spans that can be allocated (the hard limit)
+         */
+        std::size_t capacity() const;
+
+        /**
+         * @return number of spans backed by committed pool memory
+         */
+        std::size_t committed() const;
+
+        /**
+         * @return number of spans above which the pool is under pressure
+         */
+        std::size_t soft_limit() const;
+
+        /**
+         * Sets the soft and hard limits of the pool, clamped to pool_size.
+         */
+        void set_limits(std::size_t soft_limit, std::size_t hard_limit);
+
         /***********************
          * Metrics
          */
@@ -595,6 +643,7 @@ class SpanGenerator {
         «ENDFOR»
 
         using span_t = ::«app.pkg.name»::«app.name»::spans::«span.name»;
+        using pool_t = ChunkedPool<span_t, pool_size>;
         «IF span.index !== null»
         typedef ::«app.pkg.name»::«app.name»::keys::«span.name» key_t;
         «ENDIF»
@@ -626,12 +675,12 @@ class SpanGenerator {
           };
 
           /* map type */
-          using map_t = FixedHash<key_t, span_t, pool_size, hasher_t, equals_t>;
+          using map_t = FixedHash<key_t, span_t, pool_size, hasher_t, equals_t, std::allocator<span_t>, pool_t>;
 
           map_t map;
         «ELSE»
           /* pool */
-          Pool<span_t, pool_size> map;
+          pool_t map;
         «ENDIF»
 
         /* metric stores */
@@ -998,6 +1047,22 @@ class SpanGenerator {
         return map.max_size();
       }
 
+      std::size_t «span.name»::capacity() const {
+        return map.capacity();
+      }
+
+      std::size_t «span.name»::committed() const {
+        return map.committed();
+      }
+
+      std::size_t «span.name»::soft_limit() const {
+        return map.soft_limit();
+      }
+
+      void «span.name»::set_limits(std::size_t soft_limit, std::size_t hard_limit) {
+        map.set_limits(soft_limit, hard_limit);
+      }
+
       /* metric aggregators */
       «FOR agg : span.aggs»
       «IF agg.isRoot»
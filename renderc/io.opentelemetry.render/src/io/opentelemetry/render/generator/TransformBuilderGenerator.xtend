@@ -37,6 +37,12 @@ class TransformBuilderGenerator {
 
     namespace «app.pkg.name»::«app.name» {
 
+    «IF !app.jit»
+      // Holds the identity transforms of every message. They are all set up by the
+      // constructor and only looked up afterwards, so a single instance can be
+      // shared by any number of Protocol instances, across threads.
+      //
+    «ENDIF»
     class TransformBuilder «IF app.jit»: public ::jitbuf::TransformBuilder«ENDIF» {
     public:
       // Format-transformation function signature.
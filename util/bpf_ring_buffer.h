@@ -0,0 +1,403 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <linux/perf_event.h>
+#include <platform/platform.h>
+
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <uv.h>
+
+/**
+ * All the shared data for a BPF ring buffer (BPF_MAP_TYPE_RINGBUF).
+ *
+ * Memory layout, as exposed by the kernel:
+ *  - consumer page: u64 consumer position, writable by userspace
+ *  - producer page: u64 producer position, read-only for userspace
+ *  - data pages: the ring itself, read-only for userspace
+ *
+ * Optionally, a single u64 counter of records the BPF side failed to reserve
+ * space for (i.e. were lost because the ring was full).
+ */
+class BpfRingBufferStorage {
+public:
+  virtual ~BpfRingBufferStorage() {}
+
+  u64 *consumer_pos() { return consumer_pos_; }
+  u64 const *producer_pos() const { return producer_pos_; }
+  char const *data() const { return data_; }
+  u64 data_size() const { return data_size_; }
+  u64 const *lost_count() const { return lost_count_; }
+
+  typedef void CALLBACK(void *ctx);
+  virtual void set_callback(uv_loop_t &loop, void *ctx, CALLBACK cb) = 0;
+
+protected:
+  u64 *consumer_pos_ = nullptr;
+  u64 const *producer_pos_ = nullptr;
+  char const *data_ = nullptr;
+  u64 data_size_ = 0;
+  u64 const *lost_count_ = nullptr;
+};
+
+/**
+ * Storage backed by the mmap'd pages of a BPF ring buffer map
+ */
+class MmapBpfRingBufferStorage : public BpfRingBufferStorage {
+public:
+  /**
+   * C'tor
+   * @param ring_fd: file descriptor of the BPF_MAP_TYPE_RINGBUF map
+   * @param n_bytes: size of the ring's data area (the map's max_entries)
+   * @param lost_count_fd: file descriptor of a BPF_F_MMAPABLE array holding
+   *   a single u64 lost record counter, or -1 if there is none
+   */
+  MmapBpfRingBufferStorage(int ring_fd, u64 n_bytes, int lost_count_fd);
+
+  virtual ~MmapBpfRingBufferStorage();
+
+  virtual void set_callback(uv_loop_t &loop, void *ctx, CALLBACK cb);
+
+  /**
+   * Returns the file descriptor of the ring buffer map
+   */
+  int fd() { return fd_; }
+
+private:
+  /* disallow copy and assignment */
+  MmapBpfRingBufferStorage(const MmapBpfRingBufferStorage &) = delete;
+  void operator=(const MmapBpfRingBufferStorage &) = delete;
+
+  int fd_;
+  u64 page_size_;
+  void *consumer_mmap_ = MAP_FAILED;
+  void *producer_mmap_ = MAP_FAILED;
+  void *lost_count_mmap_ = MAP_FAILED;
+  uv_poll_t ring_poll_;
+  void *callback_ctx_ = nullptr;
+  CALLBACK *callback_ = nullptr;
+};
+
+/**
+ * Consumer side of a BPF ring buffer.
+ *
+ * Mirrors the reading API of PerfRing, so the control channel can be drained
+ * from either one. Offsets passed to the peek functions are relative to the
+ * start of the record's payload, which BPF lays out exactly like the payload
+ * of a perf sample:
+ *  - u32: cpu the record was submitted from
+ *  - u32: unpadded length
+ *  - u64: timestamp
+ *  - ...: message
+ *
+ * Records are already in submission order, so no merging is required. Records
+ * lost by the BPF side are reported as a single synthetic PERF_RECORD_LOST
+ * at the start of a read batch.
+ */
+class BpfRingBuffer {
+public:
+  static constexpr u32 busy_bit = 1u << 31;
+  static constexpr u32 discard_bit = 1u << 30;
+  static constexpr u32 header_size = 8;
+
+  BpfRingBuffer(std::shared_ptr<BpfRingBufferStorage> storage);
+
+  /* snapshots the producer position and lost count */
+  void start_read_batch();
+
+  /* returns the payload length of the next record, or -ENOENT if empty */
+  int peek_size() const;
+
+  /* PERF_RECORD_LOST if there are unreported losses, PERF_RECORD_SAMPLE otherwise */
+  int peek_type() const;
+
+  /* number of records lost, when peek_type() == PERF_RECORD_LOST */
+  u64 peek_n_lost() const { return lost_pending_; }
+
+  u64 peek_aligned_u64(u16 offset) const;
+  u32 peek_aligned_u32(u16 offset) const;
+  u16 peek_aligned_u16(u16 offset) const;
+
+  /* copies @len bytes of the payload, starting at @offset, into @buf */
+  void peek_copy(char *buf, u16 offset, u16 len) const;
+
+  /* view of the message (starting at the timestamp), see PerfRing::peek */
+  std::pair<std::string_view, std::string_view> peek() const;
+
+  /* returns the number of unread bytes, and optionally the size of the ring */
+  u32 bytes_remaining(u32 *total_bytes) const;
+
+  /* discards the next record */
+  void pop();
+
+  /* releases consumed space back to the producer */
+  void finish_read_batch();
+
+  typedef void CALLBACK(void *ctx);
+  void set_callback(uv_loop_t &loop, void *ctx, CALLBACK cb);
+
+  /* size of a record with the given payload length, including header and padding */
+  static constexpr u64 record_size(u32 len) { return ((len & ~(busy_bit | discard_bit)) + header_size + 7) & ~7ull; }
+
+private:
+  /* skips over discarded records, stopping at the first committed or busy one */
+  void skip_discarded();
+
+  u32 record_header() const;
+  char const *payload_at(u64 offset) const { return &storage_->data()[(head_ + header_size + offset) & mask_]; }
+
+  std::shared_ptr<BpfRingBufferStorage> storage_;
+  u64 mask_;
+  u64 head_;
+  u64 tail_;
+  u64 lost_reported_ = 0;
+  u64 lost_pending_ = 0;
+};
+
+/*****************
+ * IMPLEMENTATION
+ *****************/
+
+inline MmapBpfRingBufferStorage::MmapBpfRingBufferStorage(int ring_fd, u64 n_bytes, int lost_count_fd) : fd_(ring_fd)
+{
+  page_size_ = getpagesize();
+
+  if ((n_bytes == 0) || (n_bytes & (n_bytes - 1)) || (n_bytes % page_size_)) {
+    std::stringstream msg;
+    msg << "ring buffer size " << n_bytes << " must be a power of 2 multiple of the page size";
+    throw std::invalid_argument(msg.str());
+  }
+
+  consumer_mmap_ = mmap(NULL, page_size_, PROT_READ | PROT_WRITE, MAP_SHARED, ring_fd, 0);
+  if (consumer_mmap_ == MAP_FAILED) {
+    std::stringstream msg;
+    msg << "mmap of ring buffer consumer page failed with errno " << errno << ", error: '" << strerror(errno) << "'";
+    throw std::runtime_error(msg.str());
+  }
+
+  /* the kernel maps the data pages twice in a row, so records never wrap around */
+  producer_mmap_ = mmap(NULL, page_size_ + 2 * n_bytes, PROT_READ, MAP_SHARED, ring_fd, page_size_);
+  if (producer_mmap_ == MAP_FAILED) {
+    munmap(consumer_mmap_, page_size_);
+
+    std::stringstream msg;
+    msg << "mmap of ring buffer data pages failed with errno " << errno << ", error: '" << strerror(errno) << "'";
+    throw std::runtime_error(msg.str());
+  }
+
+  if (lost_count_fd >= 0) {
+    lost_count_mmap_ = mmap(NULL, page_size_, PROT_READ, MAP_SHARED, lost_count_fd, 0);
+    if (lost_count_mmap_ == MAP_FAILED) {
+      munmap(producer_mmap_, page_size_ + 2 * n_bytes);
+      munmap(consumer_mmap_, page_size_);
+
+      std::stringstream msg;
+      msg << "mmap of ring buffer lost counter failed with errno " << errno << ", error: '" << strerror(errno) << "'";
+      throw std::runtime_error(msg.str());
+    }
+    lost_count_ = (u64 const *)lost_count_mmap_;
+  }
+
+  consumer_pos_ = (u64 *)consumer_mmap_;
+  producer_pos_ = (u64 const *)producer_mmap_;
+  data_ = (char const *)producer_mmap_ + page_size_;
+  data_size_ = n_bytes;
+}
+
+inline MmapBpfRingBufferStorage::~MmapBpfRingBufferStorage()
+{
+  if (callback_) {
+    uv_poll_stop(&ring_poll_);
+  }
+  if (lost_count_mmap_ != MAP_FAILED) {
+    munmap(lost_count_mmap_, page_size_);
+  }
+  munmap(producer_mmap_, page_size_ + 2 * data_size_);
+  munmap(consumer_mmap_, page_size_);
+}
+
+inline void MmapBpfRingBufferStorage::set_callback(uv_loop_t &loop, void *ctx, CALLBACK cb)
+{
+  callback_ = cb;
+  callback_ctx_ = ctx;
+
+  int res = uv_poll_init(&loop, &ring_poll_, fd_);
+  if (res != 0) {
+    throw std::runtime_error("Could not init ring_poll_");
+  }
+
+  uv_handle_set_data((uv_handle_t *)&ring_poll_, this);
+
+  res = uv_poll_start(&ring_poll_, UV_READABLE, [](uv_poll_t *handle, int status, int events) {
+    MmapBpfRingBufferStorage *obj = (MmapBpfRingBufferStorage *)uv_handle_get_data((uv_handle_t *)handle);
+    (obj->callback_)(obj->callback_ctx_);
+  });
+  if (res != 0) {
+    throw std::runtime_error("Could not start watching ring_poll_");
+  }
+}
+
+inline BpfRingBuffer::BpfRingBuffer(std::shared_ptr<BpfRingBufferStorage> storage)
+    : storage_(std::move(storage)), mask_(storage_->data_size() - 1)
+{
+  head_ = __atomic_load_n(storage_->consumer_pos(), __ATOMIC_ACQUIRE);
+  tail_ = head_;
+  if (auto const lost_count = storage_->lost_count()) {
+    /* only report losses that happen from now on */
+    lost_reported_ = __atomic_load_n(lost_count, __ATOMIC_ACQUIRE);
+  }
+}
+
+inline void BpfRingBuffer::start_read_batch()
+{
+  tail_ = __atomic_load_n(storage_->producer_pos(), __ATOMIC_ACQUIRE);
+
+  if (auto const lost_count = storage_->lost_count()) {
+    lost_pending_ = __atomic_load_n(lost_count, __ATOMIC_ACQUIRE) - lost_reported_;
+  }
+
+  skip_discarded();
+}
+
+inline u32 BpfRingBuffer::record_header() const
+{
+  return __atomic_load_n((u32 const *)&storage_->data()[head_ & mask_], __ATOMIC_ACQUIRE);
+}
+
+inline void BpfRingBuffer::skip_discarded()
+{
+  while (head_ < tail_) {
+    u32 const header = record_header();
+    if ((header & busy_bit) || !(header & discard_bit)) {
+      return;
+    }
+    head_ += record_size(header);
+  }
+}
+
+inline int BpfRingBuffer::peek_size() const
+{
+  if (lost_pending_) {
+    /* synthetic PERF_RECORD_LOST: u64 id + u64 lost */
+    return 2 * sizeof(u64);
+  }
+
+  if (head_ == tail_) {
+    return -ENOENT;
+  }
+
+  /* the producer reserved the record but hasn't committed it yet */
+  u32 const header = record_header();
+  if (header & busy_bit) {
+    return -ENOENT;
+  }
+
+  return header & ~discard_bit;
+}
+
+inline int BpfRingBuffer::peek_type() const
+{
+  return lost_pending_ ? PERF_RECORD_LOST : PERF_RECORD_SAMPLE;
+}
+
+inline u64 BpfRingBuffer::peek_aligned_u64(u16 offset) const
+{
+  assert(((head_ + header_size + offset) & 7) == 0);
+  return *(u64 const *)payload_at(offset);
+}
+
+inline u32 BpfRingBuffer::peek_aligned_u32(u16 offset) const
+{
+  assert(((head_ + header_size + offset) & 3) == 0);
+  return *(u32 const *)payload_at(offset);
+}
+
+inline u16 BpfRingBuffer::peek_aligned_u16(u16 offset) const
+{
+  assert(((head_ + header_size + offset) & 1) == 0);
+  return *(u16 const *)payload_at(offset);
+}
+
+inline void BpfRingBuffer::peek_copy(char *buf, u16 offset, u16 len) const
+{
+  if (len == 0) {
+    return;
+  }
+
+  assert(peek_size() >= (int)offset + len);
+
+  u64 const begin = (head_ + header_size + offset) & mask_;
+  u64 const len_to_ring_end = mask_ + 1 - begin;
+
+  if (len > len_to_ring_end) {
+    /* wraps around, only possible when the storage isn't double-mapped */
+    memcpy(buf, &storage_->data()[begin], len_to_ring_end);
+    memcpy(buf + len_to_ring_end, &storage_->data()[0], len - len_to_ring_end);
+  } else {
+    memcpy(buf, &storage_->data()[begin], len);
+  }
+}
+
+inline std::pair<std::string_view, std::string_view> BpfRingBuffer::peek() const
+{
+  u32 const unpadded_len = peek_aligned_u32(sizeof(u32));
+  if (unpadded_len == 0) {
+    return {};
+  }
+
+  u64 const begin = (head_ + header_size + sizeof(u64)) & mask_;
+  u64 const len_to_ring_end = mask_ + 1 - begin;
+  char const *data = storage_->data();
+
+  if (unpadded_len > len_to_ring_end) {
+    return std::make_pair(
+        std::string_view(&data[begin], len_to_ring_end), std::string_view(&data[0], unpadded_len - len_to_ring_end));
+  }
+
+  return std::make_pair(std::string_view(&data[begin], unpadded_len), std::string_view());
+}
+
+inline u32 BpfRingBuffer::bytes_remaining(u32 *total_bytes) const
+{
+  if (total_bytes) {
+    *total_bytes = mask_ + 1;
+  }
+  return tail_ - head_;
+}
+
+inline void BpfRingBuffer::pop()
+{
+  if (lost_pending_) {
+    lost_reported_ += lost_pending_;
+    lost_pending_ = 0;
+    return;
+  }
+
+  assert(head_ != tail_);
+  head_ += record_size(record_header());
+  skip_discarded();
+}
+
+inline void BpfRingBuffer::finish_read_batch()
+{
+  __atomic_store_n(storage_->consumer_pos(), head_, __ATOMIC_RELEASE);
+}
+
+inline void BpfRingBuffer::set_callback(uv_loop_t &loop, void *ctx, CALLBACK cb)
+{
+  storage_->set_callback(loop, ctx, cb);
+}
@@ -0,0 +1,195 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <util/bpf_ring_buffer.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+/* in-memory storage with a producer that mimics the kernel's reserve/commit/discard */
+class TestStorage : public BpfRingBufferStorage {
+public:
+  TestStorage(u64 n_bytes) : buffer_(n_bytes / sizeof(u64))
+  {
+    consumer_pos_ = &consumer_;
+    producer_pos_ = &producer_;
+    data_ = reinterpret_cast<char const *>(buffer_.data());
+    data_size_ = n_bytes;
+    lost_count_ = &lost_;
+  }
+
+  void set_callback(uv_loop_t &loop, void *ctx, CALLBACK cb) override {}
+
+  /* returns the position of the reserved record, or ~0 if the ring is full */
+  u64 reserve(u32 len)
+  {
+    u64 const size = BpfRingBuffer::record_size(len);
+    if (producer_ + size - consumer_ > data_size_) {
+      ++lost_;
+      return ~0ull;
+    }
+    u64 const pos = producer_;
+    header(pos) = BpfRingBuffer::busy_bit | len;
+    producer_ += size;
+    return pos;
+  }
+
+  void commit(u64 pos, std::string const &payload)
+  {
+    for (size_t i = 0; i < payload.size(); ++i) {
+      data()[(pos + BpfRingBuffer::header_size + i) & (data_size_ - 1)] = payload[i];
+    }
+    header(pos) &= ~BpfRingBuffer::busy_bit;
+  }
+
+  void discard(u64 pos) { header(pos) = (header(pos) & ~BpfRingBuffer::busy_bit) | BpfRingBuffer::discard_bit; }
+
+  bool output(std::string const &payload)
+  {
+    u64 const pos = reserve(payload.size());
+    if (pos == ~0ull) {
+      return false;
+    }
+    commit(pos, payload);
+    return true;
+  }
+
+  u64 consumer() const { return consumer_; }
+
+private:
+  char *data() { return reinterpret_cast<char *>(buffer_.data()); }
+  u32 &header(u64 pos) { return *reinterpret_cast<u32 *>(&data()[pos & (data_size_ - 1)]); }
+
+  std::vector<u64> buffer_;
+  u64 consumer_ = 0;
+  u64 producer_ = 0;
+  u64 lost_ = 0;
+};
+
+/* payload laid out like a BPF message: cpu, unpadded size, timestamp, message */
+std::string make_payload(u32 cpu, u64 timestamp, std::string const &message)
+{
+  std::string payload(2 * sizeof(u32) + sizeof(u64), '\0');
+  u32 const unpadded = sizeof(u64) + message.size();
+  memcpy(&payload[0], &cpu, sizeof(cpu));
+  memcpy(&payload[sizeof(u32)], &unpadded, sizeof(unpadded));
+  memcpy(&payload[sizeof(u64)], &timestamp, sizeof(timestamp));
+  return payload + message;
+}
+
+std::string read_message(BpfRingBuffer const &ring)
+{
+  auto const view = ring.peek();
+  std::string message(view.first);
+  message.append(view.second);
+  return message.substr(sizeof(u64));
+}
+
+} // namespace
+
+TEST(bpf_ring_buffer, read_in_order)
+{
+  auto storage = std::make_shared<TestStorage>(4096);
+  BpfRingBuffer ring(storage);
+
+  ring.start_read_batch();
+  EXPECT_EQ(-ENOENT, ring.peek_size());
+
+  ASSERT_TRUE(storage->output(make_payload(3, 10, "first")));
+  ASSERT_TRUE(storage->output(make_payload(1, 11, "second")));
+
+  ring.start_read_batch();
+  ASSERT_EQ(PERF_RECORD_SAMPLE, ring.peek_type());
+  EXPECT_EQ(3u, ring.peek_aligned_u32(0));
+  EXPECT_EQ(10u, ring.peek_aligned_u64(sizeof(u64)));
+  EXPECT_EQ("first", read_message(ring));
+  ring.pop();
+
+  EXPECT_EQ(1u, ring.peek_aligned_u32(0));
+  EXPECT_EQ("second", read_message(ring));
+  ring.pop();
+
+  EXPECT_EQ(-ENOENT, ring.peek_size());
+  EXPECT_EQ(0u, storage->consumer());
+
+  ring.finish_read_batch();
+  EXPECT_EQ(2 * BpfRingBuffer::record_size(make_payload(0, 0, "second").size()), storage->consumer());
+}
+
+TEST(bpf_ring_buffer, skips_discarded_and_stops_at_busy)
+{
+  auto storage = std::make_shared<TestStorage>(4096);
+  BpfRingBuffer ring(storage);
+
+  storage->discard(storage->reserve(16));
+  ASSERT_TRUE(storage->output(make_payload(0, 1, "kept")));
+  u64 const busy = storage->reserve(24);
+
+  ring.start_read_batch();
+  ASSERT_GT(ring.peek_size(), 0);
+  EXPECT_EQ("kept", read_message(ring));
+  ring.pop();
+
+  /* reserved but not yet committed */
+  EXPECT_EQ(-ENOENT, ring.peek_size());
+
+  storage->commit(busy, make_payload(0, 2, "late"));
+  ring.start_read_batch();
+  ASSERT_GT(ring.peek_size(), 0);
+  EXPECT_EQ("late", read_message(ring));
+}
+
+TEST(bpf_ring_buffer, wraps_around)
+{
+  auto storage = std::make_shared<TestStorage>(256);
+  BpfRingBuffer ring(storage);
+
+  std::string const message(40, 'x');
+  for (u64 i = 0; i < 100; ++i) {
+    ASSERT_TRUE(storage->output(make_payload(0, i, message + std::to_string(i))));
+
+    ring.start_read_batch();
+    ASSERT_EQ(i, ring.peek_aligned_u64(sizeof(u64)));
+
+    std::string copy(ring.peek_size(), '\0');
+    ring.peek_copy(copy.data(), 0, copy.size());
+    EXPECT_EQ(make_payload(0, i, message + std::to_string(i)), copy);
+    EXPECT_EQ(message + std::to_string(i), read_message(ring));
+
+    ring.pop();
+    ring.finish_read_batch();
+  }
+}
+
+TEST(bpf_ring_buffer, reports_lost_records)
+{
+  auto storage = std::make_shared<TestStorage>(128);
+  BpfRingBuffer ring(storage);
+
+  u64 n_written = 0;
+  for (int i = 0; i < 10; ++i) {
+    n_written += storage->output(make_payload(0, i, "message"));
+  }
+  ASSERT_LT(n_written, 10u);
+
+  ring.start_read_batch();
+  ASSERT_EQ(PERF_RECORD_LOST, ring.peek_type());
+  EXPECT_EQ(10 - n_written, ring.peek_n_lost());
+  ring.pop();
+
+  u64 n_read = 0;
+  for (; ring.peek_size() != -ENOENT; ring.pop()) {
+    EXPECT_EQ(PERF_RECORD_SAMPLE, ring.peek_type());
+    ++n_read;
+  }
+  EXPECT_EQ(n_written, n_read);
+  ring.finish_read_batch();
+
+  /* losses are only reported once */
+  ring.start_read_batch();
+  EXPECT_EQ(-ENOENT, ring.peek_size());
+}
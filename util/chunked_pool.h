@@ -0,0 +1,230 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <platform/platform.h>
+#include <util/iterable_bitmap.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/**
+ * A drop-in replacement for Pool that commits its storage in fixed-size
+ * chunks as it grows, instead of all at once.
+ *
+ * Indices are stable: element `i` always lives at offset `i % CHUNK_SIZE` of
+ * chunk `i / CHUNK_SIZE`. Chunks are only allocated when the free list is
+ * empty and all committed slots are taken, so committed memory follows the
+ * high-water mark of the pool rather than SIZE.
+ *
+ * SIZE is the compile-time ceiling, which bounds the index type. At runtime,
+ * the pool can be limited further with set_limits():
+ *  - hard limit: emplace() fails once size() reaches it.
+ *  - soft limit: only reported, through over_soft_limit(), so callers can
+ *    warn before the pool starts dropping elements.
+ */
+template <class T, std::size_t SIZE, std::size_t CHUNK_SIZE = 4096, class Allocator = std::allocator<T>> class ChunkedPool {
+public:
+  using index_type = typename std::conditional<(SIZE >= (1 << 16) - 1), u32, u16>::type;
+  using element_type = T;
+  using size_type = std::size_t;
+  using bitmap_type = IterableBitmap<SIZE>;
+
+  static constexpr size_type pool_size = SIZE;
+  static constexpr size_type chunk_size = CHUNK_SIZE;
+  static constexpr size_type max_chunks = (SIZE + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  static constexpr index_type invalid = std::numeric_limits<index_type>::max();
+
+private:
+  /* freed slots hold the index of the next free slot */
+  union poolable_type {
+    element_type t;
+    index_type next_free;
+  };
+
+  /* POD type suitable for use as uninitialized storage */
+  using storage_type = typename std::aligned_storage<sizeof(poolable_type), alignof(poolable_type)>::type;
+
+  /* allocator traits rebound to the storage type */
+  using allocator_traits = typename std::allocator_traits<Allocator>::template rebind_traits<storage_type>;
+
+public:
+  using allocator_type = typename allocator_traits::allocator_type;
+
+  struct position {
+    index_type index;
+    element_type *entry;
+  };
+
+  ChunkedPool()
+  {
+    static_assert(pool_size > 0, "pool size must be larger than 0");
+    static_assert(chunk_size > 0 && (chunk_size & (chunk_size - 1)) == 0, "chunk size must be a power of 2");
+  }
+
+  ChunkedPool(ChunkedPool const &) = delete;
+  ChunkedPool &operator=(ChunkedPool const &) = delete;
+
+  ~ChunkedPool()
+  {
+    for (auto i : allocated_) {
+      destroy(i);
+    }
+
+    for (size_type chunk = 0; chunk < chunks_.size(); ++chunk) {
+      allocator_traits::deallocate(allocator_, chunks_[chunk], chunk_capacity(chunk));
+    }
+  }
+
+  /**
+   * Sets the runtime limits of the pool, clamped to SIZE.
+   *
+   * Lowering the hard limit below size() does not evict anything, emplace()
+   * just fails until enough elements are removed.
+   */
+  void set_limits(size_type soft_limit, size_type hard_limit)
+  {
+    hard_limit_ = std::min(hard_limit, pool_size);
+    soft_limit_ = std::min(soft_limit, hard_limit_);
+  }
+
+  size_type soft_limit() const { return soft_limit_; }
+
+  size_type hard_limit() const { return hard_limit_; }
+
+  bool over_soft_limit() const { return size() > soft_limit_; }
+
+  bool empty() const { return size() == 0; }
+
+  bool full() const { return size() >= capacity(); }
+
+  size_type size() const { return elem_count_; }
+
+  size_type max_size() const { return max_elem_count_; }
+
+  size_type capacity() const { return hard_limit_; }
+
+  /**
+   * Number of slots backed by allocated chunks.
+   */
+  size_type committed() const { return committed_; }
+
+  const bitmap_type &allocated() const { return allocated_; }
+
+  element_type &operator[](index_type index)
+  {
+    assert(index < committed_);
+    assert(allocated_.get(index));
+    return *(element_type *)slot(index);
+  }
+
+  element_type const &operator[](index_type index) const
+  {
+    assert(index < committed_);
+    assert(allocated_.get(index));
+    return *(element_type const *)slot(index);
+  }
+
+  /**
+   * Emplaces an element into the pool, committing a new chunk if needed.
+   * @returns position of the new value, or {invalid,nullptr} if the pool is
+   *   at its hard limit.
+   */
+  template <typename... Args> position emplace(Args &&... args)
+  {
+    if (full())
+      return {invalid, nullptr};
+
+    index_type index;
+    if (free_head_ != invalid) {
+      index = free_head_;
+      free_head_ = ((poolable_type *)slot(index))->next_free;
+    } else {
+      if (next_unused_ == committed_) {
+        grow();
+      }
+      index = next_unused_++;
+    }
+
+    try {
+      /* construct the object, might throw! */
+      allocator_traits::construct(allocator_, (element_type *)slot(index), std::forward<Args>(args)...);
+    } catch (...) {
+      release(index);
+      throw;
+    }
+
+    elem_count_++;
+    allocated_.set(index);
+
+    max_elem_count_ = std::max(max_elem_count_, elem_count_);
+
+    return {index, (element_type *)slot(index)};
+  }
+
+  /**
+   * Destroys the element at @index and returns its slot to the free list.
+   */
+  void remove(index_type index)
+  {
+    assert(index < committed_);
+    assert(allocated_.get(index));
+
+    destroy(index);
+    release(index);
+
+    elem_count_--;
+    allocated_.clear(index);
+  }
+
+private:
+  allocator_type allocator_;
+
+  /* chunks_[i] holds slots [i * chunk_size, (i + 1) * chunk_size) */
+  std::vector<storage_type *> chunks_;
+
+  bitmap_type allocated_;
+
+  /* head of the list of freed slots */
+  index_type free_head_{invalid};
+  /* slots below this index have been handed out at least once */
+  size_type next_unused_{0};
+  size_type committed_{0};
+
+  size_type soft_limit_{pool_size};
+  size_type hard_limit_{pool_size};
+
+  size_type elem_count_{0};
+  size_type max_elem_count_{0};
+
+  /* the last chunk is truncated so that committed() never exceeds SIZE */
+  static constexpr size_type chunk_capacity(size_type chunk) { return std::min(chunk_size, pool_size - chunk * chunk_size); }
+
+  storage_type *slot(index_type index) const { return &chunks_[index / chunk_size][index % chunk_size]; }
+
+  void grow()
+  {
+    assert(chunks_.size() < max_chunks);
+    size_type const capacity = chunk_capacity(chunks_.size());
+
+    chunks_.reserve(max_chunks);
+    chunks_.push_back(allocator_traits::allocate(allocator_, capacity));
+    committed_ += capacity;
+  }
+
+  void release(index_type index)
+  {
+    ((poolable_type *)slot(index))->next_free = free_head_;
+    free_head_ = index;
+  }
+
+  void destroy(index_type index) { allocator_traits::destroy(allocator_, (element_type *)slot(index)); }
+};
@@ -0,0 +1,147 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <util/chunked_pool.h>
+#include <util/fixed_hash.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+TEST(chunked_pool, commits_chunks_on_demand)
+{
+  ChunkedPool<u64, 100, 16> pool;
+  EXPECT_EQ(0u, pool.committed());
+  EXPECT_EQ(100u, pool.capacity());
+
+  std::vector<u32> indices;
+  for (u64 i = 0; i < 17; ++i) {
+    auto pos = pool.emplace(i);
+    ASSERT_NE(pool.invalid, pos.index);
+    EXPECT_EQ(i, *pos.entry);
+    indices.push_back(pos.index);
+  }
+  EXPECT_EQ(32u, pool.committed());
+
+  /* freed slots are reused before committing more chunks */
+  pool.remove(indices[3]);
+  pool.remove(indices[7]);
+  auto pos = pool.emplace(100u);
+  EXPECT_TRUE(pos.index == indices[3] || pos.index == indices[7]);
+  EXPECT_EQ(16u, pool.size());
+  EXPECT_EQ(17u, pool.max_size());
+  EXPECT_EQ(32u, pool.committed());
+
+  /* the last chunk is truncated to the pool size */
+  while (!pool.full()) {
+    ASSERT_NE(pool.invalid, pool.emplace(0u).index);
+  }
+  EXPECT_EQ(100u, pool.committed());
+  EXPECT_EQ(pool.invalid, pool.emplace(0u).index);
+}
+
+TEST(chunked_pool, indices_are_stable)
+{
+  ChunkedPool<u64, 1000, 8> pool;
+
+  std::vector<std::pair<u32, u64 *>> positions;
+  for (u64 i = 0; i < 500; ++i) {
+    auto pos = pool.emplace(i);
+    positions.emplace_back(pos.index, pos.entry);
+  }
+
+  for (u64 i = 0; i < positions.size(); ++i) {
+    auto [index, entry] = positions[i];
+    EXPECT_EQ(entry, &pool[index]);
+    EXPECT_EQ(i, pool[index]);
+  }
+
+  std::set<u32> allocated;
+  for (auto i : pool.allocated()) {
+    allocated.insert(i);
+  }
+  EXPECT_EQ(500u, allocated.size());
+  EXPECT_EQ(499u, *allocated.rbegin());
+}
+
+TEST(chunked_pool, limits)
+{
+  ChunkedPool<u64, 100, 16> pool;
+  pool.set_limits(10, 20);
+  EXPECT_EQ(10u, pool.soft_limit());
+  EXPECT_EQ(20u, pool.capacity());
+
+  for (u64 i = 0; i < 20; ++i) {
+    ASSERT_NE(pool.invalid, pool.emplace(i).index);
+    EXPECT_EQ(i >= 10, pool.over_soft_limit());
+  }
+  EXPECT_TRUE(pool.full());
+  EXPECT_EQ(pool.invalid, pool.emplace(0u).index);
+  EXPECT_EQ(32u, pool.committed());
+
+  /* lowering the hard limit does not evict */
+  pool.set_limits(5, 10);
+  EXPECT_EQ(20u, pool.size());
+  EXPECT_TRUE(pool.full());
+
+  /* limits are clamped to the pool size */
+  pool.set_limits(1000, 1000);
+  EXPECT_EQ(100u, pool.soft_limit());
+  EXPECT_EQ(100u, pool.capacity());
+}
+
+TEST(chunked_pool, releases_slot_when_constructor_throws)
+{
+  struct Throws {
+    Throws(bool fail)
+    {
+      if (fail) {
+        throw std::runtime_error("fail");
+      }
+    }
+  };
+
+  ChunkedPool<Throws, 10, 4> pool;
+  EXPECT_THROW(pool.emplace(true), std::runtime_error);
+  EXPECT_EQ(0u, pool.size());
+
+  auto pos = pool.emplace(false);
+  EXPECT_EQ(0u, pos.index);
+  EXPECT_EQ(1u, pool.size());
+}
+
+TEST(chunked_pool, destroys_elements)
+{
+  auto counter = std::make_shared<int>();
+  {
+    ChunkedPool<std::shared_ptr<int>, 100, 16> pool;
+    for (int i = 0; i < 40; ++i) {
+      pool.emplace(counter);
+    }
+    pool.remove(0);
+    EXPECT_EQ(40, counter.use_count());
+  }
+  EXPECT_EQ(1, counter.use_count());
+}
+
+TEST(chunked_pool, fixed_hash)
+{
+  FixedHash<int, int, 100, std::hash<int>, std::equal_to<int>, std::allocator<int>, ChunkedPool<int, 100, 16>> hash;
+  hash.set_limits(50, 60);
+
+  for (int i = 0; i < 100; ++i) {
+    bool const inserted = hash.insert(i, i * 2).index != hash.invalid;
+    EXPECT_EQ(i < 60, inserted);
+  }
+  EXPECT_EQ(60u, hash.size());
+  EXPECT_EQ(64u, hash.committed());
+
+  /* keys rejected when full are not left in the map */
+  EXPECT_FALSE(hash.contains(70));
+  auto pos = hash.find(42);
+  ASSERT_NE(hash.invalid, pos.index);
+  EXPECT_EQ(84, *pos.entry);
+}
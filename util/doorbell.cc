@@ -0,0 +1,40 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include "doorbell.h"
+
+#include <util/log.h>
+
+#include <cerrno>
+#include <system_error>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+Doorbell::Doorbell() : fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+  if (fd_ < 0) {
+    throw std::system_error(errno, std::generic_category(), "could not create doorbell eventfd");
+  }
+}
+
+Doorbell::~Doorbell()
+{
+  close(fd_);
+}
+
+void Doorbell::disarm()
+{
+  armed_.store(false, std::memory_order_relaxed);
+
+  eventfd_t value;
+  // EAGAIN when the doorbell wasn't rung, which is fine
+  (void)eventfd_read(fd_, &value);
+}
+
+void Doorbell::notify()
+{
+  if (eventfd_write(fd_, 1) < 0) {
+    LOG::warn("Doorbell: could not write to eventfd: {}", std::error_code(errno, std::generic_category()).message());
+  }
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <atomic>
+
+// Lets producers wake up a consumer that is blocked waiting for new elements
+// in its element queues.
+//
+// Before blocking, the consumer arms the doorbell, checks its queues one last
+// time, and then waits for fd() to become readable. Producers ring the
+// doorbell after publishing elements; this only costs a syscall when the
+// doorbell is armed, so a busy consumer doesn't slow producers down.
+//
+class Doorbell {
+public:
+  // Throws std::system_error if the underlying eventfd can't be created.
+  Doorbell();
+  ~Doorbell();
+
+  Doorbell(Doorbell const &) = delete;
+  Doorbell &operator=(Doorbell const &) = delete;
+
+  // File descriptor that becomes readable when the doorbell is rung while armed.
+  int fd() const { return fd_; }
+
+  // Called by producers after publishing elements.
+  void ring()
+  {
+    // Pairs with the fence in arm(): either the producer sees the doorbell
+    // armed, or the consumer sees the published elements in its last check.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (armed_.load(std::memory_order_relaxed) && armed_.exchange(false, std::memory_order_relaxed)) {
+      notify();
+    }
+  }
+
+  // Called by the consumer before its last check of the queues.
+  void arm()
+  {
+    armed_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  // Called by the consumer when it's done waiting. Discards pending rings.
+  void disarm();
+
+  // Whether the doorbell is currently armed.
+  bool armed() const { return armed_.load(std::memory_order_relaxed); }
+
+private:
+  void notify();
+
+  int fd_;
+  std::atomic<bool> armed_{false};
+};
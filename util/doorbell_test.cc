@@ -0,0 +1,67 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <util/doorbell.h>
+#include <util/element_queue_writer.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+
+#include <poll.h>
+
+namespace {
+
+bool is_readable(Doorbell const &doorbell, int timeout_ms = 0)
+{
+  pollfd pfd{.fd = doorbell.fd(), .events = POLLIN, .revents = 0};
+  return poll(&pfd, 1, timeout_ms) == 1 && (pfd.revents & POLLIN);
+}
+
+} // namespace
+
+TEST(doorbell, only_rings_when_armed)
+{
+  Doorbell doorbell;
+
+  doorbell.ring();
+  EXPECT_FALSE(is_readable(doorbell));
+
+  doorbell.arm();
+  doorbell.ring();
+  EXPECT_TRUE(is_readable(doorbell));
+  /* disarmed by the first ring */
+  EXPECT_FALSE(doorbell.armed());
+
+  doorbell.disarm();
+  EXPECT_FALSE(is_readable(doorbell));
+}
+
+TEST(doorbell, element_queue_writer_rings)
+{
+  auto storage = std::make_shared<MemElementQueueStorage>(16, 1024);
+  ElementQueue writer_queue(storage);
+  ElementQueue reader_queue(storage);
+  Doorbell doorbell;
+  ElementQueueWriter writer(writer_queue, &doorbell);
+
+  doorbell.arm();
+  reader_queue.start_read_batch();
+  ASSERT_EQ(-ENOENT, reader_queue.peek());
+  reader_queue.finish_read_batch();
+
+  std::thread producer([&] {
+    auto buf = writer.start_write(4);
+    ASSERT_TRUE(buf);
+    writer.finish_write();
+  });
+
+  EXPECT_TRUE(is_readable(doorbell, 10'000));
+  producer.join();
+  doorbell.disarm();
+
+  reader_queue.start_read_batch();
+  EXPECT_EQ(4, reader_queue.peek());
+  reader_queue.finish_read_batch();
+}
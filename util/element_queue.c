@@ -18,6 +18,15 @@ static inline u32 __eq_next_offset_by_len(u32 buf_offset, u32 buf_mask, u32 len)
   return buf_offset;
 }
 
+/**
+ * Internal helper, refreshes the producer's copy of the consumer's heads.
+ */
+static inline void __eq_load_heads(struct element_queue *eq)
+{
+  eq->elem_head = ACCESS_ONCE(eq->shared->elem_head);
+  eq->buf_head = ACCESS_ONCE(eq->shared->buf_head);
+}
+
 void eq_init_shared(struct element_queue_shared *shared)
 {
   shared->elem_head = 0;
@@ -70,16 +79,22 @@ int eq_write(struct element_queue *eq, u32 len)
   if (aligned_len > eq->buf_mask)
     return -EINVAL;
 
-  /* is the element queue full? */
-  if (eq->elem_tail - eq->elem_head >= eq->elem_mask + 1)
-    return -ENOSPC;
+  /* is the element queue full? if so, check how far the consumer got */
+  if (eq->elem_tail - eq->elem_head >= eq->elem_mask + 1) {
+    __eq_load_heads(eq);
+    if (eq->elem_tail - eq->elem_head >= eq->elem_mask + 1)
+      return -ENOSPC;
+  }
 
   buf_mask = eq->buf_mask;
   buf_tail = __eq_next_offset_by_len(eq->buf_tail, buf_mask, aligned_len);
 
-  /* is there enough space in the eq? */
-  if (buf_tail + aligned_len - eq->buf_head > buf_mask + 1)
-    return -ENOSPC;
+  /* is there enough space in the eq? if not, check how far the consumer got */
+  if (buf_tail + aligned_len - eq->buf_head > buf_mask + 1) {
+    __eq_load_heads(eq);
+    if (buf_tail + aligned_len - eq->buf_head > buf_mask + 1)
+      return -ENOSPC;
+  }
 
   /* okay we're good to go */
   eq->buf_tail = buf_tail + aligned_len;
@@ -12,11 +12,28 @@
 extern "C" {
 #endif /* __cplusplus */
 
+/* the consumer's and the producer's shared indices are kept this far apart */
+#define EQ_CACHE_LINE_SIZE 64
+
+/**
+ * Indices shared between the consumer and the producer.
+ *
+ * Each side writes its indices to its own cache line, so publishing a batch
+ *   doesn't invalidate the line the other side is writing to. Each side also
+ *   keeps a cached copy of the other side's indices in struct element_queue,
+ *   and only re-reads them when that copy runs out: the producer when the
+ *   queue looks full, the consumer when it looks empty.
+ */
 struct element_queue_shared {
+  /* written by the consumer */
   u32 elem_head;
   u32 buf_head;
+  u8 consumer_padding[EQ_CACHE_LINE_SIZE - 2 * sizeof(u32)];
+
+  /* written by the producer */
   u32 elem_tail;
   u32 buf_tail;
+  u8 producer_padding[EQ_CACHE_LINE_SIZE - 2 * sizeof(u32)];
 };
 
 /**
@@ -57,7 +74,8 @@ void eq_init_shared(struct element_queue_shared *shared);
  * @param eq: the element_queue to initialize
  * @param n_elems: number of elements in shared buffer. Must be power of 2.
  * @param buf_len: number of bytes in shared buffer. Must be power of 2.
- * @param data: shared memory area
+ * @param data: shared memory area, aligned to EQ_CACHE_LINE_SIZE so the
+ *   shared indices don't share cache lines with anything else
  *
  * Memory layout of eq data:
  *   element_queue_shared
@@ -83,9 +101,7 @@ u32 eq_contig_size(u32 n_elems, u32 buf_len);
  */
 static inline void eq_start_write_batch(struct element_queue *eq)
 {
-  eq->elem_head = ACCESS_ONCE(eq->shared->elem_head);
-  eq->buf_head = ACCESS_ONCE(eq->shared->buf_head);
-
+  /* the consumer's heads are only re-read when the queue looks full, see eq_write */
   assert((int)eq->buf_tail - eq->buf_head >= 0);
   assert((int)eq->elem_tail - eq->elem_head >= 0);
 }
@@ -130,8 +146,11 @@ static inline void eq_start_read_batch(struct element_queue *eq)
   /* we don't need to read buf_tail because we trust that the sizes in the
    * element-size array do not overflow the element_queue */
 
-  eq->elem_tail = ACCESS_ONCE(eq->shared->elem_tail);
-  smp_rmb();
+  /* only re-read the producer's tail once the elements seen so far are consumed */
+  if (eq->elem_head == eq->elem_tail) {
+    eq->elem_tail = ACCESS_ONCE(eq->shared->elem_tail);
+    smp_rmb();
+  }
 
   assert((int)eq->elem_tail - eq->elem_head >= 0);
 }
@@ -184,9 +203,14 @@ static inline void eq_finish_read_batch(struct element_queue *eq)
  */
 int eq_move(struct element_queue *to, struct element_queue *from);
 
+/*
+ * eq_elem_count and eq_buf_used read the shared indices, since the cached
+ *   copy of the other side's indices can be arbitrarily stale
+ */
+
 static inline u32 eq_elem_count(const struct element_queue *eq)
 {
-  return eq->elem_tail - eq->elem_head;
+  return ACCESS_ONCE(eq->shared->elem_tail) - ACCESS_ONCE(eq->shared->elem_head);
 }
 
 static inline u32 eq_elem_capacity(const struct element_queue *eq)
@@ -196,7 +220,7 @@ static inline u32 eq_elem_capacity(const struct element_queue *eq)
 
 static inline u32 eq_buf_used(const struct element_queue *eq)
 {
-  return eq->buf_tail - eq->buf_head;
+  return ACCESS_ONCE(eq->shared->buf_tail) - ACCESS_ONCE(eq->shared->buf_head);
 }
 
 static inline u32 eq_buf_capacity(const struct element_queue *eq)
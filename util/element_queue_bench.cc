@@ -0,0 +1,126 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+// Measures element queue throughput between a producer and a consumer pinned to different cores. The producer writes
+// one element per write batch, like ElementQueueWriter does, and the consumer drains the queue in batches, like the
+// reducer's cores do with their RpcQueueMatrix queues, which have the same default sizes as the queue used here.
+//
+// Usage: element_queue_bench [producer_cpu] [consumer_cpu] [n_elems] [elem_size]
+
+#include <util/element_queue_cpp.h>
+#include <util/stop_watch.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+namespace {
+
+/* RpcQueueMatrix defaults */
+constexpr u32 queue_n_elems = 1 << 18;
+constexpr u32 queue_buf_len = 8 * 1024 * 1024;
+
+/* elements read per read batch, like reducer::Core's kMaxRpcBatchPerQueue */
+constexpr u32 read_batch_size = 1000;
+
+void pin_to_cpu(int cpu)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (int const res = pthread_setaffinity_np(pthread_self(), sizeof(set), &set); res != 0) {
+    throw std::runtime_error("could not pin thread to cpu " + std::to_string(cpu) + ": " + strerror(res));
+  }
+}
+
+void produce(ElementQueueStoragePtr const &storage, int cpu, u64 n_elems, u32 elem_size, std::atomic<bool> &go)
+{
+  pin_to_cpu(cpu);
+  ElementQueue queue(storage);
+
+  std::vector<char> elem(elem_size);
+  while (!go.load(std::memory_order_acquire)) {
+  }
+
+  for (u64 i = 0; i < n_elems; ++i) {
+    memcpy(elem.data(), &i, std::min<std::size_t>(sizeof(i), elem_size));
+
+    for (;;) {
+      queue.start_write_batch();
+      int const offset = eq_write(&queue, elem_size);
+      if (offset >= 0) {
+        memcpy(queue.data + offset, elem.data(), elem_size);
+        queue.finish_write_batch();
+        break;
+      }
+      queue.finish_write_batch();
+
+      if (offset != -ENOSPC) {
+        throw std::runtime_error("eq_write failed");
+      }
+    }
+  }
+}
+
+u64 consume(ElementQueueStoragePtr const &storage, int cpu, u64 n_elems, std::atomic<bool> &go)
+{
+  pin_to_cpu(cpu);
+  ElementQueue queue(storage);
+
+  u64 checksum = 0;
+  go.store(true, std::memory_order_release);
+
+  for (u64 n_read = 0; n_read < n_elems;) {
+    queue.start_read_batch();
+    for (u32 i = 0; i < read_batch_size && queue.peek() >= 0; ++i, ++n_read) {
+      char *elem = nullptr;
+      int const len = queue.read(elem);
+      checksum += len + elem[0];
+    }
+    queue.finish_read_batch();
+  }
+
+  return checksum;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  int const producer_cpu = argc > 1 ? std::atoi(argv[1]) : 0;
+  int const consumer_cpu = argc > 2 ? std::atoi(argv[2]) : 1;
+  u64 const n_elems = argc > 3 ? std::atoll(argv[3]) : 50'000'000;
+  u32 const elem_size = argc > 4 ? std::atoi(argv[4]) : 64;
+
+  if (elem_size == 0) {
+    std::cerr << "elem_size must be positive" << std::endl;
+    return 1;
+  }
+
+  auto storage = std::make_shared<MemElementQueueStorage>(queue_n_elems, queue_buf_len);
+  std::atomic<bool> go = false;
+
+  StopWatch<> watch;
+  std::thread producer(produce, storage, producer_cpu, n_elems, elem_size, std::ref(go));
+  u64 const checksum = consume(storage, consumer_cpu, n_elems, go);
+  producer.join();
+  double const ns = watch.elapsed_ns();
+
+  std::cout << "cpus " << producer_cpu << " -> " << consumer_cpu << ", " << n_elems << " elements of " << elem_size
+            << " bytes" << std::endl;
+  std::cout << "  " << ns / n_elems << " ns/element, " << n_elems * 1e3 / ns << " Melements/s, "
+            << n_elems * elem_size * 1e3 / ns << " MB/s" << std::endl;
+  std::cout << "checksum: " << checksum << std::endl;
+  return 0;
+}
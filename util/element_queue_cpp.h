@@ -162,10 +162,11 @@ protected:
 
 inline MemElementQueueStorage::MemElementQueueStorage(u32 n_elems, u32 buf_len) : ElementQueueStorage(n_elems, buf_len)
 {
-  u32 size = eq_contig_size(n_elems, buf_len);
+  /* aligned_alloc needs the size to be a multiple of the alignment */
+  u32 size = (eq_contig_size(n_elems, buf_len) + EQ_CACHE_LINE_SIZE - 1) & ~(EQ_CACHE_LINE_SIZE - 1);
 
-  /* allocate contig memory */
-  data_ = (char *)malloc(size);
+  /* allocate contig memory, cache line aligned for the shared indices */
+  data_ = (char *)aligned_alloc(EQ_CACHE_LINE_SIZE, size);
   if (data_ == NULL)
     throw std::runtime_error("Unable to allocate memory for element queue");
 
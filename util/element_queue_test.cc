@@ -0,0 +1,106 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <util/element_queue_cpp.h>
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace {
+
+ElementQueueStoragePtr make_storage(u32 n_elems, u32 buf_len)
+{
+  return std::make_shared<MemElementQueueStorage>(n_elems, buf_len);
+}
+
+bool write(ElementQueue &queue, std::string const &elem)
+{
+  queue.start_write_batch();
+  int const res = queue.write(elem);
+  queue.finish_write_batch();
+  return res == 0;
+}
+
+} // namespace
+
+TEST(element_queue, shared_indices_on_separate_cache_lines)
+{
+  EXPECT_GE(offsetof(element_queue_shared, elem_tail) - offsetof(element_queue_shared, elem_head), EQ_CACHE_LINE_SIZE);
+  EXPECT_EQ(0u, sizeof(element_queue_shared) % EQ_CACHE_LINE_SIZE);
+
+  auto storage = make_storage(16, 1024);
+  EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(storage->data()) % EQ_CACHE_LINE_SIZE);
+}
+
+TEST(element_queue, read_write_wrap_around)
+{
+  auto storage = make_storage(4, 64);
+  ElementQueue writer(storage);
+  ElementQueue reader(storage);
+
+  for (int i = 0; i < 100; ++i) {
+    std::string const elem = "element " + std::to_string(i);
+    ASSERT_TRUE(write(writer, elem));
+
+    reader.start_read_batch();
+    EXPECT_EQ(elem, reader.read());
+    EXPECT_EQ(-ENOENT, reader.peek());
+    reader.finish_read_batch();
+  }
+}
+
+TEST(element_queue, writer_sees_space_freed_by_reader)
+{
+  auto storage = make_storage(4, 1024);
+  ElementQueue writer(storage);
+  ElementQueue reader(storage);
+
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(write(writer, "x"));
+  }
+  EXPECT_FALSE(write(writer, "full"));
+  EXPECT_EQ(4u, writer.elem_count());
+
+  reader.start_read_batch();
+  EXPECT_EQ("x", reader.read());
+  EXPECT_EQ("x", reader.read());
+  reader.finish_read_batch();
+
+  /* the writer only learns about the freed elements once it runs out of space */
+  EXPECT_EQ(2u, writer.elem_count());
+  EXPECT_TRUE(write(writer, "y"));
+  EXPECT_TRUE(write(writer, "z"));
+  EXPECT_FALSE(write(writer, "full"));
+}
+
+TEST(element_queue, reader_sees_new_elements_once_caught_up)
+{
+  auto storage = make_storage(16, 1024);
+  ElementQueue writer(storage);
+  ElementQueue reader(storage);
+
+  ASSERT_TRUE(write(writer, "a"));
+  ASSERT_TRUE(write(writer, "b"));
+
+  reader.start_read_batch();
+  EXPECT_EQ("a", reader.read());
+  reader.finish_read_batch();
+
+  ASSERT_TRUE(write(writer, "c"));
+
+  /* the batch still has "b" from the previous view, "c" shows up in the next one */
+  reader.start_read_batch();
+  EXPECT_EQ("b", reader.read());
+  EXPECT_EQ(-ENOENT, reader.peek());
+  reader.finish_read_batch();
+
+  reader.start_read_batch();
+  EXPECT_EQ("c", reader.read());
+  reader.finish_read_batch();
+
+  EXPECT_EQ(0u, reader.elem_count());
+}
@@ -7,6 +7,7 @@
 
 #include <channel/ibuffered_writer.h>
 #include <platform/platform.h>
+#include <util/doorbell.h>
 #include <util/element_queue_cpp.h>
 
 // Adapter class for writing to ElementQueues through the
@@ -14,7 +15,9 @@
 //
 class ElementQueueWriter : public IBufferedWriter {
 public:
-  ElementQueueWriter(ElementQueue &queue);
+  // If \p doorbell is given, it is rung after each write, so a consumer
+  // blocked on it wakes up as soon as there are elements to read.
+  ElementQueueWriter(ElementQueue &queue, Doorbell *doorbell = nullptr);
   virtual ~ElementQueueWriter();
 
   // Starts a write operation of size \p length.
@@ -42,5 +45,6 @@ public:
 
 private:
   ElementQueue &queue_;
+  Doorbell *doorbell_;
   u64 num_write_stalls_{0};
 };
@@ -23,12 +23,13 @@ template <
     std::size_t ELEM_POOL_SZ,
     class Hash,
     class KeyEqual = std::equal_to<Key>,
-    class Allocator = std::allocator<T>>
+    class Allocator = std::allocator<T>,
+    class PoolType = Pool<T, ELEM_POOL_SZ, Allocator>>
 class FixedHash {
 public:
   using key_type = Key;
   using value_type = T;
-  using pool_type = Pool<value_type, ELEM_POOL_SZ, Allocator>;
+  using pool_type = PoolType;
   using index_type = typename pool_type::index_type;
   using size_type = std::size_t;
   using map_type = absl::flat_hash_map<key_type, index_type, Hash, KeyEqual, Allocator>;
@@ -48,7 +49,12 @@ public:
   size_type capacity() const { return pool_.capacity(); }
   value_type const &operator[](index_type index) const { return pool_[index]; }
   value_type &operator[](index_type index) { return pool_[index]; }
-  bitmap_type allocated() const { return pool_.allocated(); }
+  bitmap_type const &allocated() const { return pool_.allocated(); }
+
+  /* only available when pool_type is a ChunkedPool */
+  size_type committed() const { return pool_.committed(); }
+  size_type soft_limit() const { return pool_.soft_limit(); }
+  void set_limits(size_type soft_limit, size_type hard_limit) { pool_.set_limits(soft_limit, hard_limit); }
 
   template <typename K> bool contains(const K &key) const { return map_.count(key) == 1; }
 
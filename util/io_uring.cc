@@ -0,0 +1,242 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <util/io_uring.h>
+
+#include <util/log.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+template <typename T> T *at_offset(void *base, u32 offset)
+{
+  return reinterpret_cast<T *>(static_cast<char *>(base) + offset);
+}
+
+void *map(std::size_t size, int fd, off_t offset)
+{
+  int const flags = fd < 0 ? MAP_PRIVATE | MAP_ANONYMOUS : MAP_SHARED | MAP_POPULATE;
+  void *const address = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, fd, offset);
+  if (address == MAP_FAILED) {
+    throw std::system_error(errno, std::generic_category(), "io_uring: mmap failed");
+  }
+  return address;
+}
+
+void unmap(void *address, std::size_t size)
+{
+  if (address) {
+    munmap(address, size);
+  }
+}
+
+} // namespace
+
+IoUring::IoUring(u32 entries, u32 cq_entries)
+{
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = cq_entries ? cq_entries : entries * 4;
+
+  fd_ = syscall(__NR_io_uring_setup, entries, &params);
+  if (fd_ < 0) {
+    throw std::system_error(errno, std::generic_category(), "io_uring_setup failed");
+  }
+  features_ = params.features;
+
+  try {
+    // without it, completions that don't fit in the completion queue are lost
+    if (!(features_ & IORING_FEAT_NODROP)) {
+      throw std::system_error(ENOSYS, std::generic_category(), "io_uring does not support IORING_FEAT_NODROP");
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(u32);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    if (features_ & IORING_FEAT_SINGLE_MMAP) {
+      sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+      sq_ring_ = map(sq_ring_size_, fd_, IORING_OFF_SQ_RING);
+      cq_ring_ = sq_ring_;
+    } else {
+      sq_ring_ = map(sq_ring_size_, fd_, IORING_OFF_SQ_RING);
+      cq_ring_ = map(cq_ring_size_, fd_, IORING_OFF_CQ_RING);
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe *>(map(sqes_size_, fd_, IORING_OFF_SQES));
+  } catch (...) {
+    release();
+    throw;
+  }
+
+  sq_.head = at_offset<u32>(sq_ring_, params.sq_off.head);
+  sq_.tail = at_offset<u32>(sq_ring_, params.sq_off.tail);
+  sq_.flags = at_offset<u32>(sq_ring_, params.sq_off.flags);
+  sq_.mask = *at_offset<u32>(sq_ring_, params.sq_off.ring_mask);
+  sq_.entries = *at_offset<u32>(sq_ring_, params.sq_off.ring_entries);
+  sq_.array = at_offset<u32>(sq_ring_, params.sq_off.array);
+  sq_.sqe_tail = *sq_.tail;
+
+  // entries are always used in order, so the indirection array is fixed
+  for (u32 i = 0; i < sq_.entries; ++i) {
+    sq_.array[i] = i;
+  }
+
+  cq_.head = at_offset<u32>(cq_ring_, params.cq_off.head);
+  cq_.tail = at_offset<u32>(cq_ring_, params.cq_off.tail);
+  cq_.mask = *at_offset<u32>(cq_ring_, params.cq_off.ring_mask);
+  cq_.cqes = at_offset<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+}
+
+IoUring::~IoUring()
+{
+  release();
+}
+
+void IoUring::release()
+{
+  unmap(sqes_, sqes_size_);
+  if (cq_ring_ != sq_ring_) {
+    unmap(cq_ring_, cq_ring_size_);
+  }
+  unmap(sq_ring_, sq_ring_size_);
+  sqes_ = nullptr;
+  cq_ring_ = sq_ring_ = nullptr;
+
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+io_uring_sqe *IoUring::get_sqe()
+{
+  if (sq_.sqe_tail - std::atomic_ref<u32>(*sq_.head).load(std::memory_order_acquire) >= sq_.entries) {
+    submit();
+    if (sq_.sqe_tail - std::atomic_ref<u32>(*sq_.head).load(std::memory_order_acquire) >= sq_.entries) {
+      throw std::system_error(EBUSY, std::generic_category(), "io_uring: submission queue is full");
+    }
+  }
+
+  io_uring_sqe *const sqe = &sqes_[sq_.sqe_tail & sq_.mask];
+  memset(sqe, 0, sizeof(*sqe));
+  ++sq_.sqe_tail;
+  return sqe;
+}
+
+u32 IoUring::submit(u32 wait_for)
+{
+  std::atomic_ref<u32>(*sq_.tail).store(sq_.sqe_tail, std::memory_order_release);
+
+  u32 const to_submit = sq_.sqe_tail - std::atomic_ref<u32>(*sq_.head).load(std::memory_order_acquire);
+  if (to_submit == 0 && wait_for == 0) {
+    return 0;
+  }
+
+  for (;;) {
+    int const submitted =
+        syscall(__NR_io_uring_enter, fd_, to_submit, wait_for, wait_for ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+    if (submitted >= 0) {
+      return submitted;
+    }
+
+    switch (errno) {
+    case EINTR:
+      continue;
+
+    case EAGAIN:
+    case EBUSY:
+      // out of memory for requests, or completions need to be processed first:
+      // the entries are left in the queue for the next submit()
+      return 0;
+
+    default:
+      throw std::system_error(errno, std::generic_category(), "io_uring_enter failed");
+    }
+  }
+}
+
+void IoUring::flush_overflow()
+{
+  while (syscall(__NR_io_uring_enter, fd_, 0, 0, IORING_ENTER_GETEVENTS, nullptr, 0) < 0) {
+    if (errno != EINTR) {
+      throw std::system_error(errno, std::generic_category(), "io_uring_enter failed");
+    }
+  }
+}
+
+void IoUring::register_with(unsigned opcode, void *arg, unsigned nr_args)
+{
+  if (syscall(__NR_io_uring_register, fd_, opcode, arg, nr_args) < 0) {
+    throw std::system_error(errno, std::generic_category(), "io_uring_register failed");
+  }
+}
+
+IoUringBufferRing::IoUringBufferRing(IoUring &ring, u16 group, u32 count, u32 size)
+    : ring_(ring), group_(group), count_(count), size_(size)
+{
+  if (count == 0 || (count & (count - 1)) || count > (1u << 15)) {
+    throw std::system_error(EINVAL, std::generic_category(), "io_uring: buffer count must be a power of 2 up to 32768");
+  }
+
+  ring_entries_ = static_cast<io_uring_buf_ring *>(map(count_ * sizeof(io_uring_buf), -1, 0));
+
+  try {
+    buffers_ = static_cast<u8 *>(map(static_cast<std::size_t>(count_) * size_, -1, 0));
+
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<u64>(ring_entries_);
+    reg.ring_entries = count_;
+    reg.bgid = group_;
+    ring_.register_with(IORING_REGISTER_PBUF_RING, &reg, 1);
+  } catch (...) {
+    unmap(buffers_, static_cast<std::size_t>(count_) * size_);
+    unmap(ring_entries_, count_ * sizeof(io_uring_buf));
+    throw;
+  }
+
+  for (u32 id = 0; id < count_; ++id) {
+    recycle(id);
+  }
+}
+
+IoUringBufferRing::~IoUringBufferRing()
+{
+  io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.bgid = group_;
+  try {
+    ring_.register_with(IORING_UNREGISTER_PBUF_RING, &reg, 1);
+  } catch (std::system_error const &e) {
+    LOG::warn("IoUringBufferRing: could not unregister buffer group {}: {}", group_, e.what());
+  }
+
+  unmap(buffers_, static_cast<std::size_t>(count_) * size_);
+  unmap(ring_entries_, count_ * sizeof(io_uring_buf));
+}
+
+void IoUringBufferRing::recycle(u16 id)
+{
+  // the first entry's last field overlaps the ring's tail, so fields are set
+  // one by one rather than with a struct assignment
+  //
+  // entries are not accessed through io_uring_buf_ring::bufs, which some
+  // versions of the uapi header place after an empty struct in C++
+  io_uring_buf &entry = reinterpret_cast<io_uring_buf *>(ring_entries_)[tail_ & (count_ - 1)];
+  entry.addr = reinterpret_cast<u64>(buffer(id));
+  entry.len = size_;
+  entry.bid = id;
+
+  ++tail_;
+  std::atomic_ref<u16>(ring_entries_->tail).store(tail_, std::memory_order_release);
+}
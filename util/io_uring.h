@@ -0,0 +1,153 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <platform/types.h>
+
+#include <linux/io_uring.h>
+
+#include <atomic>
+#include <cstddef>
+
+// An io_uring instance, set up through the raw system calls: a submission
+// queue, a completion queue, and nothing else.
+//
+// Not thread-safe: meant to be used by a single thread.
+class IoUring {
+public:
+  // Sets up a ring with |entries| submission queue entries and |cq_entries|
+  // completion queue entries, or four times |entries| if 0.
+  //
+  // Throws std::system_error if io_uring is not available, e.g. because the
+  // kernel is too old or a seccomp profile blocks it.
+  explicit IoUring(u32 entries, u32 cq_entries = 0);
+  ~IoUring();
+
+  IoUring(IoUring const &) = delete;
+  IoUring &operator=(IoUring const &) = delete;
+
+  // File descriptor that polls readable while completions are available.
+  int fd() const { return fd_; }
+
+  // Returns a cleared submission queue entry to fill in, which is submitted
+  // with the next submit(). Submits the queued entries first if the
+  // submission queue is full.
+  io_uring_sqe *get_sqe();
+
+  // Submits the queued entries and waits for at least |wait_for| completions.
+  //
+  // Returns the number of entries submitted. Throws std::system_error on
+  // failure, except for transient ones after which submit() can be retried.
+  u32 submit(u32 wait_for = 0);
+
+  // Calls |fn| with each available completion, then hands all of them back to
+  // the kernel at once. |fn| can queue new submissions.
+  //
+  // Returns the number of completions processed.
+  template <typename Fn> u32 for_each_completion(Fn &&fn)
+  {
+    u32 count = 0;
+    for (;;) {
+      u32 head = *cq_.head;
+      u32 const tail = std::atomic_ref<u32>(*cq_.tail).load(std::memory_order_acquire);
+
+      count += tail - head;
+      for (; head != tail; ++head) {
+        fn(cq_.cqes[head & cq_.mask]);
+      }
+
+      std::atomic_ref<u32>(*cq_.head).store(head, std::memory_order_release);
+
+      if (!(std::atomic_ref<u32>(*sq_.flags).load(std::memory_order_acquire) & IORING_SQ_CQ_OVERFLOW)) {
+        return count;
+      }
+      flush_overflow();
+    }
+  }
+
+  // Registers |arg| with the ring, as per io_uring_register(2). Throws
+  // std::system_error on failure.
+  void register_with(unsigned opcode, void *arg, unsigned nr_args);
+
+private:
+  // Has the kernel move the completions that didn't fit in the completion
+  // queue, which it holds on to until asked, into the queue.
+  void flush_overflow();
+
+  void release();
+
+  int fd_ = -1;
+  u32 features_ = 0;
+
+  struct {
+    u32 *head;
+    u32 *tail;
+    u32 *flags;
+    u32 mask;
+    u32 entries;
+    u32 *array;
+    /* tail of the entries handed out by get_sqe(), published by submit() */
+    u32 sqe_tail = 0;
+  } sq_;
+
+  struct {
+    u32 *head;
+    u32 *tail;
+    u32 mask;
+    io_uring_cqe *cqes;
+  } cq_;
+
+  io_uring_sqe *sqes_ = nullptr;
+
+  void *sq_ring_ = nullptr;
+  std::size_t sq_ring_size_ = 0;
+  void *cq_ring_ = nullptr;
+  std::size_t cq_ring_size_ = 0;
+  std::size_t sqes_size_ = 0;
+};
+
+// A ring of buffers that receive operations pick from as data arrives, rather
+// than a buffer given to each operation up front, so that idle connections
+// don't hold any memory.
+//
+// Completions of operations that picked a buffer carry IORING_CQE_F_BUFFER and
+// the buffer's id; the buffer must be recycled once its data has been used.
+//
+// Not thread-safe: meant to be used by the thread that uses the IoUring.
+class IoUringBufferRing {
+public:
+  // Registers |count| buffers, a power of 2, of |size| bytes each with |ring|
+  // as buffer group |group|.
+  //
+  // Throws std::system_error if provided buffer rings are not supported
+  // (Linux 5.19 and later) or the memory can't be allocated.
+  IoUringBufferRing(IoUring &ring, u16 group, u32 count, u32 size);
+  ~IoUringBufferRing();
+
+  IoUringBufferRing(IoUringBufferRing const &) = delete;
+  IoUringBufferRing &operator=(IoUringBufferRing const &) = delete;
+
+  u16 group() const { return group_; }
+  u32 buffer_size() const { return size_; }
+
+  // Buffer id of a completion that has IORING_CQE_F_BUFFER set.
+  static u16 buffer_id(io_uring_cqe const &cqe) { return cqe.flags >> IORING_CQE_BUFFER_SHIFT; }
+
+  u8 const *buffer(u16 id) const { return buffers_ + static_cast<std::size_t>(id) * size_; }
+
+  // Hands buffer |id| back to the kernel.
+  void recycle(u16 id);
+
+private:
+  IoUring &ring_;
+  u16 const group_;
+  u32 const count_;
+  u32 const size_;
+
+  io_uring_buf_ring *ring_entries_ = nullptr;
+  u8 *buffers_ = nullptr;
+  u16 tail_ = 0;
+};
@@ -0,0 +1,119 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <platform/types.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+
+namespace util {
+
+// Histogram of non-negative integer values, in log-linear buckets: values
+// below 32 have a bucket each, and each power of two above that is split in 32
+// buckets. Estimates are bucket midpoints, which are within 1/64 (1.6%) of any
+// value in the bucket. Values at or above 2^36 go to the last bucket.
+//
+// Unlike TDigest, values can be removed as well as added, so a histogram can
+// track a sliding window by removing the values that leave it. Its size is
+// fixed, whatever the number of values.
+class LogHistogram {
+public:
+  static constexpr u32 sub_bucket_bits = 5;
+  static constexpr u32 sub_bucket_count = 1u << sub_bucket_bits;
+  static constexpr u32 max_value_bits = 36;
+  static constexpr u32 group_count = max_value_bits - sub_bucket_bits + 1;
+  static constexpr u32 bucket_count = group_count * sub_bucket_count;
+
+  // Returns the bucket that |value| is counted in.
+  static u32 bucket_of(u64 value)
+  {
+    if (value < sub_bucket_count) {
+      return static_cast<u32>(value);
+    }
+
+    u32 const exponent = 63 - __builtin_clzll(value);
+    if (exponent >= max_value_bits) {
+      return bucket_count - 1;
+    }
+
+    // the bits right after the leading one select the bucket within the group
+    u32 const shift = exponent - sub_bucket_bits;
+    return (shift + 1) * sub_bucket_count + static_cast<u32>(value >> shift) - sub_bucket_count;
+  }
+
+  // Returns the value in the middle of |bucket|.
+  static double bucket_midpoint(u32 bucket)
+  {
+    assert(bucket < bucket_count);
+    u32 const group = bucket / sub_bucket_count;
+    if (group == 0) {
+      return bucket;
+    }
+
+    u32 const shift = group - 1;
+    u64 const lower = static_cast<u64>(sub_bucket_count + bucket % sub_bucket_count) << shift;
+    return lower + static_cast<double>((u64{1} << shift) - 1) / 2;
+  }
+
+  inline u64 count() const { return count_; }
+  inline bool empty() const { return count_ == 0; }
+
+  void add(u64 value, u32 n = 1) { add_to_bucket(bucket_of(value), n); }
+
+  void add_to_bucket(u32 bucket, u32 n = 1)
+  {
+    assert(bucket < bucket_count);
+    counts_[bucket] += n;
+    group_counts_[bucket / sub_bucket_count] += n;
+    count_ += n;
+  }
+
+  // Removes |n| values that were added to |bucket|.
+  void remove_from_bucket(u32 bucket, u32 n = 1)
+  {
+    assert(bucket < bucket_count);
+    assert(counts_[bucket] >= n);
+    counts_[bucket] -= n;
+    group_counts_[bucket / sub_bucket_count] -= n;
+    count_ -= n;
+  }
+
+  // Estimates the value at quantile |q|, between 0 and 1, as the midpoint of
+  // the bucket that holds the value of that rank.
+  // Returns 0 if the histogram is empty.
+  double estimate_value_at_quantile(double q) const
+  {
+    if (count_ == 0) {
+      return 0.0;
+    }
+
+    u64 rank = static_cast<u64>(std::ceil(std::clamp(q, 0.0, 1.0) * count_));
+    rank = std::clamp<u64>(rank, 1, count_);
+
+    // skip whole groups first, so that this looks at most at group_count + sub_bucket_count counters
+    u32 group = 0;
+    for (; rank > group_counts_[group]; ++group) {
+      rank -= group_counts_[group];
+    }
+
+    u32 bucket = group * sub_bucket_count;
+    for (; rank > counts_[bucket]; ++bucket) {
+      rank -= counts_[bucket];
+    }
+
+    return bucket_midpoint(bucket);
+  }
+
+private:
+  u64 count_ = 0;
+  std::array<u32, group_count> group_counts_{};
+  std::array<u32, bucket_count> counts_{};
+};
+
+} // namespace util
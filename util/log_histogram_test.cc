@@ -0,0 +1,79 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include "util/log_histogram.h"
+#include "gtest/gtest.h"
+
+namespace util {
+namespace {
+
+TEST(LogHistogramTest, SmallValuesAreExact)
+{
+  LogHistogram histogram;
+  for (u64 i = 1; i <= 20; ++i) {
+    histogram.add(i);
+  }
+
+  EXPECT_EQ(histogram.count(), 20u);
+  EXPECT_EQ(histogram.estimate_value_at_quantile(0), 1);
+  EXPECT_EQ(histogram.estimate_value_at_quantile(0.5), 10);
+  EXPECT_EQ(histogram.estimate_value_at_quantile(0.9), 18);
+  EXPECT_EQ(histogram.estimate_value_at_quantile(1), 20);
+}
+
+TEST(LogHistogramTest, Buckets)
+{
+  EXPECT_EQ(LogHistogram::bucket_of(31), 31u);
+  EXPECT_EQ(LogHistogram::bucket_of(32), 32u);
+  EXPECT_EQ(LogHistogram::bucket_of(63), 63u);
+  EXPECT_EQ(LogHistogram::bucket_of(64), 64u);
+  EXPECT_EQ(LogHistogram::bucket_of(65), 64u);
+  EXPECT_EQ(LogHistogram::bucket_of(66), 65u);
+  EXPECT_EQ(LogHistogram::bucket_of(~u64{0}), LogHistogram::bucket_count - 1);
+
+  EXPECT_EQ(LogHistogram::bucket_midpoint(64), 64.5);
+
+  // every bucket's values are within its relative error of the midpoint
+  for (u64 value = 1; value < (u64{1} << 20); value = value * 9 / 8 + 1) {
+    double const midpoint = LogHistogram::bucket_midpoint(LogHistogram::bucket_of(value));
+    EXPECT_NEAR(midpoint, value, value / 64.0) << value;
+  }
+}
+
+TEST(LogHistogramTest, Quantiles)
+{
+  LogHistogram histogram;
+  for (u64 i = 1; i <= 100'000; ++i) {
+    histogram.add(i);
+  }
+
+  EXPECT_NEAR(histogram.estimate_value_at_quantile(0.90), 90'000, 90'000 / 64.0);
+  EXPECT_NEAR(histogram.estimate_value_at_quantile(0.95), 95'000, 95'000 / 64.0);
+  EXPECT_NEAR(histogram.estimate_value_at_quantile(0.99), 99'000, 99'000 / 64.0);
+}
+
+TEST(LogHistogramTest, Remove)
+{
+  LogHistogram histogram;
+  EXPECT_EQ(histogram.estimate_value_at_quantile(0.5), 0);
+
+  for (u64 i = 1; i <= 10; ++i) {
+    histogram.add(i * 1000);
+  }
+  EXPECT_NEAR(histogram.estimate_value_at_quantile(0.9), 9000, 9000 / 64.0);
+
+  // removing the largest values, as when they leave a sliding window
+  histogram.remove_from_bucket(LogHistogram::bucket_of(10'000));
+  histogram.remove_from_bucket(LogHistogram::bucket_of(9'000));
+  EXPECT_EQ(histogram.count(), 8u);
+  EXPECT_NEAR(histogram.estimate_value_at_quantile(1), 8000, 8000 / 64.0);
+
+  for (u64 i = 1; i <= 8; ++i) {
+    histogram.remove_from_bucket(LogHistogram::bucket_of(i * 1000));
+  }
+  EXPECT_TRUE(histogram.empty());
+  EXPECT_EQ(histogram.estimate_value_at_quantile(0.5), 0);
+}
+
+} // namespace
+} // namespace util
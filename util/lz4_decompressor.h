@@ -29,6 +29,8 @@ public:
   // Discards |len| bytes of data in output_buf.
   void discard(size_t len);
 
+  static char const *error_name(size_t error) { return LZ4F_getErrorName(error); }
+
 private:
   const size_t output_buf_capacity_;
   size_t tail_loc_;
@@ -0,0 +1,60 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <util/reuseport_steering.h>
+
+#include <platform/types.h>
+
+#include <cerrno>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+
+#include <sys/socket.h>
+
+ReuseportSteering::ReuseportSteering(std::vector<double> const &weights)
+{
+  // each socket but the last takes a compare and a return
+  if (weights.empty() || weights.size() * 2 > BPF_MAXINSNS) {
+    throw std::invalid_argument("ReuseportSteering: unsupported number of sockets");
+  }
+
+  double total = 0;
+  for (double const weight : weights) {
+    if (!(weight >= 0) || !std::isfinite(weight)) {
+      throw std::invalid_argument("ReuseportSteering: weights must be non-negative");
+    }
+    total += weight;
+  }
+
+  // A = random u32
+  program_.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<u32>(SKF_AD_OFF + SKF_AD_RANDOM)));
+
+  // socket i is picked when A falls below the sum of the weights up to i,
+  // scaled to the u32 range
+  double const scale = static_cast<double>(std::numeric_limits<u32>::max()) + 1;
+  double cumulative = 0;
+  for (u32 i = 0; i + 1 < weights.size(); ++i) {
+    cumulative += total > 0 ? weights[i] / total : 1.0 / weights.size();
+    double const threshold = std::min(std::round(cumulative * scale), scale - 1);
+
+    // if A >= threshold skip the return that follows
+    program_.push_back(BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, static_cast<u32>(threshold), 1, 0));
+    program_.push_back(BPF_STMT(BPF_RET | BPF_K, i));
+  }
+  program_.push_back(BPF_STMT(BPF_RET | BPF_K, static_cast<u32>(weights.size() - 1)));
+}
+
+void ReuseportSteering::attach(int fd) const
+{
+  struct sock_fprog fprog = {
+      .len = static_cast<unsigned short>(program_.size()),
+      .filter = const_cast<sock_filter *>(program_.data()),
+  };
+
+  if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &fprog, sizeof(fprog)) != 0) {
+    throw std::system_error(errno, std::generic_category(), "could not attach reuseport steering program");
+  }
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <linux/filter.h>
+
+#include <vector>
+
+// Steers the connections made to a group of SO_REUSEPORT listening sockets.
+//
+// By default the kernel picks the socket accepting a connection by a hash of
+// its addresses and ports, which spreads connections evenly. A steering
+// program picks it instead, here at random with given odds for each socket,
+// so that new connections can be sent away from busy listeners.
+//
+// Sockets are numbered in the order they started listening. Closing one of
+// them renumbers the others, so the program is meant for groups whose
+// sockets are all kept open.
+//
+class ReuseportSteering {
+public:
+  // Builds a program that picks socket i with odds proportional to
+  // |weights|[i], which must be non-negative. All sockets have the same odds
+  // if the weights are all zero.
+  explicit ReuseportSteering(std::vector<double> const &weights);
+
+  // Attaches the program to the group of the listening socket |fd|,
+  // replacing the one attached before if any.
+  //
+  // Throws std::system_error on failure.
+  void attach(int fd) const;
+
+  // The classic BPF program.
+  std::vector<sock_filter> const &program() const { return program_; }
+
+private:
+  std::vector<sock_filter> program_;
+};
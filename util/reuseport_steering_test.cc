@@ -0,0 +1,138 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+#include <util/reuseport_steering.h>
+
+#include <platform/types.h>
+
+#include <gtest/gtest.h>
+
+#include <cerrno>
+#include <stdexcept>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// Socket picked by |steering| for a given random number.
+u32 pick(ReuseportSteering const &steering, u32 random)
+{
+  auto const &program = steering.program();
+  for (std::size_t pc = 1; pc < program.size(); ++pc) {
+    auto const &insn = program[pc];
+    if (BPF_CLASS(insn.code) == BPF_RET) {
+      return insn.k;
+    }
+    pc += random >= insn.k ? insn.jt : insn.jf;
+  }
+  ADD_FAILURE() << "program does not return";
+  return 0;
+}
+
+// Listening sockets in one SO_REUSEPORT group.
+class ReuseportGroup {
+public:
+  explicit ReuseportGroup(std::size_t size)
+  {
+    addr_.sin_family = AF_INET;
+    addr_.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    for (std::size_t i = 0; i < size; ++i) {
+      int const fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+      EXPECT_GE(fd, 0);
+      int const one = 1;
+      EXPECT_EQ(setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)), 0);
+      EXPECT_EQ(bind(fd, reinterpret_cast<struct sockaddr *>(&addr_), sizeof(addr_)), 0);
+      EXPECT_EQ(listen(fd, 64), 0);
+      if (i == 0) {
+        socklen_t addr_len = sizeof(addr_);
+        EXPECT_EQ(getsockname(fd, reinterpret_cast<struct sockaddr *>(&addr_), &addr_len), 0);
+      }
+      fds_.push_back(fd);
+    }
+  }
+
+  ~ReuseportGroup()
+  {
+    for (int fd : fds_) {
+      close(fd);
+    }
+  }
+
+  int fd(std::size_t i) const { return fds_[i]; }
+
+  // Makes |count| connections, and returns how many each socket accepted.
+  std::vector<std::size_t> connect_and_count(std::size_t count)
+  {
+    std::vector<int> clients;
+    for (std::size_t i = 0; i < count; ++i) {
+      int const client = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      EXPECT_EQ(connect(client, reinterpret_cast<struct sockaddr *>(&addr_), sizeof(addr_)), 0);
+      clients.push_back(client);
+    }
+
+    std::vector<std::size_t> accepted(fds_.size(), 0);
+    for (std::size_t i = 0; i < fds_.size(); ++i) {
+      for (int fd; (fd = accept4(fds_[i], nullptr, nullptr, SOCK_CLOEXEC)) >= 0;) {
+        ++accepted[i];
+        close(fd);
+      }
+      EXPECT_EQ(errno, EAGAIN);
+    }
+
+    for (int client : clients) {
+      close(client);
+    }
+    return accepted;
+  }
+
+private:
+  struct sockaddr_in addr_ = {};
+  std::vector<int> fds_;
+};
+
+} // namespace
+
+TEST(ReuseportSteering, PicksByWeight)
+{
+  ReuseportSteering const steering({1, 0, 3});
+
+  EXPECT_EQ(pick(steering, 0), 0u);
+  EXPECT_EQ(pick(steering, 0x3fffffff), 0u);
+  EXPECT_EQ(pick(steering, 0x40000000), 2u);
+  EXPECT_EQ(pick(steering, 0xffffffff), 2u);
+}
+
+TEST(ReuseportSteering, ZeroWeightsAreUniform)
+{
+  ReuseportSteering const steering({0, 0, 0, 0});
+
+  EXPECT_EQ(pick(steering, 0x3fffffff), 0u);
+  EXPECT_EQ(pick(steering, 0x40000000), 1u);
+  EXPECT_EQ(pick(steering, 0x80000000), 2u);
+  EXPECT_EQ(pick(steering, 0xffffffff), 3u);
+}
+
+TEST(ReuseportSteering, RejectsInvalidWeights)
+{
+  EXPECT_THROW(ReuseportSteering({}), std::invalid_argument);
+  EXPECT_THROW(ReuseportSteering({1, -1}), std::invalid_argument);
+  EXPECT_THROW(ReuseportSteering(std::vector<double>(BPF_MAXINSNS, 1)), std::invalid_argument);
+}
+
+TEST(ReuseportSteering, SteersConnections)
+{
+  ReuseportGroup group(2);
+
+  ReuseportSteering({0, 1}).attach(group.fd(0));
+  EXPECT_EQ(group.connect_and_count(20), (std::vector<std::size_t>{0, 20}));
+
+  // the program is shared by the group, whichever socket it is attached to
+  ReuseportSteering({1, 0}).attach(group.fd(1));
+  EXPECT_EQ(group.connect_and_count(20), (std::vector<std::size_t>{20, 0}));
+}
@@ -5,6 +5,7 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <string.h>
 #include <thread>
 namespace util {
 namespace {
@@ -45,30 +46,50 @@ void TDigest::merge(const TDigest &other)
 
 double TDigest::estimate_value_at_quantile(double q) const
 {
-  if (centroid_count_ == 0) {
-    return 0.0;
-  }
+  double value;
+  estimate_values_at_quantiles(&q, &value, 1);
+  return value;
+}
 
-  if (q >= 1.0) {
-    return max_;
-  }
-  if (q <= 0.0) {
-    return min_;
-  }
+void TDigest::estimate_values_at_quantiles(const double *quantiles, double *values, u32 count) const
+{
+  // Centroids are visited once for all quantiles, from the last one, as
+  // quantiles of interest are usually high: |pos| only moves backwards, and
+  // |t| is the total weight of the centroids before it.
+  u32 pos = centroid_count_;
+  double t = value_count_ * 1.0;
+
+  for (u32 i = count; i-- > 0;) {
+    const double q = quantiles[i];
+    assert(i == 0 || quantiles[i - 1] <= q);
+
+    if (centroid_count_ == 0) {
+      values[i] = 0.0;
+      continue;
+    }
+
+    if (q >= 1.0) {
+      values[i] = max_;
+      continue;
+    }
+    if (q <= 0.0) {
+      values[i] = min_;
+      continue;
+    }
 
-  const double rank = q * value_count_;
-  double t = 0.0;
-  u32 pos = 0;
-
-  t = value_count_ * 1.0;
-  pos = centroid_count_;
-  for (u32 i = 0; i < centroid_count_; i++) {
-    pos--;
-    t -= centroids_[pos].weight;
-    if (rank >= t) {
-      break;
+    // find the last centroid that starts at or before |rank|
+    const double rank = q * value_count_;
+    while (pos > 0 && rank < t) {
+      pos--;
+      t -= centroids_[pos].weight;
     }
+
+    values[i] = interpolate(pos, rank, t);
   }
+}
+
+double TDigest::interpolate(u32 pos, double rank, double t) const
+{
   double delta = 0;
   double min = min_;
   double max = max_;
@@ -116,8 +137,7 @@ void TDigestMerger::merge_from_values(TDigest &tdigest, double *values, u32 valu
   }
   assert(value_count <= TDIGEST_VALUE_BUFFER_SIZE);
 
-  // TODO: use double_radix_sort.
-  std::sort(values, (values + value_count));
+  sort_values(values, value_count);
 
   tdigest.min_ = (tdigest.value_count_ == 0) ? *values : (std::min(tdigest.min_, *values));
   tdigest.max_ =
@@ -198,6 +218,61 @@ void TDigestMerger::merge_from_values(TDigest &tdigest, double *values, u32 valu
   tdigest.centroid_count_ = next - merging_buffer_;
 }
 
+void TDigestMerger::sort_values(double *values, u32 value_count)
+{
+  if (value_count < TDIGEST_RADIX_SORT_MIN) {
+    std::sort(values, values + value_count);
+    return;
+  }
+
+  // LSD radix sort, one byte at a time. Doubles are mapped to integers that
+  // sort in the same order: negative values have all their bits flipped, and
+  // positive values only their sign bit.
+  u32 counts[sizeof(u64)][256] = {};
+
+  for (u32 i = 0; i < value_count; i++) {
+    u64 key;
+    memcpy(&key, &values[i], sizeof(key));
+    key = (key >> 63) ? ~key : (key | (u64{1} << 63));
+    sort_keys_[i] = key;
+    for (u32 byte = 0; byte < sizeof(u64); byte++) {
+      counts[byte][(key >> (byte * 8)) & 0xff]++;
+    }
+  }
+
+  u64 *src = sort_keys_;
+  u64 *dst = sort_buffer_;
+
+  for (u32 byte = 0; byte < sizeof(u64); byte++) {
+    const u32 shift = byte * 8;
+    u32 *count = counts[byte];
+
+    // values of a latency distribution share their sign and most of their
+    // exponent, so passes on the high bytes are usually skipped
+    if (count[(src[0] >> shift) & 0xff] == value_count) {
+      continue;
+    }
+
+    u32 offset = 0;
+    for (u32 digit = 0; digit < 256; digit++) {
+      const u32 digit_count = count[digit];
+      count[digit] = offset;
+      offset += digit_count;
+    }
+
+    for (u32 i = 0; i < value_count; i++) {
+      dst[count[(src[i] >> shift) & 0xff]++] = src[i];
+    }
+    std::swap(src, dst);
+  }
+
+  for (u32 i = 0; i < value_count; i++) {
+    u64 key = src[i];
+    key = (key >> 63) ? (key & ~(u64{1} << 63)) : ~key;
+    memcpy(&values[i], &key, sizeof(key));
+  }
+}
+
 void TDigestMerger::merge(TDigest &left, const TDigest &right)
 {
   if (right.value_count_ == 0) {
@@ -11,6 +11,8 @@ namespace util {
 
 #define TDIGEST_CENTROID_COUNT_MAX 100
 #define TDIGEST_VALUE_BUFFER_SIZE 500
+// Smaller value buffers are sorted with std::sort rather than radix sort.
+#define TDIGEST_RADIX_SORT_MIN 64
 
 class TDigestAccumulator;
 class TDigestMerger;
@@ -35,6 +37,11 @@ public:
   // Estimates the value at given quantile |q|
   double estimate_value_at_quantile(double q) const;
 
+  // Estimates the values at |count| quantiles in one pass over the centroids,
+  // storing them in |values|.
+  // |quantiles| must be sorted in ascending order.
+  void estimate_values_at_quantiles(const double *quantiles, double *values, u32 count) const;
+
   // Merges |values|.
   // No-op if |value_count| == 0
   void merge_from_values(double *values, u32 value_count);
@@ -47,6 +54,10 @@ private:
   friend class TDigestAccumulator;
   friend class TDigestMerger;
 
+  // Interpolates the value at |rank| within the centroid at |pos|, whose
+  // preceding centroids weigh |t| in total.
+  double interpolate(u32 pos, double rank, double t) const;
+
   // Total number of values that this tdigest object has consumed so far.
   size_t value_count_ = 0;
 
@@ -131,8 +142,15 @@ public:
 private:
   using Centroid = TDigest::Centroid;
 
+  // Sorts |values| in place.
+  void sort_values(double *values, u32 value_count);
+
   // Note additional 1 Centroid space for scratching during merging.
   Centroid merging_buffer_[TDIGEST_CENTROID_COUNT_MAX + 1];
+
+  // Radix sort keys, and the buffer they are scattered to on each pass.
+  u64 sort_keys_[TDIGEST_VALUE_BUFFER_SIZE];
+  u64 sort_buffer_[TDIGEST_VALUE_BUFFER_SIZE];
 };
 
 } // namespace util
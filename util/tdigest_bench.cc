@@ -0,0 +1,154 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+// Measures TDigest throughput and accuracy on latency distributions, and compares its accuracy with LogHistogram's. Values
+// are added in value buffers, digests of 30 time slots are merged like the reducer's sliding windows used to, and p90,
+// p95 and p99 are estimated one at a time and in a single batch. Errors are relative to the exact quantiles.
+//
+// Distributions are synthetic unless a file of recorded latencies, one value in milliseconds per line, is given.
+//
+// Usage: tdigest_bench [n_values] [latencies_file]
+
+#include <util/log_histogram.h>
+#include <util/stop_watch.h>
+#include <util/tdigest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr u32 n_slots = 30;
+constexpr double quantiles[] = {0.90, 0.95, 0.99};
+constexpr u32 n_quantiles = sizeof(quantiles) / sizeof(quantiles[0]);
+
+/* keeps the optimizer from dropping computations whose results are not used */
+volatile double sink;
+
+std::vector<double> generate(u64 n_values, std::function<double(std::mt19937_64 &)> const &sample)
+{
+  std::mt19937_64 rng(42);
+  std::vector<double> values(n_values);
+  for (auto &value : values) {
+    value = sample(rng);
+  }
+  return values;
+}
+
+double exact_quantile(std::vector<double> const &sorted, double q)
+{
+  return sorted[std::min<std::size_t>(sorted.size() - 1, std::ceil(q * sorted.size()) - 1)];
+}
+
+double relative_error(double estimate, double exact)
+{
+  return exact == 0 ? std::abs(estimate) : std::abs(estimate - exact) / exact;
+}
+
+void run(std::string const &name, std::vector<double> const &values)
+{
+  std::cout << name << ", " << values.size() << " values" << std::endl;
+  if (values.size() < n_slots) {
+    std::cout << "  not enough values" << std::endl;
+    return;
+  }
+
+  /* one digest per time slot, filled through value buffers */
+  std::vector<util::TDigest> slots(n_slots);
+  std::size_t const slot_size = values.size() / n_slots;
+  StopWatch<> watch;
+  for (u32 slot = 0; slot < n_slots; ++slot) {
+    util::TDigestAccumulator accumulator(slots[slot]);
+    for (std::size_t i = slot * slot_size; i < (slot + 1) * slot_size; ++i) {
+      accumulator.add(values[i]);
+    }
+    accumulator.flush();
+  }
+  double const add_ns = watch.elapsed_ns();
+  std::cout << "  add:     " << add_ns / (slot_size * n_slots) << " ns/value" << std::endl;
+
+  /* merge the window, repeatedly so that the time is measurable */
+  constexpr u32 merge_rounds = 1000;
+  util::TDigest window;
+  watch.reset();
+  for (u32 round = 0; round < merge_rounds; ++round) {
+    window = util::TDigest();
+    for (auto const &slot : slots) {
+      window.merge(slot);
+    }
+  }
+  double const merge_ns = watch.elapsed_ns();
+  std::cout << "  merge:   " << merge_ns / (merge_rounds * n_slots) << " ns/digest" << std::endl;
+
+  constexpr u32 estimate_rounds = 1'000'000;
+  watch.reset();
+  for (u32 round = 0; round < estimate_rounds; ++round) {
+    for (double q : quantiles) {
+      sink = window.estimate_value_at_quantile(q);
+    }
+  }
+  double const single_ns = watch.elapsed_ns();
+
+  double estimates[n_quantiles];
+  watch.reset();
+  for (u32 round = 0; round < estimate_rounds; ++round) {
+    window.estimate_values_at_quantiles(quantiles, estimates, n_quantiles);
+    sink = estimates[0];
+  }
+  double const batched_ns = watch.elapsed_ns();
+  std::cout << "  p90/p95/p99: " << single_ns / estimate_rounds << " ns one at a time, " << batched_ns / estimate_rounds
+            << " ns batched" << std::endl;
+
+  /* LogHistogram buckets latencies in microseconds, like LatencyAccumulator does */
+  util::LogHistogram histogram;
+  for (std::size_t i = 0; i < slot_size * n_slots; ++i) {
+    histogram.add(values[i] > 0 ? std::llround(values[i] * 1000) : 0);
+  }
+
+  std::vector<double> sorted(values.begin(), values.begin() + slot_size * n_slots);
+  std::sort(sorted.begin(), sorted.end());
+  for (u32 i = 0; i < n_quantiles; ++i) {
+    double const exact = exact_quantile(sorted, quantiles[i]);
+    std::cout << "  p" << quantiles[i] * 100 << " = " << exact << ": tdigest error "
+              << relative_error(estimates[i], exact) * 100 << "%, log_histogram error "
+              << relative_error(histogram.estimate_value_at_quantile(quantiles[i]) / 1000, exact) * 100 << "%"
+              << std::endl;
+  }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  u64 const n_values = argc > 1 ? std::atoll(argv[1]) : 3'000'000;
+
+  if (argc > 2) {
+    std::ifstream file(argv[2]);
+    if (!file) {
+      std::cerr << "cannot open " << argv[2] << std::endl;
+      return 1;
+    }
+    std::vector<double> values;
+    for (double value; file >> value;) {
+      values.push_back(value);
+    }
+    run(argv[2], values);
+    return 0;
+  }
+
+  /* request latencies in milliseconds: a long tail, a cache with a fast and a slow mode, and round trip times */
+  run("lognormal", generate(n_values, [](auto &rng) { return std::lognormal_distribution<double>(std::log(20.0), 1.0)(rng); }));
+  run("bimodal", generate(n_values, [](auto &rng) {
+        return std::bernoulli_distribution(0.9)(rng) ? std::normal_distribution<double>(0.5, 0.1)(rng)
+                                                     : std::normal_distribution<double>(50, 10)(rng);
+      }));
+  run("uniform", generate(n_values, [](auto &rng) { return std::uniform_real_distribution<double>(0.1, 2.0)(rng); }));
+  return 0;
+}
@@ -193,5 +193,49 @@ TEST(TDigestTest, TwoLargeTDigiests)
     EXPECT_EQ(digest.estimate_value_at_quantile(0.999), 100);
   */
 }
+
+TEST(TDigestTest, SortsLargeBuffers)
+{
+  TDigest digest;
+
+  // more values than TDIGEST_RADIX_SORT_MIN, in an order that std::sort and
+  // radix sort must agree on, including negative values and zeroes
+  double values[TDIGEST_VALUE_BUFFER_SIZE];
+  for (u32 i = 0; i < TDIGEST_VALUE_BUFFER_SIZE; ++i) {
+    values[i] = ((i * 7919) % TDIGEST_VALUE_BUFFER_SIZE) * 0.5 - 100.0;
+  }
+  digest.merge_from_values(values, TDIGEST_VALUE_BUFFER_SIZE);
+
+  EXPECT_EQ(digest.value_count(), TDIGEST_VALUE_BUFFER_SIZE);
+  EXPECT_EQ(digest.min(), -100);
+  EXPECT_EQ(digest.max(), 149.5);
+  EXPECT_NEAR(digest.estimate_value_at_quantile(0.5), 25, 1);
+}
+
+TEST(TDigestTest, BatchedQuantiles)
+{
+  TDigest digest;
+  TDigestAccumulator accumulator(digest);
+
+  for (int i = 1; i <= 1000; ++i) {
+    accumulator.add(static_cast<double>((i * 37) % 1000));
+  }
+  accumulator.flush();
+
+  const double quantiles[] = {0.0, 0.001, 0.01, 0.5, 0.5, 0.9, 0.95, 0.99, 0.999, 1.0};
+  constexpr u32 count = sizeof(quantiles) / sizeof(quantiles[0]);
+  double values[count];
+  digest.estimate_values_at_quantiles(quantiles, values, count);
+
+  for (u32 i = 0; i < count; ++i) {
+    EXPECT_EQ(values[i], digest.estimate_value_at_quantile(quantiles[i])) << quantiles[i];
+  }
+
+  TDigest empty;
+  empty.estimate_values_at_quantiles(quantiles, values, count);
+  for (u32 i = 0; i < count; ++i) {
+    EXPECT_EQ(values[i], 0.0);
+  }
+}
 } // namespace
 } // namespace util
@@ -0,0 +1,156 @@
+// Copyright The OpenTelemetry Authors
+// SPDX-License-Identifier: Apache-2.0
+
+// for ZSTD_d_refMultipleDDicts, zstd is linked statically
+#define ZSTD_STATIC_LINKING_ONLY
+
+#include "zstd_decompressor.h"
+
+#include <util/file_ops.h>
+
+#include <zdict.h>
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+void check_zstd_error(size_t code, char const *what)
+{
+  if (ZSTD_isError(code)) {
+    throw std::runtime_error(std::string("ZstdDecompressor: ") + what + ": " + ZSTD_getErrorName(code));
+  }
+}
+
+} // namespace
+
+void ZstdDictionaries::load(char const *path)
+{
+  auto const dictionary = read_file_as_string(path);
+  if (!dictionary) {
+    throw std::runtime_error(std::string("failed to read Zstandard dictionary at ") + path);
+  }
+
+  add(*dictionary);
+}
+
+void ZstdDictionaries::add(std::string_view dictionary)
+{
+  u32 const id = ZDICT_getDictID(dictionary.data(), dictionary.size());
+  if (id == 0) {
+    throw std::runtime_error("not a Zstandard dictionary");
+  }
+
+  pod_unique_ptr<ZSTD_DDict, size_t, ZSTD_freeDDict> ddict(ZSTD_createDDict(dictionary.data(), dictionary.size()));
+  if (!ddict) {
+    throw std::runtime_error("failed to load Zstandard dictionary");
+  }
+
+  dictionaries_.insert_or_assign(id, std::move(ddict));
+}
+
+ZstdContextPool::ZstdContextPool(ZstdDecompressionOptions options, std::size_t max_idle)
+    : options_(std::move(options)), max_idle_(max_idle)
+{}
+
+ZstdContextPool::Context ZstdContextPool::acquire()
+{
+  if (!idle_.empty()) {
+    Context context = std::move(idle_.back());
+    idle_.pop_back();
+    return context;
+  }
+
+  Context context(ZSTD_createDCtx());
+  if (!context) {
+    throw std::runtime_error("ZstdDecompressor: failed to create a context");
+  }
+
+  if (options_.window_log_max) {
+    check_zstd_error(
+        ZSTD_DCtx_setParameter(context.get(), ZSTD_d_windowLogMax, options_.window_log_max), "invalid window log max");
+  }
+
+  if (options_.dictionaries && !options_.dictionaries->empty()) {
+    check_zstd_error(
+        ZSTD_DCtx_setParameter(context.get(), ZSTD_d_refMultipleDDicts, ZSTD_rmd_refMultipleDDicts),
+        "failed to enable multiple dictionaries");
+    options_.dictionaries->for_each([&](u32, ZSTD_DDict const *ddict) {
+      check_zstd_error(ZSTD_DCtx_refDDict(context.get(), ddict), "failed to reference dictionary");
+    });
+  }
+
+  return context;
+}
+
+void ZstdContextPool::release(Context context)
+{
+  if (idle_.size() >= max_idle_) {
+    return;
+  }
+
+  // keeps parameters and dictionaries, drops the stream's state
+  if (ZSTD_isError(ZSTD_DCtx_reset(context.get(), ZSTD_reset_session_only))) {
+    return;
+  }
+
+  idle_.push_back(std::move(context));
+}
+
+ZstdDecompressor::ZstdDecompressor(size_t buf_capacity, ZstdContextPool &pool)
+    : pool_(pool), ctx_(pool.acquire()), output_buf_(buf_capacity)
+{}
+
+ZstdDecompressor::~ZstdDecompressor()
+{
+  pool_.release(std::move(ctx_));
+}
+
+size_t ZstdDecompressor::process(const u8 *data, size_t data_len, size_t *consumed_len)
+{
+  ZSTD_inBuffer input = {.src = data, .size = data_len, .pos = 0};
+  size_t res = 0;
+  size_t progress = 0;
+
+  do {
+    ZSTD_outBuffer output = {.dst = output_buf_.data() + tail_loc_, .size = output_buf_.size() - tail_loc_, .pos = 0};
+    size_t const input_pos = input.pos;
+
+    res = ZSTD_decompressStream(ctx_.get(), &output, &input);
+
+    tail_loc_ += output.pos;
+    progress = output.pos + (input.pos - input_pos);
+
+    // continue to decompress while Zstandard is making progress
+  } while (!ZSTD_isError(res) && progress > 0 && input.pos < input.size);
+
+  *consumed_len = input.pos;
+
+  return ZSTD_isError(res) ? res : 0;
+}
+
+void ZstdDecompressor::discard(size_t len)
+{
+  assert(tail_loc_ >= len);
+
+  if (tail_loc_ == len) {
+    tail_loc_ = 0;
+    return;
+  }
+
+  memmove(output_buf_.data(), output_buf_.data() + len, tail_loc_ - len);
+  tail_loc_ -= len;
+}
+
+bool ZstdDecompressor::is_frame(const u8 *data, size_t data_len)
+{
+  if (data_len < sizeof(u32)) {
+    return false;
+  }
+
+  u32 magic;
+  memcpy(&magic, data, sizeof(magic));
+  return magic == ZSTD_MAGICNUMBER;
+}
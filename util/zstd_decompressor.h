@@ -0,0 +1,116 @@
+/*
+ * Copyright The OpenTelemetry Authors
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <platform/platform.h>
+#include <util/raii.h>
+
+#include <absl/container/flat_hash_map.h>
+
+#include <zstd.h>
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Decompression dictionaries, by dictionary id.
+//
+// Dictionaries are immutable once loaded, so they can be shared by the
+// decompression contexts of all threads.
+class ZstdDictionaries {
+public:
+  // Loads the dictionary file at |path|. Throws if it can't be read or is not
+  // a Zstandard dictionary.
+  void load(char const *path);
+
+  // Adds |dictionary|, the contents of a dictionary file. Throws if it is not
+  // a Zstandard dictionary.
+  void add(std::string_view dictionary);
+
+  bool empty() const { return dictionaries_.empty(); }
+
+  template <typename Fn> void for_each(Fn &&fn) const
+  {
+    for (auto const &[id, dictionary] : dictionaries_) {
+      fn(id, dictionary.get());
+    }
+  }
+
+private:
+  absl::flat_hash_map<u32, pod_unique_ptr<ZSTD_DDict, size_t, ZSTD_freeDDict>> dictionaries_;
+};
+
+struct ZstdDecompressionOptions {
+  std::shared_ptr<ZstdDictionaries const> dictionaries;
+  // frames whose window is larger than 2^window_log_max are rejected, 0 for Zstandard's default limit
+  u32 window_log_max = 0;
+};
+
+// Keeps the decompression contexts of closed streams for reuse by new ones,
+// so that connections coming and going don't allocate and free windows.
+//
+// Contexts reference all dictionaries, the one a stream needs is picked by the
+// id in its frame header.
+//
+// Not thread-safe: meant to be used by a single thread.
+class ZstdContextPool {
+public:
+  using Context = pod_unique_ptr<ZSTD_DCtx, size_t, ZSTD_freeDCtx>;
+
+  explicit ZstdContextPool(ZstdDecompressionOptions options, std::size_t max_idle = DEFAULT_MAX_IDLE);
+
+  // Returns a context ready to decompress a new frame. Throws if a context
+  // can't be created.
+  Context acquire();
+
+  // Returns a context that's no longer in use to the pool.
+  void release(Context context);
+
+  std::size_t idle() const { return idle_.size(); }
+
+  static constexpr std::size_t DEFAULT_MAX_IDLE = 16;
+
+private:
+  ZstdDecompressionOptions const options_;
+  std::size_t const max_idle_;
+  std::vector<Context> idle_;
+};
+
+// Decompresses a Zstandard stream, with the same interface as Lz4Decompressor.
+class ZstdDecompressor {
+public:
+  // Takes a context from |pool| and returns it when destroyed.
+  ZstdDecompressor(size_t buf_capacity, ZstdContextPool &pool);
+  ~ZstdDecompressor();
+
+  ZstdDecompressor(ZstdDecompressor const &) = delete;
+  ZstdDecompressor &operator=(ZstdDecompressor const &) = delete;
+
+  const u8 *output_buf() const { return output_buf_.data(); }
+  size_t output_buf_size() const { return tail_loc_; }
+
+  // Decompresses |data| of size |data_len|.
+  // The # of bytes that have been decompressed is stored in |consumed_len|.
+  //
+  // Returns Zstandard error, if an error happened, 0 otherwise.
+  size_t process(const u8 *data, size_t data_len, size_t *consumed_len);
+
+  // Discards |len| bytes of data in output_buf.
+  void discard(size_t len);
+
+  static char const *error_name(size_t error) { return ZSTD_getErrorName(error); }
+
+  // Tells whether |data| starts with the magic number of a Zstandard frame.
+  // Needs at least 4 bytes.
+  static bool is_frame(const u8 *data, size_t data_len);
+
+private:
+  ZstdContextPool &pool_;
+  ZstdContextPool::Context ctx_;
+
+  std::vector<u8> output_buf_;
+  size_t tail_loc_ = 0;
+};